@@ -8,9 +8,12 @@
 #include <prom.h>
 #include <promhttp.h>
 #include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h> // Para sleep
 /**
  * @brief Tamaño del buffer
@@ -18,6 +21,19 @@
  */
 #define BUFFER_SIZE 256
 
+/**
+ * @brief Funciones de recolección update_* cuya duración y errores se exponen como métricas.
+ */
+typedef enum
+{
+    COLLECTION_CPU,        /**< update_cpu_gauge */
+    COLLECTION_MEMORY,     /**< update_memory_gauge */
+    COLLECTION_DISKSTATS,  /**< update_diskstats_gauge */
+    COLLECTION_NETWORK,    /**< update_network_gauge */
+    COLLECTION_PROCESSES,  /**< update_running_processes_add_context_gauge */
+    COLLECTION_COUNT       /**< Cantidad de funciones de recolección */
+} collection_t;
+
 /**
  * @brief Actualiza la métrica de uso de CPU.
  *
@@ -39,8 +39,8 @@ typedef struct
  */
 typedef struct
 {
-    unsigned long rx_bytes; /**< Bytes recibidos */
-    unsigned long tx_bytes; /**< Bytes transmitidos */
+    unsigned long long rx_bytes; /**< Bytes recibidos */
+    unsigned long long tx_bytes; /**< Bytes transmitidos */
 } network_stats_t;
 
 /**
@@ -94,8 +94,9 @@ int get_network_traffic(network_stats_t* network_stats);
  * las variables running_processes y context_switches.
  *
  * @param running_processes Puntero a la variable para almacenar el conteo de procesos.
- * @param context_switches Puntero a la variable para almacenar el conteo de cambios de contexto.
+ * @param context_switches Puntero a la variable para almacenar el conteo de cambios de contexto. Es de 64 bits
+ * porque el contador acumulado desde el arranque supera INT_MAX en pocas horas.
  *
  * @return 0 en caso de éxito, -1 en caso de error.
  */
-int get_running_processes_and_context_switches(int* running_processes, int* context_switches);
+int get_running_processes_and_context_switches(int* running_processes, unsigned long long* context_switches);
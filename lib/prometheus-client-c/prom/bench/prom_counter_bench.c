@@ -0,0 +1,108 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures increments of one counter series from 1 to 64 threads at once, for a counter from prom_counter_new, one
+ * from prom_counter_new_sharded and one from prom_counter_new_int. Every thread adds through a handle from
+ * prom_counter_labels, so only the add itself is timed, and the total of each counter is checked at the end.
+ *
+ * Contention only shows with as many CPUs as threads; on fewer CPUs the threads take turns and both counters look
+ * alike.
+ *
+ * Usage: prom_counter_bench [increments per thread]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "prom.h"
+#include "prom_metric_sample_i.h"
+
+typedef struct bench_job {
+  prom_metric_sample_t *sample;
+  long increments;
+  bool integer;
+  pthread_barrier_t *barrier;
+} bench_job_t;
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker(void *data) {
+  bench_job_t *job = (bench_job_t *)data;
+  pthread_barrier_wait(job->barrier);
+  if (job->integer) {
+    for (long i = 0; i < job->increments; i++) prom_metric_sample_add_int(job->sample, 1);
+  } else {
+    for (long i = 0; i < job->increments; i++) prom_metric_sample_add(job->sample, 1.0);
+  }
+  return NULL;
+}
+
+// Returns the nanoseconds per increment across all threads, or a negative value if the total is wrong
+static double bench_run(prom_counter_t *counter, bool integer, int threads, long increments) {
+  const char *values[] = {"GET"};
+  prom_metric_sample_t *sample = prom_counter_labels(counter, values);
+  double before = prom_metric_sample_value(sample);
+
+  pthread_t workers[64];
+  pthread_barrier_t barrier;
+  pthread_barrier_init(&barrier, NULL, threads + 1);
+  bench_job_t job = {sample, increments, integer, &barrier};
+  for (int t = 0; t < threads; t++) pthread_create(&workers[t], NULL, bench_worker, &job);
+
+  pthread_barrier_wait(&barrier);
+  double start = bench_now();
+  for (int t = 0; t < threads; t++) pthread_join(workers[t], NULL);
+  double elapsed = bench_now() - start;
+  pthread_barrier_destroy(&barrier);
+
+  if (prom_metric_sample_value(sample) - before != (double)threads * increments) return -1.0;
+  return elapsed / ((double)threads * increments) * 1e9;
+}
+
+int main(int argc, char **argv) {
+  long increments = argc > 1 ? atol(argv[1]) : 1000000;
+  if (increments < 1) increments = 1;
+
+  const char *keys[] = {"method"};
+  prom_counter_t *plain = prom_counter_new("bench_requests_total", "Requests.", 1, keys);
+  prom_counter_t *sharded = prom_counter_new_sharded("bench_sharded_requests_total", "Requests.", 1, keys);
+  prom_counter_t *integer = prom_counter_new_int("bench_integer_requests_total", "Requests.", 1, keys);
+
+  printf("%8s %14s %14s %14s\n", "threads", "plain ns/inc", "sharded ns/inc", "integer ns/inc");
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    double plain_ns = bench_run(plain, false, threads, increments);
+    double sharded_ns = bench_run(sharded, false, threads, increments);
+    double integer_ns = bench_run(integer, true, threads, increments);
+    if (plain_ns < 0 || sharded_ns < 0 || integer_ns < 0) {
+      fprintf(stderr, "lost increments with %d threads\n", threads);
+      return 1;
+    }
+    printf("%8d %14.2f %14.2f %14.2f\n", threads, plain_ns, sharded_ns, integer_ns);
+  }
+
+  prom_counter_destroy(plain);
+  prom_counter_destroy(sharded);
+  prom_counter_destroy(integer);
+  return 0;
+}
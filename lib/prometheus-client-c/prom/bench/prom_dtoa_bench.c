@@ -0,0 +1,89 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Compares prom_dtoa with the sprintf("%.17g") call the formatter used to make for every sample value.
+ *
+ * The values mimic a host agent: byte and tick counts, which are whole numbers, and seconds and ratios, which are not.
+ *
+ * Usage: prom_dtoa_bench [samples] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom_dtoa_i.h"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_populate(double *values, int samples) {
+  srand(42);
+  for (int i = 0; i < samples; i++) {
+    switch (i % 4) {
+      case 0:
+        values[i] = 4096.0 * (rand() % 1000000);
+        break;
+      case 1:
+        values[i] = (double)(rand() % 100000);
+        break;
+      case 2:
+        values[i] = (rand() % 10000000) / 100.0;
+        break;
+      default:
+        values[i] = (double)rand() / RAND_MAX;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int samples = argc > 1 ? atoi(argv[1]) : 100000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 20;
+  if (samples < 1) samples = 1;
+  if (iterations < 1) iterations = 1;
+
+  double *values = malloc(samples * sizeof(double));
+  bench_populate(values, samples);
+
+  char buffer[PROM_DTOA_BUFFER_SIZE + 20];
+  size_t bytes = 0;
+
+  double start = bench_now();
+  for (int n = 0; n < iterations; n++) {
+    for (int i = 0; i < samples; i++) bytes += sprintf(buffer, "%.17g", values[i]);
+  }
+  double per_page = (bench_now() - start) / iterations;
+  printf("%-8s %10.1f us/page %8.1f ns/value %10zu bytes/page\n", "sprintf", per_page * 1e6, per_page / samples * 1e9,
+         bytes / iterations);
+
+  bytes = 0;
+  start = bench_now();
+  for (int n = 0; n < iterations; n++) {
+    for (int i = 0; i < samples; i++) bytes += prom_dtoa(values[i], buffer);
+  }
+  per_page = (bench_now() - start) / iterations;
+  printf("%-8s %10.1f us/page %8.1f ns/value %10zu bytes/page\n", "dtoa", per_page * 1e6, per_page / samples * 1e9,
+         bytes / iterations);
+
+  free(values);
+  return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Measures the time to render a registry and the size of the resulting page for each exposition format.
+ *
+ * The registry mimics a host agent: per-CPU, per-device and per-process series with labels, plus a request latency
+ * histogram.
+ *
+ * Usage: prom_exposition_bench [scale] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom.h"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_populate(prom_collector_registry_t *registry, int scale) {
+  const char *cpu_keys[] = {"cpu", "mode"};
+  const char *modes[] = {"user", "nice", "system", "idle", "iowait", "irq", "softirq", "steal"};
+  prom_counter_t *cpu = prom_counter_new("node_cpu_seconds_total", "Seconds the CPUs spent in each mode.", 2, cpu_keys);
+
+  const char *disk_keys[] = {"device"};
+  prom_gauge_t *reads = prom_gauge_new("node_disk_reads_completed_total", "Reads completed.", 1, disk_keys);
+
+  const char *proc_keys[] = {"pid", "comm"};
+  prom_gauge_t *rss = prom_gauge_new("process_resident_memory_bytes_by_pid", "Resident memory by process.", 2,
+                                     proc_keys);
+
+  const char *handler_keys[] = {"handler"};
+  prom_histogram_t *latency =
+      prom_histogram_new("http_request_duration_seconds", "Request latency.",
+                         prom_histogram_buckets_exponential(0.001, 2, 12), 1, handler_keys);
+
+  char a[32];
+  char b[32];
+  for (int i = 0; i < 16 * scale; i++) {
+    snprintf(a, sizeof(a), "%d", i);
+    for (int m = 0; m < 8; m++) {
+      const char *values[] = {a, modes[m]};
+      prom_counter_add(cpu, 1000.0 * i + m + 0.25, values);
+    }
+  }
+  for (int i = 0; i < 8 * scale; i++) {
+    snprintf(a, sizeof(a), "nvme%dn1", i);
+    const char *values[] = {a};
+    prom_gauge_set(reads, 123456.0 * (i + 1), values);
+  }
+  for (int i = 0; i < 64 * scale; i++) {
+    snprintf(a, sizeof(a), "%d", 1000 + i * 7);
+    snprintf(b, sizeof(b), "worker-%d", i % 13);
+    const char *values[] = {a, b};
+    prom_gauge_set(rss, 4096.0 * (i * 31 % 977), values);
+  }
+  for (int i = 0; i < scale; i++) {
+    snprintf(a, sizeof(a), "/api/v%d", i);
+    const char *values[] = {a};
+    for (int o = 0; o < 100; o++) prom_histogram_observe(latency, 0.0005 * (o * o % 97), values);
+  }
+
+  prom_collector_t *collector = prom_collector_new("bench");
+  prom_collector_add_metric(collector, cpu);
+  prom_collector_add_metric(collector, reads);
+  prom_collector_add_metric(collector, rss);
+  prom_collector_add_metric(collector, latency);
+  prom_collector_registry_register_collector(registry, collector);
+}
+
+int main(int argc, char **argv) {
+  int scale = argc > 1 ? atoi(argv[1]) : 16;
+  int iterations = argc > 2 ? atoi(argv[2]) : 50;
+  if (scale < 1) scale = 1;
+  if (iterations < 1) iterations = 1;
+
+  const char *names[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT] = {"text", "protobuf", "openmetrics"};
+
+  prom_collector_registry_t *registry = prom_collector_registry_new("bench");
+  bench_populate(registry, scale);
+
+  printf("%d iterations per row\n\n", iterations);
+  printf("%-12s %12s %10s %12s\n", "format", "bytes", "us/page", "MB/s");
+  for (int format = 0; format < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; format++) {
+    size_t len = 0;
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+      const char *page = prom_collector_registry_bridge_lease_format(registry, format, &len);
+      if (page == NULL) {
+        fprintf(stderr, "rendering failed\n");
+        return 1;
+      }
+      prom_collector_registry_bridge_return(registry, page);
+    }
+    double per_page = (bench_now() - start) / iterations;
+    printf("%-12s %12zu %10.1f %12.1f\n", names[format], len, per_page * 1e6, len / per_page / 1e6);
+  }
+
+  prom_collector_registry_destroy(registry);
+  return 0;
+}
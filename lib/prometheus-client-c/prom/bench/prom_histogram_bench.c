@@ -0,0 +1,126 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures prom_metric_sample_histogram_observe through a handle from prom_histogram_labels, for the 11 default buckets,
+ * for 64 exponential buckets and for native buckets at schema 3, from 1 to 8 threads observing the same series at once.
+ * Values are spread over all buckets with a fixed pseudo-random sequence so that bucket search branches cannot be
+ * learned.
+ *
+ * Usage: prom_histogram_bench [observations per thread]
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "prom.h"
+#include "prom_metric_sample_histogram_i.h"
+
+#define BENCH_VALUES 4096
+
+typedef struct bench_job {
+  prom_metric_sample_histogram_t *sample;
+  const double *values;
+  long observations;
+  pthread_barrier_t *barrier;
+} bench_job_t;
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker(void *data) {
+  bench_job_t *job = (bench_job_t *)data;
+  pthread_barrier_wait(job->barrier);
+  for (long i = 0; i < job->observations; i++) {
+    prom_metric_sample_histogram_observe(job->sample, job->values[i & (BENCH_VALUES - 1)]);
+  }
+  return NULL;
+}
+
+static uint64_t bench_total(prom_metric_sample_histogram_t *sample, size_t bucket_count) {
+  uint64_t cumulative[bucket_count + 1];
+  double sum = 0.0;
+  prom_metric_sample_histogram_collect(sample, cumulative, &sum);
+  return cumulative[bucket_count];
+}
+
+// Returns the nanoseconds per observation across all threads, or a negative value if observations were lost
+static double bench_run(prom_histogram_t *histogram, size_t bucket_count, const double *values, int threads,
+                        long observations) {
+  prom_metric_sample_histogram_t *sample = prom_histogram_labels(histogram, NULL);
+  uint64_t before = bench_total(sample, bucket_count);
+
+  pthread_t workers[8];
+  pthread_barrier_t barrier;
+  pthread_barrier_init(&barrier, NULL, threads + 1);
+  bench_job_t job = {sample, values, observations, &barrier};
+  for (int t = 0; t < threads; t++) pthread_create(&workers[t], NULL, bench_worker, &job);
+
+  pthread_barrier_wait(&barrier);
+  double start = bench_now();
+  for (int t = 0; t < threads; t++) pthread_join(workers[t], NULL);
+  double elapsed = bench_now() - start;
+  pthread_barrier_destroy(&barrier);
+
+  if (bench_total(sample, bucket_count) - before != (uint64_t)threads * observations) return -1.0;
+  return elapsed / ((double)threads * observations) * 1e9;
+}
+
+int main(int argc, char **argv) {
+  long observations = argc > 1 ? atol(argv[1]) : 1000000;
+  if (observations < 1) observations = 1;
+
+  // Latencies from 100us to about 60s spread evenly over the exponential buckets, so every bucket of both layouts is hit
+  double *values = (double *)malloc(sizeof(double) * BENCH_VALUES);
+  uint64_t state = 88172645463325252ULL;
+  for (int i = 0; i < BENCH_VALUES; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    double value = 0.0001 * (1.0 + (double)(state >> 40) / (double)(1 << 24) * 0.25);
+    for (uint64_t step = state % 60; step > 0; step--) value *= 1.25;
+    values[i] = value;
+  }
+
+  prom_histogram_t *fixed = prom_histogram_new("bench_default_seconds", "Default buckets.", NULL, 0, NULL);
+  prom_histogram_t *wide = prom_histogram_new("bench_wide_seconds", "64 buckets.",
+                                              prom_histogram_buckets_exponential(0.0001, 1.25, 64), 0, NULL);
+  prom_histogram_t *native = prom_histogram_new_native("bench_native_seconds", "Native buckets.", 1.1, 160, 0, NULL);
+
+  printf("%8s %16s %16s %16s\n", "threads", "11 buckets ns", "64 buckets ns", "native ns");
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    double fixed_ns = bench_run(fixed, 11, values, threads, observations);
+    double wide_ns = bench_run(wide, 64, values, threads, observations);
+    double native_ns = bench_run(native, 0, values, threads, observations);
+    if (fixed_ns < 0 || wide_ns < 0 || native_ns < 0) {
+      fprintf(stderr, "lost observations with %d threads\n", threads);
+      return 1;
+    }
+    printf("%8d %16.2f %16.2f %16.2f\n", threads, fixed_ns, wide_ns, native_ns);
+  }
+
+  prom_histogram_destroy(fixed);
+  prom_histogram_destroy(wide);
+  prom_histogram_destroy(native);
+  free(values);
+  return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures prom_map_set, prom_map_get (hits and misses) and prom_map_delete at map sizes from 1k to 1M keys. Keys look
+ * like the label sets prom_metric_sample_from_labels stores, so their length and shape match real use.
+ *
+ * Then times every single prom_map_set while a map grows to the largest size, since a set that has to grow the table
+ * is what stalls writers and scrapes; the maximum shows whether any one insert pays for a whole rehash.
+ *
+ * Usage: prom_map_bench [largest size] [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom_map_i.h"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char **bench_keys(size_t count, const char *format) {
+  char **keys = malloc(count * sizeof(char *));
+  char key[128];
+  for (size_t i = 0; i < count; i++) {
+    snprintf(key, sizeof(key), format, i % 64, i);
+    keys[i] = strdup(key);
+  }
+  return keys;
+}
+
+static void bench_free_keys(char **keys, size_t count) {
+  for (size_t i = 0; i < count; i++) free(keys[i]);
+  free(keys);
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Visits keys in a scrambled order so lookups do not follow insertion order
+static size_t bench_index(size_t i, size_t count) { return (i * 2654435761u) % count; }
+
+int main(int argc, char **argv) {
+  size_t largest = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 3;
+  if (largest < 1000) largest = 1000;
+  if (rounds < 1) rounds = 1;
+
+  printf("%10s %12s %12s %12s %12s\n", "keys", "set ns", "get ns", "miss ns", "delete ns");
+  for (size_t count = 1000; count <= largest; count *= 10) {
+    char **keys = bench_keys(count, "{\"cpu\",\"%zu\",\"device\",\"nvme%zun1\"}");
+    char **missing = bench_keys(count, "{\"cpu\",\"%zu\",\"device\",\"sda%zu\"}");
+    double set_s = 0, get_s = 0, miss_s = 0, delete_s = 0;
+    size_t found = 0;
+
+    for (int round = 0; round < rounds; round++) {
+      prom_map_t *map = prom_map_new();
+
+      double start = bench_now();
+      for (size_t i = 0; i < count; i++) prom_map_set(map, keys[i], keys[i]);
+      set_s += bench_now() - start;
+
+      start = bench_now();
+      for (size_t i = 0; i < count; i++) found += prom_map_get(map, keys[bench_index(i, count)]) != NULL;
+      get_s += bench_now() - start;
+
+      start = bench_now();
+      for (size_t i = 0; i < count; i++) found += prom_map_get(map, missing[bench_index(i, count)]) != NULL;
+      miss_s += bench_now() - start;
+
+      start = bench_now();
+      for (size_t i = 0; i < count; i++) prom_map_delete(map, keys[bench_index(i, count)]);
+      delete_s += bench_now() - start;
+
+      if (prom_map_size(map) != 0) {
+        fprintf(stderr, "map not empty after deleting every key\n");
+        return 1;
+      }
+      prom_map_destroy(map);
+    }
+    if (found != count * rounds) {
+      fprintf(stderr, "found %zu keys, expected %zu\n", found, count * rounds);
+      return 1;
+    }
+
+    double ops = (double)count * rounds;
+    printf("%10zu %12.1f %12.1f %12.1f %12.1f\n", count, set_s / ops * 1e9, get_s / ops * 1e9, miss_s / ops * 1e9,
+           delete_s / ops * 1e9);
+    bench_free_keys(keys, count);
+    bench_free_keys(missing, count);
+  }
+
+  char **keys = bench_keys(largest, "{\"cpu\",\"%zu\",\"device\",\"nvme%zun1\"}");
+  double *latencies = malloc(largest * sizeof(double));
+  prom_map_t *map = prom_map_new();
+  for (size_t i = 0; i < largest; i++) {
+    double start = bench_now();
+    prom_map_set(map, keys[i], keys[i]);
+    latencies[i] = bench_now() - start;
+  }
+  prom_map_destroy(map);
+  qsort(latencies, largest, sizeof(double), bench_compare_double);
+  printf("\nset latency growing to %zu keys: p50 %.0f ns, p99.9 %.0f ns, p99.99 %.0f ns, max %.0f ns\n", largest,
+         latencies[largest / 2] * 1e9, latencies[largest - largest / 1000] * 1e9,
+         latencies[largest - largest / 10000] * 1e9, latencies[largest - 1] * 1e9);
+  free(latencies);
+  bench_free_keys(keys, largest);
+  return 0;
+}
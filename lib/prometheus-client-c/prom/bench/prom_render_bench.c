@@ -0,0 +1,124 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures scrape latency of a registry with many collectors, rendered into one string and rendered in pieces by an
+ * increasing number of render threads. Every page in pieces is checked against the string.
+ *
+ * Usage: prom_render_bench [collectors] [series per collector] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "prom.h"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_populate(prom_collector_registry_t *registry, int collectors, int series) {
+  const char *keys[] = {"device", "mode"};
+  const char *modes[] = {"read", "write", "discard", "flush"};
+  char name[64];
+  char device[32];
+  for (int c = 0; c < collectors; c++) {
+    snprintf(name, sizeof(name), "bench_%d", c);
+    prom_collector_t *collector = prom_collector_new(name);
+    snprintf(name, sizeof(name), "node_bench_%d_operations_total", c);
+    prom_counter_t *counter = prom_counter_new(name, "Operations completed.", 2, keys);
+    for (int i = 0; i < series; i++) {
+      snprintf(device, sizeof(device), "dev%d", i / 4);
+      const char *values[] = {device, modes[i % 4]};
+      prom_counter_add(counter, 1234.5 * (i + 1) + c, values);
+    }
+    prom_collector_add_metric(collector, counter);
+    prom_collector_registry_register_collector(registry, collector);
+  }
+}
+
+int main(int argc, char **argv) {
+  int collectors = argc > 1 ? atoi(argv[1]) : 32;
+  int series = argc > 2 ? atoi(argv[2]) : 4096;
+  int iterations = argc > 3 ? atoi(argv[3]) : 20;
+  if (collectors < 1) collectors = 1;
+  if (series < 1) series = 1;
+  if (iterations < 1) iterations = 1;
+
+  prom_collector_registry_t *registry = prom_collector_registry_new("bench");
+  bench_populate(registry, collectors, series);
+
+  size_t len = 0;
+  double start = bench_now();
+  const char *page = NULL;
+  for (int i = 0; i < iterations; i++) {
+    if (page != NULL) prom_collector_registry_bridge_return(registry, page);
+    page = prom_collector_registry_bridge_lease(registry, &len);
+    if (page == NULL) {
+      fprintf(stderr, "rendering failed\n");
+      return 1;
+    }
+  }
+  double per_page = (bench_now() - start) / iterations;
+
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("%d collectors, %zu bytes, %ld cores, %d iterations per row\n\n", collectors, len, cores, iterations);
+  printf("%-24s %10s\n", "rendering", "us/page");
+  printf("%-24s %10.1f\n", "one string", per_page * 1e6);
+
+  for (size_t threads = 0; threads < (size_t)(cores > 1 ? cores : 2); threads = threads ? threads * 2 : 1) {
+    if (prom_collector_registry_set_render_threads(registry, threads)) {
+      fprintf(stderr, "starting render threads failed\n");
+      return 1;
+    }
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+      size_t count = 0;
+      size_t parts_len = 0;
+      const prom_collector_registry_part_t *parts =
+          prom_collector_registry_bridge_lease_parts(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, &count, &parts_len);
+      if (parts == NULL) {
+        fprintf(stderr, "rendering failed\n");
+        return 1;
+      }
+      if (i == 0) {
+        size_t offset = 0;
+        for (size_t p = 0; p < count; p++) {
+          if (offset + parts[p].len > len || memcmp(page + offset, parts[p].data, parts[p].len) != 0) break;
+          offset += parts[p].len;
+        }
+        if (offset != len || parts_len != len) {
+          fprintf(stderr, "the pieces differ from the page\n");
+          return 1;
+        }
+      }
+      prom_collector_registry_bridge_return_parts(registry, parts);
+    }
+    per_page = (bench_now() - start) / iterations;
+    char label[48];
+    snprintf(label, sizeof(label), "pieces, %zu threads", threads);
+    printf("%-24s %10.1f\n", label, per_page * 1e6);
+  }
+
+  prom_collector_registry_bridge_return(registry, page);
+  prom_collector_registry_destroy(registry);
+  return 0;
+}
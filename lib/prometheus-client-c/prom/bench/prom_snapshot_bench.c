@@ -0,0 +1,126 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures taking a snapshot of a registry against rendering it from the metrics. The snapshot is the only part that
+ * holds the metrics' locks, so its time is what updates of the metrics wait for. The rendered snapshot is checked
+ * against the page rendered from the metrics.
+ *
+ * Usage: prom_snapshot_bench [series] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom.h"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_populate(prom_collector_registry_t *registry, int series) {
+  const char *keys[] = {"device", "mode"};
+  const char *modes[] = {"read", "write", "discard", "flush"};
+  prom_counter_t *counter = prom_counter_new("node_bench_operations_total", "Operations completed.", 2, keys);
+  prom_gauge_t *gauge = prom_gauge_new("node_bench_queue_depth", "Requests queued.", 2, keys);
+
+  const char *latency_keys[] = {"device"};
+  prom_histogram_t *latency = prom_histogram_new("node_bench_latency_seconds", "Operation latency.",
+                                                 prom_histogram_buckets_exponential(0.0001, 4, 8), 1, latency_keys);
+
+  char device[32];
+  for (int i = 0; i < series; i++) {
+    snprintf(device, sizeof(device), "dev%d", i / 4);
+    const char *values[] = {device, modes[i % 4]};
+    prom_counter_add(counter, 1234.5 * (i + 1), values);
+    prom_gauge_set(gauge, i % 64, values);
+    if (i % 4 == 0) {
+      const char *latency_values[] = {device};
+      for (int j = 0; j < 16; j++) prom_histogram_observe(latency, 0.00005 * (j + 1) * (i % 97 + 1), latency_values);
+    }
+  }
+
+  prom_collector_t *collector = prom_collector_new("bench");
+  prom_collector_add_metric(collector, counter);
+  prom_collector_add_metric(collector, gauge);
+  prom_collector_add_metric(collector, latency);
+  prom_collector_registry_register_collector(registry, collector);
+}
+
+int main(int argc, char **argv) {
+  int series = argc > 1 ? atoi(argv[1]) : 65536;
+  int iterations = argc > 2 ? atoi(argv[2]) : 20;
+  if (series < 1) series = 1;
+  if (iterations < 1) iterations = 1;
+
+  prom_collector_registry_t *registry = prom_collector_registry_new("bench");
+  bench_populate(registry, series);
+  prom_collector_registry_snapshot_t *snapshot = prom_collector_registry_snapshot_new();
+
+  size_t len = 0;
+  double start = bench_now();
+  const char *page = NULL;
+  for (int i = 0; i < iterations; i++) {
+    if (page != NULL) prom_collector_registry_bridge_return(registry, page);
+    page = prom_collector_registry_bridge_lease(registry, &len);
+    if (page == NULL) {
+      fprintf(stderr, "rendering failed\n");
+      return 1;
+    }
+  }
+  double per_page = (bench_now() - start) / iterations;
+
+  double snapshot_time = 0.0;
+  double render_time = 0.0;
+  size_t snapshot_len = 0;
+  const char *text = NULL;
+  for (int i = 0; i < iterations; i++) {
+    start = bench_now();
+    if (prom_collector_registry_snapshot(registry, snapshot)) {
+      fprintf(stderr, "taking the snapshot failed\n");
+      return 1;
+    }
+    double taken = bench_now();
+    text = prom_collector_registry_snapshot_render(snapshot, &snapshot_len);
+    if (text == NULL) {
+      fprintf(stderr, "rendering the snapshot failed\n");
+      return 1;
+    }
+    snapshot_time += taken - start;
+    render_time += bench_now() - taken;
+  }
+  if (snapshot_len != len || memcmp(text, page, len) != 0) {
+    fprintf(stderr, "the rendered snapshot differs from the page\n");
+    return 1;
+  }
+
+  size_t lines = 0;
+  prom_collector_registry_snapshot_samples(snapshot, &lines);
+  printf("%zu lines, %zu bytes, %d iterations per row\n\n", lines, len, iterations);
+  printf("%-28s %10s\n", "", "us/page");
+  printf("%-28s %10.1f\n", "render from the metrics", per_page * 1e6);
+  printf("%-28s %10.1f\n", "take a snapshot", snapshot_time / iterations * 1e6);
+  printf("%-28s %10.1f\n", "render the snapshot", render_time / iterations * 1e6);
+
+  prom_collector_registry_snapshot_destroy(snapshot);
+  prom_collector_registry_bridge_return(registry, page);
+  prom_collector_registry_destroy(registry);
+  return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures prom_metric_sample_summary_observe through a handle from prom_summary_labels for p50, p99 and p999, from 1
+ * to 8 threads observing the same series at once, then compares the quantiles a scrape reports with the exact ones
+ * and counts the values the sketches keep.
+ *
+ * Usage: prom_summary_bench [observations per thread]
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "prom.h"
+#include "prom_metric_sample_summary_i.h"
+
+#define BENCH_VALUES 4096
+
+typedef struct bench_job {
+  prom_metric_sample_summary_t *sample;
+  const double *values;
+  long observations;
+  pthread_barrier_t *barrier;
+} bench_job_t;
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker(void *data) {
+  bench_job_t *job = (bench_job_t *)data;
+  pthread_barrier_wait(job->barrier);
+  for (long i = 0; i < job->observations; i++) {
+    prom_metric_sample_summary_observe(job->sample, job->values[i & (BENCH_VALUES - 1)]);
+  }
+  return NULL;
+}
+
+static int bench_compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+  long observations = argc > 1 ? atol(argv[1]) : 1000000;
+  if (observations < 1) observations = 1;
+
+  // Latencies from 100us to about 60s, like the histogram benchmark
+  double *values = (double *)malloc(sizeof(double) * BENCH_VALUES);
+  uint64_t state = 88172645463325252ULL;
+  for (int i = 0; i < BENCH_VALUES; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    double value = 0.0001 * (1.0 + (double)(state >> 40) / (double)(1 << 24) * 0.25);
+    for (uint64_t step = state % 60; step > 0; step--) value *= 1.25;
+    values[i] = value;
+  }
+
+  double quantiles[] = {0.5, 0.99, 0.999};
+  double errors[] = {0.05, 0.001, 0.0001};
+  printf("%8s %16s %16s\n", "threads", "observe ns", "scrape us");
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    prom_summary_t *summary = prom_summary_new("bench_seconds", "Latencies.", 3, quantiles, errors, 0, 0, 0, NULL);
+    prom_metric_sample_summary_t *sample = prom_summary_labels(summary, NULL);
+
+    pthread_t workers[8];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+    bench_job_t job = {sample, values, observations, &barrier};
+    for (int t = 0; t < threads; t++) pthread_create(&workers[t], NULL, bench_worker, &job);
+
+    pthread_barrier_wait(&barrier);
+    double start = bench_now();
+    for (int t = 0; t < threads; t++) pthread_join(workers[t], NULL);
+    double elapsed = bench_now() - start;
+    pthread_barrier_destroy(&barrier);
+
+    double estimates[3];
+    uint64_t count = 0;
+    double sum = 0.0;
+    double scrape_start = bench_now();
+    prom_metric_sample_summary_collect(sample, estimates, &count, &sum);
+    double scrape = bench_now() - scrape_start;
+    if (count != (uint64_t)threads * observations) {
+      fprintf(stderr, "lost observations with %d threads\n", threads);
+      return 1;
+    }
+    printf("%8d %16.2f %16.2f\n", threads, elapsed / ((double)threads * observations) * 1e9, scrape * 1e6);
+    prom_summary_destroy(summary);
+  }
+
+  // Every value repeats equally often, so the exact quantiles are those of the sorted value table
+  prom_summary_t *summary = prom_summary_new("bench_seconds", "Latencies.", 3, quantiles, errors, 0, 0, 0, NULL);
+  prom_metric_sample_summary_t *sample = prom_summary_labels(summary, NULL);
+  for (long i = 0; i < observations; i++) prom_metric_sample_summary_observe(sample, values[i & (BENCH_VALUES - 1)]);
+  double estimates[3];
+  uint64_t count = 0;
+  double sum = 0.0;
+  prom_metric_sample_summary_collect(sample, estimates, &count, &sum);
+  qsort(values, BENCH_VALUES, sizeof(double), bench_compare);
+
+  printf("\n%8s %16s %16s %16s\n", "quantile", "exact", "reported", "rank error");
+  for (int i = 0; i < 3; i++) {
+    int rank = 0;
+    while (rank < BENCH_VALUES && values[rank] < estimates[i]) rank++;
+    printf("%8g %16.6f %16.6f %16.5f\n", quantiles[i], values[(int)(quantiles[i] * BENCH_VALUES)], estimates[i],
+           (double)rank / BENCH_VALUES - quantiles[i]);
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < sample->config->age_buckets; i++) kept += sample->streams[i]->len;
+  printf("\nvalues kept by %zu sketches: %zu\n", sample->config->age_buckets, kept);
+
+  prom_summary_destroy(summary);
+  free(values);
+  return 0;
+}
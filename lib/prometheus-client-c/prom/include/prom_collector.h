@@ -87,6 +87,20 @@ int prom_collector_destroy_generic(void *gen);
  */
 int prom_collector_add_metric(prom_collector_t *self, prom_metric_t *metric);
 
+/**
+ * @brief Reuses the rendered page of this collector for the given number of seconds.
+ *
+ * While a rendered page is younger than the TTL, scrapes copy it instead of calling the collect function and rendering
+ * the collector's metrics again, so an expensive collector can be scraped often without redoing the work. Concurrent
+ * scrapes of a stale collector render it once. The page is cached per exposition format. Streamed responses and
+ * responses restricted with selectors bypass the cache. The TTL is 0, i.e. no caching, by default.
+ *
+ * @param self The target prom_collector_t*
+ * @param seconds The TTL in seconds; 0 disables caching
+ * @return A non-zero integer value upon failure.
+ */
+int prom_collector_set_cache_ttl(prom_collector_t *self, double seconds);
+
 /**
  * @brief The collect function is responsible for doing any work involving a set of metrics and then returning them
  *        for metric exposition.
@@ -97,4 +111,12 @@ int prom_collector_add_metric(prom_collector_t *self, prom_metric_t *metric);
  */
 int prom_collector_set_collect_fn(prom_collector_t *self, prom_collect_fn *fn);
 
+/**
+ * @brief Returns the metrics added to the collector with prom_collector_add_metric, which is what a collect function
+ *        set with prom_collector_set_collect_fn returns once it has updated them.
+ * @param self The target prom_collector_t*
+ * @return The prom_map_t* of the collector's metrics, or NULL upon failure
+ */
+prom_map_t *prom_collector_metrics(prom_collector_t *self);
+
 #endif  // PROM_COLLECTOR_H
@@ -22,6 +22,9 @@ limitations under the License.
 #ifndef PROM_REGISTRY_H
 #define PROM_REGISTRY_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "prom_collector.h"
 #include "prom_metric.h"
 
@@ -63,6 +66,32 @@ int prom_collector_registry_destroy(prom_collector_registry_t *self);
  */
 int prom_collector_registry_enable_process_metrics(prom_collector_registry_t *self);
 
+/**
+ * @brief Registers a collector named "self" that reports how much exposing the registry costs.
+ *
+ * It exposes prom_scrapes_total, prom_scrape_duration_seconds and prom_scrape_bytes_total as recorded with
+ * prom_collector_registry_observe_scrape, plus prom_collector_render_seconds_total and prom_collector_errors_total per
+ * collector. Render time and errors are recorded for every collector whether or not this is enabled. Metrics with a
+ * series limit or a TTL also get prom_metric_series_dropped_total and prom_metric_series_evicted_total, see
+ * prom_metric_set_series_limit and prom_metric_set_ttl.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_enable_self_metrics(prom_collector_registry_t *self);
+
+/**
+ * @brief Records a scrape of the registry for the metrics of prom_collector_registry_enable_self_metrics.
+ *
+ * Recording only updates atomic counters; it never blocks or allocates.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param seconds How long the scrape took
+ * @param bytes The length of the page it rendered, before compression
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_observe_scrape(prom_collector_registry_t *self, double seconds, size_t bytes);
+
 /**
  * @brief Registers a metric with the default collector on PROM_DEFAULT_COLLECTOR_REGISTRY
  *
@@ -106,6 +135,293 @@ int prom_collector_registry_register_collector(prom_collector_registry_t *self,
  */
 const char *prom_collector_registry_bridge(prom_collector_registry_t *self);
 
+/**
+ * @brief Renders the default metric exposition format into a buffer leased from the registry.
+ *
+ * Unlike prom_collector_registry_bridge, the page is not copied out of the formatter that produced it. The buffer
+ * stays owned by the registry and MUST be handed back with prom_collector_registry_bridge_return once it has been
+ * sent, after which the registry reuses it for a later scrape. Up to four pages may be leased at once; beyond that a
+ * copy is returned, which prom_collector_registry_bridge_return frees.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param len Set to the length of the page in bytes, excluding the terminating null byte
+ * @return The page, or NULL upon failure
+ */
+const char *prom_collector_registry_bridge_lease(prom_collector_registry_t *self, size_t *len);
+
+/**
+ * @brief Hands a page obtained from prom_collector_registry_bridge_lease back to the registry.
+ *
+ * @param self The prom_collector_registry_t* the page was leased from
+ * @param page The page. It MUST NOT be used after this call.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_bridge_return(prom_collector_registry_t *self, const char *page);
+
+/**
+ * @brief The exposition formats a registry can be rendered in
+ *
+ * Reference: https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+typedef enum prom_collector_registry_format {
+  PROM_COLLECTOR_REGISTRY_FORMAT_TEXT = 0,        /**< the text format, version 0.0.4 */
+  PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF = 1,    /**< length delimited io.prometheus.client.MetricFamily messages */
+  PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS = 2, /**< OpenMetrics 1.0.0, with _created samples and exemplars */
+  PROM_COLLECTOR_REGISTRY_FORMAT_COUNT = 3        /**< the number of formats */
+} prom_collector_registry_format_t;
+
+/**
+ * @brief Like prom_collector_registry_bridge_lease, but renders the given exposition format.
+ *
+ * Binary formats may contain null bytes, so the page MUST be read up to *len rather than as a string.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param format The exposition format
+ * @param len Set to the length of the page in bytes
+ * @return The page, or NULL upon failure
+ */
+const char *prom_collector_registry_bridge_lease_format(prom_collector_registry_t *self,
+                                                        prom_collector_registry_format_t format, size_t *len);
+
+/**
+ * @brief Like prom_collector_registry_bridge_lease_format, but only renders the metric families named by selectors.
+ *
+ * A selector is either a metric name or a name prefix followed by '*', e.g. node_cpu_*. Families are looked up in a
+ * per-collector trie of metric names, so families that do not match are never visited. A family matched by several
+ * selectors is rendered once.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param format The exposition format
+ * @param selectors The selectors, each valid per prom_collector_registry_validate_selector
+ * @param selector_count The number of selectors
+ * @param len Set to the length of the page in bytes
+ * @return The page, or NULL upon failure
+ */
+const char *prom_collector_registry_bridge_lease_select(prom_collector_registry_t *self,
+                                                        prom_collector_registry_format_t format,
+                                                        const char **selectors, size_t selector_count, size_t *len);
+
+/**
+ * @brief Like prom_collector_registry_bridge_lease_select, but renders a single collector.
+ *
+ * Collectors can then be scraped separately, e.g. cheap ones every second and expensive ones every minute. Unless
+ * selectors are given, a collector with a cache TTL (see prom_collector_set_cache_ttl) reuses its last rendered page
+ * while the page is younger than the TTL, for full and per-collector pages alike.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param format The exposition format
+ * @param collector_name The name of the collector, or NULL for every collector
+ * @param selectors The selectors, or NULL to render every family of the collector
+ * @param selector_count The number of selectors
+ * @param len Set to the length of the page in bytes
+ * @return The page, or NULL upon failure or if no such collector is registered
+ */
+const char *prom_collector_registry_bridge_lease_collector(prom_collector_registry_t *self,
+                                                           prom_collector_registry_format_t format,
+                                                           const char *collector_name, const char **selectors,
+                                                           size_t selector_count, size_t *len);
+
+/**
+ * @brief Returns true if a collector with the given name is registered with the registry
+ */
+bool prom_collector_registry_has_collector(prom_collector_registry_t *self, const char *collector_name);
+
+/**
+ * @brief A piece of an exposition page, laid out like struct iovec
+ */
+typedef struct prom_collector_registry_part {
+  const char *data; /**< the bytes of the piece; not null terminated */
+  size_t len;       /**< the number of bytes */
+} prom_collector_registry_part_t;
+
+/**
+ * @brief Renders each collector into a buffer of its own, which are left in pieces rather than joined into one string.
+ *
+ * The pieces concatenated in order form the page of prom_collector_registry_bridge_lease_format. They can be sent with
+ * writev or libmicrohttpd's MHD_create_response_from_iovec without being copied. With render threads (see
+ * prom_collector_registry_set_render_threads) the collectors are rendered in parallel. The pieces stay owned by the
+ * registry and MUST be handed back with prom_collector_registry_bridge_return_parts.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param format The exposition format
+ * @param count Set to the number of pieces
+ * @param len Set to the length of the page in bytes
+ * @return The pieces, or NULL upon failure
+ */
+const prom_collector_registry_part_t *prom_collector_registry_bridge_lease_parts(
+    prom_collector_registry_t *self, prom_collector_registry_format_t format, size_t *count, size_t *len);
+
+/**
+ * @brief Hands pieces obtained from prom_collector_registry_bridge_lease_parts back to the registry.
+ *
+ * @param self The prom_collector_registry_t* the pieces were leased from
+ * @param parts The pieces. They MUST NOT be used after this call.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_bridge_return_parts(prom_collector_registry_t *self,
+                                                const prom_collector_registry_part_t *parts);
+
+/**
+ * @brief Sets the number of threads that render collectors for prom_collector_registry_bridge_lease_parts.
+ *
+ * The scraping thread renders collectors as well, so thread_count extra threads render up to thread_count + 1
+ * collectors at once. Collect functions then run concurrently with each other and MUST NOT share unsynchronized state.
+ * 0, the default, renders collectors one after the other on the scraping thread. This MUST NOT be called while the
+ * registry is being scraped.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param thread_count The number of threads
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_set_render_threads(prom_collector_registry_t *self, size_t thread_count);
+
+/**
+ * @brief Validates a selector for prom_collector_registry_bridge_lease_select: a metric name, optionally ending in '*',
+ * or '*' alone.
+ *
+ * @param selector The selector
+ * @return A non-zero integer value if the selector is invalid
+ */
+int prom_collector_registry_validate_selector(const char *selector);
+
+/**
+ * @brief Sorts valid selectors and drops those another selector already covers, e.g. node_cpu_seconds_total after
+ * node_cpu_*, so no family matches twice. Selections that render the same families normalize to the same selectors.
+ *
+ * @param selectors The selectors, sorted in place
+ * @param count The number of selectors
+ * @return The number of selectors left at the front of selectors
+ */
+size_t prom_collector_registry_normalize_selectors(const char **selectors, size_t count);
+
+/**
+ * @brief An exposition of a registry that is rendered incrementally as it is read.
+ */
+typedef struct prom_collector_registry_stream prom_collector_registry_stream_t;
+
+/**
+ * @brief Starts rendering the registry in the default metric exposition format without building the whole page.
+ *
+ * The stream renders a few kilobytes at a time, so memory does not grow with the number of series and the first bytes
+ * are available before the last collector has been visited. Series created while the stream is open may or may not
+ * appear in it.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @return The stream, which MUST be destroyed with prom_collector_registry_stream_destroy
+ */
+prom_collector_registry_stream_t *prom_collector_registry_stream_new(prom_collector_registry_t *self);
+
+/**
+ * @brief Destroys a prom_collector_registry_stream_t*
+ *
+ * @param self The target prom_collector_registry_stream_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_stream_destroy(prom_collector_registry_stream_t *self);
+
+/**
+ * @brief Copies the next part of the exposition into buf.
+ *
+ * @param self The target prom_collector_registry_stream_t*
+ * @param buf Receives up to max bytes. The bytes are not null terminated.
+ * @param max The capacity of buf
+ * @param len Set to the number of bytes written to buf. Fewer than max bytes are written only at the end of the
+ *            exposition, and 0 bytes once it has been read in full.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_stream_read(prom_collector_registry_stream_t *self, char *buf, size_t max, size_t *len);
+
+/**
+ * @brief The values of every series of a registry, copied in one pass by prom_collector_registry_snapshot.
+ */
+typedef struct prom_collector_registry_snapshot prom_collector_registry_snapshot_t;
+
+/**
+ * @brief A metric family of a snapshot
+ */
+typedef struct prom_collector_registry_snapshot_family {
+  const char *name;   /**< the name of the metric */
+  const char *type;   /**< counter, gauge, histogram or summary */
+  const char *header; /**< the HELP and TYPE lines of the default exposition format */
+  size_t header_len;  /**< the length of header */
+  size_t first;       /**< the index of the family's first line among the lines of the snapshot */
+  size_t count;       /**< the number of lines of the family */
+} prom_collector_registry_snapshot_family_t;
+
+/**
+ * @brief A line of a snapshot: one series, or one bucket, quantile, count or sum of a histogram or summary series
+ */
+typedef struct prom_collector_registry_snapshot_sample {
+  const char *l_value; /**< the name and labels of the line, e.g. http_requests_total{code="200"} */
+  size_t l_value_len;  /**< the length of l_value */
+  bool integer;        /**< true if the value is i_value, false if it is r_value */
+  int64_t i_value;     /**< the value of integer samples and of bucket and count lines */
+  double r_value;      /**< the value of other lines */
+} prom_collector_registry_snapshot_sample_t;
+
+/**
+ * @brief Constructs an empty prom_collector_registry_snapshot_t*
+ *
+ * @return The snapshot, which MUST be destroyed with prom_collector_registry_snapshot_destroy
+ */
+prom_collector_registry_snapshot_t *prom_collector_registry_snapshot_new(void);
+
+/**
+ * @brief Destroys a prom_collector_registry_snapshot_t*
+ *
+ * @param self The target prom_collector_registry_snapshot_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_snapshot_destroy(prom_collector_registry_snapshot_t *self);
+
+/**
+ * @brief Copies the value of every series of the registry into snapshot, replacing what it held before.
+ *
+ * The lines of each metric are copied under its lock, so a metric is seen either before or after a concurrent update,
+ * and histogram and summary lines agree with each other. Names, labels and headers are copied along with the values,
+ * so the snapshot stays valid however its series are removed or evicted afterwards. Its arrays are kept from one call
+ * to the next, so taking snapshots at an interval does not allocate once they have grown to the registry's size.
+ *
+ * Collectors are always collected, whatever their prom_collector_set_cache_ttl. Lines are those of the default
+ * exposition format: native buckets, exemplars and _created samples are only rendered from the metrics.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param snapshot The snapshot to fill. It is left empty upon failure.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_snapshot(prom_collector_registry_t *self, prom_collector_registry_snapshot_t *snapshot);
+
+/**
+ * @brief Returns the metric families of a snapshot, in the order they are exposed.
+ *
+ * @param self The target prom_collector_registry_snapshot_t*
+ * @param count Set to the number of families
+ * @return The families, valid until the snapshot is taken again or destroyed
+ */
+const prom_collector_registry_snapshot_family_t *prom_collector_registry_snapshot_families(
+    const prom_collector_registry_snapshot_t *self, size_t *count);
+
+/**
+ * @brief Returns the lines of a snapshot. The lines of a family are contiguous; see
+ * prom_collector_registry_snapshot_family_t.
+ *
+ * @param self The target prom_collector_registry_snapshot_t*
+ * @param count Set to the number of lines
+ * @return The lines, valid until the snapshot is taken again or destroyed
+ */
+const prom_collector_registry_snapshot_sample_t *prom_collector_registry_snapshot_samples(
+    const prom_collector_registry_snapshot_t *self, size_t *count);
+
+/**
+ * @brief Renders a snapshot in the default metric exposition format.
+ *
+ * @param self The target prom_collector_registry_snapshot_t*
+ * @param len Set to the length of the page in bytes
+ * @return The page, owned by the snapshot and valid until it is rendered again, taken again or destroyed; NULL upon
+ *         failure
+ */
+const char *prom_collector_registry_snapshot_render(prom_collector_registry_snapshot_t *self, size_t *len);
+
 /**
  *@brief Validates that the given metric name complies with the specification:
  *
@@ -119,4 +435,24 @@ const char *prom_collector_registry_bridge(prom_collector_registry_t *self);
  */
 int prom_collector_registry_validate_metric_name(prom_collector_registry_t *self, const char *metric_name);
 
+/**
+ * @brief Evicts the series of the registry's metrics that were not updated within their TTL; see prom_metric_set_ttl.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_sweep(prom_collector_registry_t *self);
+
+/**
+ * @brief Starts a thread that calls prom_collector_registry_sweep every interval, or stops it if seconds is 0.
+ *
+ * Series are evicted up to one interval after their TTL expired, so the interval is best kept to a fraction of the
+ * shortest TTL. No thread is started by default.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param seconds The interval in seconds. Negative, non-finite and intervals beyond 2^64 nanoseconds are refused.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_set_sweep_interval(prom_collector_registry_t *self, double seconds);
+
 #endif  // PROM_H
@@ -17,6 +17,7 @@ limitations under the License.
 #ifndef PROM_COUNTER_H
 #define PROM_COUNTER_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "prom_metric.h"
@@ -55,6 +56,31 @@ typedef prom_metric_t prom_counter_t;
  */
 prom_counter_t *prom_counter_new(const char *name, const char *help, size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief Constructs a prom_counter_t* whose samples are sharded per CPU.
+ *
+ * prom_counter_inc and prom_counter_add on a plain counter update a single value with a compare-and-swap loop, so
+ * threads incrementing the same series at once keep invalidating each other's cache line and retrying. Each sample of
+ * a sharded counter has one cache-line-sized slot per CPU instead; an increment only touches the slot of the CPU it
+ * runs on, and the slots are summed when the counter is rendered.
+ *
+ * Every sample costs 64 bytes per CPU, so use this for counters with few series that many threads increment, e.g. the
+ * requests served by an embedding application. Arguments and behaviour are otherwise those of prom_counter_new.
+ */
+prom_counter_t *prom_counter_new_sharded(const char *name, const char *help, size_t label_key_count,
+                                         const char **label_keys);
+
+/**
+ * @brief Constructs a prom_counter_t* whose samples hold 64-bit integers.
+ *
+ * Use this for counters that only ever count whole things, e.g. bytes, packets or context switches. An increment is a
+ * single atomic_fetch_add rather than a compare-and-swap loop on a double, the value is rendered without converting it
+ * to a double first, and values beyond 2^53 stay exact. prom_counter_inc and prom_counter_add still work; the latter
+ * fails for fractions, which would be lost. Arguments and behaviour are otherwise those of prom_counter_new.
+ */
+prom_counter_t *prom_counter_new_int(const char *name, const char *help, size_t label_key_count,
+                                     const char **label_keys);
+
 /**
  * @brief Destroys a prom_counter_t*. You must set self to NULL after destruction. A non-zero integer value will be
  *        returned on failure.
@@ -100,4 +126,49 @@ int prom_counter_inc(prom_counter_t *self, const char **label_values);
  */
 int prom_counter_add(prom_counter_t *self, double r_value, const char **label_values);
 
+/**
+ * @brief Add the integer to the prom_counter_t*. A non-zero integer value will be returned on failure.
+ *
+ * This is the counterpart of prom_counter_add for counters created with prom_counter_new_int. On other counters
+ * i_value is converted to a double.
+ * @param self The target prom_counter_t*
+ * @param i_value The integer to add to the prom_counter_t passed as self. The value MUST be greater than or equal to 0.
+ * @param label_values The label values associated with the metric sample being updated. The number of labels must
+ *                     match the value passed to label_key_count in the counter's constructor. If no label values are
+ *                     necessary, pass NULL. Otherwise, It may be convenient to pass this value as a literal.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_counter_add_int(prom_counter_t *self, int64_t i_value, const char **label_values);
+
+/**
+ * @brief Returns the sample of the prom_counter_t* for the given label values, creating it if needed.
+ *
+ * The returned handle is updated with prom_metric_sample_add without formatting the label values or looking the
+ * sample up again. A handle stays valid until it is returned with prom_metric_return_sample or the counter is
+ * destroyed, even after its series was removed or evicted, see prom_metric_remove.
+ *
+ * @param self The target prom_counter_t*
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the counter's constructor. If no label values are necessary, pass NULL.
+ * @return The prom_metric_sample_t* of the series, or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_metric_sample_t *sda_reads = prom_counter_labels(foo_counter, (const char *[]){"sda"});
+ *     // On every tick
+ *     prom_metric_sample_add(sda_reads, reads_since_last_tick);
+ */
+prom_metric_sample_t *prom_counter_labels(prom_counter_t *self, const char **label_values);
+
+/**
+ * @brief Removes the series of the prom_counter_t* with the given label values, e.g. one for a device that disappeared.
+ *
+ * See prom_metric_remove.
+ *
+ * @param self The target prom_counter_t*
+ * @param label_values The label values of the series
+ * @return A non-zero integer value upon failure
+ */
+int prom_counter_remove(prom_counter_t *self, const char **label_values);
+
 #endif  // PROM_COUNTER_H
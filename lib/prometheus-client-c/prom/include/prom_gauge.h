@@ -22,6 +22,7 @@ limitations under the License.
 #ifndef PROM_GAUGE_H
 #define PROM_GAUGE_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "prom_metric.h"
@@ -53,6 +54,18 @@ typedef prom_metric_t prom_gauge_t;
  */
 prom_gauge_t *prom_gauge_new(const char *name, const char *help, size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief Constructs a prom_gauge_t* whose samples hold 64-bit integers.
+ *
+ * Use this for gauges of whole quantities read from counters of the kernel, e.g. bytes of memory or running processes.
+ * Updates are single atomic operations on the integer, the value is rendered without converting it to a double first,
+ * and values beyond 2^53 stay exact. The double functions still work: prom_gauge_set rounds its argument to the
+ * nearest integer, while prom_gauge_add and prom_gauge_sub fail for fractions, which would be lost.
+ * Arguments and behaviour are otherwise those of prom_gauge_new.
+ */
+prom_gauge_t *prom_gauge_new_int(const char *name, const char *help, size_t label_key_count,
+                                 const char **label_keys);
+
 /**
  * @brief Destroys a prom_gauge_t*. You must set self to NULL after destruction. A non-zero integer value will be
  *        returned on failure.
@@ -152,4 +165,74 @@ int prom_gauge_sub(prom_gauge_t *self, double r_value, const char **label_values
  */
 int prom_gauge_set(prom_gauge_t *self, double r_value, const char **label_values);
 
+/**
+ * @brief Add the integer to the prom_gauge_t*. The counterpart of prom_gauge_add for gauges created with
+ *        prom_gauge_new_int; on other gauges i_value is converted to a double.
+ * @param self The target prom_gauge_t*
+ * @param i_value The integer to add to the prom_gauge_t passed as self. The value MUST be greater than or equal to 0.
+ * @param label_values The label values associated with the metric sample being updated. The number of labels must
+ *                     match the value passed to label_key_count in the gauge's constructor. If no label values are
+ *                     necessary, pass NULL.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_add_int(prom_gauge_t *self, int64_t i_value, const char **label_values);
+
+/**
+ * @brief Subtract the integer from the prom_gauge_t*. The counterpart of prom_gauge_sub, see prom_gauge_add_int.
+ * @param self The target prom_gauge_t*
+ * @param i_value The integer to subtract from the prom_gauge_t passed as self.
+ * @param label_values The label values associated with the metric sample being updated. If no label values are
+ *                     necessary, pass NULL.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_sub_int(prom_gauge_t *self, int64_t i_value, const char **label_values);
+
+/**
+ * @brief Set the prom_gauge_t* to the integer. The counterpart of prom_gauge_set, see prom_gauge_add_int.
+ * @param self The target prom_gauge_t*
+ * @param i_value The integer to which the prom_gauge_t* passed as self will be set
+ * @param label_values The label values associated with the metric sample being updated. If no label values are
+ *                     necessary, pass NULL.
+ * @return A non-zero integer value upon failure.
+ *
+ * *Example*
+ *
+ *     prom_gauge_t *rx = prom_gauge_new_int("foo_rx_bytes", "foo_rx_bytes is an integer gauge", 0, NULL);
+ *     prom_gauge_set_int(rx, 18446744073709, NULL);
+ */
+int prom_gauge_set_int(prom_gauge_t *self, int64_t i_value, const char **label_values);
+
+/**
+ * @brief Returns the sample of the prom_gauge_t* for the given label values, creating it if needed.
+ *
+ * The returned handle is updated with prom_metric_sample_set, prom_metric_sample_add and prom_metric_sample_sub, each
+ * a single atomic operation on the value: the label values are not formatted and the sample is not looked up again.
+ * Collectors that update the same series on every tick, e.g. one per CPU or per device, should resolve their handles
+ * once and keep them. A handle stays valid until it is returned with prom_metric_return_sample or the gauge is
+ * destroyed, even after its series was removed or evicted, see prom_metric_remove.
+ *
+ * @param self The target prom_gauge_t*
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the gauge's constructor. If no label values are necessary, pass NULL.
+ * @return The prom_metric_sample_t* of the series, or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_metric_sample_t *cpu0 = prom_gauge_labels(foo_gauge, (const char *[]){"cpu0"});
+ *     // On every tick
+ *     prom_metric_sample_set(cpu0, usage);
+ */
+prom_metric_sample_t *prom_gauge_labels(prom_gauge_t *self, const char **label_values);
+
+/**
+ * @brief Removes the series of the prom_gauge_t* with the given label values, e.g. one for a device that disappeared.
+ *
+ * See prom_metric_remove.
+ *
+ * @param self The target prom_gauge_t*
+ * @param label_values The label values of the series
+ * @return A non-zero integer value upon failure
+ */
+int prom_gauge_remove(prom_gauge_t *self, const char **label_values);
+
 #endif  // PROM_GAUGE_H
@@ -60,6 +60,37 @@ typedef prom_metric_t prom_histogram_t;
 prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_histogram_buckets_t *buckets,
                                      size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief Construct a prom_histogram_t* with native buckets: sparse exponential buckets whose resolution is picked at
+ *        runtime instead of fixed upper bounds.
+ *
+ * Bucket boundaries are powers of 2^(2^-schema), where the schema is the highest between -4 and 8 whose buckets grow by
+ * no more than bucket_factor, e.g. 1.1 selects schema 3 and buckets about 9% wide. Only buckets that received
+ * observations take memory. When a sample populates more than max_bucket_count buckets, neighbouring buckets are
+ * merged and the schema drops by one until they fit again. Observations no further from zero than 2^-128 are counted
+ * in a zero bucket.
+ *
+ * The buckets are exposed in the protobuf format only. The text and OpenMetrics formats expose the +Inf bucket, the
+ * count and the sum.
+ *
+ * @param name The name of the metric
+ * @param help The metric description
+ * @param bucket_factor The growth factor between neighbouring buckets. The value MUST be greater than 1.
+ * @param max_bucket_count The populated buckets a sample may hold before its resolution is lowered. Pass 0 for no
+ *                         limit.
+ * @param label_key_count is the number of labels associated with the given metric. Pass 0 if the metric does not
+ *                        require labels.
+ * @param label_keys A collection of label keys. The number of keys MUST match the value passed as label_key_count. If
+ *                   no labels are required, pass NULL.
+ * @return The constructed prom_histogram_t*, or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_histogram_new_native("request_seconds", "request_seconds is a native histogram", 1.1, 160, 0, NULL);
+ */
+prom_histogram_t *prom_histogram_new_native(const char *name, const char *help, double bucket_factor,
+                                            size_t max_bucket_count, size_t label_key_count, const char **label_keys);
+
 /**
  * @brief Destroy a prom_histogram_t*. self MUSTS be set to NULL after destruction. Returns a non-zero integer value
  *        upon failure.
@@ -78,4 +109,39 @@ int prom_histogram_destroy(prom_histogram_t *self);
  */
 int prom_histogram_observe(prom_histogram_t *self, double value, const char **label_values);
 
+/**
+ * @brief Observe the prom_histogram_t given the value and labels, and record the observation as the exemplar of the
+ *        bucket it falls in, e.g. with the trace_id of the request that was measured.
+ *
+ * Each bucket keeps its most recent exemplar, which is exposed in the OpenMetrics format only. Recording an exemplar
+ * takes no lock; if two threads record one for the same bucket at once, one of them is dropped.
+ *
+ * @param self The target prom_histogram_t*
+ * @param value The value to observe
+ * @param label_values The label values of the series. The number of values MUST match the label_key_count passed to
+ *                     prom_histogram_new.
+ * @param exemplar_label_count The number of exemplar labels
+ * @param exemplar_label_keys The exemplar label names
+ * @param exemplar_label_values The exemplar label values. Names and values together MUST NOT exceed 128 characters.
+ * @return Non-zero value upon failure
+ */
+int prom_histogram_observe_with_exemplar(prom_histogram_t *self, double value, const char **label_values,
+                                         size_t exemplar_label_count, const char **exemplar_label_keys,
+                                         const char **exemplar_label_values);
+
+/**
+ * @brief Returns the sample of the prom_histogram_t* for the given label values, creating it if needed.
+ *
+ * The returned handle is updated with prom_metric_sample_histogram_observe and
+ * prom_metric_sample_histogram_observe_with_exemplar without formatting the label values or looking the sample up
+ * again. A handle stays valid until it is returned with prom_metric_return_sample or the histogram is destroyed,
+ * even after its series was removed or evicted, see prom_metric_remove.
+ *
+ * @param self The target prom_histogram_t*
+ * @param label_values The label values of the sample. The number of values MUST match the label_key_count passed to
+ *                     prom_histogram_new. If no label values are necessary, pass NULL.
+ * @return The prom_metric_sample_histogram_t* of the series, or NULL upon failure
+ */
+prom_metric_sample_histogram_t *prom_histogram_labels(prom_histogram_t *self, const char **label_values);
+
 #endif  // PROM_HISTOGRAM_INCLUDED
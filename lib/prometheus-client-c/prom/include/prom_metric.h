@@ -22,8 +22,11 @@ limitations under the License.
 #ifndef PROM_METRIC_H
 #define PROM_METRIC_H
 
+#include <stddef.h>
+
 #include "prom_metric_sample.h"
 #include "prom_metric_sample_histogram.h"
+#include "prom_metric_sample_summary.h"
 
 struct prom_metric;
 /**
@@ -33,6 +36,13 @@ struct prom_metric;
  */
 typedef struct prom_metric prom_metric_t;
 
+struct prom_metric_family;
+/**
+ * @brief A set of samples built for a counter or a gauge, to replace all of its samples at once with
+ * prom_metric_replace.
+ */
+typedef struct prom_metric_family prom_metric_family_t;
+
 /**
  * @brief Returns a prom_metric_sample_t*. The order of label_values is significant.
  *
@@ -40,6 +50,10 @@ typedef struct prom_metric prom_metric_t;
  * with O(1) lookups in average case; nonethless, caching metric samples and updating them directly might be
  * preferrable in performance-sensitive situations.
  *
+ * The returned sample stays valid until it is handed back with prom_metric_return_sample or the metric is destroyed.
+ * Once its series is removed, replaced or evicted, updates of the sample are no longer exposed, and the next update of
+ * the series through the metric starts it again in a new sample, see prom_metric_remove.
+ *
  * @param self The target prom_metric_t*
  * @param label_values The label values associated with the metric sample being updated. The number of labels must
  *                     match the value passed to label_key_count in the counter's constructor. If no label values are
@@ -55,6 +69,10 @@ prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const
  * with O(1) lookups in average case; nonethless, caching metric samples and updating them directly might be
  * preferrable in performance-sensitive situations.
  *
+ * The returned sample stays valid until it is handed back with prom_metric_return_sample or the metric is destroyed.
+ * Once its series is removed, replaced or evicted, updates of the sample are no longer exposed, and the next update of
+ * the series through the metric starts it again in a new sample, see prom_metric_remove.
+ *
  * @param self The target prom_histogram_metric_t*
  * @param label_values The label values associated with the metric sample being updated. The number of labels must
  *                     match the value passed to label_key_count in the counter's constructor. If no label values are
@@ -64,4 +82,134 @@ prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const
 prom_metric_sample_histogram_t *prom_metric_sample_histogram_from_labels(prom_metric_t *self,
                                                                          const char **label_values);
 
+/**
+ * @brief Returns a prom_metric_sample_summary_t*. The order of label_values is significant.
+ *
+ * The returned sample is held like those of prom_metric_sample_from_labels.
+ *
+ * @param self The target prom_metric_t*
+ * @param label_values The label values associated with the metric sample being updated. The number of labels must
+ *                     match the value passed to label_key_count in the summary's constructor. If no label values are
+ *                     necessary, pass NULL.
+ * @return A prom_metric_sample_summary_t*
+ */
+prom_metric_sample_summary_t *prom_metric_sample_summary_from_labels(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief Hands back a sample returned by a *_from_labels function, e.g. prom_gauge_labels. The sample MUST NOT be used
+ * afterwards.
+ *
+ * Handed out samples outlive the removal, replacement or eviction of their series, so a collector that drops a series,
+ * e.g. that of a device which disappeared, returns its handle for the sample to be freed. The series of a sample that
+ * is still exposed stays in place. Samples not handed back are freed along with the metric.
+ *
+ * @param self The prom_metric_t* the sample was obtained from
+ * @param sample The prom_metric_sample_t*, prom_metric_sample_histogram_t* or prom_metric_sample_summary_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_return_sample(prom_metric_t *self, void *sample);
+
+/**
+ * @brief Caps the number of series, i.e. distinct label value sets, the metric holds.
+ *
+ * Once the metric holds max_series series, updates that would create another one are dropped: the *_from_labels
+ * functions return NULL and the update functions of the metric types return a non-zero value, while series that exist
+ * keep being updated. Dropped updates are counted by prom_metric_series_dropped_total, see
+ * prom_collector_registry_enable_self_metrics.
+ *
+ * @param self The target prom_metric_t*
+ * @param max_series The maximum number of series. 0, the default, does not limit them.
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_set_series_limit(prom_metric_t *self, size_t max_series);
+
+/**
+ * @brief Evicts series of the metric that were not updated for ttl seconds.
+ *
+ * Series are evicted by prom_collector_registry_sweep, or periodically once prom_collector_registry_set_sweep_interval
+ * is set, and show up again with their next update, starting from zero. This bounds the memory of metrics whose label
+ * values come and go, such as per-process or per-connection series. Evicted samples are freed like removed ones, see
+ * prom_metric_remove; an update that races with the eviction of its series may land in the evicted sample and be
+ * lost.
+ *
+ * Updates of such metrics stamp their series with a coarse clock, so this MUST be called before the first series of
+ * the metric is created. Updates through the samples handed out by the *_from_labels functions stamp them as well.
+ *
+ * @param self The target prom_metric_t*
+ * @param ttl The number of seconds. 0, the default, never evicts series. Negative, non-finite and TTLs beyond 2^64
+ *            nanoseconds are refused.
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_set_ttl(prom_metric_t *self, double ttl);
+
+/**
+ * @brief Removes the series of the metric with the given label values, e.g. that of a process which exited.
+ *
+ * Removing a series that does not exist succeeds. A later update creates the series again, starting from zero. The
+ * sample is freed at once, since updates through the metric types hold their sample while they run, unless a
+ * *_from_labels function, e.g. prom_gauge_labels, handed it out: it is then kept until every such handle is returned
+ * with prom_metric_return_sample, so updating a handle stays safe but is no longer exposed.
+ *
+ * @param self The target prom_metric_t*
+ * @param label_values The label values of the series
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_remove(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief Removes every series of the metric at once, like replacing them with an empty prom_metric_family_t*.
+ *
+ * @param self The target prom_metric_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_clear(prom_metric_t *self);
+
+/**
+ * @brief Starts building the samples that will replace those of a counter or a gauge, such as the top processes of a
+ * tick.
+ *
+ * The family is filled with prom_metric_family_set off to the side, without taking any lock of the metric, and swapped
+ * in with prom_metric_replace, so scrapes render either all of the old samples or all of the new ones and never wait
+ * for the family to be built. A family that is not passed to prom_metric_replace is freed with
+ * prom_metric_family_destroy.
+ *
+ * @param metric The target prom_metric_t*
+ * @return The prom_metric_family_t*, or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_metric_family_t *top = prom_metric_family_new(top_rss);
+ *     for (size_t i = 0; i < n; i++) prom_metric_family_set(top, (const char *[]){procs[i].comm}, procs[i].rss);
+ *     prom_metric_replace(top_rss, top);
+ */
+prom_metric_family_t *prom_metric_family_new(prom_metric_t *metric);
+
+/**
+ * @brief Sets the value of the series with the given label values in the family, creating it if needed. The series
+ * limit of the metric applies to the family.
+ *
+ * @param self The target prom_metric_family_t*
+ * @param label_values The label values of the series
+ * @param r_value The value of the series, which counters report as their total
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_family_set(prom_metric_family_t *self, const char **label_values, double r_value);
+
+/**
+ * @brief Frees a family that was not passed to prom_metric_replace
+ */
+int prom_metric_family_destroy(prom_metric_family_t *self);
+
+/**
+ * @brief Replaces every series of the metric with those of the family, in one step for scrapes.
+ *
+ * The family MUST have been created for self, and is consumed even upon failure. The old samples are freed like
+ * removed ones, see prom_metric_remove.
+ *
+ * @param self The target prom_metric_t*
+ * @param family The samples to expose from now on
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_replace(prom_metric_t *self, prom_metric_family_t *family);
+
 #endif  // PROM_METRIC_H
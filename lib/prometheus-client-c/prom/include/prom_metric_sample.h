@@ -22,6 +22,8 @@ limitations under the License.
 #ifndef PROM_METRIC_SAMPLE_H
 #define PROM_METRIC_SAMPLE_H
 
+#include <stdint.h>
+
 struct prom_metric_sample;
 /**
  * @brief Contains the specific metric and value given the name and label set
@@ -57,4 +59,37 @@ int prom_metric_sample_sub(prom_metric_sample_t *self, double r_value);
  */
 int prom_metric_sample_set(prom_metric_sample_t *self, double r_value);
 
+/**
+ * @brief Add the i_value to the sample. The value must be greater than or equal to zero.
+ *
+ * On a sample of a metric created with prom_counter_new_int or prom_gauge_new_int this is a single atomic_fetch_add;
+ * prom_metric_sample_set rounds its double to the nearest integer on such samples, while prom_metric_sample_add and
+ * prom_metric_sample_sub refuse fractions, which would otherwise be lost on every update. NaN, infinities and values
+ * beyond the range of int64_t are refused. On other samples i_value is converted to a double.
+ * @param self The target prom_metric_sample_t*
+ * @param i_value The integer to add to the prom_metric_sample_t* provided by self
+ * @return Non-zero integer value upon failure
+ */
+int prom_metric_sample_add_int(prom_metric_sample_t *self, int64_t i_value);
+
+/**
+ * @brief Subtract the i_value from the sample. See prom_metric_sample_add_int.
+ *
+ * This operation MUST be called on a sample derived from a gauge metric.
+ * @param self The target prom_metric_sample_t*
+ * @param i_value The integer to subtract from the prom_metric_sample_t* provided by self
+ * @return Non-zero integer value upon failure
+ */
+int prom_metric_sample_sub_int(prom_metric_sample_t *self, int64_t i_value);
+
+/**
+ * @brief Set the value of the sample to i_value. See prom_metric_sample_add_int.
+ *
+ * This operation MUST be called on a sample derived from a gauge metric.
+ * @param self The target prom_metric_sample_t*
+ * @param i_value The integer which will be set to the prom_metric_sample_t* provided by self
+ * @return Non-zero integer value upon failure
+ */
+int prom_metric_sample_set_int(prom_metric_sample_t *self, int64_t i_value);
+
 #endif  // PROM_METRIC_SAMPLE_H
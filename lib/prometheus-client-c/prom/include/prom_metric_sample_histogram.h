@@ -22,6 +22,8 @@ limitations under the License.
 #ifndef PROM_METRIC_SAMPLE_HISOTGRAM_H
 #define PROM_METRIC_SAMPLE_HISOTGRAM_H
 
+#include <stddef.h>
+
 struct prom_metric_sample_histogram;
 /**
  * @brief A histogram metric sample
@@ -36,4 +38,18 @@ typedef struct prom_metric_sample_histogram prom_metric_sample_histogram_t;
  */
 int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value);
 
+/**
+ * @brief Observe the double for the given prom_metric_sample_histogram_t and record it as the exemplar of the bucket it
+ * falls in. Exemplars are exposed in the OpenMetrics format only.
+ * @param self The target prom_metric_sample_histogram_t*
+ * @param value The value to observe.
+ * @param exemplar_label_count The number of exemplar labels, e.g. 1 for a trace_id
+ * @param exemplar_label_keys The exemplar label names
+ * @param exemplar_label_values The exemplar label values. Names and values together MUST NOT exceed 128 characters.
+ * @return Non-zero integer value upon failure
+ */
+int prom_metric_sample_histogram_observe_with_exemplar(prom_metric_sample_histogram_t *self, double value,
+                                                       size_t exemplar_label_count, const char **exemplar_label_keys,
+                                                       const char **exemplar_label_values);
+
 #endif  // PROM_METRIC_SAMPLE_HISOTGRAM_H
@@ -0,0 +1,106 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file prom_summary.h
+ * @brief https://prometheus.io/docs/concepts/metric_types/#summary
+ */
+
+#ifndef PROM_SUMMARY_INCLUDED
+#define PROM_SUMMARY_INCLUDED
+
+#include <stdlib.h>
+
+#include "prom_metric.h"
+#include "prom_metric_sample_summary.h"
+
+/**
+ * @brief A prometheus summary.
+ *
+ * References
+ * * See https://prometheus.io/docs/concepts/metric_types/#summary
+ */
+typedef prom_metric_t prom_summary_t;
+
+/**
+ * @brief Construct a prom_summary_t* that exposes quantiles of the values observed over a sliding time window, plus
+ *        the count and the sum of every value observed.
+ *
+ * Each sample keeps age_buckets quantile sketches (Cormode et al., "Effective Computation of Biased Quantiles over
+ * Data Streams") that are started max_age / age_buckets apart. Quantiles are read from the oldest, so they cover the
+ * values observed in the last max_age, give or take one rotation. A sketch keeps a small subset of the values, chosen
+ * so that each quantile is answered within its error: with error 0.001, the p99 of a million values is a value whose
+ * rank is between 989000 and 991000.
+ *
+ * Observations are appended to a buffer of the CPU the caller runs on and merged into the sketches 128 at a time, so
+ * observing takes no lock shared with other CPUs most of the time. Scrapes merge the buffers before reading the
+ * quantiles. A quantile is NaN while no value was observed in the window.
+ *
+ * @param name The name of the metric
+ * @param help The metric description
+ * @param quantile_count The number of quantiles. Pass 0 to only expose the count and the sum.
+ * @param quantiles The quantiles to expose, each within (0, 1), e.g. {0.5, 0.99, 0.999}. The array is copied.
+ * @param errors The allowed rank error of each quantile, each within (0, 1), e.g. {0.05, 0.001, 0.0001}. Smaller
+ *               errors keep more values. The array is copied.
+ * @param max_age How long an observation counts towards the quantiles, in seconds. Pass 0 for 10 minutes.
+ * @param age_buckets The number of sketches the window rotates through. Pass 0 for 5.
+ * @param label_key_count is the number of labels associated with the given metric. Pass 0 if the metric does not
+ *                        require labels.
+ * @param label_keys A collection of label keys. The number of keys MUST match the value passed as label_key_count. If
+ *                   no labels are required, pass NULL. The quantile label is reserved.
+ * @return The constructed prom_summary_t*, or NULL upon failure
+ *
+ * *Example*
+ *
+ *     double quantiles[] = {0.5, 0.99, 0.999};
+ *     double errors[] = {0.05, 0.001, 0.0001};
+ *     prom_summary_new("request_seconds", "request_seconds is a summary", 3, quantiles, errors, 0, 0, 0, NULL);
+ */
+prom_summary_t *prom_summary_new(const char *name, const char *help, size_t quantile_count, const double *quantiles,
+                                 const double *errors, double max_age, size_t age_buckets, size_t label_key_count,
+                                 const char **label_keys);
+
+/**
+ * @brief Destroy a prom_summary_t*. self MUST be set to NULL after destruction.
+ * @return Non-zero value upon failure.
+ */
+int prom_summary_destroy(prom_summary_t *self);
+
+/**
+ * @brief Observe the prom_summary_t given the value and labels
+ * @param self The target prom_summary_t*
+ * @param value The value to observe. NaN is counted and summed but does not take part in the quantiles.
+ * @param label_values The label values of the series. The number of values MUST match the label_key_count passed to
+ *                     prom_summary_new. If no label values are necessary, pass NULL.
+ * @return Non-zero value upon failure
+ */
+int prom_summary_observe(prom_summary_t *self, double value, const char **label_values);
+
+/**
+ * @brief Returns the sample of the prom_summary_t* for the given label values, creating it if needed.
+ *
+ * The returned handle is updated with prom_metric_sample_summary_observe without formatting the label values or
+ * looking the sample up again. A handle stays valid until it is returned with prom_metric_return_sample or the
+ * summary is destroyed, even after its series was removed or evicted, see prom_metric_remove.
+ *
+ * @param self The target prom_summary_t*
+ * @param label_values The label values of the sample. The number of values MUST match the label_key_count passed to
+ *                     prom_summary_new. If no label values are necessary, pass NULL.
+ * @return The prom_metric_sample_summary_t* of the series, or NULL upon failure
+ */
+prom_metric_sample_summary_t *prom_summary_labels(prom_summary_t *self, const char **label_values);
+
+#endif  // PROM_SUMMARY_INCLUDED
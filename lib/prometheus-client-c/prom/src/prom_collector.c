@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 
@@ -25,6 +27,7 @@
 // Private
 #include "prom_assert.h"
 #include "prom_collector_t.h"
+#include "prom_errors.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_i.h"
@@ -35,6 +38,7 @@
 #include "prom_process_stat_i.h"
 #include "prom_process_stat_t.h"
 #include "prom_string_builder_i.h"
+#include "prom_trie_i.h"
 
 prom_map_t *prom_collector_default_collect(prom_collector_t *self) { return self->metrics; }
 
@@ -42,6 +46,16 @@ prom_collector_t *prom_collector_new(const char *name) {
   int r = 0;
   prom_collector_t *self = (prom_collector_t *)prom_malloc(sizeof(prom_collector_t));
   self->name = prom_strdup(name);
+  self->names = NULL;
+  self->cache_ttl = 0;
+  self->cache_lock = NULL;
+  for (int i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) {
+    self->cache[i] = NULL;
+    self->cached_at[i] = -1;
+  }
+  atomic_init(&self->render_nanoseconds, 0);
+  atomic_init(&self->errors, 0);
+  self->registry = NULL;
   self->metrics = prom_map_new();
   if (self->metrics == NULL) {
     prom_collector_destroy(self);
@@ -52,6 +66,7 @@ prom_collector_t *prom_collector_new(const char *name) {
     prom_collector_destroy(self);
     return NULL;
   }
+  self->names = prom_trie_new();
   self->collect_fn = &prom_collector_default_collect;
   self->string_builder = prom_string_builder_new();
   if (self->string_builder == NULL) {
@@ -60,6 +75,15 @@ prom_collector_t *prom_collector_new(const char *name) {
   }
   self->proc_limits_file_path = NULL;
   self->proc_stat_file_path = NULL;
+  self->cache_lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  r = pthread_mutex_init(self->cache_lock, NULL);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+    prom_free(self->cache_lock);
+    self->cache_lock = NULL;
+    prom_collector_destroy(self);
+    return NULL;
+  }
   return self;
 }
 
@@ -74,10 +98,29 @@ int prom_collector_destroy(prom_collector_t *self) {
   if (r) ret = r;
   self->metrics = NULL;
 
+  if (self->names != NULL) {
+    r = prom_trie_destroy(self->names);
+    if (r) ret = r;
+    self->names = NULL;
+  }
+
   r = prom_string_builder_destroy(self->string_builder);
   if (r) ret = r;
   self->string_builder = NULL;
 
+  for (int i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) {
+    if (self->cache[i] == NULL) continue;
+    r = prom_string_builder_destroy(self->cache[i]);
+    if (r) ret = r;
+    self->cache[i] = NULL;
+  }
+  if (self->cache_lock != NULL) {
+    r = pthread_mutex_destroy(self->cache_lock);
+    if (r) ret = r;
+    prom_free(self->cache_lock);
+    self->cache_lock = NULL;
+  }
+
   prom_free((char *)self->name);
   self->name = NULL;
   prom_free(self);
@@ -106,6 +149,30 @@ int prom_collector_set_collect_fn(prom_collector_t *self, prom_collect_fn *fn) {
   return 0;
 }
 
+prom_map_t *prom_collector_metrics(prom_collector_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  return self->metrics;
+}
+
+int prom_collector_set_cache_ttl(prom_collector_t *self, double seconds) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || seconds < 0) return 1;
+
+  int r = pthread_mutex_lock(self->cache_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  for (int i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) {
+    if (seconds > 0 && self->cache[i] == NULL) self->cache[i] = prom_string_builder_new();
+    // Pages rendered under the old TTL are dropped
+    self->cached_at[i] = -1;
+  }
+  self->cache_ttl = seconds;
+  return pthread_mutex_unlock(self->cache_lock);
+}
+
 int prom_collector_add_metric(prom_collector_t *self, prom_metric_t *metric) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
@@ -113,7 +180,9 @@ int prom_collector_add_metric(prom_collector_t *self, prom_metric_t *metric) {
     PROM_LOG("metric already found in collector");
     return 1;
   }
-  return prom_map_set(self->metrics, metric->name, metric);
+  int r = prom_map_set(self->metrics, metric->name, metric);
+  if (r) return r;
+  return prom_trie_set(self->names, metric->name, metric);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -205,9 +274,9 @@ prom_map_t *prom_collector_process_collect(prom_collector_t *self) {
   }
 
   // Set the metric values for max_fds and virtual_memory_max_bytes
-  r = prom_gauge_set(prom_process_max_fds, max_fds->soft, NULL);
+  r = prom_gauge_set_int(prom_process_max_fds, max_fds->soft, NULL);
   if (r) return NULL;
-  r = prom_gauge_set(prom_process_virtual_memory_max_bytes, virtual_memory_max_bytes->soft, NULL);
+  r = prom_gauge_set_int(prom_process_virtual_memory_max_bytes, virtual_memory_max_bytes->soft, NULL);
   if (r) return NULL;
 
   // Aloocate and create a *prom_process_stat_file_t
@@ -230,7 +299,7 @@ prom_map_t *prom_collector_process_collect(prom_collector_t *self) {
     prom_process_stat_destroy(stat);
     return NULL;
   }
-  r = prom_gauge_set(prom_process_virtual_memory_bytes, stat->vsize, NULL);
+  r = prom_gauge_set_int(prom_process_virtual_memory_bytes, stat->vsize, NULL);
   if (r) {
     prom_process_limits_file_destroy(limits_f);
     prom_map_destroy(limits_map);
@@ -238,7 +307,7 @@ prom_map_t *prom_collector_process_collect(prom_collector_t *self) {
     prom_process_stat_destroy(stat);
     return NULL;
   }
-  r = prom_gauge_set(prom_process_resident_memory_bytes, stat->rss*sysconf(_SC_PAGE_SIZE), NULL);
+  r = prom_gauge_set_int(prom_process_resident_memory_bytes, (int64_t)stat->rss * sysconf(_SC_PAGE_SIZE), NULL);
   if (r) {
     prom_process_limits_file_destroy(limits_f);
     prom_map_destroy(limits_map);
@@ -254,7 +323,7 @@ prom_map_t *prom_collector_process_collect(prom_collector_t *self) {
     prom_process_stat_destroy(stat);
     return NULL;
   }
-  r = prom_gauge_set(prom_process_open_fds, prom_process_fds_count(NULL), NULL);
+  r = prom_gauge_set_int(prom_process_open_fds, prom_process_fds_count(NULL), NULL);
   if (r) {
     prom_process_limits_file_destroy(limits_f);
     prom_map_destroy(limits_map);
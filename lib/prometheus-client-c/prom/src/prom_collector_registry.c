@@ -16,7 +16,11 @@
 
 #include <pthread.h>
 #include <regex.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 // Public
 #include "prom_alloc.h"
@@ -32,12 +36,19 @@
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
 #include "prom_metric_i.h"
+#include "prom_metric_sample_i.h"
 #include "prom_metric_t.h"
 #include "prom_process_limits_i.h"
+#include "prom_render_pool_i.h"
+#include "prom_self_metrics_i.h"
 #include "prom_string_builder_i.h"
+#include "prom_sweeper_i.h"
+#include "prom_trie_i.h"
 
 prom_collector_registry_t *PROM_COLLECTOR_REGISTRY_DEFAULT;
 
+static int prom_collector_registry_parts_destroy(prom_collector_registry_parts_t *self);
+
 prom_collector_registry_t *prom_collector_registry_new(const char *name) {
   int r = 0;
 
@@ -58,6 +69,23 @@ prom_collector_registry_t *prom_collector_registry_new(const char *name) {
     PROM_LOG("failed to initialize rwlock");
     return NULL;
   }
+  self->pool_lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  r = pthread_mutex_init(self->pool_lock, NULL);
+  if (r) {
+    PROM_LOG("failed to initialize mutex");
+    return NULL;
+  }
+  self->pool_count = 0;
+  self->leased_count = 0;
+  self->last_len = 0;
+  atomic_init(&self->scrape_stats.count, 0);
+  atomic_init(&self->scrape_stats.nanoseconds, 0);
+  atomic_init(&self->scrape_stats.bytes, 0);
+  for (size_t i = 0; i <= PROM_SELF_METRICS_BUCKET_COUNT; i++) atomic_init(&self->scrape_stats.buckets[i], 0);
+  self->parts_pool_count = 0;
+  self->parts_leased = NULL;
+  self->render_pool = NULL;
+  self->sweeper = NULL;
   return self;
 }
 
@@ -72,6 +100,23 @@ int prom_collector_registry_enable_process_metrics(prom_collector_registry_t *se
   return 1;
 }
 
+int prom_collector_registry_enable_self_metrics(prom_collector_registry_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  prom_collector_t *self_collector = prom_self_metrics_collector_new(self);
+  if (self_collector == NULL) return 1;
+  int r = prom_collector_registry_register_collector(self, self_collector);
+  if (r) prom_collector_destroy(self_collector);
+  return r;
+}
+
+int prom_collector_registry_observe_scrape(prom_collector_registry_t *self, double seconds, size_t bytes) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  prom_self_metrics_observe_scrape(&self->scrape_stats, seconds, bytes);
+  return 0;
+}
+
 int prom_collector_registry_enable_custom_process_metrics(prom_collector_registry_t *self,
                                                           const char *process_limits_path,
                                                           const char *process_stats_path) {
@@ -104,6 +149,11 @@ int prom_collector_registry_destroy(prom_collector_registry_t *self) {
   int r = 0;
   int ret = 0;
 
+  // The sweeper walks the collectors, so it stops before they are freed
+  r = prom_sweeper_destroy(self->sweeper);
+  self->sweeper = NULL;
+  if (r) ret = r;
+
   r = prom_map_destroy(self->collectors);
   self->collectors = NULL;
   if (r) ret = r;
@@ -121,6 +171,37 @@ int prom_collector_registry_destroy(prom_collector_registry_t *self) {
   self->lock = NULL;
   if (r) ret = r;
 
+  // Pages still leased at this point are invalidated along with their formatters
+  for (size_t i = 0; i < self->pool_count; i++) {
+    r = prom_metric_formatter_destroy(self->pool[i]);
+    self->pool[i] = NULL;
+    if (r) ret = r;
+  }
+  for (size_t i = 0; i < self->leased_count; i++) {
+    r = prom_metric_formatter_destroy(self->leased[i]);
+    self->leased[i] = NULL;
+    if (r) ret = r;
+  }
+  for (size_t i = 0; i < self->parts_pool_count; i++) {
+    r = prom_collector_registry_parts_destroy(self->parts_pool[i]);
+    self->parts_pool[i] = NULL;
+    if (r) ret = r;
+  }
+  while (self->parts_leased != NULL) {
+    prom_collector_registry_parts_t *next = self->parts_leased->next;
+    r = prom_collector_registry_parts_destroy(self->parts_leased);
+    self->parts_leased = next;
+    if (r) ret = r;
+  }
+  r = prom_render_pool_destroy(self->render_pool);
+  self->render_pool = NULL;
+  if (r) ret = r;
+
+  r = pthread_mutex_destroy(self->pool_lock);
+  prom_free(self->pool_lock);
+  self->pool_lock = NULL;
+  if (r) ret = r;
+
   prom_free((char *)self->name);
   self->name = NULL;
 
@@ -215,3 +296,600 @@ const char *prom_collector_registry_bridge(prom_collector_registry_t *self) {
   prom_metric_formatter_load_metrics(self->metric_formatter, self->collectors);
   return (const char *)prom_metric_formatter_dump(self->metric_formatter);
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Selection
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int prom_collector_registry_validate_selector(const char *selector) {
+  if (selector == NULL || *selector == '\0') return 1;
+  for (const char *p = selector; *p != '\0'; p++) {
+    if (*p == '*' && p[1] == '\0') return 0;
+    if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || *p == '_' || *p == ':') continue;
+    if (*p >= '0' && *p <= '9' && p != selector) continue;
+    return 1;
+  }
+  return 0;
+}
+
+static bool prom_collector_registry_selector_is_prefix(const char *selector) {
+  size_t len = strlen(selector);
+  return len > 0 && selector[len - 1] == '*';
+}
+
+static bool prom_collector_registry_selector_matches(const char *selector, const char *metric_name) {
+  if (!prom_collector_registry_selector_is_prefix(selector)) return strcmp(selector, metric_name) == 0;
+  return strncmp(selector, metric_name, strlen(selector) - 1) == 0;
+}
+
+static int prom_collector_registry_selector_compare(const void *a, const void *b) {
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+size_t prom_collector_registry_normalize_selectors(const char **selectors, size_t count) {
+  if (selectors == NULL || count == 0) return 0;
+  // '*' sorts before every character allowed in a metric name, so a prefix selector comes before everything it covers
+  qsort(selectors, count, sizeof(const char *), &prom_collector_registry_selector_compare);
+  size_t kept = 0;
+  const char *prefix = NULL;
+  for (size_t i = 0; i < count; i++) {
+    if (kept > 0 && strcmp(selectors[kept - 1], selectors[i]) == 0) continue;
+    if (prefix != NULL && prom_collector_registry_selector_matches(prefix, selectors[i])) continue;
+    if (prom_collector_registry_selector_is_prefix(selectors[i])) prefix = selectors[i];
+    selectors[kept++] = selectors[i];
+  }
+  return kept;
+}
+
+typedef struct prom_collector_registry_selection {
+  prom_metric_formatter_t *formatter;
+  prom_collector_registry_format_t format;
+} prom_collector_registry_selection_t;
+
+static int prom_collector_registry_load_metric(void *value, void *data) {
+  prom_metric_t *metric = (prom_metric_t *)value;
+  prom_collector_registry_selection_t *selection = (prom_collector_registry_selection_t *)data;
+  switch (selection->format) {
+    case PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF:
+      return prom_metric_formatter_load_metric_protobuf(selection->formatter, metric);
+    case PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS:
+      return prom_metric_formatter_load_metric_openmetrics(selection->formatter, metric);
+    default:
+      return prom_metric_formatter_load_metric(selection->formatter, metric);
+  }
+}
+
+/**
+ * @brief Loads the families of collector that match one of the normalized selectors
+ */
+static int prom_collector_registry_load_selected(prom_collector_t *collector,
+                                                 prom_collector_registry_selection_t *selection,
+                                                 const char **selectors, size_t selector_count) {
+  int r = 0;
+
+  // Collect first: collectors such as the process collector refresh their metrics here
+  prom_map_t *metrics = collector->collect_fn(collector);
+  if (metrics == NULL) return 1;
+
+  if (metrics != collector->metrics) {
+    // A custom collect function returned metrics the trie does not index, so match them one by one
+    for (prom_linked_list_node_t *metric_node = metrics->keys->head; metric_node != NULL;
+         metric_node = metric_node->next) {
+      const char *metric_name = (const char *)metric_node->item;
+      for (size_t i = 0; i < selector_count; i++) {
+        if (!prom_collector_registry_selector_matches(selectors[i], metric_name)) continue;
+        r = prom_collector_registry_load_metric(prom_map_get(metrics, metric_name), selection);
+        if (r) return r;
+        break;
+      }
+    }
+    return 0;
+  }
+
+  for (size_t i = 0; i < selector_count; i++) {
+    if (prom_collector_registry_selector_is_prefix(selectors[i])) {
+      // Walk the subtree below the selector minus its '*'
+      r = prom_trie_visit_prefix(collector->names, selectors[i], strlen(selectors[i]) - 1,
+                                 &prom_collector_registry_load_metric, selection);
+    } else {
+      prom_metric_t *metric = (prom_metric_t *)prom_trie_get(collector->names, selectors[i]);
+      if (metric != NULL) r = prom_collector_registry_load_metric(metric, selection);
+    }
+    if (r) return r;
+  }
+  return 0;
+}
+
+/**
+ * @brief Loads every family of collector
+ */
+static int prom_collector_registry_load_all(prom_collector_t *collector,
+                                            prom_collector_registry_selection_t *selection) {
+  int r = 0;
+  prom_map_t *metrics = collector->collect_fn(collector);
+  if (metrics == NULL) return 1;
+
+  for (prom_linked_list_node_t *metric_node = metrics->keys->head; metric_node != NULL;
+       metric_node = metric_node->next) {
+    prom_metric_t *metric = (prom_metric_t *)prom_map_get(metrics, (const char *)metric_node->item);
+    if (metric == NULL) return 1;
+    r = prom_collector_registry_load_metric(metric, selection);
+    if (r) return r;
+  }
+  return 0;
+}
+
+/**
+ * @brief Loads every family of collector, copying the page rendered by an earlier scrape while it is younger than the
+ * collector's cache TTL
+ */
+static int prom_collector_registry_load_collector(prom_collector_t *collector,
+                                                  prom_collector_registry_selection_t *selection) {
+  if (collector->cache_ttl <= 0) return prom_collector_registry_load_all(collector, selection);
+
+  int r = 0;
+  prom_string_builder_t *page = selection->formatter->string_builder;
+
+  // Held while rendering, so concurrent scrapes of a stale collector wait for one render instead of each doing it
+  r = pthread_mutex_lock(collector->cache_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  prom_string_builder_t *cache = collector->cache[selection->format];
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  double now = (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+
+  if (cache != NULL && collector->cached_at[selection->format] >= 0 &&
+      now - collector->cached_at[selection->format] < collector->cache_ttl) {
+    r = prom_string_builder_add_bytes(page, prom_string_builder_str(cache), prom_string_builder_len(cache));
+  } else {
+    size_t start = prom_string_builder_len(page);
+    r = prom_collector_registry_load_all(collector, selection);
+    if (!r && cache != NULL) {
+      prom_string_builder_clear(cache);
+      r = prom_string_builder_add_bytes(cache, prom_string_builder_str(page) + start,
+                                        prom_string_builder_len(page) - start);
+      collector->cached_at[selection->format] = r ? -1 : now;
+    }
+  }
+  pthread_mutex_unlock(collector->cache_lock);
+  return r;
+}
+
+/**
+ * @brief Loads the families of collector matching selectors, or all of them if selectors is NULL, and records how long
+ * that took
+ */
+static int prom_collector_registry_load_one(prom_collector_t *collector,
+                                            prom_collector_registry_selection_t *selection, const char **selectors,
+                                            size_t selector_count) {
+  int r = 0;
+  uint64_t start = prom_self_metrics_now();
+  if (selectors != NULL) {
+    r = prom_collector_registry_load_selected(collector, selection, selectors, selector_count);
+  } else {
+    r = prom_collector_registry_load_collector(collector, selection);
+  }
+  prom_self_metrics_observe_render(collector, prom_self_metrics_now() - start, r != 0);
+  return r;
+}
+
+/**
+ * @brief Loads the named collector, or every collector if collector_name is NULL. If selectors is not NULL only the
+ * families matching one of them are loaded.
+ */
+static int prom_collector_registry_load(prom_collector_registry_t *self, prom_metric_formatter_t *formatter,
+                                       prom_collector_registry_format_t format, const char *collector_name,
+                                       const char **selectors, size_t selector_count) {
+  int r = 0;
+  prom_collector_registry_selection_t selection = {formatter, format};
+
+  for (prom_linked_list_node_t *current_node = self->collectors->keys->head; current_node != NULL;
+       current_node = current_node->next) {
+    const char *name = (const char *)current_node->item;
+    if (collector_name != NULL && strcmp(name, collector_name) != 0) continue;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(self->collectors, name);
+    if (collector == NULL) return 1;
+
+    r = prom_collector_registry_load_one(collector, &selection, selectors, selector_count);
+    if (r) return r;
+  }
+  if (format == PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS) {
+    return prom_metric_formatter_load_openmetrics_eof(formatter);
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Leases
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char *prom_collector_registry_lease(prom_collector_registry_t *self,
+                                                 prom_collector_registry_format_t format, const char *collector_name,
+                                                 const char **selectors, size_t selector_count, size_t *len);
+
+const char *prom_collector_registry_bridge_lease(prom_collector_registry_t *self, size_t *len) {
+  return prom_collector_registry_lease(self, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, NULL, NULL, 0, len);
+}
+
+const char *prom_collector_registry_bridge_lease_format(prom_collector_registry_t *self,
+                                                        prom_collector_registry_format_t format, size_t *len) {
+  return prom_collector_registry_lease(self, format, NULL, NULL, 0, len);
+}
+
+const char *prom_collector_registry_bridge_lease_select(prom_collector_registry_t *self,
+                                                        prom_collector_registry_format_t format,
+                                                        const char **selectors, size_t selector_count, size_t *len) {
+  return prom_collector_registry_bridge_lease_collector(self, format, NULL, selectors, selector_count, len);
+}
+
+const char *prom_collector_registry_bridge_lease_collector(prom_collector_registry_t *self,
+                                                           prom_collector_registry_format_t format,
+                                                           const char *collector_name, const char **selectors,
+                                                           size_t selector_count, size_t *len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  if (collector_name != NULL && prom_map_get(self->collectors, collector_name) == NULL) {
+    PROM_LOG(PROM_COLLECTOR_REGISTRY_UNKNOWN_COLLECTOR);
+    return NULL;
+  }
+  if (selectors == NULL) return prom_collector_registry_lease(self, format, collector_name, NULL, 0, len);
+
+  for (size_t i = 0; i < selector_count; i++) {
+    if (prom_collector_registry_validate_selector(selectors[i])) {
+      PROM_LOG(PROM_COLLECTOR_REGISTRY_INVALID_SELECTOR);
+      return NULL;
+    }
+  }
+
+  // Normalize a copy; the caller's array is left as it was
+  const char **normalized = (const char **)prom_malloc((selector_count + 1) * sizeof(const char *));
+  memcpy(normalized, selectors, selector_count * sizeof(const char *));
+  size_t normalized_count = prom_collector_registry_normalize_selectors(normalized, selector_count);
+  const char *page =
+      prom_collector_registry_lease(self, format, collector_name, normalized, normalized_count, len);
+  prom_free(normalized);
+  return page;
+}
+
+bool prom_collector_registry_has_collector(prom_collector_registry_t *self, const char *collector_name) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || collector_name == NULL) return false;
+  return prom_map_get(self->collectors, collector_name) != NULL;
+}
+
+static const char *prom_collector_registry_lease(prom_collector_registry_t *self,
+                                                 prom_collector_registry_format_t format, const char *collector_name,
+                                                 const char **selectors, size_t selector_count, size_t *len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  int r = 0;
+
+  r = pthread_mutex_lock(self->pool_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return NULL;
+  }
+  bool pooled = self->leased_count < PROM_COLLECTOR_REGISTRY_POOL_SIZE;
+  prom_metric_formatter_t *formatter = NULL;
+  if (pooled && self->pool_count > 0) {
+    formatter = self->pool[--self->pool_count];
+  } else {
+    formatter = prom_metric_formatter_new();
+    if (formatter == NULL) {
+      pthread_mutex_unlock(self->pool_lock);
+      return NULL;
+    }
+    // Size a cold formatter from the last page so it does not regrow through repeated reallocs
+    prom_string_builder_reserve(formatter->string_builder, self->last_len + self->last_len / 8);
+  }
+  if (pooled) {
+    self->leased_pages[self->leased_count] = NULL;
+    self->leased[self->leased_count++] = formatter;
+  }
+  pthread_mutex_unlock(self->pool_lock);
+
+  prom_metric_formatter_clear(formatter);
+  r = prom_collector_registry_load(self, formatter, format, collector_name, selectors, selector_count);
+  *len = prom_string_builder_len(formatter->string_builder);
+  const char *page = prom_string_builder_str(formatter->string_builder);
+
+  if (!pooled) {
+    // Every pooled formatter is in flight; hand out a copy, which prom_collector_registry_bridge_return frees
+    page = r ? NULL : prom_string_builder_dump(formatter->string_builder);
+    prom_metric_formatter_destroy(formatter);
+    return page;
+  }
+
+  // Returns look pages up by address, which is only settled now that the formatter is done growing its buffer
+  pthread_mutex_lock(self->pool_lock);
+  for (size_t i = 0; i < self->leased_count; i++) {
+    if (self->leased[i] == formatter) self->leased_pages[i] = page;
+  }
+  // Partial pages are much smaller than full ones and would make a poor size hint
+  if (!r && collector_name == NULL && selectors == NULL) self->last_len = *len;
+  pthread_mutex_unlock(self->pool_lock);
+
+  if (r) {
+    prom_collector_registry_bridge_return(self, page);
+    return NULL;
+  }
+  return page;
+}
+
+int prom_collector_registry_bridge_return(prom_collector_registry_t *self, const char *page) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (page == NULL) return 0;
+
+  int r = 0;
+
+  r = pthread_mutex_lock(self->pool_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  for (size_t i = 0; i < self->leased_count; i++) {
+    if (self->leased_pages[i] != page) continue;
+
+    prom_metric_formatter_t *formatter = self->leased[i];
+    self->leased[i] = self->leased[--self->leased_count];
+    self->leased_pages[i] = self->leased_pages[self->leased_count];
+    self->leased[self->leased_count] = NULL;
+    self->leased_pages[self->leased_count] = NULL;
+    self->pool[self->pool_count++] = formatter;
+    return pthread_mutex_unlock(self->pool_lock);
+  }
+  pthread_mutex_unlock(self->pool_lock);
+
+  // Not leased from the pool, so it is a copy made by prom_collector_registry_bridge
+  prom_free((char *)page);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pages in parts
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static prom_collector_registry_parts_t *prom_collector_registry_parts_new(void) {
+  prom_collector_registry_parts_t *self =
+      (prom_collector_registry_parts_t *)prom_malloc(sizeof(prom_collector_registry_parts_t));
+  self->collectors = NULL;
+  self->formatters = NULL;
+  self->parts = NULL;
+  self->allocated = 0;
+  self->next = NULL;
+  return self;
+}
+
+static int prom_collector_registry_parts_destroy(prom_collector_registry_parts_t *self) {
+  if (self == NULL) return 0;
+  int r = 0;
+  int ret = 0;
+  for (size_t i = 0; i < self->allocated; i++) {
+    r = prom_metric_formatter_destroy(self->formatters[i]);
+    self->formatters[i] = NULL;
+    if (r) ret = r;
+  }
+  prom_free(self->formatters);
+  self->formatters = NULL;
+  prom_free(self->collectors);
+  self->collectors = NULL;
+  prom_free(self->parts);
+  self->parts = NULL;
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+// Makes room for count collectors
+static int prom_collector_registry_parts_reserve(prom_collector_registry_parts_t *self, size_t count) {
+  if (count <= self->allocated) return 0;
+
+  // Each array is only replaced once it grew, so a failure leaves self as it was, minus some spare capacity
+  prom_collector_t **collectors =
+      (prom_collector_t **)prom_realloc(self->collectors, count * sizeof(prom_collector_t *));
+  if (collectors == NULL) return 1;
+  self->collectors = collectors;
+  prom_metric_formatter_t **formatters =
+      (prom_metric_formatter_t **)prom_realloc(self->formatters, count * sizeof(prom_metric_formatter_t *));
+  if (formatters == NULL) return 1;
+  self->formatters = formatters;
+  prom_collector_registry_part_t *parts =
+      (prom_collector_registry_part_t *)prom_realloc(self->parts, count * sizeof(prom_collector_registry_part_t));
+  if (parts == NULL) return 1;
+  self->parts = parts;
+
+  for (; self->allocated < count; self->allocated++) {
+    self->formatters[self->allocated] = prom_metric_formatter_new();
+    if (self->formatters[self->allocated] == NULL) return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Unlinks the page *link points to from parts_leased and pools it. The caller holds pool_lock.
+ *
+ * @return The page if the pool is full, for the caller to destroy once pool_lock is released, or NULL
+ */
+static prom_collector_registry_parts_t *prom_collector_registry_parts_unlease(prom_collector_registry_t *self,
+                                                                              prom_collector_registry_parts_t **link) {
+  prom_collector_registry_parts_t *leased = *link;
+  *link = leased->next;
+  leased->next = NULL;
+  if (self->parts_pool_count < PROM_COLLECTOR_REGISTRY_POOL_SIZE) {
+    self->parts_pool[self->parts_pool_count++] = leased;
+    return NULL;
+  }
+  return leased;
+}
+
+// What the jobs rendering a page share
+typedef struct prom_collector_registry_render {
+  prom_collector_registry_parts_t *parts;
+  prom_collector_registry_format_t format;
+} prom_collector_registry_render_t;
+
+static int prom_collector_registry_render_job(void *data, size_t index) {
+  prom_collector_registry_render_t *render = (prom_collector_registry_render_t *)data;
+  prom_metric_formatter_t *formatter = render->parts->formatters[index];
+  prom_metric_formatter_clear(formatter);
+  prom_collector_registry_selection_t selection = {formatter, render->format};
+  return prom_collector_registry_load_one(render->parts->collectors[index], &selection, NULL, 0);
+}
+
+const prom_collector_registry_part_t *prom_collector_registry_bridge_lease_parts(
+    prom_collector_registry_t *self, prom_collector_registry_format_t format, size_t *count, size_t *len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  int r = 0;
+
+  r = pthread_mutex_lock(self->pool_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return NULL;
+  }
+  prom_collector_registry_parts_t *parts = NULL;
+  if (self->parts_pool_count > 0) {
+    parts = self->parts_pool[--self->parts_pool_count];
+  } else {
+    parts = prom_collector_registry_parts_new();
+  }
+  parts->next = self->parts_leased;
+  self->parts_leased = parts;
+  pthread_mutex_unlock(self->pool_lock);
+
+  // One formatter per collector, and at least one for the OpenMetrics EOF marker
+  size_t collector_count = self->collectors->size;
+  r = prom_collector_registry_parts_reserve(parts, collector_count > 0 ? collector_count : 1);
+  size_t n = 0;
+  for (prom_linked_list_node_t *node = self->collectors->keys->head; !r && node != NULL && n < collector_count;
+       node = node->next) {
+    parts->collectors[n] = (prom_collector_t *)prom_map_get(self->collectors, (const char *)node->item);
+    if (parts->collectors[n] == NULL) r = 1;
+    n++;
+  }
+
+  if (!r) {
+    prom_collector_registry_render_t render = {parts, format};
+    r = prom_render_pool_run(self->render_pool, &prom_collector_registry_render_job, &render, n);
+  }
+  if (!r && format == PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS) {
+    if (n == 0) prom_metric_formatter_clear(parts->formatters[0]);
+    r = prom_metric_formatter_load_openmetrics_eof(parts->formatters[n > 0 ? n - 1 : 0]);
+    if (n == 0) n = 1;
+  }
+  if (r) {
+    // parts->parts may still be NULL if reserving failed, so the page is unlinked by its own pointer
+    pthread_mutex_lock(self->pool_lock);
+    prom_collector_registry_parts_t **link = &self->parts_leased;
+    while (*link != parts) link = &(*link)->next;
+    parts = prom_collector_registry_parts_unlease(self, link);
+    pthread_mutex_unlock(self->pool_lock);
+    prom_collector_registry_parts_destroy(parts);
+    return NULL;
+  }
+
+  *count = 0;
+  *len = 0;
+  for (size_t i = 0; i < n; i++) {
+    prom_string_builder_t *page = parts->formatters[i]->string_builder;
+    size_t part_len = prom_string_builder_len(page);
+    if (part_len == 0) continue;
+    parts->parts[*count].data = prom_string_builder_str(page);
+    parts->parts[*count].len = part_len;
+    (*count)++;
+    *len += part_len;
+  }
+  return parts->parts;
+}
+
+int prom_collector_registry_bridge_return_parts(prom_collector_registry_t *self,
+                                                const prom_collector_registry_part_t *parts) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (parts == NULL) return 0;
+
+  int r = 0;
+
+  r = pthread_mutex_lock(self->pool_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  prom_collector_registry_parts_t **link = &self->parts_leased;
+  while (*link != NULL && (*link)->parts != parts) link = &(*link)->next;
+  prom_collector_registry_parts_t *leased = *link;
+  if (leased == NULL) {
+    pthread_mutex_unlock(self->pool_lock);
+    PROM_LOG("the given parts were not leased from this registry");
+    return 1;
+  }
+  leased = prom_collector_registry_parts_unlease(self, link);
+  pthread_mutex_unlock(self->pool_lock);
+  return prom_collector_registry_parts_destroy(leased);
+}
+
+int prom_collector_registry_set_render_threads(prom_collector_registry_t *self, size_t thread_count) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = prom_render_pool_destroy(self->render_pool);
+  self->render_pool = NULL;
+  if (r) return r;
+  if (thread_count == 0) return 0;
+  self->render_pool = prom_render_pool_new(thread_count);
+  return self->render_pool == NULL ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Series eviction
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int prom_collector_registry_sweep(prom_collector_registry_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = pthread_rwlock_rdlock(self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  // Reads the clock once so every metric is swept against the same time
+  uint64_t now = prom_metric_sample_clock();
+  int ret = 0;
+  for (prom_linked_list_node_t *collector_node = self->collectors->keys->head; collector_node != NULL;
+       collector_node = collector_node->next) {
+    const char *name = (const char *)collector_node->item;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(self->collectors, name);
+    if (collector == NULL) continue;
+    for (prom_linked_list_node_t *metric_node = collector->metrics->keys->head; metric_node != NULL;
+         metric_node = metric_node->next) {
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(collector->metrics, (const char *)metric_node->item);
+      if (metric == NULL) continue;
+      r = prom_metric_sweep(metric, now);
+      if (r && !ret) ret = r;
+    }
+  }
+  pthread_rwlock_unlock(self->lock);
+  return ret;
+}
+
+int prom_collector_registry_set_sweep_interval(prom_collector_registry_t *self, double seconds) {
+  PROM_ASSERT(self != NULL);
+  // NaN, infinities and intervals past the range of the nanosecond clock are refused; (double)UINT64_MAX is 2^64
+  if (self == NULL || !(seconds >= 0.0 && seconds * 1e9 < (double)UINT64_MAX)) return 1;
+
+  int r = prom_sweeper_destroy(self->sweeper);
+  self->sweeper = NULL;
+  if (r) return r;
+  uint64_t interval = (uint64_t)(seconds * 1e9);
+  if (interval == 0) return 0;
+  self->sweeper = prom_sweeper_new(self, interval);
+  return self->sweeper == NULL ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+#include "prom_collector_registry.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_collector_registry_snapshot_t.h"
+#include "prom_collector_registry_t.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_map_i.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_sample_summary_t.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_t.h"
+#include "prom_self_metrics_i.h"
+#include "prom_string_builder_i.h"
+
+prom_collector_registry_snapshot_t *prom_collector_registry_snapshot_new(void) {
+  prom_collector_registry_snapshot_t *self =
+      (prom_collector_registry_snapshot_t *)prom_malloc(sizeof(prom_collector_registry_snapshot_t));
+  self->families = NULL;
+  self->family_count = 0;
+  self->families_allocated = 0;
+  self->samples = NULL;
+  self->sample_count = 0;
+  self->samples_allocated = 0;
+  self->strings = prom_string_builder_new();
+  self->formatter = prom_metric_formatter_new();
+  if (self->strings == NULL || self->formatter == NULL) {
+    prom_collector_registry_snapshot_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_collector_registry_snapshot_destroy(prom_collector_registry_snapshot_t *self) {
+  if (self == NULL) return 0;
+  int r = 0;
+  int ret = 0;
+
+  prom_free(self->families);
+  self->families = NULL;
+  prom_free(self->samples);
+  self->samples = NULL;
+  if (self->strings != NULL) {
+    r = prom_string_builder_destroy(self->strings);
+    self->strings = NULL;
+    if (r) ret = r;
+  }
+  if (self->formatter != NULL) {
+    r = prom_metric_formatter_destroy(self->formatter);
+    self->formatter = NULL;
+    if (r) ret = r;
+  }
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+static void prom_collector_registry_snapshot_clear(prom_collector_registry_snapshot_t *self) {
+  self->family_count = 0;
+  self->sample_count = 0;
+  prom_string_builder_clear(self->strings);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copying
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Appends a null terminated copy of str to the strings of the snapshot
+static int prom_collector_registry_snapshot_add_string(prom_collector_registry_snapshot_t *self, const char *str,
+                                                       size_t len) {
+  int r = prom_string_builder_add_bytes(self->strings, str, len);
+  if (r) return r;
+  return prom_string_builder_add_char(self->strings, '\0');
+}
+
+// Appends a line whose value the caller fills in. l_value is linked once every string has been copied, because the
+// strings may still move while they grow.
+static prom_collector_registry_snapshot_sample_t *prom_collector_registry_snapshot_add_line(
+    prom_collector_registry_snapshot_t *self, const char *l_value, size_t l_value_len) {
+  if (self->sample_count == self->samples_allocated) {
+    size_t allocated = self->samples_allocated == 0 ? 64 : self->samples_allocated * 2;
+    prom_collector_registry_snapshot_sample_t *samples = (prom_collector_registry_snapshot_sample_t *)prom_realloc(
+        self->samples, allocated * sizeof(prom_collector_registry_snapshot_sample_t));
+    if (samples == NULL) return NULL;
+    self->samples = samples;
+    self->samples_allocated = allocated;
+  }
+  if (prom_collector_registry_snapshot_add_string(self, l_value, l_value_len)) return NULL;
+
+  prom_collector_registry_snapshot_sample_t *sample = &self->samples[self->sample_count++];
+  sample->l_value = NULL;
+  sample->l_value_len = l_value_len;
+  sample->integer = false;
+  sample->i_value = 0;
+  sample->r_value = 0.0;
+  return sample;
+}
+
+// Copies the bucket, count and sum lines of a histogram sample, in the order of its l_value_list
+static int prom_collector_registry_snapshot_add_histogram(prom_collector_registry_snapshot_t *self,
+                                                          prom_metric_sample_histogram_t *hist_sample) {
+  size_t bucket_count = prom_histogram_buckets_count(hist_sample->buckets);
+  uint64_t *cumulative =
+      (uint64_t *)prom_metric_formatter_scratch(self->formatter, (bucket_count + 1) * sizeof(uint64_t));
+  if (cumulative == NULL) return 1;
+  double sum = 0.0;
+  prom_metric_sample_histogram_collect(hist_sample, cumulative, &sum);
+
+  size_t i = 0;
+  for (prom_linked_list_node_t *current_node = hist_sample->l_value_list->head; current_node != NULL;
+       current_node = current_node->next, i++) {
+    prom_metric_sample_t *sample =
+        (prom_metric_sample_t *)prom_map_get(hist_sample->samples, (const char *)current_node->item);
+    if (sample == NULL) return 1;
+    prom_collector_registry_snapshot_sample_t *line =
+        prom_collector_registry_snapshot_add_line(self, sample->l_value, sample->l_value_len);
+    if (line == NULL) return 1;
+    // The total count is the count of the +Inf bucket
+    if (i <= bucket_count + 1) {
+      line->integer = true;
+      line->i_value = (int64_t)cumulative[i <= bucket_count ? i : bucket_count];
+    } else {
+      line->r_value = sum;
+    }
+  }
+  return 0;
+}
+
+// Copies the quantile, count and sum lines of a summary sample, in the order of its l_value_list
+static int prom_collector_registry_snapshot_add_summary(prom_collector_registry_snapshot_t *self,
+                                                        prom_metric_sample_summary_t *summary_sample) {
+  size_t quantile_count = summary_sample->config->quantile_count;
+  double *quantile_values =
+      (double *)prom_metric_formatter_scratch(self->formatter, (quantile_count + 1) * sizeof(double));
+  if (quantile_values == NULL) return 1;
+  uint64_t count = 0;
+  double sum = 0.0;
+  int r = prom_metric_sample_summary_collect(summary_sample, quantile_values, &count, &sum);
+  if (r) return r;
+
+  size_t i = 0;
+  for (prom_linked_list_node_t *current_node = summary_sample->l_value_list->head; current_node != NULL;
+       current_node = current_node->next, i++) {
+    const char *l_value = (const char *)current_node->item;
+    prom_collector_registry_snapshot_sample_t *line =
+        prom_collector_registry_snapshot_add_line(self, l_value, strlen(l_value));
+    if (line == NULL) return 1;
+    if (i < quantile_count) {
+      line->r_value = quantile_values[i];
+    } else if (i == quantile_count) {
+      line->integer = true;
+      line->i_value = (int64_t)count;
+    } else {
+      line->r_value = sum;
+    }
+  }
+  return 0;
+}
+
+// Copies the family and every line of a metric
+static int prom_collector_registry_snapshot_add_metric(prom_collector_registry_snapshot_t *self,
+                                                       prom_metric_t *metric) {
+  int r = 0;
+
+  if (self->family_count == self->families_allocated) {
+    size_t allocated = self->families_allocated == 0 ? 16 : self->families_allocated * 2;
+    prom_collector_registry_snapshot_family_t *families = (prom_collector_registry_snapshot_family_t *)prom_realloc(
+        self->families, allocated * sizeof(prom_collector_registry_snapshot_family_t));
+    if (families == NULL) return 1;
+    self->families = families;
+    self->families_allocated = allocated;
+  }
+  r = prom_collector_registry_snapshot_add_string(self, metric->name, strlen(metric->name));
+  if (r) return r;
+  r = prom_collector_registry_snapshot_add_string(self, metric->header, metric->header_len);
+  if (r) return r;
+
+  size_t first = self->sample_count;
+
+  // Every line of the metric is copied under one read lock, which samples are created, removed and replaced without
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL && r == 0;
+       current_node = current_node->next) {
+    const char *key = (const char *)current_node->item;
+    if (metric->type == PROM_HISTOGRAM) {
+      prom_metric_sample_histogram_t *hist_sample =
+          (prom_metric_sample_histogram_t *)prom_map_get(metric->samples, key);
+      r = hist_sample == NULL ? 1 : prom_collector_registry_snapshot_add_histogram(self, hist_sample);
+    } else if (metric->type == PROM_SUMMARY) {
+      prom_metric_sample_summary_t *summary_sample =
+          (prom_metric_sample_summary_t *)prom_map_get(metric->samples, key);
+      r = summary_sample == NULL ? 1 : prom_collector_registry_snapshot_add_summary(self, summary_sample);
+    } else {
+      prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(metric->samples, key);
+      prom_collector_registry_snapshot_sample_t *line =
+          sample == NULL ? NULL : prom_collector_registry_snapshot_add_line(self, sample->l_value, sample->l_value_len);
+      if (line == NULL) {
+        r = 1;
+      } else if (sample->integer) {
+        line->integer = true;
+        line->i_value = atomic_load(&sample->i_value);
+      } else {
+        line->r_value = prom_metric_sample_value(sample);
+      }
+    }
+  }
+  pthread_rwlock_unlock(metric->rwlock);
+  if (r) return r;
+
+  prom_collector_registry_snapshot_family_t *family = &self->families[self->family_count++];
+  family->name = NULL;
+  family->type = prom_metric_type_map[metric->type];
+  family->header = NULL;
+  family->header_len = metric->header_len;
+  family->first = first;
+  family->count = self->sample_count - first;
+  return 0;
+}
+
+// Points the families and lines at their strings, which were copied in the same order
+static void prom_collector_registry_snapshot_link(prom_collector_registry_snapshot_t *self) {
+  const char *str = prom_string_builder_str(self->strings);
+  for (size_t f = 0; f < self->family_count; f++) {
+    prom_collector_registry_snapshot_family_t *family = &self->families[f];
+    family->name = str;
+    str += strlen(str) + 1;
+    family->header = str;
+    str += family->header_len + 1;
+    for (size_t i = family->first; i < family->first + family->count; i++) {
+      self->samples[i].l_value = str;
+      str += self->samples[i].l_value_len + 1;
+    }
+  }
+}
+
+int prom_collector_registry_snapshot(prom_collector_registry_t *self, prom_collector_registry_snapshot_t *snapshot) {
+  PROM_ASSERT(self != NULL);
+  PROM_ASSERT(snapshot != NULL);
+  if (self == NULL || snapshot == NULL) return 1;
+
+  prom_collector_registry_snapshot_clear(snapshot);
+
+  int r = pthread_rwlock_rdlock(self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  for (prom_linked_list_node_t *collector_node = self->collectors->keys->head; collector_node != NULL && r == 0;
+       collector_node = collector_node->next) {
+    const char *name = (const char *)collector_node->item;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(self->collectors, name);
+    if (collector == NULL) {
+      r = 1;
+      break;
+    }
+
+    uint64_t start = prom_self_metrics_now();
+    prom_map_t *metrics = collector->collect_fn(collector);
+    if (metrics == NULL) r = 1;
+    for (prom_linked_list_node_t *metric_node = metrics == NULL ? NULL : metrics->keys->head;
+         metric_node != NULL && r == 0; metric_node = metric_node->next) {
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(metrics, (const char *)metric_node->item);
+      r = metric == NULL ? 1 : prom_collector_registry_snapshot_add_metric(snapshot, metric);
+    }
+    prom_self_metrics_observe_render(collector, prom_self_metrics_now() - start, r != 0);
+  }
+  pthread_rwlock_unlock(self->lock);
+
+  if (r) {
+    prom_collector_registry_snapshot_clear(snapshot);
+    return r;
+  }
+  prom_collector_registry_snapshot_link(snapshot);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reading
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const prom_collector_registry_snapshot_family_t *prom_collector_registry_snapshot_families(
+    const prom_collector_registry_snapshot_t *self, size_t *count) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  *count = self->family_count;
+  return self->families;
+}
+
+const prom_collector_registry_snapshot_sample_t *prom_collector_registry_snapshot_samples(
+    const prom_collector_registry_snapshot_t *self, size_t *count) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  *count = self->sample_count;
+  return self->samples;
+}
+
+const char *prom_collector_registry_snapshot_render(prom_collector_registry_snapshot_t *self, size_t *len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  int r = prom_metric_formatter_clear(self->formatter);
+  if (r) return NULL;
+  r = prom_metric_formatter_load_snapshot(self->formatter, self);
+  if (r) return NULL;
+  *len = prom_string_builder_len(self->formatter->string_builder);
+  return prom_string_builder_str(self->formatter->string_builder);
+}
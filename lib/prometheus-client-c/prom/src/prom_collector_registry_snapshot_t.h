@@ -0,0 +1,40 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_COLLECTOR_REGISTRY_SNAPSHOT_T_H
+#define PROM_COLLECTOR_REGISTRY_SNAPSHOT_T_H
+
+#include <stddef.h>
+
+// Public
+#include "prom_collector_registry.h"
+
+// Private
+#include "prom_metric_formatter_t.h"
+#include "prom_string_builder_t.h"
+
+struct prom_collector_registry_snapshot {
+  prom_collector_registry_snapshot_family_t *families; /**< the families, in the order they are exposed */
+  size_t family_count;                                 /**< the number of families */
+  size_t families_allocated;                           /**< the length of families */
+  prom_collector_registry_snapshot_sample_t *samples;  /**< the lines of every family, family after family */
+  size_t sample_count;                                 /**< the number of lines */
+  size_t samples_allocated;                            /**< the length of samples */
+  prom_string_builder_t *strings;     /**< the name, header and l_values of each family in turn, null terminated */
+  prom_metric_formatter_t *formatter; /**< holds the page of prom_collector_registry_snapshot_render */
+};
+
+#endif  // PROM_COLLECTOR_REGISTRY_SNAPSHOT_T_H
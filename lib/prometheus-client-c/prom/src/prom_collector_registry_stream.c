@@ -0,0 +1,245 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <pthread.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+#include "prom_collector_registry.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_collector_registry_stream_t.h"
+#include "prom_collector_registry_t.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_map_i.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_t.h"
+#include "prom_self_metrics_i.h"
+#include "prom_string_builder_i.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_collector_registry_stream_cursor
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void prom_collector_registry_stream_cursor_init(prom_collector_registry_stream_cursor_t *self, prom_map_t *map) {
+  self->map = map;
+  self->node = map->keys->head;
+  self->ordinal = 0;
+  self->version = map->version;
+}
+
+static void prom_collector_registry_stream_cursor_sync(prom_collector_registry_stream_cursor_t *self) {
+  if (self->version == self->map->version) {
+    // A NULL node may have gained a successor since it was read
+    if (self->node == NULL && self->ordinal < self->map->size) {
+      self->node = self->map->keys->head;
+      for (size_t i = 0; i < self->ordinal && self->node != NULL; i++) self->node = self->node->next;
+    }
+    return;
+  }
+  self->node = self->map->keys->head;
+  for (size_t i = 0; i < self->ordinal && self->node != NULL; i++) self->node = self->node->next;
+  self->version = self->map->version;
+}
+
+static const char *prom_collector_registry_stream_cursor_next(prom_collector_registry_stream_cursor_t *self) {
+  if (self->node == NULL) return NULL;
+  const char *key = (const char *)self->node->item;
+  self->node = self->node->next;
+  self->ordinal++;
+  return key;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_collector_registry_stream
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+prom_collector_registry_stream_t *prom_collector_registry_stream_new(prom_collector_registry_t *registry) {
+  PROM_ASSERT(registry != NULL);
+  if (registry == NULL) return NULL;
+
+  prom_collector_registry_stream_t *self =
+      (prom_collector_registry_stream_t *)prom_malloc(sizeof(prom_collector_registry_stream_t));
+  self->registry = registry;
+  self->formatter = prom_metric_formatter_new();
+  if (self->formatter == NULL) {
+    prom_free(self);
+    return NULL;
+  }
+  self->offset = 0;
+  prom_collector_registry_stream_cursor_init(&self->collectors, registry->collectors);
+  self->in_collector = false;
+  self->metric = NULL;
+  self->done = false;
+  return self;
+}
+
+int prom_collector_registry_stream_destroy(prom_collector_registry_stream_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+  int r = prom_metric_formatter_destroy(self->formatter);
+  self->formatter = NULL;
+  prom_free(self);
+  self = NULL;
+  return r;
+}
+
+// Renders the next collector's metrics map into self->metrics, or sets self->done when there are no collectors left
+static int prom_collector_registry_stream_next_collector(prom_collector_registry_stream_t *self) {
+  int r = 0;
+
+  r = pthread_rwlock_rdlock(self->registry->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  prom_collector_registry_stream_cursor_sync(&self->collectors);
+  const char *collector_name = prom_collector_registry_stream_cursor_next(&self->collectors);
+  prom_collector_t *collector =
+      collector_name == NULL ? NULL : (prom_collector_t *)prom_map_get(self->registry->collectors, collector_name);
+  pthread_rwlock_unlock(self->registry->lock);
+
+  if (collector_name == NULL) {
+    self->done = true;
+    return 0;
+  }
+  if (collector == NULL) return 1;
+
+  // Rendering is spread over many reads, so only the collect call is timed
+  uint64_t start = prom_self_metrics_now();
+  prom_map_t *metrics = collector->collect_fn(collector);
+  prom_self_metrics_observe_render(collector, prom_self_metrics_now() - start, metrics == NULL);
+  if (metrics == NULL) return 1;
+  prom_collector_registry_stream_cursor_init(&self->metrics, metrics);
+  self->in_collector = true;
+  return 0;
+}
+
+// Renders the HELP and TYPE lines of the next metric of the current collector
+static int prom_collector_registry_stream_next_metric(prom_collector_registry_stream_t *self) {
+  int r = 0;
+
+  prom_collector_registry_stream_cursor_sync(&self->metrics);
+  const char *metric_name = prom_collector_registry_stream_cursor_next(&self->metrics);
+  if (metric_name == NULL) {
+    self->in_collector = false;
+    return 0;
+  }
+  prom_metric_t *metric = (prom_metric_t *)prom_map_get(self->metrics.map, metric_name);
+  if (metric == NULL) return 1;
+
+  r = prom_metric_formatter_load_header(self->formatter, metric);
+  if (r) return r;
+
+  // The list of keys changes when samples are created, removed or replaced, which takes the write lock
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  self->metric = metric;
+  prom_collector_registry_stream_cursor_init(&self->samples, metric->samples);
+  pthread_rwlock_unlock(metric->rwlock);
+  return 0;
+}
+
+// Renders samples of the current metric until the batch is full or the metric is exhausted
+static int prom_collector_registry_stream_next_samples(prom_collector_registry_stream_t *self) {
+  int r = 0;
+  prom_metric_t *metric = self->metric;
+
+  // The write lock taken to create samples keeps the samples map stable while the batch renders
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  prom_collector_registry_stream_cursor_sync(&self->samples);
+
+  const char *key = NULL;
+  while (prom_string_builder_len(self->formatter->string_builder) < PROM_COLLECTOR_REGISTRY_STREAM_BATCH_SIZE &&
+         (key = prom_collector_registry_stream_cursor_next(&self->samples)) != NULL) {
+    if (metric->type == PROM_HISTOGRAM) {
+      prom_metric_sample_histogram_t *hist_sample =
+          (prom_metric_sample_histogram_t *)prom_map_get(metric->samples, key);
+      r = hist_sample == NULL ? 1 : prom_metric_formatter_load_histogram(self->formatter, hist_sample);
+      if (r) break;
+    } else if (metric->type == PROM_SUMMARY) {
+      prom_metric_sample_summary_t *summary_sample =
+          (prom_metric_sample_summary_t *)prom_map_get(metric->samples, key);
+      r = summary_sample == NULL ? 1 : prom_metric_formatter_load_summary(self->formatter, summary_sample);
+      if (r) break;
+    } else {
+      prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(metric->samples, key);
+      if (sample == NULL) {
+        r = 1;
+        break;
+      }
+      r = prom_metric_formatter_load_sample(self->formatter, sample);
+      if (r) break;
+    }
+  }
+  bool exhausted = self->samples.node == NULL;
+  pthread_rwlock_unlock(metric->rwlock);
+  if (r) return r;
+
+  if (exhausted) {
+    self->metric = NULL;
+    return prom_string_builder_add_char(self->formatter->string_builder, '\n');
+  }
+  return 0;
+}
+
+int prom_collector_registry_stream_read(prom_collector_registry_stream_t *self, char *buf, size_t max, size_t *len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  prom_string_builder_t *batch = self->formatter->string_builder;
+
+  *len = 0;
+  while (*len < max) {
+    size_t pending = prom_string_builder_len(batch) - self->offset;
+    if (pending > 0) {
+      size_t n = pending < max - *len ? pending : max - *len;
+      memcpy(buf + *len, prom_string_builder_str(batch) + self->offset, n);
+      self->offset += n;
+      *len += n;
+      continue;
+    }
+    if (self->done) break;
+
+    // The batch has been handed out in full, so render the next one in its place
+    r = prom_string_builder_clear(batch);
+    if (r) return r;
+    self->offset = 0;
+
+    if (self->metric != NULL) {
+      r = prom_collector_registry_stream_next_samples(self);
+    } else if (self->in_collector) {
+      r = prom_collector_registry_stream_next_metric(self);
+    } else {
+      r = prom_collector_registry_stream_next_collector(self);
+    }
+    if (r) return r;
+  }
+  return 0;
+}
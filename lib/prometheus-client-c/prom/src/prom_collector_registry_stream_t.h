@@ -0,0 +1,60 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_COLLECTOR_REGISTRY_STREAM_T_H
+#define PROM_COLLECTOR_REGISTRY_STREAM_T_H
+
+#include <stdbool.h>
+
+// Public
+#include "prom_collector_registry.h"
+
+// Private
+#include "prom_collector_t.h"
+#include "prom_linked_list_t.h"
+#include "prom_map_t.h"
+#include "prom_metric_formatter_t.h"
+#include "prom_metric_t.h"
+
+// Once a batch of samples has rendered this many bytes the metric's lock is released and the batch is handed out
+#define PROM_COLLECTOR_REGISTRY_STREAM_BATCH_SIZE 4096
+
+/**
+ * @brief API PRIVATE A position within the list of keys of a prom_map_t* that is held across calls.
+ *
+ * node is only trusted while map->version equals version. Otherwise the cursor is moved back to the key at ordinal,
+ * which is exact because maps keep insertion order across resizes.
+ */
+typedef struct prom_collector_registry_stream_cursor {
+  prom_map_t *map;               /**< the map being walked */
+  prom_linked_list_node_t *node; /**< the next key to visit; NULL when the map is exhausted */
+  size_t ordinal;                /**< index of node within the list of keys */
+  size_t version;                /**< map->version when node was read */
+} prom_collector_registry_stream_cursor_t;
+
+struct prom_collector_registry_stream {
+  prom_collector_registry_t *registry;                /**< the registry being rendered */
+  prom_metric_formatter_t *formatter;                 /**< holds the batch being handed out */
+  size_t offset;                                      /**< bytes of the current batch already handed out */
+  prom_collector_registry_stream_cursor_t collectors; /**< position within registry->collectors */
+  bool in_collector;                                  /**< true while metrics walks a collector's metrics */
+  prom_collector_registry_stream_cursor_t metrics;    /**< position within the current collector's metrics */
+  prom_metric_t *metric;                              /**< metric whose samples are being rendered, if any */
+  prom_collector_registry_stream_cursor_t samples;    /**< position within metric->samples */
+  bool done;                                          /**< true once every collector has been rendered */
+};
+
+#endif  // PROM_COLLECTOR_REGISTRY_STREAM_T_H
@@ -25,8 +25,26 @@
 
 // Private
 #include "prom_map_t.h"
+#include "prom_collector_t.h"
 #include "prom_metric_formatter_t.h"
+#include "prom_render_pool_t.h"
+#include "prom_self_metrics_t.h"
 #include "prom_string_builder_t.h"
+#include "prom_sweeper_t.h"
+
+// The number of formatters a registry keeps for leased exposition pages
+#define PROM_COLLECTOR_REGISTRY_POOL_SIZE 4
+
+/**
+ * @brief A page rendered one collector per formatter, leased with prom_collector_registry_bridge_lease_parts
+ */
+typedef struct prom_collector_registry_parts {
+  prom_collector_t **collectors;              /**< the collectors of the page, one per formatter */
+  prom_metric_formatter_t **formatters;       /**< kept across leases so their buffers stay allocated */
+  prom_collector_registry_part_t *parts;      /**< the non-empty buffers of formatters, in collector order */
+  size_t allocated;                           /**< the length of collectors, formatters and parts */
+  struct prom_collector_registry_parts *next; /**< the next leased page */
+} prom_collector_registry_parts_t;
 
 struct prom_collector_registry {
   const char *name;
@@ -35,6 +53,19 @@ struct prom_collector_registry {
   prom_string_builder_t *string_builder;     /**< Enables string building */
   prom_metric_formatter_t *metric_formatter; /**< metric formatter for metric exposition on bridge call */
   pthread_rwlock_t *lock;                    /**< mutex for safety against concurrent registration */
+  pthread_mutex_t *pool_lock;                /**< guards pool, leased, leased_pages and last_len */
+  prom_metric_formatter_t *pool[PROM_COLLECTOR_REGISTRY_POOL_SIZE];   /**< idle formatters kept for reuse */
+  size_t pool_count;                                                  /**< number of idle formatters in pool */
+  prom_metric_formatter_t *leased[PROM_COLLECTOR_REGISTRY_POOL_SIZE]; /**< formatters whose page is in flight */
+  const char *leased_pages[PROM_COLLECTOR_REGISTRY_POOL_SIZE];        /**< page of each of leased, NULL mid-render */
+  size_t leased_count;                                                /**< number of formatters in leased */
+  size_t last_len;                                                    /**< length of the last leased page */
+  prom_scrape_stats_t scrape_stats; /**< recorded by prom_collector_registry_observe_scrape */
+  prom_collector_registry_parts_t *parts_pool[PROM_COLLECTOR_REGISTRY_POOL_SIZE]; /**< idle pages kept for reuse */
+  size_t parts_pool_count;                        /**< number of idle pages in parts_pool */
+  prom_collector_registry_parts_t *parts_leased;  /**< pages in flight, guarded by pool_lock like parts_pool */
+  prom_render_pool_t *render_pool;                /**< renders collectors in parallel; NULL renders them in turn */
+  prom_sweeper_t *sweeper;                        /**< sweeps series at an interval; NULL leaves it to the caller */
 };
 
 #endif  // PROM_REGISTRY_T_H
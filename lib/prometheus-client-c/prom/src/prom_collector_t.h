@@ -17,17 +17,30 @@
 #ifndef PROM_COLLECTOR_T_H
 #define PROM_COLLECTOR_T_H
 
+#include <pthread.h>
+#include <stdatomic.h>
+
 #include "prom_collector.h"
+#include "prom_collector_registry.h"
 #include "prom_map_t.h"
 #include "prom_string_builder_t.h"
+#include "prom_trie_t.h"
 
 struct prom_collector {
   const char *name;
   prom_map_t *metrics;
+  prom_trie_t *names; /**< The metrics again, keyed by name in a trie for selection by prefix */
   prom_collect_fn *collect_fn;
   prom_string_builder_t *string_builder;
   const char *proc_limits_file_path;
   const char *proc_stat_file_path;
+  double cache_ttl;            /**< Seconds a rendered page of this collector is reused for; 0 disables the cache */
+  pthread_mutex_t *cache_lock; /**< Guards cache and cached_at */
+  prom_string_builder_t *cache[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT]; /**< The last page rendered, per format */
+  double cached_at[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT]; /**< When cache was rendered, or a negative value if never */
+  atomic_ullong render_nanoseconds;     /**< Time spent collecting and rendering this collector */
+  atomic_ullong errors;                 /**< The number of times collecting or rendering this collector failed */
+  prom_collector_registry_t *registry;  /**< The registry the self collector reports on; NULL for other collectors */
 };
 
 #endif  // PROM_COLLECTOR_T_H
@@ -32,6 +32,22 @@ prom_counter_t *prom_counter_new(const char *name, const char *help, size_t labe
   return (prom_counter_t *)prom_metric_new(PROM_COUNTER, name, help, label_key_count, label_keys);
 }
 
+prom_counter_t *prom_counter_new_sharded(const char *name, const char *help, size_t label_key_count,
+                                         const char **label_keys) {
+  prom_counter_t *self = prom_counter_new(name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+  self->sharded = true;
+  return self;
+}
+
+prom_counter_t *prom_counter_new_int(const char *name, const char *help, size_t label_key_count,
+                                     const char **label_keys) {
+  prom_counter_t *self = prom_counter_new(name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+  self->integer = true;
+  return self;
+}
+
 int prom_counter_destroy(prom_counter_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
@@ -48,9 +64,11 @@ int prom_counter_inc(prom_counter_t *self, const char **label_values) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
+  prom_metric_sample_t *sample = prom_metric_sample_acquire(self, label_values);
   if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, 1.0);
+  int r = prom_metric_sample_add(sample, 1.0);
+  prom_metric_sample_release(self);
+  return r;
 }
 
 int prom_counter_add(prom_counter_t *self, double r_value, const char **label_values) {
@@ -60,7 +78,43 @@ int prom_counter_add(prom_counter_t *self, double r_value, const char **label_va
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
+  prom_metric_sample_t *sample = prom_metric_sample_acquire(self, label_values);
+  if (sample == NULL) return 1;
+  int r = prom_metric_sample_add(sample, r_value);
+  prom_metric_sample_release(self);
+  return r;
+}
+
+int prom_counter_add_int(prom_counter_t *self, int64_t i_value, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  prom_metric_sample_t *sample = prom_metric_sample_acquire(self, label_values);
   if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, r_value);
+  int r = prom_metric_sample_add_int(sample, i_value);
+  prom_metric_sample_release(self);
+  return r;
+}
+
+prom_metric_sample_t *prom_counter_labels(prom_counter_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return prom_metric_sample_from_labels(self, label_values);
+}
+
+int prom_counter_remove(prom_counter_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_remove(self, label_values);
 }
@@ -0,0 +1,369 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Shortest round-trip conversion of doubles to decimal strings.
+ *
+ * Integral values below 2^53 take a plain integer path. Everything else goes through Grisu2 (Loitsch, "Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010), following the layout of Milo Yip's dtoa.
+ * Grisu2 always produces digits that read back as the same double and for all but a tiny fraction of inputs they are
+ * also the shortest such digits.
+ *
+ * References:
+ *   * https://www.cs.tufts.edu/~nr/cs257/archive/florian-loitsch/printf.pdf
+ *   * https://github.com/miloyip/dtoa-benchmark
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+// Private
+#include "prom_dtoa_i.h"
+
+// Values of at most this magnitude are exactly representable integers when integral
+#define PROM_DTOA_MAX_SAFE_INTEGER 9007199254740992.0
+
+#define PROM_DTOA_SIGNIFICAND_SIZE 52
+#define PROM_DTOA_EXPONENT_BIAS (0x3FF + PROM_DTOA_SIGNIFICAND_SIZE)
+#define PROM_DTOA_MIN_EXPONENT (-PROM_DTOA_EXPONENT_BIAS)
+#define PROM_DTOA_EXPONENT_MASK 0x7FF0000000000000ULL
+#define PROM_DTOA_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define PROM_DTOA_HIDDEN_BIT 0x0010000000000000ULL
+
+static const char prom_dtoa_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t prom_dtoa_pow10[20] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+                                             100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+                                             1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+                                             1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+                                             1000000000000000000ULL, 10000000000000000000ULL};
+
+// Normalized significands and binary exponents of 10^-348, 10^-340, ..., 10^340
+static const uint64_t prom_dtoa_cached_powers_f[] = {
+    0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76, 0xcf42894a5dce35ea, 0x9a6bb0aa55653b2d,
+    0xe61acf033d1a45df, 0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f, 0xbe5691ef416bd60c, 0x8dd01fad907ffc3c,
+    0xd3515c2831559a83, 0x9d71ac8fada6c9b5, 0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57,
+    0xc21094364dfb5637, 0x9096ea6f3848984f, 0xd77485cb25823ac7, 0xa086cfcd97bf97f4, 0xef340a98172aace5,
+    0xb23867fb2a35b28e, 0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996, 0xdbac6c247d62a584,
+    0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126, 0xb5b5ada8aaff80b8, 0x87625f056c7c4a8b, 0xc9bcff6034c13053,
+    0x964e858c91ba2655, 0xdff9772470297ebd, 0xa6dfbd9fb8e5b88f, 0xf8a95fcf88747d94, 0xb94470938fa89bcf,
+    0x8a08f0f8bf0f156b, 0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06, 0xaa242499697392d3,
+    0xfd87b5f28300ca0e, 0xbce5086492111aeb, 0x8cbccc096f5088cc, 0xd1b71758e219652c, 0x9c40000000000000,
+    0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984, 0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70,
+    0xd5d238a4abe98068, 0x9f4f2726179a2245, 0xed63a231d4c4fb27, 0xb0de65388cc8ada8, 0x83c7088e1aab65db,
+    0xc45d1df942711d9a, 0x924d692ca61be758, 0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+    0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d, 0x952ab45cfa97a0b3, 0xde469fbd99a05fe3,
+    0xa59bc234db398c25, 0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece, 0x88fcf317f22241e2, 0xcc20ce9bd35c78a5,
+    0x98165af37b2153df, 0xe2a0b5dc971f303a, 0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410,
+    0x8bab8eefb6409c1a, 0xd01fef10a657842c, 0x9b10a4e5e9913129, 0xe7109bfba19c0c9d, 0xac2820d9623bf429,
+    0x80444b5e7aa7cf85, 0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841, 0x9e19db92b4e31ba9,
+    0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b};
+
+static const int16_t prom_dtoa_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821, -794, -768,
+    -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289, -263,
+    -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960,
+    986, 1013, 1039, 1066};
+
+/**
+ * @brief A floating point number f * 2^e with a 64 bit significand and no implicit bit
+ */
+typedef struct prom_dtoa_fp {
+  uint64_t f;
+  int e;
+} prom_dtoa_fp_t;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Integers
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t prom_dtoa_uint64(uint64_t value, char *buffer) {
+  char digits[20];
+  char *p = digits + sizeof(digits);
+
+  // Two digits at a time from the right
+  while (value >= 100) {
+    unsigned int pair = (unsigned int)(value % 100) * 2;
+    value /= 100;
+    *--p = prom_dtoa_digit_pairs[pair + 1];
+    *--p = prom_dtoa_digit_pairs[pair];
+  }
+  if (value >= 10) {
+    unsigned int pair = (unsigned int)value * 2;
+    *--p = prom_dtoa_digit_pairs[pair + 1];
+    *--p = prom_dtoa_digit_pairs[pair];
+  } else {
+    *--p = (char)('0' + value);
+  }
+
+  size_t len = digits + sizeof(digits) - p;
+  memcpy(buffer, p, len);
+  return len;
+}
+
+size_t prom_itoa(int64_t value, char *buffer) {
+  if (value >= 0) return prom_dtoa_uint64((uint64_t)value, buffer);
+  // Negating in unsigned arithmetic also handles INT64_MIN
+  *buffer = '-';
+  return 1 + prom_dtoa_uint64(-(uint64_t)value, buffer + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Grisu2
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static prom_dtoa_fp_t prom_dtoa_fp_from_double(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased_e = (int)((bits & PROM_DTOA_EXPONENT_MASK) >> PROM_DTOA_SIGNIFICAND_SIZE);
+  uint64_t significand = bits & PROM_DTOA_SIGNIFICAND_MASK;
+
+  prom_dtoa_fp_t fp;
+  if (biased_e != 0) {
+    fp.f = significand + PROM_DTOA_HIDDEN_BIT;
+    fp.e = biased_e - PROM_DTOA_EXPONENT_BIAS;
+  } else {
+    // Subnormal
+    fp.f = significand;
+    fp.e = PROM_DTOA_MIN_EXPONENT + 1;
+  }
+  return fp;
+}
+
+static prom_dtoa_fp_t prom_dtoa_fp_multiply(prom_dtoa_fp_t x, prom_dtoa_fp_t y) {
+  unsigned __int128 p = (unsigned __int128)x.f * y.f;
+  uint64_t h = (uint64_t)(p >> 64);
+  uint64_t l = (uint64_t)p;
+  // Round the dropped half
+  if (l & (1ULL << 63)) h++;
+  prom_dtoa_fp_t r = {h, x.e + y.e + 64};
+  return r;
+}
+
+static prom_dtoa_fp_t prom_dtoa_fp_normalize(prom_dtoa_fp_t fp) {
+  int shift = __builtin_clzll(fp.f);
+  prom_dtoa_fp_t r = {fp.f << shift, fp.e - shift};
+  return r;
+}
+
+/**
+ * @brief Computes the normalized boundaries m- and m+ halfway to the neighbouring doubles
+ */
+static void prom_dtoa_fp_boundaries(prom_dtoa_fp_t fp, prom_dtoa_fp_t *minus, prom_dtoa_fp_t *plus) {
+  prom_dtoa_fp_t pl = {(fp.f << 1) + 1, fp.e - 1};
+  while (!(pl.f & (PROM_DTOA_HIDDEN_BIT << 1))) {
+    pl.f <<= 1;
+    pl.e--;
+  }
+  pl.f <<= 64 - PROM_DTOA_SIGNIFICAND_SIZE - 2;
+  pl.e -= 64 - PROM_DTOA_SIGNIFICAND_SIZE - 2;
+
+  // The gap below a power of two is half the gap above it
+  prom_dtoa_fp_t mi;
+  if (fp.f == PROM_DTOA_HIDDEN_BIT) {
+    mi.f = (fp.f << 2) - 1;
+    mi.e = fp.e - 2;
+  } else {
+    mi.f = (fp.f << 1) - 1;
+    mi.e = fp.e - 1;
+  }
+  mi.f <<= mi.e - pl.e;
+  mi.e = pl.e;
+
+  *minus = mi;
+  *plus = pl;
+}
+
+/**
+ * @brief Returns a cached power of ten c such that e + c.e lands in [-60, -32], and its decimal exponent in *k
+ */
+static prom_dtoa_fp_t prom_dtoa_cached_power(int e, int *k) {
+  // 0.30102999566398114 is log10(2)
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int ik = (int)dk;
+  if (dk - ik > 0.0) ik++;
+
+  unsigned int index = (unsigned int)((ik >> 3) + 1);
+  // The decimal exponent of the cached power is index * 8 - 348; the caller scales by its inverse
+  *k = -(-348 + (int)(index << 3));
+  prom_dtoa_fp_t c = {prom_dtoa_cached_powers_f[index], prom_dtoa_cached_powers_e[index]};
+  return c;
+}
+
+/**
+ * @brief Moves the last digit towards w while it stays inside the rounding interval
+ */
+static void prom_dtoa_round(char *buffer, size_t len, uint64_t delta, uint64_t rest, uint64_t ten_kappa,
+                            uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static int prom_dtoa_count_digits(uint32_t n) {
+  int digits = 1;
+  while (digits < 10 && n >= prom_dtoa_pow10[digits]) digits++;
+  return digits;
+}
+
+/**
+ * @brief Generates the digits of Mp until they identify a number inside (Mp - delta, Mp]
+ */
+static void prom_dtoa_digit_gen(prom_dtoa_fp_t w, prom_dtoa_fp_t mp, uint64_t delta, char *buffer, size_t *len,
+                                int *k) {
+  prom_dtoa_fp_t one = {1ULL << -mp.e, mp.e};
+  uint64_t wp_w = mp.f - w.f;
+  uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = prom_dtoa_count_digits(p1);
+  *len = 0;
+
+  // Integral part
+  while (kappa > 0) {
+    uint32_t divisor = (uint32_t)prom_dtoa_pow10[kappa - 1];
+    uint32_t d = p1 / divisor;
+    p1 %= divisor;
+    if (d || *len) buffer[(*len)++] = (char)('0' + d);
+    kappa--;
+    uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+    if (rest <= delta) {
+      *k += kappa;
+      prom_dtoa_round(buffer, *len, delta, rest, prom_dtoa_pow10[kappa] << -one.e, wp_w);
+      return;
+    }
+  }
+
+  // Fractional part
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> -one.e);
+    if (d || *len) buffer[(*len)++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *k += kappa;
+      int index = -kappa;
+      prom_dtoa_round(buffer, *len, delta, p2, one.f, wp_w * (index < 20 ? prom_dtoa_pow10[index] : 0));
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Writes the significant digits of a positive value to buffer; the value is digits * 10^k
+ */
+static void prom_dtoa_grisu2(double value, char *buffer, size_t *len, int *k) {
+  prom_dtoa_fp_t v = prom_dtoa_fp_from_double(value);
+  prom_dtoa_fp_t w_m, w_p;
+  prom_dtoa_fp_boundaries(v, &w_m, &w_p);
+
+  prom_dtoa_fp_t c_mk = prom_dtoa_cached_power(w_p.e, k);
+  prom_dtoa_fp_t w = prom_dtoa_fp_multiply(prom_dtoa_fp_normalize(v), c_mk);
+  prom_dtoa_fp_t wp = prom_dtoa_fp_multiply(w_p, c_mk);
+  prom_dtoa_fp_t wm = prom_dtoa_fp_multiply(w_m, c_mk);
+
+  // Shrink the interval by one unit on each side to stay clear of the rounding error in the products
+  wm.f++;
+  wp.f--;
+  prom_dtoa_digit_gen(w, wp, wp.f - wm.f, buffer, len, k);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Layout
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t prom_dtoa_exponent(int exponent, char *buffer) {
+  char *p = buffer;
+  *p++ = 'e';
+  if (exponent < 0) {
+    *p++ = '-';
+    exponent = -exponent;
+  } else {
+    *p++ = '+';
+  }
+  // At least two digits, as printf does
+  if (exponent < 10) *p++ = '0';
+  p += prom_dtoa_uint64((uint64_t)exponent, p);
+  return p - buffer;
+}
+
+/**
+ * @brief Lays out len digits worth digits * 10^k in fixed or scientific notation, whichever printf's %g would pick
+ */
+static size_t prom_dtoa_layout(char *buffer, size_t len, int k) {
+  // The position of the decimal point relative to the first digit
+  int point = (int)len + k;
+
+  if (point > 0 && (size_t)point >= len && point <= 17) {
+    // An integer too large for the integer path, e.g. 1e16 + 2
+    memset(buffer + len, '0', point - len);
+    return point;
+  }
+  if (point > 0 && point <= 17) {
+    // 1234e-2 -> 12.34
+    memmove(buffer + point + 1, buffer + point, len - point);
+    buffer[point] = '.';
+    return len + 1;
+  }
+  if (point > -4 && point <= 0) {
+    // 1234e-6 -> 0.001234
+    size_t offset = 2 - point;
+    memmove(buffer + offset, buffer, len);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    memset(buffer + 2, '0', -point);
+    return len + offset;
+  }
+  if (len == 1) {
+    // 1e30 -> 1e+30
+    return 1 + prom_dtoa_exponent(point - 1, buffer + 1);
+  }
+  // 1234e30 -> 1.234e+33
+  memmove(buffer + 2, buffer + 1, len - 1);
+  buffer[1] = '.';
+  return len + 1 + prom_dtoa_exponent(point - 1, buffer + len + 1);
+}
+
+size_t prom_dtoa(double value, char *buffer) {
+  char *p = buffer;
+  if (value == 0) {
+    // Also covers negative zero
+    *p = '0';
+    return 1;
+  }
+  if (value < 0) {
+    *p++ = '-';
+    value = -value;
+  }
+
+  // Counters, byte counts and most gauges hold whole numbers
+  if (value <= PROM_DTOA_MAX_SAFE_INTEGER && value == (double)(uint64_t)value) {
+    return (p - buffer) + prom_dtoa_uint64((uint64_t)value, p);
+  }
+
+  size_t len = 0;
+  int k = 0;
+  prom_dtoa_grisu2(value, p, &len, &k);
+  return (p - buffer) + prom_dtoa_layout(p, len, k);
+}
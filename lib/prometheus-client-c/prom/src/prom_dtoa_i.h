@@ -0,0 +1,49 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PROM_DTOA_I_H
+#define PROM_DTOA_I_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Large enough for any finite double written by prom_dtoa, e.g. -1.2345678901234567e-308
+#define PROM_DTOA_BUFFER_SIZE 32
+
+/**
+ * API PRIVATE
+ * @brief Writes the shortest decimal string that reads back as value. The string is not null terminated.
+ *
+ * Integral values are written without a decimal point or exponent. Other values use printf's %g layout, so
+ * 12.000000000000002 is written as 12.000000000000002 but 0.1 is written as 0.1 rather than 0.10000000000000001.
+ *
+ * @param value A finite double
+ * @param buffer At least PROM_DTOA_BUFFER_SIZE bytes
+ * @return The number of bytes written
+ */
+size_t prom_dtoa(double value, char *buffer);
+
+/**
+ * API PRIVATE
+ * @brief Writes value in decimal. The string is not null terminated.
+ *
+ * @param buffer At least PROM_DTOA_BUFFER_SIZE bytes
+ * @return The number of bytes written
+ */
+size_t prom_itoa(int64_t value, char *buffer);
+
+#endif  // PROM_DTOA_I_H
@@ -16,8 +16,18 @@
 
 #define PROM_STDIO_CLOSE_DIR_ERROR "failed to close dir"
 #define PROM_STDIO_OPEN_DIR_ERROR "failed to open dir"
+#define PROM_COLLECTOR_REGISTRY_INVALID_SELECTOR "invalid metric selector"
+#define PROM_COLLECTOR_REGISTRY_UNKNOWN_COLLECTOR "no collector with the given name is registered"
+#define PROM_EXEMPLAR_TOO_LONG "exemplar labels exceed 128 characters"
 #define PROM_METRIC_INCORRECT_TYPE "incorrect metric type"
 #define PROM_METRIC_INVALID_LABEL_NAME "invalid label name"
+#define PROM_METRIC_SERIES_LIMIT "the series limit of the metric is reached"
+#define PROM_METRIC_TTL_AFTER_SAMPLES "the TTL of a metric must be set before its first sample is created"
+#define PROM_METRIC_SAMPLE_INTEGER_RANGE "value does not fit a 64-bit integer sample"
+#define PROM_METRIC_SAMPLE_FRACTION "only whole numbers can be added to or subtracted from a 64-bit integer sample"
+#define PROM_PTHREAD_KEY_CREATE_ERROR "failed to create the pthread_key_t"
+#define PROM_PTHREAD_MUTEX_INIT_ERROR "failed to initialize the pthread_mutex_t*"
+#define PROM_PTHREAD_MUTEX_LOCK_ERROR "failed to lock the pthread_mutex_t*"
 #define PROM_PTHREAD_RWLOCK_DESTROY_ERROR "failed to destroy the pthread_rwlock_t*"
 #define PROM_PTHREAD_RWLOCK_INIT_ERROR "failed to initialize the pthread_rwlock_t*"
 #define PROM_PTHREAD_RWLOCK_LOCK_ERROR "failed to lock the pthread_rwlock_t*"
@@ -29,6 +29,7 @@
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_histogram_t.h"
 #include "prom_metric_t.h"
+#include "prom_native_histogram_i.h"
 
 prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_histogram_buckets_t *buckets,
                                      size_t label_key_count, const char **label_keys) {
@@ -54,6 +55,23 @@ prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_hi
   return self;
 }
 
+prom_histogram_t *prom_histogram_new_native(const char *name, const char *help, double bucket_factor,
+                                            size_t max_bucket_count, size_t label_key_count, const char **label_keys) {
+  if (!(bucket_factor > 1.0)) return NULL;
+  prom_histogram_t *self = (prom_histogram_t *)prom_metric_new(PROM_HISTOGRAM, name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+
+  // Native samples keep no fixed buckets, so only +Inf, the count and the sum are rendered from them
+  prom_histogram_buckets_t *buckets = (prom_histogram_buckets_t *)prom_malloc(sizeof(prom_histogram_buckets_t));
+  buckets->count = 0;
+  buckets->upper_bounds = NULL;
+  self->buckets = buckets;
+  self->native = true;
+  self->native_schema = prom_native_histogram_schema_for_factor(bucket_factor);
+  self->native_max_bucket_count = max_bucket_count;
+  return self;
+}
+
 int prom_histogram_destroy(prom_histogram_t *self) {
   PROM_ASSERT(self != NULL);
 
@@ -73,7 +91,36 @@ int prom_histogram_observe(prom_histogram_t *self, double value, const char **la
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
-  prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_from_labels(self, label_values);
+  prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_acquire(self, label_values);
+  if (h_sample == NULL) return 1;
+  int r = prom_metric_sample_histogram_observe(h_sample, value);
+  prom_metric_sample_release(self);
+  return r;
+}
+
+int prom_histogram_observe_with_exemplar(prom_histogram_t *self, double value, const char **label_values,
+                                         size_t exemplar_label_count, const char **exemplar_label_keys,
+                                         const char **exemplar_label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_HISTOGRAM) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_acquire(self, label_values);
   if (h_sample == NULL) return 1;
-  return prom_metric_sample_histogram_observe(h_sample, value);
+  int r = prom_metric_sample_histogram_observe_with_exemplar(h_sample, value, exemplar_label_count,
+                                                             exemplar_label_keys, exemplar_label_values);
+  prom_metric_sample_release(self);
+  return r;
+}
+
+prom_metric_sample_histogram_t *prom_histogram_labels(prom_histogram_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_HISTOGRAM) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return prom_metric_sample_histogram_from_labels(self, label_values);
 }
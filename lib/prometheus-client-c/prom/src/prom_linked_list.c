@@ -92,6 +92,7 @@ int prom_linked_list_append(prom_linked_list_t *self, void *item) {
   prom_linked_list_node_t *node = (prom_linked_list_node_t *)prom_malloc(sizeof(prom_linked_list_node_t));
 
   node->item = item;
+  node->prev = self->tail;
   if (self->tail) {
     self->tail->next = node;
   } else {
@@ -109,7 +110,11 @@ int prom_linked_list_push(prom_linked_list_t *self, void *item) {
   prom_linked_list_node_t *node = (prom_linked_list_node_t *)prom_malloc(sizeof(prom_linked_list_node_t));
 
   node->item = item;
+  node->prev = NULL;
   node->next = self->head;
+  if (self->head) {
+    self->head->prev = node;
+  }
   self->head = node;
   if (self->tail == NULL) {
     self->tail = node;
@@ -126,6 +131,9 @@ void *prom_linked_list_pop(prom_linked_list_t *self) {
   if (node != NULL) {
     item = node->item;
     self->head = node->next;
+    if (self->head) {
+      self->head->prev = NULL;
+    }
     if (self->tail == node) {
       self->tail = NULL;
     }
@@ -147,7 +155,6 @@ int prom_linked_list_remove(prom_linked_list_t *self, void *item) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
   prom_linked_list_node_t *node;
-  prom_linked_list_node_t *prev_node = NULL;
 
   // Locate the node
   for (node = self->head; node != NULL; node = node->next) {
@@ -160,18 +167,27 @@ int prom_linked_list_remove(prom_linked_list_t *self, void *item) {
         break;
       }
     }
-    prev_node = node;
   }
 
   if (node == NULL) return 0;
+  return prom_linked_list_remove_node(self, node);
+}
 
-  if (prev_node) {
-    prev_node->next = node->next;
+int prom_linked_list_remove_node(prom_linked_list_t *self, prom_linked_list_node_t *node) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  PROM_ASSERT(node != NULL);
+  if (node == NULL) return 1;
+
+  if (node->prev) {
+    node->prev->next = node->next;
   } else {
     self->head = node->next;
   }
-  if (node->next == NULL) {
-    self->tail = prev_node;
+  if (node->next) {
+    node->next->prev = node->prev;
+  } else {
+    self->tail = node->prev;
   }
 
   if (node->item != NULL) {
@@ -65,6 +65,11 @@ void *prom_linked_list_last(prom_linked_list_t *self);
  */
 int prom_linked_list_remove(prom_linked_list_t *self, void *item);
 
+/**
+ * @brief API PRIVATE Removes node, which MUST belong to the linked list, without searching for it
+ */
+int prom_linked_list_remove_node(prom_linked_list_t *self, prom_linked_list_node_t *node);
+
 /**
  * @brief API PRIVATE Compares two items within a linked list
  */
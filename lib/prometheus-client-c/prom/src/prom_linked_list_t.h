@@ -32,11 +32,12 @@ typedef void (*prom_linked_list_free_item_fn)(void *);
 typedef prom_linked_list_compare_t (*prom_linked_list_compare_item_fn)(void *item_a, void *item_b);
 
 /**
- * @brief API PRIVATE A struct containing a generic item, represented as a void pointer, and next, a pointer to the
- * next prom_linked_list_node*
+ * @brief API PRIVATE A struct containing a generic item, represented as a void pointer, and next and prev, pointers to
+ * the neighbouring prom_linked_list_node* instances
  */
 typedef struct prom_linked_list_node {
   struct prom_linked_list_node *next;
+  struct prom_linked_list_node *prev;
   void *item;
 } prom_linked_list_node_t;
 
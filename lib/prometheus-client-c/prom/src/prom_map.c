@@ -16,6 +16,7 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <string.h>
 
 // Public
 #include "prom_alloc.h"
@@ -29,10 +30,101 @@
 #include "prom_map_i.h"
 #include "prom_map_t.h"
 
+// The number of slots of a new map; MUST be a power of two
 #define PROM_MAP_INITIAL_SIZE 32
 
+// The table doubles before more than 7/8 of its slots are taken
+#define PROM_MAP_MAX_LOAD(max_size) ((max_size) - (max_size) / 8)
+
+// The number of slots of the previous table each set or delete moves into the current one while the map grows. The
+// previous table holds 7/8 of its slots when growth starts and the current one has room for as many new keys again,
+// so any value above 1 finishes the migration before the current table fills up.
+#define PROM_MAP_MIGRATE_SLOTS 16
+
+// Marks a deleted entry in the previous table, whose probe sequences must stay intact until it is freed
+static prom_map_node_t prom_map_tombstone;
+
 static void destroy_map_node_value_no_op(void *value) {}
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hashing
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// wyhash (final version 4) with a zero seed and the default secret. It reads 8 or 16 bytes per round and finishes
+// with a 64x64->128 bit multiply, so hashing a typical label set costs a few nanoseconds.
+// Reference: https://github.com/wangyi-fudan/wyhash
+
+static const uint64_t prom_map_wyhash_secret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                                   0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+static inline void prom_map_wymum(uint64_t *a, uint64_t *b) {
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t prom_map_wymix(uint64_t a, uint64_t b) {
+  prom_map_wymum(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t prom_map_wyr8(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static inline uint64_t prom_map_wyr4(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint64_t prom_map_wyr3(const uint8_t *p, size_t k) {
+  return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+static uint64_t prom_map_hash(const char *key, size_t len) {
+  const uint64_t *secret = prom_map_wyhash_secret;
+  const uint8_t *p = (const uint8_t *)key;
+  uint64_t seed = prom_map_wymix(secret[0], secret[1]);
+  uint64_t a = 0;
+  uint64_t b = 0;
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (prom_map_wyr4(p) << 32) | prom_map_wyr4(p + ((len >> 3) << 2));
+      b = (prom_map_wyr4(p + len - 4) << 32) | prom_map_wyr4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = prom_map_wyr3(p, len);
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed;
+      uint64_t see2 = seed;
+      do {
+        seed = prom_map_wymix(prom_map_wyr8(p) ^ secret[1], prom_map_wyr8(p + 8) ^ seed);
+        see1 = prom_map_wymix(prom_map_wyr8(p + 16) ^ secret[2], prom_map_wyr8(p + 24) ^ see1);
+        see2 = prom_map_wymix(prom_map_wyr8(p + 32) ^ secret[3], prom_map_wyr8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = prom_map_wymix(prom_map_wyr8(p) ^ secret[1], prom_map_wyr8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = prom_map_wyr8(p + i - 16);
+    b = prom_map_wyr8(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  prom_map_wymum(&a, &b);
+  return prom_map_wymix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // prom_map_node
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -40,8 +132,10 @@ static void destroy_map_node_value_no_op(void *value) {}
 prom_map_node_t *prom_map_node_new(const char *key, void *value, prom_map_node_free_value_fn free_value_fn) {
   prom_map_node_t *self = prom_malloc(sizeof(prom_map_node_t));
   self->key = prom_strdup(key);
+  self->key_len = strlen(key);
   self->value = value;
   self->free_value_fn = free_value_fn;
+  self->key_node = NULL;
   return self;
 }
 
@@ -57,16 +151,72 @@ int prom_map_node_destroy(prom_map_node_t *self) {
   return 0;
 }
 
-void prom_map_node_free(void *item) {
-  prom_map_node_t *map_node = (prom_map_node_t *)item;
-  prom_map_node_destroy(map_node);
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Open addressing table
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// calloc hands out large tables as untouched zero pages, so growing does not pay for clearing the new table up front
+static prom_map_slot_t *prom_map_slots_new(size_t max_size) {
+  return (prom_map_slot_t *)prom_calloc(max_size, sizeof(prom_map_slot_t));
 }
 
-prom_linked_list_compare_t prom_map_node_compare(void *item_a, void *item_b) {
-  prom_map_node_t *map_node_a = (prom_map_node_t *)item_a;
-  prom_map_node_t *map_node_b = (prom_map_node_t *)item_b;
+// How far the entry at pos is from the slot its hash picks
+static inline size_t prom_map_slot_distance(const prom_map_slot_t *slot, size_t pos, size_t mask) {
+  return (pos - (size_t)slot->hash) & mask;
+}
 
-  return strcmp(map_node_a->key, map_node_b->key);
+/**
+ * @brief Returns the slot holding key, or NULL.
+ *
+ * Slots below migrated are only used to follow probe sequences; their nodes have moved to the current table and may
+ * have been freed since. Tombstones are passed over the same way.
+ */
+static prom_map_slot_t *prom_map_find(prom_map_slot_t *slots, size_t max_size, size_t migrated, const char *key,
+                                      size_t len, uint64_t hash) {
+  size_t mask = max_size - 1;
+  size_t pos = (size_t)hash & mask;
+  for (size_t distance = 0;; distance++, pos = (pos + 1) & mask) {
+    prom_map_slot_t *slot = &slots[pos];
+    // Robin Hood order: once an entry is closer to its slot than key would be, key cannot come later
+    if (slot->node == NULL || prom_map_slot_distance(slot, pos, mask) < distance) return NULL;
+    if (slot->hash != hash || pos < migrated || slot->node == &prom_map_tombstone) continue;
+    if (slot->node->key_len == len && memcmp(slot->node->key, key, len) == 0) return slot;
+  }
+}
+
+// Places node, whose key MUST NOT be in the table yet, displacing entries that are closer to their slot
+static void prom_map_place(prom_map_slot_t *slots, size_t max_size, uint64_t hash, prom_map_node_t *node) {
+  size_t mask = max_size - 1;
+  size_t pos = (size_t)hash & mask;
+  prom_map_slot_t entry = {hash, node};
+  for (size_t distance = 0;; distance++, pos = (pos + 1) & mask) {
+    prom_map_slot_t *slot = &slots[pos];
+    if (slot->node == NULL) {
+      *slot = entry;
+      return;
+    }
+    size_t slot_distance = prom_map_slot_distance(slot, pos, mask);
+    if (slot_distance < distance) {
+      prom_map_slot_t displaced = *slot;
+      *slot = entry;
+      entry = displaced;
+      distance = slot_distance;
+    }
+  }
+}
+
+// Empties slot and shifts the entries after it back by one until one is in its own slot
+static void prom_map_remove_slot(prom_map_slot_t *slots, size_t max_size, prom_map_slot_t *slot) {
+  size_t mask = max_size - 1;
+  size_t pos = (size_t)(slot - slots);
+  for (;;) {
+    size_t next = (pos + 1) & mask;
+    if (slots[next].node == NULL || prom_map_slot_distance(&slots[next], next, mask) == 0) break;
+    slots[pos] = slots[next];
+    pos = next;
+  }
+  slots[pos].hash = 0;
+  slots[pos].node = NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -79,39 +229,37 @@ prom_map_t *prom_map_new() {
   prom_map_t *self = (prom_map_t *)prom_malloc(sizeof(prom_map_t));
   self->size = 0;
   self->max_size = PROM_MAP_INITIAL_SIZE;
+  self->version = 0;
+  self->slots = NULL;
+  self->old_max_size = 0;
+  self->old_slots = NULL;
+  self->migrated = 0;
+  self->rwlock = NULL;
+  self->free_value_fn = destroy_map_node_value_no_op;
 
   self->keys = prom_linked_list_new();
   if (self->keys == NULL) return NULL;
 
-  // These each key will be allocated once by prom_map_node_new and used here as well to save memory. With that said
-  // we will only have to deallocate each key once. That will happen on prom_map_node_destroy.
+  // Each key is allocated once by prom_map_node_new and shared with the list of keys, so it is only freed by
+  // prom_map_node_destroy
   r = prom_linked_list_set_free_fn(self->keys, prom_linked_list_no_op_free);
   if (r) {
     prom_map_destroy(self);
     return NULL;
   }
 
-  self->addrs = prom_malloc(sizeof(prom_linked_list_t) * self->max_size);
-  self->free_value_fn = destroy_map_node_value_no_op;
-
-  for (int i = 0; i < self->max_size; i++) {
-    self->addrs[i] = prom_linked_list_new();
-    r = prom_linked_list_set_free_fn(self->addrs[i], prom_map_node_free);
-    if (r) {
-      prom_map_destroy(self);
-      return NULL;
-    }
-    r = prom_linked_list_set_compare_fn(self->addrs[i], prom_map_node_compare);
-    if (r) {
-      prom_map_destroy(self);
-      return NULL;
-    }
+  self->slots = prom_map_slots_new(self->max_size);
+  if (self->slots == NULL) {
+    prom_map_destroy(self);
+    return NULL;
   }
 
   self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
   r = pthread_rwlock_init(self->rwlock, NULL);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_INIT_ERROR);
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
     prom_map_destroy(self);
     return NULL;
   }
@@ -128,18 +276,35 @@ int prom_map_destroy(prom_map_t *self) {
   if (r) ret = r;
   self->keys = NULL;
 
-  for (size_t i = 0; i < self->max_size; i++) {
-    r = prom_linked_list_destroy(self->addrs[i]);
-    if (r) ret = r;
-    self->addrs[i] = NULL;
+  if (self->slots != NULL) {
+    for (size_t i = 0; i < self->max_size; i++) {
+      if (self->slots[i].node == NULL) continue;
+      r = prom_map_node_destroy(self->slots[i].node);
+      if (r) ret = r;
+      self->slots[i].node = NULL;
+    }
   }
-  prom_free(self->addrs);
-  self->addrs = NULL;
+  prom_free(self->slots);
+  self->slots = NULL;
+
+  // Nodes below migrated were moved to the current table
+  if (self->old_slots != NULL) {
+    for (size_t i = self->migrated; i < self->old_max_size; i++) {
+      prom_map_node_t *node = self->old_slots[i].node;
+      if (node == NULL || node == &prom_map_tombstone) continue;
+      r = prom_map_node_destroy(node);
+      if (r) ret = r;
+    }
+  }
+  prom_free(self->old_slots);
+  self->old_slots = NULL;
 
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR)
-    ret = r;
+  if (self->rwlock != NULL) {
+    r = pthread_rwlock_destroy(self->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR)
+      ret = r;
+    }
   }
 
   prom_free(self->rwlock);
@@ -150,64 +315,27 @@ int prom_map_destroy(prom_map_t *self) {
   return ret;
 }
 
-static size_t prom_map_get_index_internal(const char *key, size_t *size, size_t *max_size) {
-  size_t index;
-  size_t a = 31415, b = 27183;
-  for (index = 0; *key != '\0'; key++, a = a * b % (*max_size - 1)) {
-    index = (a * index + *key) % *max_size;
-  }
-  return index;
-}
-
-/**
- * @brief API PRIVATE hash function that returns an array index from the given key and prom_map.
- *
- * The algorithm is based off of Horner's method. In a simpler version, you set the return value to 0. Next, for each
- * character in the string, you add the integer value of the current character to the product of the prime number and
- * the current return value, set the result to the return value, then finally return the return value.
- *
- * In this version of the algorithm, we attempt to achieve a probabily of key to index conversion collisions to
- * 1/M (with M being the max_size of the map). This optimizes dispersion and consequently, evens out the performance
- * for gets and sets for each item. Instead of using a fixed prime number, we generate a coefficient for each iteration
- * through the loop.
- *
- * Reference:
- *   * Algorithms in C: Third Edition by Robert Sedgewick, p579
- */
-size_t prom_map_get_index(prom_map_t *self, const char *key) {
-  return prom_map_get_index_internal(key, &self->size, &self->max_size);
-}
-
-static void *prom_map_get_internal(const char *key, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                   prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn) {
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  prom_map_node_t *temp_map_node = prom_map_node_new(key, NULL, free_value_fn);
-
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, temp_map_node);
-    if (result == PROM_EQUAL) {
-      prom_map_node_destroy(temp_map_node);
-      temp_map_node = NULL;
-      return current_map_node->value;
-    }
-  }
-  prom_map_node_destroy(temp_map_node);
-  temp_map_node = NULL;
-  return NULL;
+// Looks key up in the current table, then in the previous one while it is being migrated
+static prom_map_slot_t *prom_map_lookup(prom_map_t *self, const char *key, size_t len, uint64_t hash) {
+  prom_map_slot_t *slot = prom_map_find(self->slots, self->max_size, 0, key, len, hash);
+  if (slot != NULL || self->old_slots == NULL) return slot;
+  return prom_map_find(self->old_slots, self->old_max_size, self->migrated, key, len, hash);
 }
 
 void *prom_map_get(prom_map_t *self, const char *key) {
   PROM_ASSERT(self != NULL);
   int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
+  size_t len = strlen(key);
+  uint64_t hash = prom_map_hash(key, len);
+
+  // Lookups neither allocate nor modify the table, so any number of them may run at once
+  r = pthread_rwlock_rdlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    NULL;
+    return NULL;
   }
-  void *payload =
-      prom_map_get_internal(key, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn);
+  prom_map_slot_t *slot = prom_map_lookup(self, key, len, hash);
+  void *payload = slot == NULL ? NULL : slot->node->value;
   r = pthread_rwlock_unlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
@@ -216,106 +344,104 @@ void *prom_map_get(prom_map_t *self, const char *key) {
   return payload;
 }
 
-static int prom_map_set_internal(const char *key, void *value, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                 prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn,
-                                 bool destroy_current_value) {
-  prom_map_node_t *map_node = prom_map_node_new(key, value, free_value_fn);
-  if (map_node == NULL) return 1;
-
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, map_node);
-    if (result == PROM_EQUAL) {
-      if (destroy_current_value) {
-        free_value_fn(current_map_node->value);
-        current_map_node->value = NULL;
-      }
-      prom_free((char *)current_map_node->key);
-      current_map_node->key = NULL;
-      prom_free(current_map_node);
-      current_map_node = NULL;
-      current_node->item = map_node;
-      return 0;
-    }
-  }
-  prom_linked_list_append(list, map_node);
-  prom_linked_list_append(keys, (char *)map_node->key);
-  (*size)++;
-  return 0;
-}
-
-int prom_map_ensure_space(prom_map_t *self) {
+void *prom_map_acquire(prom_map_t *self, const char *key) {
   PROM_ASSERT(self != NULL);
   int r = 0;
+  size_t len = strlen(key);
+  uint64_t hash = prom_map_hash(key, len);
 
-  if (self->size <= self->max_size / 2) {
-    return 0;
+  r = pthread_rwlock_rdlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
   }
+  prom_map_slot_t *slot = prom_map_lookup(self, key, len, hash);
+  if (slot != NULL) return slot->node->value;
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return NULL;
+}
 
-  // Increase the max size
-  size_t new_max = self->max_size * 2;
-  size_t new_size = 0;
+void prom_map_release(prom_map_t *self) {
+  PROM_ASSERT(self != NULL);
+  int r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+}
 
-  // Create a new list of keys
-  prom_linked_list_t *new_keys = prom_linked_list_new();
-  if (new_keys == NULL) return 1;
+/**
+ * @brief Moves up to count slots of the previous table into the current one and frees the previous table once all of
+ * them are moved.
+ *
+ * The previous table is never modified, so its probe sequences stay valid; migrated only records how far the move has
+ * come. Nodes are moved by pointer, so neither they nor the list of keys are touched.
+ */
+static void prom_map_migrate(prom_map_t *self, size_t count) {
+  if (self->old_slots == NULL) return;
+  size_t end = self->migrated + count;
+  if (end > self->old_max_size) end = self->old_max_size;
+  for (size_t i = self->migrated; i < end; i++) {
+    prom_map_slot_t *slot = &self->old_slots[i];
+    if (slot->node != NULL && slot->node != &prom_map_tombstone) {
+      prom_map_place(self->slots, self->max_size, slot->hash, slot->node);
+    }
+  }
+  self->migrated = end;
+  if (self->migrated < self->old_max_size) return;
+  prom_free(self->old_slots);
+  self->old_slots = NULL;
+  self->old_max_size = 0;
+  self->migrated = 0;
+}
 
-  r = prom_linked_list_set_free_fn(new_keys, prom_linked_list_no_op_free);
-  if (r) return r;
+// Starts doubling the table when it is full. The entries move over in later calls to prom_map_migrate.
+static int prom_map_ensure_space(prom_map_t *self) {
+  if (self->size < PROM_MAP_MAX_LOAD(self->max_size)) return 0;
 
-  // Create a new array of addrs
-  prom_linked_list_t **new_addrs = prom_malloc(sizeof(prom_linked_list_t) * new_max);
+  // Keeps a single previous table; with PROM_MAP_MIGRATE_SLOTS above 1 it is always gone by now
+  prom_map_migrate(self, self->old_max_size);
 
-  // Initialize the new array
-  for (int i = 0; i < new_max; i++) {
-    new_addrs[i] = prom_linked_list_new();
-    r = prom_linked_list_set_free_fn(new_addrs[i], prom_map_node_free);
-    if (r) return r;
-    r = prom_linked_list_set_compare_fn(new_addrs[i], prom_map_node_compare);
-    if (r) return r;
-  }
+  size_t new_max = self->max_size * 2;
+  prom_map_slot_t *new_slots = prom_map_slots_new(new_max);
+  if (new_slots == NULL) return 1;
+  self->old_slots = self->slots;
+  self->old_max_size = self->max_size;
+  self->migrated = 0;
+  self->slots = new_slots;
+  self->max_size = new_max;
+  return 0;
+}
 
-  // Iterate through each linked-list at each memory region in the map's backbone
-  for (int i = 0; i < self->max_size; i++) {
-    // Create a new map node for each node in the linked list and insert it into the new map. Afterwards, deallocate
-    // the old map node
-    prom_linked_list_t *list = self->addrs[i];
-    prom_linked_list_node_t *current_node = list->head;
-    while (current_node != NULL) {
-      prom_map_node_t *map_node = (prom_map_node_t *)current_node->item;
-      r = prom_map_set_internal(map_node->key, map_node->value, &new_size, &new_max, new_keys, new_addrs,
-                                self->free_value_fn, false);
-      if (r) return r;
-
-      prom_linked_list_node_t *next = current_node->next;
-      prom_free(current_node);
-      current_node = NULL;
-      prom_free((void *)map_node->key);
-      map_node->key = NULL;
-      prom_free(map_node);
-      map_node = NULL;
-      current_node = next;
-    }
-    // We're done deallocating each map node in the linked list, so deallocate the linked-list object
-    prom_free(self->addrs[i]);
-    self->addrs[i] = NULL;
+static int prom_map_set_internal(prom_map_t *self, const char *key, void *value) {
+  int r = 0;
+  size_t len = strlen(key);
+  uint64_t hash = prom_map_hash(key, len);
+
+  prom_map_migrate(self, PROM_MAP_MIGRATE_SLOTS);
+
+  prom_map_slot_t *slot = prom_map_lookup(self, key, len, hash);
+  if (slot != NULL) {
+    prom_map_node_t *node = slot->node;
+    if (node->value != NULL && node->value != value) node->free_value_fn(node->value);
+    // Keep the existing key since the list of keys points at it
+    node->value = value;
+    node->free_value_fn = self->free_value_fn;
+    return 0;
   }
-  // Destroy the collection of keys in the map
-  prom_linked_list_destroy(self->keys);
-  self->keys = NULL;
-
-  // Deallocate the backbone of the map
-  prom_free(self->addrs);
-  self->addrs = NULL;
 
-  // Update the members of the current map
-  self->size = new_size;
-  self->max_size = new_max;
-  self->keys = new_keys;
-  self->addrs = new_addrs;
+  r = prom_map_ensure_space(self);
+  if (r) return r;
 
+  prom_map_node_t *node = prom_map_node_new(key, value, self->free_value_fn);
+  if (node == NULL) return 1;
+  r = prom_linked_list_append(self->keys, (char *)node->key);
+  if (r) {
+    node->value = NULL;
+    prom_map_node_destroy(node);
+    return r;
+  }
+  node->key_node = self->keys->tail;
+  prom_map_place(self->slots, self->max_size, hash, node);
+  self->size++;
   return 0;
 }
 
@@ -328,79 +454,115 @@ int prom_map_set(prom_map_t *self, const char *key, void *value) {
     return r;
   }
 
-  r = prom_map_ensure_space(self);
-  if (r) {
-    int rr = 0;
-    rr = pthread_rwlock_unlock(self->rwlock);
-    if (rr) {
-      PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-      return rr;
-    } else {
-      return r;
-    }
+  r = prom_map_set_internal(self, key, value);
+
+  int rr = pthread_rwlock_unlock(self->rwlock);
+  if (rr) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    return rr;
   }
-  r = prom_map_set_internal(key, value, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn,
-                            true);
-  if (r) {
-    int rr = 0;
-    rr = pthread_rwlock_unlock(self->rwlock);
-    if (rr) {
-      PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-      return rr;
-    } else {
-      return r;
-    }
+  return r;
+}
+
+// Removes key from the map. If value is not NULL, the value is handed to the caller instead of being freed.
+static int prom_map_delete_internal(prom_map_t *self, const char *key, void **value) {
+  int r = 0;
+  size_t len = strlen(key);
+  uint64_t hash = prom_map_hash(key, len);
+
+  prom_map_migrate(self, PROM_MAP_MIGRATE_SLOTS);
+
+  prom_map_slot_t *slot = prom_map_lookup(self, key, len, hash);
+  if (slot == NULL) return 0;
+
+  prom_map_node_t *node = slot->node;
+  if (slot >= self->slots && slot < self->slots + self->max_size) {
+    prom_map_remove_slot(self->slots, self->max_size, slot);
+  } else {
+    slot->node = &prom_map_tombstone;
   }
-  r = pthread_rwlock_unlock(self->rwlock);
+  self->size--;
+
+  r = prom_linked_list_remove_node(self->keys, node->key_node);
+  self->version++;
+  if (value != NULL) {
+    *value = node->value;
+    node->value = NULL;
+  }
+  int rr = prom_map_node_destroy(node);
+  return r ? r : rr;
+}
+
+int prom_map_delete(prom_map_t *self, const char *key) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+  r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  r = prom_map_delete_internal(self, key, NULL);
+  int rr = pthread_rwlock_unlock(self->rwlock);
+  if (rr) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    return rr;
   }
   return r;
 }
 
-static int prom_map_delete_internal(const char *key, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                    prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn) {
-  int r = 0;
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  prom_map_node_t *temp_map_node = prom_map_node_new(key, NULL, free_value_fn);
-
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, temp_map_node);
-    if (result == PROM_EQUAL) {
-      r = prom_linked_list_remove(list, current_node);
-      if (r) return r;
-
-      r = prom_linked_list_remove(keys, (char *)current_map_node->key);
-      if (r) return r;
-
-      (*size)--;
-      break;
-    }
+void *prom_map_take(prom_map_t *self, const char *key) {
+  PROM_ASSERT(self != NULL);
+  void *value = NULL;
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
   }
-  r = prom_map_node_destroy(temp_map_node);
-  temp_map_node = NULL;
-  return r;
+  r = prom_map_delete_internal(self, key, &value);
+  pthread_rwlock_unlock(self->rwlock);
+  return r ? NULL : value;
 }
 
-int prom_map_delete(prom_map_t *self, const char *key) {
+int prom_map_swap(prom_map_t *self, prom_map_t *other) {
   PROM_ASSERT(self != NULL);
+  PROM_ASSERT(other != NULL);
   int r = 0;
-  int ret = 0;
+
   r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    ret = r;
+    return r;
   }
-  r = prom_map_delete_internal(key, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn);
-  if (r) ret = r;
-  r = pthread_rwlock_unlock(self->rwlock);
+  r = pthread_rwlock_wrlock(other->rwlock);
   if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-    ret = r;
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    pthread_rwlock_unlock(self->rwlock);
+    return r;
   }
-  return ret;
+
+  prom_map_t entries = *self;
+  self->size = other->size;
+  self->max_size = other->max_size;
+  self->keys = other->keys;
+  self->slots = other->slots;
+  self->old_max_size = other->old_max_size;
+  self->old_slots = other->old_slots;
+  self->migrated = other->migrated;
+  other->size = entries.size;
+  other->max_size = entries.max_size;
+  other->keys = entries.keys;
+  other->slots = entries.slots;
+  other->old_max_size = entries.old_max_size;
+  other->old_slots = entries.old_slots;
+  other->migrated = entries.migrated;
+
+  // Cursors into either list of keys must resync, whichever version they saw last
+  size_t version = (self->version > other->version ? self->version : other->version) + 1;
+  self->version = version;
+  other->version = version;
+
+  pthread_rwlock_unlock(other->rwlock);
+  return pthread_rwlock_unlock(self->rwlock);
 }
 
 int prom_map_set_free_value_fn(prom_map_t *self, prom_map_node_free_value_fn free_value_fn) {
@@ -25,10 +25,33 @@ int prom_map_set_free_value_fn(prom_map_t *self, prom_map_node_free_value_fn fre
 
 void *prom_map_get(prom_map_t *self, const char *key);
 
+/**
+ * @brief API PRIVATE Returns the value of key like prom_map_get, but keeps holding the read lock of the map if the key
+ * is found, so the value can be neither taken nor freed until prom_map_release. Returns NULL without the lock
+ * otherwise.
+ */
+void *prom_map_acquire(prom_map_t *self, const char *key);
+
+/**
+ * @brief API PRIVATE Releases the read lock kept by a successful prom_map_acquire
+ */
+void prom_map_release(prom_map_t *self);
+
 int prom_map_set(prom_map_t *self, const char *key, void *value);
 
 int prom_map_delete(prom_map_t *self, const char *key);
 
+/**
+ * @brief API PRIVATE Removes key from the map and returns its value without freeing it, or NULL if key is absent
+ */
+void *prom_map_take(prom_map_t *self, const char *key);
+
+/**
+ * @brief API PRIVATE Exchanges the entries of the two maps, so either map's readers see all of its old entries or all
+ * of its new ones. Both maps keep their locks and free functions.
+ */
+int prom_map_swap(prom_map_t *self, prom_map_t *other);
+
 int prom_map_destroy(prom_map_t *self);
 
 size_t prom_map_size(prom_map_t *self);
@@ -18,6 +18,8 @@
 #define PROM_MAP_T_H
 
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Public
 #include "prom_map.h"
@@ -29,15 +31,41 @@ typedef void (*prom_map_node_free_value_fn)(void *);
 
 struct prom_map_node {
   const char *key;
+  size_t key_len; /**< strlen(key), so probes compare lengths before bytes */
   void *value;
   prom_map_node_free_value_fn free_value_fn;
+  prom_linked_list_node_t *key_node; /**< the node of key in the list of keys, so deletion does not search the list */
 };
 
+/**
+ * @brief API PRIVATE A slot of the open addressing table of a prom_map
+ */
+typedef struct prom_map_slot {
+  uint64_t hash;         /**< the hash of node->key, kept here so probes rarely touch the node */
+  prom_map_node_t *node; /**< NULL when the slot is empty */
+} prom_map_slot_t;
+
+/**
+ * @brief API PRIVATE A hash map with string keys that remembers insertion order.
+ *
+ * Keys are found through an open addressing table with Robin Hood probing: an entry is never further from the slot its
+ * hash picks than the entries it passes, which keeps probe sequences short even when the table is 7/8 full, and a
+ * lookup can stop as soon as it meets an entry closer to home than the key would be. Deletion shifts the following
+ * entries back instead of leaving tombstones. Iteration goes through keys, in insertion order.
+ *
+ * Growing does not rehash at once: the full table becomes old_slots, and every set or delete moves a few of its slots
+ * into a table twice as large until none are left. Lookups check slots, then old_slots. Deletions from old_slots leave
+ * a tombstone since the table is read-only until it is freed.
+ */
 struct prom_map {
   size_t size;                /**< contains the size of the map */
-  size_t max_size;            /**< stores the current max_size */
+  size_t max_size;            /**< the number of slots, a power of two */
   prom_linked_list_t *keys;   /**< linked list containing containing all keys present */
-  prom_linked_list_t **addrs; /**< Sequence of linked lists. Each list contains nodes with the same index */
+  prom_map_slot_t *slots;     /**< the open addressing table */
+  size_t old_max_size;        /**< the number of slots of old_slots */
+  prom_map_slot_t *old_slots; /**< the table being migrated into slots, or NULL */
+  size_t migrated;            /**< the number of slots of old_slots already moved into slots */
+  size_t version;             /**< bumped whenever nodes of keys are freed, so cursors held across calls can resync */
   pthread_rwlock_t *rwlock;
   prom_map_node_free_value_fn free_value_fn;
 };
@@ -23,42 +23,76 @@
 // Private
 #include "prom_assert.h"
 #include "prom_errors.h"
+#include "prom_linked_list_i.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
+#include "prom_metric_formatter_t.h"
 #include "prom_metric_i.h"
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_native_histogram_i.h"
+#include "prom_string_builder_i.h"
 
 char *prom_metric_type_map[4] = {"counter", "gauge", "histogram", "summary"};
 
 prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name, const char *help,
                                size_t label_key_count, const char **label_keys) {
   int r = 0;
+
+  // Reserved label names are refused before anything is allocated. Histograms expose le and summaries quantile.
+  for (size_t i = 0; i < label_key_count; i++) {
+    if (strcmp(label_keys[i], "le") == 0 || (metric_type == PROM_SUMMARY && strcmp(label_keys[i], "quantile") == 0)) {
+      PROM_LOG(PROM_METRIC_INVALID_LABEL_NAME);
+      return NULL;
+    }
+  }
+
   prom_metric_t *self = (prom_metric_t *)prom_malloc(sizeof(prom_metric_t));
   self->type = metric_type;
   self->name = name;
   self->help = help;
   self->buckets = NULL;
+  self->header = NULL;
+  self->header_len = 0;
+  self->openmetrics_header = NULL;
+  self->openmetrics_header_len = 0;
+  self->sharded = false;
+  self->integer = false;
+  self->native = false;
+  self->native_schema = 0;
+  self->native_max_bucket_count = 0;
+  self->summary_config = NULL;
+  self->max_series = 0;
+  self->ttl = 0;
+  atomic_init(&self->dropped_series, 0);
+  atomic_init(&self->evicted_series, 0);
+  self->samples = NULL;
+  self->retired = NULL;
+  self->formatter = NULL;
 
   const char **k = (const char **)prom_malloc(sizeof(const char *) * label_key_count);
-
-  for (int i = 0; i < label_key_count; i++) {
-    if (strcmp(label_keys[i], "le") == 0) {
-      PROM_LOG(PROM_METRIC_INVALID_LABEL_NAME);
-      prom_metric_destroy(self);
-      return NULL;
-    }
-    if (strcmp(label_keys[i], "quantile") == 0) {
-      PROM_LOG(PROM_METRIC_INVALID_LABEL_NAME);
-      prom_metric_destroy(self);
-      return NULL;
-    }
-    k[i] = prom_strdup(label_keys[i]);
-  }
+  for (int i = 0; i < label_key_count; i++) k[i] = prom_strdup(label_keys[i]);
   self->label_keys = k;
   self->label_key_count = label_key_count;
+
+  // Created first so that every later failure can go through prom_metric_destroy
+  self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
+  r = pthread_rwlock_init(self->rwlock, NULL);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_INIT_ERROR);
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
+    prom_metric_destroy(self);
+    return NULL;
+  }
+
   self->samples = prom_map_new();
+  if (self->samples == NULL) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
 
   if (metric_type == PROM_HISTOGRAM) {
     r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_histogram_free_generic);
@@ -66,6 +100,12 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
       prom_metric_destroy(self);
       return NULL;
     }
+  } else if (metric_type == PROM_SUMMARY) {
+    r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_summary_free_generic);
+    if (r) {
+      prom_metric_destroy(self);
+      return NULL;
+    }
   } else {
     r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_free_generic);
     if (r) {
@@ -74,17 +114,40 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
     }
   }
 
+  self->retired = prom_linked_list_new();
+  if (self->retired == NULL) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  r = prom_linked_list_set_free_fn(self->retired, self->samples->free_value_fn);
+  if (r) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+
   self->formatter = prom_metric_formatter_new();
   if (self->formatter == NULL) {
     prom_metric_destroy(self);
     return NULL;
   }
-  self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
-  r = pthread_rwlock_init(self->rwlock, NULL);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_INIT_ERROR);
+
+  // Neither the name, the help nor the type change after this, so render the descriptor lines once
+  r = prom_metric_formatter_load_help(self->formatter, self->name, self->help);
+  if (!r) r = prom_metric_formatter_load_type(self->formatter, self->name, self->type);
+  if (!r) self->header = prom_metric_formatter_dump(self->formatter);
+  if (r || self->header == NULL) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  self->header_len = strlen(self->header);
+
+  r = prom_metric_formatter_load_openmetrics_descriptor(self->formatter, self);
+  if (!r) self->openmetrics_header = prom_metric_formatter_dump(self->formatter);
+  if (r || self->openmetrics_header == NULL) {
+    prom_metric_destroy(self);
     return NULL;
   }
+  self->openmetrics_header_len = strlen(self->openmetrics_header);
   return self;
 }
 
@@ -101,22 +164,42 @@ int prom_metric_destroy(prom_metric_t *self) {
     if (r) ret = r;
   }
 
-  r = prom_map_destroy(self->samples);
-  self->samples = NULL;
+  if (self->samples != NULL) {
+    r = prom_map_destroy(self->samples);
+    self->samples = NULL;
+    if (r) ret = r;
+  }
+
+  // Handles to retired samples are invalidated along with those to linked ones
+  if (self->retired != NULL) {
+    r = prom_linked_list_destroy(self->retired);
+    self->retired = NULL;
+    if (r) ret = r;
+  }
+
+  // The samples point to the configuration, so it goes after them
+  r = prom_summary_config_destroy(self->summary_config);
+  self->summary_config = NULL;
   if (r) ret = r;
 
   r = prom_metric_formatter_destroy(self->formatter);
   self->formatter = NULL;
   if (r) ret = r;
 
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR);
-    ret = r;
-  }
+  prom_free(self->header);
+  self->header = NULL;
+  prom_free(self->openmetrics_header);
+  self->openmetrics_header = NULL;
 
-  prom_free(self->rwlock);
-  self->rwlock = NULL;
+  if (self->rwlock != NULL) {
+    r = pthread_rwlock_destroy(self->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR);
+      ret = r;
+    }
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
+  }
 
   for (int i = 0; i < self->label_key_count; i++) {
     prom_free((void *)self->label_keys[i]);
@@ -144,95 +227,459 @@ void prom_metric_free_generic(void *item) {
   prom_metric_destroy(self);
 }
 
-prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const char **label_values) {
-  PROM_ASSERT(self != NULL);
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sample lookup
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Each thread formats l_values in a formatter of its own, which keeps its buffer between calls, so looking up an
+// existing sample neither allocates nor serializes threads on the metric's formatter
+static pthread_key_t prom_metric_lookup_key;
+static pthread_once_t prom_metric_lookup_once = PTHREAD_ONCE_INIT;
+static int prom_metric_lookup_key_error = 0;
+
+static void prom_metric_lookup_formatter_destroy(void *formatter) {
+  prom_metric_formatter_destroy((prom_metric_formatter_t *)formatter);
+}
+
+static void prom_metric_lookup_key_init(void) {
+  prom_metric_lookup_key_error = pthread_key_create(&prom_metric_lookup_key, prom_metric_lookup_formatter_destroy);
+}
+
+/**
+ * @brief Formats the l_value of label_values into the calling thread's formatter and returns it. The string is only
+ * valid until the next call on the same thread.
+ */
+static const char *prom_metric_lookup_l_value(prom_metric_t *self, const char **label_values) {
   int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+
+  r = pthread_once(&prom_metric_lookup_once, prom_metric_lookup_key_init);
+  if (r || prom_metric_lookup_key_error) {
+    PROM_LOG(PROM_PTHREAD_KEY_CREATE_ERROR);
     return NULL;
   }
 
-#define PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK() \
-  r = pthread_rwlock_unlock(self->rwlock);             \
-  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);   \
-  return NULL;
+  prom_metric_formatter_t *formatter = (prom_metric_formatter_t *)pthread_getspecific(prom_metric_lookup_key);
+  if (formatter == NULL) {
+    formatter = prom_metric_formatter_new();
+    if (formatter == NULL) return NULL;
+    r = pthread_setspecific(prom_metric_lookup_key, formatter);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_KEY_CREATE_ERROR);
+      prom_metric_formatter_destroy(formatter);
+      return NULL;
+    }
+  }
 
-  // Get l_value
-  r = prom_metric_formatter_load_l_value(self->formatter, self->name, NULL, self->label_key_count, self->label_keys,
+  r = prom_metric_formatter_clear(formatter);
+  if (r) return NULL;
+  r = prom_metric_formatter_load_l_value(formatter, self->name, NULL, self->label_key_count, self->label_keys,
                                          label_values);
+  if (r) return NULL;
+  return prom_string_builder_str(formatter->string_builder);
+}
+
+/**
+ * @brief Returns whether a new sample may be created, counting the refusal if the metric holds max_series samples
+ * already. The caller MUST hold the write lock.
+ */
+static bool prom_metric_admit(prom_metric_t *self) {
+  if (self->max_series == 0 || prom_map_size(self->samples) < self->max_series) return true;
+  atomic_fetch_add_explicit(&self->dropped_series, 1, memory_order_relaxed);
+  PROM_LOG(PROM_METRIC_SERIES_LIMIT);
+  return false;
+}
+
+// Starts the last-update stamp of a new sample of a metric with a TTL
+static void prom_metric_stamp(prom_metric_t *self, bool *expires, _Atomic uint64_t *updated) {
+  if (self->ttl == 0) return;
+  *expires = true;
+  atomic_store_explicit(updated, prom_metric_sample_clock(), memory_order_relaxed);
+}
+
+// Creates the sample of l_value for a metric of the type; the caller MUST hold the write lock
+typedef void *(*prom_metric_sample_create_fn)(prom_metric_t *self, const char *l_value, const char **label_values);
+
+static void *prom_metric_sample_create(prom_metric_t *self, const char *l_value, const char **label_values) {
+  prom_metric_sample_t *sample = NULL;
+  if (self->sharded) {
+    sample = prom_metric_sample_sharded_new(l_value);
+  } else if (self->integer) {
+    sample = prom_metric_sample_int_new(self->type, l_value);
+  } else {
+    sample = prom_metric_sample_new(self->type, l_value, 0.0);
+  }
+  if (sample == NULL) return NULL;
+  prom_metric_stamp(self, &sample->expires, &sample->updated);
+  int r = prom_map_set(self->samples, l_value, sample);
+  if (r) {
+    prom_metric_sample_destroy(sample);
+    return NULL;
+  }
+  return sample;
+}
+
+static void *prom_metric_sample_histogram_create(prom_metric_t *self, const char *l_value, const char **label_values) {
+  prom_metric_sample_histogram_t *sample = prom_metric_sample_histogram_new(
+      self->name, self->buckets, self->label_key_count, self->label_keys, label_values);
+  if (sample == NULL) return NULL;
+  if (self->native) {
+    sample->native = prom_native_histogram_new(self->native_schema, self->native_max_bucket_count);
+    if (sample->native == NULL) {
+      prom_metric_sample_histogram_destroy(sample);
+      return NULL;
+    }
+  }
+  prom_metric_stamp(self, &sample->expires, &sample->updated);
+  int r = prom_map_set(self->samples, l_value, sample);
   if (r) {
-    PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
+    prom_metric_sample_histogram_destroy(sample);
+    return NULL;
   }
+  return sample;
+}
 
-  // This must be freed before returning
-  const char *l_value = prom_metric_formatter_dump(self->formatter);
-  if (l_value == NULL) {
-    PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
+static void *prom_metric_sample_summary_create(prom_metric_t *self, const char *l_value, const char **label_values) {
+  prom_metric_sample_summary_t *sample = prom_metric_sample_summary_new(self->name, self->summary_config,
+                                                                        self->label_key_count, self->label_keys,
+                                                                        label_values);
+  if (sample == NULL) return NULL;
+  prom_metric_stamp(self, &sample->expires, &sample->updated);
+  int r = prom_map_set(self->samples, l_value, sample);
+  if (r) {
+    prom_metric_sample_summary_destroy(sample);
+    return NULL;
   }
+  return sample;
+}
 
-  // Get sample
-  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(self->samples, l_value);
-  if (sample == NULL) {
-    sample = prom_metric_sample_new(self->type, l_value, 0.0);
-    r = prom_map_set(self->samples, l_value, sample);
+/**
+ * @brief Returns the sample of label_values, creating it if needed, with the read lock of the samples map held.
+ *
+ * Removal, eviction and replacement unlink samples under the write lock of the map, so a sample returned here cannot
+ * be freed before prom_metric_sample_release and is freed as soon as it was unlinked.
+ */
+static void *prom_metric_acquire(prom_metric_t *self, const char **label_values, prom_metric_sample_create_fn create) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  const char *l_value = prom_metric_lookup_l_value(self, label_values);
+  if (l_value == NULL) return NULL;
+
+  // Almost every call finds an existing sample, which only takes the read lock of the map
+  void *sample = prom_map_acquire(self->samples, l_value);
+  if (sample != NULL) return sample;
+
+  for (;;) {
+    r = pthread_rwlock_wrlock(self->rwlock);
     if (r) {
-      PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
+      PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+      return NULL;
     }
+    // Another thread may have created the sample before the lock was taken
+    bool created = prom_map_get(self->samples, l_value) != NULL;
+    if (!created && prom_metric_admit(self)) created = create(self, l_value, label_values) != NULL;
+    r = pthread_rwlock_unlock(self->rwlock);
+    if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    if (!created) return NULL;
+
+    // The sample may be removed again between the two locks, in which case it is created anew
+    sample = prom_map_acquire(self->samples, l_value);
+    if (sample != NULL) return sample;
   }
-  pthread_rwlock_unlock(self->rwlock);
-  prom_free((void *)l_value);
+}
+
+prom_metric_sample_t *prom_metric_sample_acquire(prom_metric_t *self, const char **label_values) {
+  return (prom_metric_sample_t *)prom_metric_acquire(self, label_values, &prom_metric_sample_create);
+}
+
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_acquire(prom_metric_t *self, const char **label_values) {
+  return (prom_metric_sample_histogram_t *)prom_metric_acquire(self, label_values,
+                                                               &prom_metric_sample_histogram_create);
+}
+
+prom_metric_sample_summary_t *prom_metric_sample_summary_acquire(prom_metric_t *self, const char **label_values) {
+  return (prom_metric_sample_summary_t *)prom_metric_acquire(self, label_values, &prom_metric_sample_summary_create);
+}
+
+void prom_metric_sample_release(prom_metric_t *self) {
+  PROM_ASSERT(self != NULL);
+  prom_map_release(self->samples);
+}
+
+// Returns the reference count of a sample of the metric
+static atomic_uint *prom_metric_sample_refs(prom_metric_t *self, void *sample) {
+  if (self->type == PROM_HISTOGRAM) return &((prom_metric_sample_histogram_t *)sample)->refs;
+  if (self->type == PROM_SUMMARY) return &((prom_metric_sample_summary_t *)sample)->refs;
+  return &((prom_metric_sample_t *)sample)->refs;
+}
+
+/**
+ * @brief Drops the reference of the map to a sample taken from it. The sample is freed unless handles still hold it,
+ * in which case it is retired until the last of them is returned. The caller MUST hold the write lock.
+ */
+static void prom_metric_unlink(prom_metric_t *self, void *sample) {
+  if (atomic_fetch_sub_explicit(prom_metric_sample_refs(self, sample), 1, memory_order_acq_rel) == 1) {
+    self->samples->free_value_fn(sample);
+    return;
+  }
+  prom_linked_list_append(self->retired, sample);
+}
+
+// Returns a sample as a handle, which holds a reference of its own until prom_metric_return_sample
+static void *prom_metric_handle(prom_metric_t *self, const char **label_values, prom_metric_sample_create_fn create) {
+  PROM_ASSERT(self != NULL);
+  void *sample = prom_metric_acquire(self, label_values, create);
+  if (sample == NULL) return NULL;
+  // The read lock of the map keeps the sample linked meanwhile, so the reference of the map is still counted
+  atomic_fetch_add_explicit(prom_metric_sample_refs(self, sample), 1, memory_order_relaxed);
+  prom_metric_sample_release(self);
   return sample;
 }
 
+prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const char **label_values) {
+  return (prom_metric_sample_t *)prom_metric_handle(self, label_values, &prom_metric_sample_create);
+}
+
 prom_metric_sample_histogram_t *prom_metric_sample_histogram_from_labels(prom_metric_t *self,
                                                                          const char **label_values) {
+  return (prom_metric_sample_histogram_t *)prom_metric_handle(self, label_values,
+                                                              &prom_metric_sample_histogram_create);
+}
+
+prom_metric_sample_summary_t *prom_metric_sample_summary_from_labels(prom_metric_t *self, const char **label_values) {
+  return (prom_metric_sample_summary_t *)prom_metric_handle(self, label_values, &prom_metric_sample_summary_create);
+}
+
+int prom_metric_return_sample(prom_metric_t *self, void *sample) {
   PROM_ASSERT(self != NULL);
+  PROM_ASSERT(sample != NULL);
+  if (self == NULL || sample == NULL) return 1;
 
-  int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
+  int r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    return NULL;
+    return r;
   }
+  // A linked sample keeps the reference of the map, so only a retired one can lose its last reference here
+  if (atomic_fetch_sub_explicit(prom_metric_sample_refs(self, sample), 1, memory_order_acq_rel) == 1) {
+    r = prom_linked_list_remove(self->retired, sample);
+  }
+  int rr = pthread_rwlock_unlock(self->rwlock);
+  if (rr) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return r ? r : rr;
+}
 
-#define PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK() \
-  r = pthread_rwlock_unlock(self->rwlock);                       \
-  if (r) {                                                       \
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);                  \
-    return NULL;                                                 \
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Series limits
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int prom_metric_set_series_limit(prom_metric_t *self, size_t max_series) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
   }
+  self->max_series = max_series;
+  return pthread_rwlock_unlock(self->rwlock);
+}
 
-  // Load the l_value
-  r = prom_metric_formatter_load_l_value(self->formatter, self->name, NULL, self->label_key_count, self->label_keys,
-                                         label_values);
+int prom_metric_set_ttl(prom_metric_t *self, double ttl) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || !(ttl >= 0.0 && ttl * 1e9 < (double)UINT64_MAX)) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  // Samples created without a TTL do not stamp their updates, so they could not be told apart from stale ones
+  if (prom_map_size(self->samples) > 0) {
+    PROM_LOG(PROM_METRIC_TTL_AFTER_SAMPLES);
+    pthread_rwlock_unlock(self->rwlock);
+    return 1;
   }
+  self->ttl = (uint64_t)(ttl * 1e9);
+  return pthread_rwlock_unlock(self->rwlock);
+}
 
-  // This must be freed before returning
-  const char *l_value = prom_metric_formatter_dump(self->formatter);
-  if (l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Series removal
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int prom_metric_remove(prom_metric_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  const char *l_value = prom_metric_lookup_l_value(self, label_values);
+  if (l_value == NULL) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
   }
+  // Updates hold the read lock of the map while they use a sample, so none of them holds it once it is taken
+  void *sample = prom_map_take(self->samples, l_value);
+  if (sample != NULL) prom_metric_unlink(self, sample);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return r;
+}
+
+int prom_metric_clear(prom_metric_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  prom_metric_family_t *family = prom_metric_family_new(self);
+  if (family == NULL) return 1;
+  return prom_metric_replace(self, family);
+}
+
+prom_metric_family_t *prom_metric_family_new(prom_metric_t *metric) {
+  PROM_ASSERT(metric != NULL);
+  if (metric == NULL) return NULL;
+
+  prom_metric_family_t *self = (prom_metric_family_t *)prom_malloc(sizeof(prom_metric_family_t));
+  self->metric = metric;
+  self->samples = prom_map_new();
+  if (self->samples == NULL) {
+    prom_free(self);
+    return NULL;
+  }
+  int r = prom_map_set_free_value_fn(self->samples, metric->samples->free_value_fn);
+  if (r) {
+    prom_metric_family_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_metric_family_destroy(prom_metric_family_t *self) {
+  if (self == NULL) return 0;
+  int r = prom_map_destroy(self->samples);
+  self->samples = NULL;
+  prom_free(self);
+  self = NULL;
+  return r;
+}
+
+int prom_metric_family_set(prom_metric_family_t *self, const char **label_values, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
 
-  // Get sample
-  prom_metric_sample_histogram_t *sample = (prom_metric_sample_histogram_t *)prom_map_get(self->samples, l_value);
+  prom_metric_t *metric = self->metric;
+  if (metric->type != PROM_COUNTER && metric->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  const char *l_value = prom_metric_lookup_l_value(metric, label_values);
+  if (l_value == NULL) return 1;
+
+  // No other thread sees the family's samples, so nothing is locked until it replaces the metric's
+  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(self->samples, l_value);
   if (sample == NULL) {
-    sample = prom_metric_sample_histogram_new(self->name, self->buckets, self->label_key_count, self->label_keys,
-                                              label_values);
-    if (sample == NULL) {
-      prom_free((void *)l_value);
-      PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+    if (metric->max_series != 0 && prom_map_size(self->samples) >= metric->max_series) {
+      atomic_fetch_add_explicit(&metric->dropped_series, 1, memory_order_relaxed);
+      PROM_LOG(PROM_METRIC_SERIES_LIMIT);
+      return 1;
+    }
+    if (metric->sharded) {
+      sample = prom_metric_sample_sharded_new(l_value);
+    } else if (metric->integer) {
+      sample = prom_metric_sample_int_new(metric->type, l_value);
+    } else {
+      sample = prom_metric_sample_new(metric->type, l_value, 0.0);
     }
-    r = prom_map_set(self->samples, l_value, sample);
+    if (sample == NULL) return 1;
+    prom_metric_stamp(metric, &sample->expires, &sample->updated);
+    int r = prom_map_set(self->samples, l_value, sample);
     if (r) {
-      prom_free((void *)l_value);
-      pthread_rwlock_unlock(self->rwlock);
-      PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+      prom_metric_sample_destroy(sample);
+      return r;
     }
   }
-  pthread_rwlock_unlock(self->rwlock);
-  prom_free((void *)l_value);
-  return sample;
+  return prom_metric_sample_load(sample, r_value);
+}
+
+int prom_metric_replace(prom_metric_t *self, prom_metric_family_t *family) {
+  PROM_ASSERT(self != NULL);
+  PROM_ASSERT(family != NULL);
+  if (self == NULL || family == NULL || family->metric != self) {
+    prom_metric_family_destroy(family);
+    return 1;
+  }
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    prom_metric_family_destroy(family);
+    return r;
+  }
+  // The metric keeps its map, which threads read without the metric's lock, and takes the family's entries
+  r = prom_map_swap(self->samples, family->samples);
+  if (r) {
+    pthread_rwlock_unlock(self->rwlock);
+    prom_metric_family_destroy(family);
+    return r;
+  }
+  // The swap took the write lock of the map, so no update holds any of the samples the family now has
+  for (prom_linked_list_node_t *node = family->samples->keys->head; node != NULL;) {
+    const char *key = (const char *)node->item;
+    node = node->next;
+    void *sample = prom_map_take(family->samples, key);
+    if (sample != NULL) prom_metric_unlink(self, sample);
+  }
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+
+  int rr = prom_metric_family_destroy(family);
+  return r ? r : rr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Eviction
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the last-update stamp of a sample of the metric
+static uint64_t prom_metric_sample_updated(prom_metric_t *self, void *sample) {
+  if (self->type == PROM_HISTOGRAM) {
+    return atomic_load_explicit(&((prom_metric_sample_histogram_t *)sample)->updated, memory_order_relaxed);
+  }
+  if (self->type == PROM_SUMMARY) {
+    return atomic_load_explicit(&((prom_metric_sample_summary_t *)sample)->updated, memory_order_relaxed);
+  }
+  return atomic_load_explicit(&((prom_metric_sample_t *)sample)->updated, memory_order_relaxed);
+}
+
+int prom_metric_sweep(prom_metric_t *self, uint64_t now) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  // The stamp of a sample updated while the sweep runs may be ahead of now
+  for (prom_linked_list_node_t *node = self->samples->keys->head; node != NULL && self->ttl != 0;) {
+    const char *key = (const char *)node->item;
+    node = node->next;
+    void *sample = prom_map_get(self->samples, key);
+    if (sample == NULL) continue;
+    uint64_t updated = prom_metric_sample_updated(self, sample);
+    if (updated > now || now - updated < self->ttl) continue;
+
+    // Updates hold the read lock of the map while they use a sample, so none of them holds it once it is taken
+    sample = prom_map_take(self->samples, key);
+    if (sample == NULL) continue;
+    prom_metric_unlink(self, sample);
+    atomic_fetch_add_explicit(&self->evicted_series, 1, memory_order_relaxed);
+  }
+
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return r;
 }
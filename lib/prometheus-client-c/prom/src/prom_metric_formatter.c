@@ -14,7 +14,17 @@
  * limitations under the License.
  */
 
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // Public
 #include "prom_alloc.h"
@@ -22,16 +32,23 @@
 // Private
 #include "prom_assert.h"
 #include "prom_collector_t.h"
+#include "prom_errors.h"
 #include "prom_linked_list_t.h"
+#include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_sample_i.h"
 #include "prom_metric_sample_t.h"
 #include "prom_metric_t.h"
 #include "prom_string_builder_i.h"
 
 prom_metric_formatter_t *prom_metric_formatter_new() {
   prom_metric_formatter_t *self = (prom_metric_formatter_t *)prom_malloc(sizeof(prom_metric_formatter_t));
+  self->scratch = NULL;
+  self->scratch_size = 0;
   self->string_builder = prom_string_builder_new();
   if (self->string_builder == NULL) {
     prom_metric_formatter_destroy(self);
@@ -60,6 +77,9 @@ int prom_metric_formatter_destroy(prom_metric_formatter_t *self) {
   self->err_builder = NULL;
   if (r) ret = r;
 
+  prom_free(self->scratch);
+  self->scratch = NULL;
+
   prom_free(self);
   self = NULL;
   return ret;
@@ -107,6 +127,60 @@ int prom_metric_formatter_load_type(prom_metric_formatter_t *self, const char *n
   return prom_string_builder_add_char(self->string_builder, '\n');
 }
 
+/**
+ * @brief Returns the length of the longest prefix of str that contains no backslash, double-quote or newline
+ *
+ * Label values are usually clean, so where SSE2 is available the scan checks 16 bytes per step, looking for the
+ * terminating null byte at the same time so the value is read once. Loads are 16 byte aligned and therefore never cross
+ * into an unmapped page, but they may read bytes around str that belong to other objects; hence no ASan nor TSan.
+ */
+#if defined(__SSE2__)
+__attribute__((no_sanitize_address, no_sanitize_thread)) static size_t
+prom_metric_formatter_clean_prefix_len(const char *str) {
+  const __m128i nul = _mm_setzero_si128();
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i newline = _mm_set1_epi8('\n');
+
+  size_t misalignment = (uintptr_t)str & 15;
+  const char *block = str - misalignment;
+  for (;;) {
+    __m128i chunk = _mm_load_si128((const __m128i *)block);
+    __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, nul), _mm_cmpeq_epi8(chunk, backslash)),
+                                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, newline)));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+    // Ignore the bytes of the first block that precede str
+    if (block < str) mask &= ~0U << misalignment;
+    if (mask) return block + __builtin_ctz(mask) - str;
+    block += 16;
+  }
+}
+#else
+static size_t prom_metric_formatter_clean_prefix_len(const char *str) {
+  return strcspn(str, "\\\"\n");
+}
+#endif
+
+/**
+ * @brief Loads a label value, escaping backslash, double-quote and newline as the exposition formats require
+ */
+static int prom_metric_formatter_load_label_value(prom_metric_formatter_t *self, const char *value) {
+  int r = 0;
+
+  for (;;) {
+    size_t clean = prom_metric_formatter_clean_prefix_len(value);
+    r = prom_string_builder_add_bytes(self->string_builder, value, clean);
+    if (r) return r;
+    value += clean;
+    if (*value == '\0') return 0;
+
+    char escaped[2] = {'\\', *value == '\n' ? 'n' : *value};
+    r = prom_string_builder_add_bytes(self->string_builder, escaped, sizeof(escaped));
+    if (r) return r;
+    value++;
+  }
+}
+
 int prom_metric_formatter_load_l_value(prom_metric_formatter_t *self, const char *name, const char *suffix,
                                        size_t label_count, const char **label_keys, const char **label_values) {
   PROM_ASSERT(self != NULL);
@@ -127,35 +201,52 @@ int prom_metric_formatter_load_l_value(prom_metric_formatter_t *self, const char
 
   if (label_count == 0) return 0;
 
+  r = prom_string_builder_add_char(self->string_builder, '{');
+  if (r) return r;
+
   for (int i = 0; i < label_count; i++) {
-    if (i == 0) {
-      r = prom_string_builder_add_char(self->string_builder, '{');
+    if (i > 0) {
+      r = prom_string_builder_add_char(self->string_builder, ',');
       if (r) return r;
     }
     r = prom_string_builder_add_str(self->string_builder, (const char *)label_keys[i]);
     if (r) return r;
 
-    r = prom_string_builder_add_char(self->string_builder, '=');
-    if (r) return r;
-
-    r = prom_string_builder_add_char(self->string_builder, '"');
+    r = prom_string_builder_add_bytes(self->string_builder, "=\"", 2);
     if (r) return r;
 
-    r = prom_string_builder_add_str(self->string_builder, (const char *)label_values[i]);
+    r = prom_metric_formatter_load_label_value(self, (const char *)label_values[i]);
     if (r) return r;
 
     r = prom_string_builder_add_char(self->string_builder, '"');
     if (r) return r;
+  }
+  return prom_string_builder_add_char(self->string_builder, '}');
+}
 
-    if (i == label_count - 1) {
-      r = prom_string_builder_add_char(self->string_builder, '}');
-      if (r) return r;
-    } else {
-      r = prom_string_builder_add_char(self->string_builder, ',');
-      if (r) return r;
-    }
+static int prom_metric_formatter_load_value(prom_metric_formatter_t *self, double value) {
+  // Both exposition formats spell the special values this way rather than as printf does
+  if (isnan(value)) return prom_string_builder_add_str(self->string_builder, "NaN");
+  if (isinf(value)) return prom_string_builder_add_str(self->string_builder, value > 0 ? "+Inf" : "-Inf");
+
+  return prom_string_builder_add_double(self->string_builder, value);
+}
+
+static int prom_metric_formatter_load_sample_value(prom_metric_formatter_t *self, prom_metric_sample_t *sample) {
+  // Integer samples are written as they are, without the special cases and the conversion of a double
+  if (sample->integer) return prom_string_builder_add_int64(self->string_builder, atomic_load(&sample->i_value));
+  return prom_metric_formatter_load_value(self, prom_metric_sample_value(sample));
+}
+
+// Writes the value at index i of a histogram's l_value_list: a cumulative bucket count, the total count or the sum
+static int prom_metric_formatter_load_histogram_value(prom_metric_formatter_t *self, const uint64_t *cumulative,
+                                                      size_t bucket_count, double sum, size_t i) {
+  // The total count is the count of the +Inf bucket
+  if (i <= bucket_count + 1) {
+    uint64_t count = cumulative[i <= bucket_count ? i : bucket_count];
+    return prom_string_builder_add_int64(self->string_builder, (int64_t)count);
   }
-  return 0;
+  return prom_metric_formatter_load_value(self, sum);
 }
 
 int prom_metric_formatter_load_sample(prom_metric_formatter_t *self, prom_metric_sample_t *sample) {
@@ -164,20 +255,100 @@ int prom_metric_formatter_load_sample(prom_metric_formatter_t *self, prom_metric
 
   int r = 0;
 
-  r = prom_string_builder_add_str(self->string_builder, sample->l_value);
+  r = prom_string_builder_add_bytes(self->string_builder, sample->l_value, sample->l_value_len);
   if (r) return r;
 
   r = prom_string_builder_add_char(self->string_builder, ' ');
   if (r) return r;
 
-  char buffer[50];
-  sprintf(buffer, "%.17g", sample->r_value);
-  r = prom_string_builder_add_str(self->string_builder, buffer);
+  r = prom_metric_formatter_load_sample_value(self, sample);
   if (r) return r;
 
   return prom_string_builder_add_char(self->string_builder, '\n');
 }
 
+int prom_metric_formatter_load_histogram(prom_metric_formatter_t *self, prom_metric_sample_histogram_t *hist_sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t bucket_count = prom_histogram_buckets_count(hist_sample->buckets);
+  uint64_t *cumulative = (uint64_t *)prom_metric_formatter_scratch(self, (bucket_count + 1) * sizeof(uint64_t));
+  if (cumulative == NULL) return 1;
+  double sum = 0.0;
+  prom_metric_sample_histogram_collect(hist_sample, cumulative, &sum);
+
+  // l_value_list holds one l_value per bucket in bucket order, then +Inf, count and sum
+  size_t i = 0;
+  for (prom_linked_list_node_t *current_node = hist_sample->l_value_list->head; current_node != NULL;
+       current_node = current_node->next, i++) {
+    prom_metric_sample_t *sample =
+        (prom_metric_sample_t *)prom_map_get(hist_sample->samples, (const char *)current_node->item);
+    if (sample == NULL) return 1;
+    r = prom_string_builder_add_bytes(self->string_builder, sample->l_value, sample->l_value_len);
+    if (r) return r;
+    r = prom_string_builder_add_char(self->string_builder, ' ');
+    if (r) return r;
+    r = prom_metric_formatter_load_histogram_value(self, cumulative, bucket_count, sum, i);
+    if (r) return r;
+    r = prom_string_builder_add_char(self->string_builder, '\n');
+    if (r) return r;
+  }
+  return 0;
+}
+
+int prom_metric_formatter_load_summary(prom_metric_formatter_t *self, prom_metric_sample_summary_t *summary_sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t quantile_count = summary_sample->config->quantile_count;
+  double *quantile_values = (double *)prom_metric_formatter_scratch(self, (quantile_count + 1) * sizeof(double));
+  if (quantile_values == NULL) return 1;
+  uint64_t count = 0;
+  double sum = 0.0;
+  r = prom_metric_sample_summary_collect(summary_sample, quantile_values, &count, &sum);
+  if (r) return r;
+
+  // l_value_list holds one l_value per quantile in ascending order, then count and sum
+  size_t i = 0;
+  for (prom_linked_list_node_t *current_node = summary_sample->l_value_list->head; current_node != NULL;
+       current_node = current_node->next, i++) {
+    r = prom_string_builder_add_str(self->string_builder, (const char *)current_node->item);
+    if (r) return r;
+    r = prom_string_builder_add_char(self->string_builder, ' ');
+    if (r) return r;
+    if (i < quantile_count) {
+      r = prom_metric_formatter_load_value(self, quantile_values[i]);
+    } else if (i == quantile_count) {
+      r = prom_string_builder_add_int64(self->string_builder, (int64_t)count);
+    } else {
+      r = prom_metric_formatter_load_value(self, sum);
+    }
+    if (r) return r;
+    r = prom_string_builder_add_char(self->string_builder, '\n');
+    if (r) return r;
+  }
+  return 0;
+}
+
+int prom_metric_formatter_load_header(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  return prom_string_builder_add_bytes(self->string_builder, metric->header, metric->header_len);
+}
+
+void *prom_metric_formatter_scratch(prom_metric_formatter_t *self, size_t size) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (size <= self->scratch_size) return self->scratch;
+  void *scratch = prom_realloc(self->scratch, size);
+  if (scratch == NULL) return NULL;
+  self->scratch = scratch;
+  self->scratch_size = size;
+  return scratch;
+}
+
 int prom_metric_formatter_clear(prom_metric_formatter_t *self) {
   PROM_ASSERT(self != NULL);
   return prom_string_builder_clear(self->string_builder);
@@ -203,36 +374,33 @@ int prom_metric_formatter_load_metric(prom_metric_formatter_t *self, prom_metric
 
   int r = 0;
 
-  r = prom_metric_formatter_load_help(self, metric->name, metric->help);
+  r = prom_metric_formatter_load_header(self, metric);
   if (r) return r;
 
-  r = prom_metric_formatter_load_type(self, metric->name, metric->type);
-  if (r) return r;
-
-  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL;
+  // Samples are added under the write lock, so the list of keys must not be walked without the read lock
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL && r == 0;
        current_node = current_node->next) {
     const char *key = (const char *)current_node->item;
     if (metric->type == PROM_HISTOGRAM) {
       prom_metric_sample_histogram_t *hist_sample =
           (prom_metric_sample_histogram_t *)prom_map_get(metric->samples, key);
-
-      if (hist_sample == NULL) return 1;
-
-      for (prom_linked_list_node_t *current_hist_node = hist_sample->l_value_list->head; current_hist_node != NULL;
-           current_hist_node = current_hist_node->next) {
-        const char *hist_key = (const char *)current_hist_node->item;
-        prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(hist_sample->samples, hist_key);
-        if (sample == NULL) return 1;
-        r = prom_metric_formatter_load_sample(self, sample);
-        if (r) return r;
-      }
+      r = hist_sample == NULL ? 1 : prom_metric_formatter_load_histogram(self, hist_sample);
+    } else if (metric->type == PROM_SUMMARY) {
+      prom_metric_sample_summary_t *summary_sample =
+          (prom_metric_sample_summary_t *)prom_map_get(metric->samples, key);
+      r = summary_sample == NULL ? 1 : prom_metric_formatter_load_summary(self, summary_sample);
     } else {
       prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(metric->samples, key);
-      if (sample == NULL) return 1;
-      r = prom_metric_formatter_load_sample(self, sample);
-      if (r) return r;
+      r = sample == NULL ? 1 : prom_metric_formatter_load_sample(self, sample);
     }
   }
+  pthread_rwlock_unlock(metric->rwlock);
+  if (r) return r;
   return prom_string_builder_add_char(self->string_builder, '\n');
 }
 
@@ -259,3 +427,270 @@ int prom_metric_formatter_load_metrics(prom_metric_formatter_t *self, prom_map_t
   }
   return r;
 }
+
+int prom_metric_formatter_load_snapshot(prom_metric_formatter_t *self,
+                                        const prom_collector_registry_snapshot_t *snapshot) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  for (size_t f = 0; f < snapshot->family_count; f++) {
+    const prom_collector_registry_snapshot_family_t *family = &snapshot->families[f];
+    r = prom_string_builder_add_bytes(self->string_builder, family->header, family->header_len);
+    if (r) return r;
+    for (size_t i = family->first; i < family->first + family->count; i++) {
+      const prom_collector_registry_snapshot_sample_t *sample = &snapshot->samples[i];
+      r = prom_string_builder_add_bytes(self->string_builder, sample->l_value, sample->l_value_len);
+      if (r) return r;
+      r = prom_string_builder_add_char(self->string_builder, ' ');
+      if (r) return r;
+      if (sample->integer) {
+        r = prom_string_builder_add_int64(self->string_builder, sample->i_value);
+      } else {
+        r = prom_metric_formatter_load_value(self, sample->r_value);
+      }
+      if (r) return r;
+      r = prom_string_builder_add_char(self->string_builder, '\n');
+      if (r) return r;
+    }
+    r = prom_string_builder_add_char(self->string_builder, '\n');
+    if (r) return r;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// OpenMetrics
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Returns the length of the OpenMetrics family name of metric. A counter family is named without the _total
+ * suffix its samples carry.
+ */
+static size_t prom_metric_formatter_openmetrics_family_len(prom_metric_t *metric) {
+  size_t name_len = strlen(metric->name);
+  if (metric->type == PROM_COUNTER && name_len > strlen("_total") &&
+      strcmp(metric->name + name_len - strlen("_total"), "_total") == 0) {
+    return name_len - strlen("_total");
+  }
+  return name_len;
+}
+
+int prom_metric_formatter_load_openmetrics_descriptor(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t family_len = prom_metric_formatter_openmetrics_family_len(metric);
+
+  r = prom_string_builder_add_str(self->string_builder, "# HELP ");
+  if (r) return r;
+  r = prom_string_builder_add_bytes(self->string_builder, metric->name, family_len);
+  if (r) return r;
+  r = prom_string_builder_add_char(self->string_builder, ' ');
+  if (r) return r;
+  // OpenMetrics escapes help text like label values
+  r = prom_metric_formatter_load_label_value(self, metric->help);
+  if (r) return r;
+
+  r = prom_string_builder_add_str(self->string_builder, "\n# TYPE ");
+  if (r) return r;
+  r = prom_string_builder_add_bytes(self->string_builder, metric->name, family_len);
+  if (r) return r;
+  r = prom_string_builder_add_char(self->string_builder, ' ');
+  if (r) return r;
+  r = prom_string_builder_add_str(self->string_builder, prom_metric_type_map[metric->type]);
+  if (r) return r;
+  return prom_string_builder_add_char(self->string_builder, '\n');
+}
+
+// Writes the name and labels of a line, up to and including the space before its value
+static int prom_metric_formatter_load_openmetrics_name(prom_metric_formatter_t *self, const char *family,
+                                                       size_t family_len, const char *suffix, const char *labels) {
+  int r = 0;
+
+  r = prom_string_builder_add_bytes(self->string_builder, family, family_len);
+  if (r) return r;
+  r = prom_string_builder_add_str(self->string_builder, suffix);
+  if (r) return r;
+  r = prom_string_builder_add_str(self->string_builder, labels);
+  if (r) return r;
+  return prom_string_builder_add_char(self->string_builder, ' ');
+}
+
+static int prom_metric_formatter_load_openmetrics_line(prom_metric_formatter_t *self, const char *family,
+                                                       size_t family_len, const char *suffix, const char *labels,
+                                                       double value, bool timestamp) {
+  int r = 0;
+
+  r = prom_metric_formatter_load_openmetrics_name(self, family, family_len, suffix, labels);
+  if (r) return r;
+  if (timestamp) {
+    char buffer[50];
+    int n = snprintf(buffer, sizeof(buffer), "%.3f", value);
+    if (n < 0 || (size_t)n >= sizeof(buffer)) return 1;
+    r = prom_string_builder_add_bytes(self->string_builder, buffer, n);
+  } else {
+    r = prom_metric_formatter_load_value(self, value);
+  }
+  if (r) return r;
+  return prom_string_builder_add_char(self->string_builder, '\n');
+}
+
+static int prom_metric_formatter_load_openmetrics_histogram(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                            prom_metric_sample_histogram_t *hist_sample) {
+  int r = 0;
+  size_t bucket_count = prom_histogram_buckets_count(hist_sample->buckets);
+  prom_metric_sample_t *count_sample = NULL;
+  uint64_t *cumulative = (uint64_t *)prom_metric_formatter_scratch(self, (bucket_count + 1) * sizeof(uint64_t));
+  if (cumulative == NULL) return 1;
+  double sum = 0.0;
+  prom_metric_sample_histogram_collect(hist_sample, cumulative, &sum);
+
+  // l_value_list holds one l_value per bucket in bucket order, then +Inf, count and sum
+  size_t i = 0;
+  for (prom_linked_list_node_t *current_node = hist_sample->l_value_list->head; current_node != NULL;
+       current_node = current_node->next, i++) {
+    prom_metric_sample_t *sample =
+        (prom_metric_sample_t *)prom_map_get(hist_sample->samples, (const char *)current_node->item);
+    if (sample == NULL) return 1;
+    if (i == bucket_count + 1) count_sample = sample;
+
+    // The text format names buckets after the metric itself; OpenMetrics requires the _bucket suffix
+    if (i <= bucket_count) {
+      size_t name_len = strlen(metric->name);
+      r = prom_string_builder_add_bytes(self->string_builder, sample->l_value, name_len);
+      if (r) return r;
+      r = prom_string_builder_add_str(self->string_builder, "_bucket");
+      if (r) return r;
+      r = prom_string_builder_add_str(self->string_builder, sample->l_value + name_len);
+    } else {
+      r = prom_string_builder_add_str(self->string_builder, sample->l_value);
+    }
+    if (r) return r;
+    r = prom_string_builder_add_char(self->string_builder, ' ');
+    if (r) return r;
+    r = prom_metric_formatter_load_histogram_value(self, cumulative, bucket_count, sum, i);
+    if (r) return r;
+
+    prom_exemplar_t exemplar;
+    if (i <= bucket_count && prom_metric_sample_histogram_read_exemplar(hist_sample, i, &exemplar)) {
+      r = prom_string_builder_add_str(self->string_builder, " # {");
+      if (r) return r;
+      r = prom_string_builder_add_str(self->string_builder, exemplar.labels);
+      if (r) return r;
+      r = prom_string_builder_add_str(self->string_builder, "} ");
+      if (r) return r;
+      r = prom_metric_formatter_load_value(self, exemplar.value);
+      if (r) return r;
+      char buffer[50];
+      int n = snprintf(buffer, sizeof(buffer), " %.3f", exemplar.timestamp);
+      if (n < 0 || (size_t)n >= sizeof(buffer)) return 1;
+      r = prom_string_builder_add_bytes(self->string_builder, buffer, n);
+      if (r) return r;
+    }
+    r = prom_string_builder_add_char(self->string_builder, '\n');
+    if (r) return r;
+  }
+  if (count_sample == NULL) return 1;
+
+  // The count sample's l_value is name_count followed by the labels of the series
+  const char *labels = count_sample->l_value + strlen(metric->name) + strlen("_count");
+  return prom_metric_formatter_load_openmetrics_line(self, metric->name, strlen(metric->name), "_created", labels,
+                                                     count_sample->created, true);
+}
+
+static int prom_metric_formatter_load_openmetrics_summary(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                          prom_metric_sample_summary_t *summary_sample) {
+  // Apart from _created, OpenMetrics renders summaries as the text format does
+  int r = prom_metric_formatter_load_summary(self, summary_sample);
+  if (r) return r;
+
+  prom_linked_list_node_t *count_node = summary_sample->l_value_list->head;
+  for (size_t i = 0; i < summary_sample->config->quantile_count && count_node != NULL; i++) {
+    count_node = count_node->next;
+  }
+  if (count_node == NULL) return 1;
+
+  // The count l_value is name_count followed by the labels of the series
+  const char *labels = (const char *)count_node->item + strlen(metric->name) + strlen("_count");
+  return prom_metric_formatter_load_openmetrics_line(self, metric->name, strlen(metric->name), "_created", labels,
+                                                     summary_sample->created, true);
+}
+
+int prom_metric_formatter_load_metric_openmetrics(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t name_len = strlen(metric->name);
+  size_t family_len = prom_metric_formatter_openmetrics_family_len(metric);
+
+  r = prom_string_builder_add_bytes(self->string_builder, metric->openmetrics_header, metric->openmetrics_header_len);
+  if (r) return r;
+
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL;
+       current_node = current_node->next) {
+    void *sample = prom_map_get(metric->samples, (const char *)current_node->item);
+    if (sample == NULL) {
+      r = 1;
+      break;
+    }
+    if (metric->type == PROM_HISTOGRAM) {
+      r = prom_metric_formatter_load_openmetrics_histogram(self, metric, (prom_metric_sample_histogram_t *)sample);
+    } else if (metric->type == PROM_SUMMARY) {
+      r = prom_metric_formatter_load_openmetrics_summary(self, metric, (prom_metric_sample_summary_t *)sample);
+    } else if (metric->type == PROM_COUNTER) {
+      prom_metric_sample_t *counter_sample = (prom_metric_sample_t *)sample;
+      const char *labels = counter_sample->l_value + name_len;
+      r = prom_metric_formatter_load_openmetrics_name(self, metric->name, family_len, "_total", labels);
+      if (r) break;
+      r = prom_metric_formatter_load_sample_value(self, counter_sample);
+      if (r) break;
+      r = prom_string_builder_add_char(self->string_builder, '\n');
+      if (r) break;
+      r = prom_metric_formatter_load_openmetrics_line(self, metric->name, family_len, "_created", labels,
+                                                      counter_sample->created, true);
+    } else {
+      r = prom_metric_formatter_load_sample(self, (prom_metric_sample_t *)sample);
+    }
+    if (r) break;
+  }
+  pthread_rwlock_unlock(metric->rwlock);
+  return r;
+}
+
+int prom_metric_formatter_load_metrics_openmetrics(prom_metric_formatter_t *self, prom_map_t *collectors) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+  for (prom_linked_list_node_t *current_node = collectors->keys->head; current_node != NULL;
+       current_node = current_node->next) {
+    const char *collector_name = (const char *)current_node->item;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(collectors, collector_name);
+    if (collector == NULL) return 1;
+
+    prom_map_t *metrics = collector->collect_fn(collector);
+    if (metrics == NULL) return 1;
+
+    for (prom_linked_list_node_t *current_node = metrics->keys->head; current_node != NULL;
+         current_node = current_node->next) {
+      const char *metric_name = (const char *)current_node->item;
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(metrics, metric_name);
+      if (metric == NULL) return 1;
+      r = prom_metric_formatter_load_metric_openmetrics(self, metric);
+      if (r) return r;
+    }
+  }
+  return prom_metric_formatter_load_openmetrics_eof(self);
+}
+
+int prom_metric_formatter_load_openmetrics_eof(prom_metric_formatter_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  return prom_string_builder_add_str(self->string_builder, "# EOF\n");
+}
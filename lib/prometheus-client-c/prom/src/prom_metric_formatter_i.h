@@ -20,7 +20,10 @@
 #define PROM_METRIC_FORMATTER_I_H
 
 // Private
+#include "prom_collector_registry_snapshot_t.h"
 #include "prom_metric_formatter_t.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_summary_t.h"
 #include "prom_metric_t.h"
 
 /**
@@ -56,11 +59,26 @@ int prom_metric_formatter_load_type(prom_metric_formatter_t *self, const char *n
 int prom_metric_formatter_load_l_value(prom_metric_formatter_t *metric_formatter, const char *name, const char *suffix,
                                        size_t label_count, const char **label_keys, const char **label_values);
 
+/**
+ * @brief API PRIVATE Loads the HELP and TYPE lines pre-rendered when the metric was created
+ */
+int prom_metric_formatter_load_header(prom_metric_formatter_t *self, prom_metric_t *metric);
+
 /**
  * @brief API PRIVATE Loads the formatter with a metric sample
  */
 int prom_metric_formatter_load_sample(prom_metric_formatter_t *metric_formatter, prom_metric_sample_t *sample);
 
+/**
+ * @brief API PRIVATE Loads the bucket, count and sum lines of a histogram sample in the text format
+ */
+int prom_metric_formatter_load_histogram(prom_metric_formatter_t *self, prom_metric_sample_histogram_t *hist_sample);
+
+/**
+ * @brief API PRIVATE Loads the quantile, count and sum lines of a summary sample in the text format
+ */
+int prom_metric_formatter_load_summary(prom_metric_formatter_t *self, prom_metric_sample_summary_t *summary_sample);
+
 /**
  * @brief API PRIVATE Loads a metric in the string exposition format
  */
@@ -71,11 +89,55 @@ int prom_metric_formatter_load_metric(prom_metric_formatter_t *self, prom_metric
  */
 int prom_metric_formatter_load_metrics(prom_metric_formatter_t *self, prom_map_t *collectors);
 
+/**
+ * @brief API PRIVATE Loads the families of a snapshot in the string exposition format
+ */
+int prom_metric_formatter_load_snapshot(prom_metric_formatter_t *self,
+                                        const prom_collector_registry_snapshot_t *snapshot);
+
+/**
+ * @brief API PRIVATE Loads a metric as a delimited io.prometheus.client.MetricFamily protobuf message
+ */
+int prom_metric_formatter_load_metric_protobuf(prom_metric_formatter_t *self, prom_metric_t *metric);
+
+/**
+ * @brief API PRIVATE Loads the given metrics as delimited io.prometheus.client.MetricFamily protobuf messages
+ */
+int prom_metric_formatter_load_metrics_protobuf(prom_metric_formatter_t *self, prom_map_t *collectors);
+
+/**
+ * @brief API PRIVATE Loads the OpenMetrics HELP and TYPE lines of a metric
+ */
+int prom_metric_formatter_load_openmetrics_descriptor(prom_metric_formatter_t *self, prom_metric_t *metric);
+
+/**
+ * @brief API PRIVATE Loads a metric in the OpenMetrics text format, with _created samples and bucket exemplars
+ */
+int prom_metric_formatter_load_metric_openmetrics(prom_metric_formatter_t *self, prom_metric_t *metric);
+
+/**
+ * @brief API PRIVATE Loads the given metrics in the OpenMetrics text format, terminated by # EOF
+ */
+int prom_metric_formatter_load_metrics_openmetrics(prom_metric_formatter_t *self, prom_map_t *collectors);
+
+/**
+ * @brief API PRIVATE Loads the # EOF line that ends an OpenMetrics exposition
+ */
+int prom_metric_formatter_load_openmetrics_eof(prom_metric_formatter_t *self);
+
 /**
  * @brief API PRIVATE Clear the underlying string_builder
  */
 int prom_metric_formatter_clear(prom_metric_formatter_t *self);
 
+/**
+ * @brief API PRIVATE Returns a buffer of at least size bytes owned by self, grown as needed and kept for the next
+ * sample. The buffer is only valid until the next call.
+ *
+ * @return The buffer, or NULL upon failure
+ */
+void *prom_metric_formatter_scratch(prom_metric_formatter_t *self, size_t size);
+
 /**
  * @brief API PRIVATE Returns the string built by prom_metric_formatter
  */
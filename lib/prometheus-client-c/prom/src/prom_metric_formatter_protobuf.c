@@ -0,0 +1,555 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Reference: https://github.com/prometheus/client_model/blob/master/io/prometheus/client/metrics.proto
+//
+// The encoder writes io.prometheus.client.MetricFamily messages straight into the formatter's string builder, each
+// preceded by its length as a varint. Nested messages whose length is not known up front get a one byte placeholder
+// that is widened once the message is complete, which only moves bytes for messages of 128 bytes or more.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_collector_t.h"
+#include "prom_errors.h"
+#include "prom_linked_list_t.h"
+#include "prom_log.h"
+#include "prom_map_i.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_sample_summary_t.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_t.h"
+#include "prom_native_histogram_t.h"
+#include "prom_string_builder_i.h"
+
+// Protobuf wire types
+#define PROM_PROTOBUF_VARINT 0
+#define PROM_PROTOBUF_I64 1
+#define PROM_PROTOBUF_LEN 2
+
+// io.prometheus.client.MetricType
+#define PROM_PROTOBUF_COUNTER 0
+#define PROM_PROTOBUF_GAUGE 1
+#define PROM_PROTOBUF_SUMMARY 2
+#define PROM_PROTOBUF_UNTYPED 3
+#define PROM_PROTOBUF_HISTOGRAM 4
+
+// Field numbers of io.prometheus.client.MetricFamily
+#define PROM_PROTOBUF_FAMILY_NAME 1
+#define PROM_PROTOBUF_FAMILY_HELP 2
+#define PROM_PROTOBUF_FAMILY_TYPE 3
+#define PROM_PROTOBUF_FAMILY_METRIC 4
+
+// Field numbers of io.prometheus.client.Metric
+#define PROM_PROTOBUF_METRIC_LABEL 1
+#define PROM_PROTOBUF_METRIC_GAUGE 2
+#define PROM_PROTOBUF_METRIC_COUNTER 3
+#define PROM_PROTOBUF_METRIC_SUMMARY 4
+#define PROM_PROTOBUF_METRIC_UNTYPED 5
+#define PROM_PROTOBUF_METRIC_HISTOGRAM 7
+
+// Field numbers of io.prometheus.client.Histogram and io.prometheus.client.Bucket
+#define PROM_PROTOBUF_HISTOGRAM_SAMPLE_COUNT 1
+#define PROM_PROTOBUF_HISTOGRAM_SAMPLE_SUM 2
+#define PROM_PROTOBUF_HISTOGRAM_BUCKET 3
+#define PROM_PROTOBUF_BUCKET_CUMULATIVE_COUNT 1
+#define PROM_PROTOBUF_BUCKET_UPPER_BOUND 2
+
+// Field numbers of io.prometheus.client.Summary and io.prometheus.client.Quantile
+#define PROM_PROTOBUF_SUMMARY_SAMPLE_COUNT 1
+#define PROM_PROTOBUF_SUMMARY_SAMPLE_SUM 2
+#define PROM_PROTOBUF_SUMMARY_QUANTILE 3
+#define PROM_PROTOBUF_QUANTILE_QUANTILE 1
+#define PROM_PROTOBUF_QUANTILE_VALUE 2
+
+// Field numbers of the native histogram part of io.prometheus.client.Histogram and of io.prometheus.client.BucketSpan
+#define PROM_PROTOBUF_HISTOGRAM_SCHEMA 5
+#define PROM_PROTOBUF_HISTOGRAM_ZERO_THRESHOLD 6
+#define PROM_PROTOBUF_HISTOGRAM_ZERO_COUNT 7
+#define PROM_PROTOBUF_HISTOGRAM_NEGATIVE_SPAN 9
+#define PROM_PROTOBUF_HISTOGRAM_NEGATIVE_DELTA 10
+#define PROM_PROTOBUF_HISTOGRAM_POSITIVE_SPAN 12
+#define PROM_PROTOBUF_HISTOGRAM_POSITIVE_DELTA 13
+#define PROM_PROTOBUF_SPAN_OFFSET 1
+#define PROM_PROTOBUF_SPAN_LENGTH 2
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Wire format
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t prom_protobuf_varint_len(uint64_t value) {
+  size_t len = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    len++;
+  }
+  return len;
+}
+
+static size_t prom_protobuf_encode_varint(unsigned char *out, uint64_t value) {
+  size_t len = 0;
+  while (value >= 0x80) {
+    out[len++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  out[len++] = (unsigned char)value;
+  return len;
+}
+
+static int prom_protobuf_add_varint(prom_string_builder_t *sb, uint64_t value) {
+  unsigned char buf[10];
+  return prom_string_builder_add_bytes(sb, buf, prom_protobuf_encode_varint(buf, value));
+}
+
+static int prom_protobuf_add_tag(prom_string_builder_t *sb, int field, int wire_type) {
+  return prom_protobuf_add_varint(sb, ((uint64_t)field << 3) | wire_type);
+}
+
+// Maps sint32 and sint64 values to unsigned ones so that small negative numbers stay short varints
+static uint64_t prom_protobuf_zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int prom_protobuf_add_double(prom_string_builder_t *sb, int field, double value) {
+  int r = prom_protobuf_add_tag(sb, field, PROM_PROTOBUF_I64);
+  if (r) return r;
+
+  // Doubles are little endian IEEE 754 on the wire
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  unsigned char buf[8];
+  for (int i = 0; i < 8; i++) buf[i] = (unsigned char)(bits >> (8 * i));
+  return prom_string_builder_add_bytes(sb, buf, sizeof(buf));
+}
+
+static int prom_protobuf_add_string(prom_string_builder_t *sb, int field, const char *str, size_t len) {
+  int r = prom_protobuf_add_tag(sb, field, PROM_PROTOBUF_LEN);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, len);
+  if (r) return r;
+  return prom_string_builder_add_bytes(sb, str, len);
+}
+
+/**
+ * @brief Opens a nested message of unknown length. Returns the offset of its length placeholder in *start.
+ */
+static int prom_protobuf_open(prom_string_builder_t *sb, int field, size_t *start) {
+  int r = 0;
+  if (field > 0) {
+    r = prom_protobuf_add_tag(sb, field, PROM_PROTOBUF_LEN);
+    if (r) return r;
+  }
+  *start = prom_string_builder_len(sb);
+  return prom_string_builder_add_char(sb, '\0');
+}
+
+/**
+ * @brief Writes the length of the message opened at start, widening its placeholder if needed
+ */
+static int prom_protobuf_close(prom_string_builder_t *sb, size_t start) {
+  size_t len = prom_string_builder_len(sb) - start - 1;
+  unsigned char buf[10];
+  size_t n = prom_protobuf_encode_varint(buf, len);
+  if (n == 1) {
+    prom_string_builder_str(sb)[start] = (char)buf[0];
+    return 0;
+  }
+  return prom_string_builder_replace(sb, start, 1, buf, n);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Labels
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Adds the unescaped form of a quoted label value from an l_value
+ */
+static int prom_protobuf_add_label_value(prom_string_builder_t *sb, const char *value, size_t raw_len,
+                                         size_t escapes) {
+  int r = 0;
+  r = prom_protobuf_add_tag(sb, 2, PROM_PROTOBUF_LEN);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, raw_len - escapes);
+  if (r) return r;
+  if (escapes == 0) return prom_string_builder_add_bytes(sb, value, raw_len);
+
+  for (size_t i = 0; i < raw_len; i++) {
+    char c = value[i];
+    if (c == '\\' && i + 1 < raw_len) {
+      c = value[++i];
+      if (c == 'n') c = '\n';
+    }
+    r = prom_string_builder_add_char(sb, c);
+    if (r) return r;
+  }
+  return 0;
+}
+
+/**
+ * @brief Adds a LabelPair for each label in l_value, skipping the label named skip if it is not NULL.
+ *
+ * Samples only keep their rendered l_value, e.g. name{a="1",b="2"}, so the labels are recovered from it.
+ */
+static int prom_protobuf_add_labels(prom_string_builder_t *sb, const char *l_value, const char *skip) {
+  int r = 0;
+  const char *p = strchr(l_value, '{');
+  if (p == NULL) return 0;
+  p++;
+
+  while (*p != '\0' && *p != '}') {
+    const char *key = p;
+    while (*p != '\0' && *p != '=') p++;
+    if (*p != '=' || p[1] != '"') return 1;
+    size_t key_len = p - key;
+    p += 2;
+
+    const char *value = p;
+    size_t escapes = 0;
+    while (*p != '\0' && *p != '"') {
+      if (*p == '\\' && p[1] != '\0') {
+        p++;
+        escapes++;
+      }
+      p++;
+    }
+    if (*p != '"') return 1;
+    size_t raw_len = p - value;
+    p++;
+    if (*p == ',') p++;
+
+    if (skip != NULL && strlen(skip) == key_len && strncmp(key, skip, key_len) == 0) continue;
+
+    r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_METRIC_LABEL, PROM_PROTOBUF_LEN);
+    if (r) return r;
+    size_t pair_len = 1 + prom_protobuf_varint_len(key_len) + key_len + 1 +
+                      prom_protobuf_varint_len(raw_len - escapes) + raw_len - escapes;
+    r = prom_protobuf_add_varint(sb, pair_len);
+    if (r) return r;
+    r = prom_protobuf_add_string(sb, 1, key, key_len);
+    if (r) return r;
+    r = prom_protobuf_add_label_value(sb, value, raw_len, escapes);
+    if (r) return r;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Metrics
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int prom_protobuf_add_sample(prom_string_builder_t *sb, prom_metric_type_t type, prom_metric_sample_t *sample) {
+  int r = 0;
+  size_t start = 0;
+
+  r = prom_protobuf_open(sb, PROM_PROTOBUF_FAMILY_METRIC, &start);
+  if (r) return r;
+  r = prom_protobuf_add_labels(sb, sample->l_value, NULL);
+  if (r) return r;
+
+  int field = PROM_PROTOBUF_METRIC_UNTYPED;
+  if (type == PROM_COUNTER) field = PROM_PROTOBUF_METRIC_COUNTER;
+  if (type == PROM_GAUGE) field = PROM_PROTOBUF_METRIC_GAUGE;
+  // Counter, Gauge and Untyped all hold a single double in field 1, which encodes to 9 bytes
+  r = prom_protobuf_add_tag(sb, field, PROM_PROTOBUF_LEN);
+  if (r) return r;
+  r = prom_string_builder_add_char(sb, 9);
+  if (r) return r;
+  r = prom_protobuf_add_double(sb, 1, prom_metric_sample_value(sample));
+  if (r) return r;
+
+  return prom_protobuf_close(sb, start);
+}
+
+/**
+ * @brief Adds the spans and the delta-encoded counts of the populated native buckets of one sign.
+ *
+ * A span is a run of consecutive bucket indexes; its offset is the gap to the end of the previous span, or the index
+ * of its first bucket for the first span. Each count is sent as the difference to the count of the previous bucket.
+ */
+static int prom_protobuf_add_native_buckets(prom_string_builder_t *sb, const prom_native_histogram_buckets_t *buckets,
+                                            int span_field, int delta_field) {
+  int r = 0;
+  for (size_t i = 0; i < buckets->len;) {
+    size_t end = i + 1;
+    while (end < buckets->len && buckets->items[end].index == buckets->items[end - 1].index + 1) end++;
+    int32_t offset = (i == 0) ? buckets->items[i].index : buckets->items[i].index - buckets->items[i - 1].index - 1;
+    uint64_t zigzag_offset = prom_protobuf_zigzag(offset);
+
+    r = prom_protobuf_add_tag(sb, span_field, PROM_PROTOBUF_LEN);
+    if (r) return r;
+    r = prom_protobuf_add_varint(sb, 2 + prom_protobuf_varint_len(zigzag_offset) + prom_protobuf_varint_len(end - i));
+    if (r) return r;
+    r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_SPAN_OFFSET, PROM_PROTOBUF_VARINT);
+    if (r) return r;
+    r = prom_protobuf_add_varint(sb, zigzag_offset);
+    if (r) return r;
+    r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_SPAN_LENGTH, PROM_PROTOBUF_VARINT);
+    if (r) return r;
+    r = prom_protobuf_add_varint(sb, end - i);
+    if (r) return r;
+    i = end;
+  }
+
+  int64_t previous = 0;
+  for (size_t i = 0; i < buckets->len; i++) {
+    int64_t count = (int64_t)buckets->items[i].count;
+    r = prom_protobuf_add_tag(sb, delta_field, PROM_PROTOBUF_VARINT);
+    if (r) return r;
+    r = prom_protobuf_add_varint(sb, prom_protobuf_zigzag(count - previous));
+    if (r) return r;
+    previous = count;
+  }
+  return 0;
+}
+
+/**
+ * @brief Adds the schema, the zero bucket and the populated buckets of a native histogram. The caller holds its lock.
+ */
+static int prom_protobuf_add_native(prom_string_builder_t *sb, const prom_native_histogram_t *native) {
+  int r = 0;
+  r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_HISTOGRAM_SCHEMA, PROM_PROTOBUF_VARINT);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, prom_protobuf_zigzag(native->schema));
+  if (r) return r;
+  r = prom_protobuf_add_double(sb, PROM_PROTOBUF_HISTOGRAM_ZERO_THRESHOLD, PROM_NATIVE_HISTOGRAM_ZERO_THRESHOLD);
+  if (r) return r;
+  r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_HISTOGRAM_ZERO_COUNT, PROM_PROTOBUF_VARINT);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, native->zero_count);
+  if (r) return r;
+  r = prom_protobuf_add_native_buckets(sb, &native->negative, PROM_PROTOBUF_HISTOGRAM_NEGATIVE_SPAN,
+                                       PROM_PROTOBUF_HISTOGRAM_NEGATIVE_DELTA);
+  if (r) return r;
+  return prom_protobuf_add_native_buckets(sb, &native->positive, PROM_PROTOBUF_HISTOGRAM_POSITIVE_SPAN,
+                                          PROM_PROTOBUF_HISTOGRAM_POSITIVE_DELTA);
+}
+
+static int prom_protobuf_add_histogram_body(prom_string_builder_t *sb, prom_metric_sample_histogram_t *hist_sample,
+                                            const uint64_t *cumulative, double sum) {
+  int r = 0;
+  size_t bucket_count = prom_histogram_buckets_count(hist_sample->buckets);
+
+  // l_value_list holds one l_value per bucket in bucket order, then +Inf, count and sum; only the labels are needed
+  prom_linked_list_node_t *count_node = hist_sample->l_value_list->head;
+  for (size_t i = 0; i < bucket_count + 1 && count_node != NULL; i++) count_node = count_node->next;
+  if (count_node == NULL) return 1;
+  prom_metric_sample_t *count_sample =
+      (prom_metric_sample_t *)prom_map_get(hist_sample->samples, (const char *)count_node->item);
+  if (count_sample == NULL) return 1;
+
+  size_t start = 0;
+  r = prom_protobuf_open(sb, PROM_PROTOBUF_FAMILY_METRIC, &start);
+  if (r) return r;
+  r = prom_protobuf_add_labels(sb, count_sample->l_value, NULL);
+  if (r) return r;
+
+  size_t histogram_start = 0;
+  r = prom_protobuf_open(sb, PROM_PROTOBUF_METRIC_HISTOGRAM, &histogram_start);
+  if (r) return r;
+  r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_HISTOGRAM_SAMPLE_COUNT, PROM_PROTOBUF_VARINT);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, cumulative[bucket_count]);
+  if (r) return r;
+  r = prom_protobuf_add_double(sb, PROM_PROTOBUF_HISTOGRAM_SAMPLE_SUM, sum);
+  if (r) return r;
+
+  // The +Inf bucket is implied by sample_count
+  for (size_t i = 0; i < bucket_count; i++) {
+    uint64_t cumulative_count = cumulative[i];
+    r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_HISTOGRAM_BUCKET, PROM_PROTOBUF_LEN);
+    if (r) return r;
+    r = prom_protobuf_add_varint(sb, 1 + prom_protobuf_varint_len(cumulative_count) + 9);
+    if (r) return r;
+    r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_BUCKET_CUMULATIVE_COUNT, PROM_PROTOBUF_VARINT);
+    if (r) return r;
+    r = prom_protobuf_add_varint(sb, cumulative_count);
+    if (r) return r;
+    r = prom_protobuf_add_double(sb, PROM_PROTOBUF_BUCKET_UPPER_BOUND, hist_sample->buckets->upper_bounds[i]);
+    if (r) return r;
+  }
+
+  if (hist_sample->native != NULL) {
+    r = prom_protobuf_add_native(sb, hist_sample->native);
+    if (r) return r;
+  }
+
+  r = prom_protobuf_close(sb, histogram_start);
+  if (r) return r;
+  return prom_protobuf_close(sb, start);
+}
+
+static int prom_protobuf_add_histogram(prom_metric_formatter_t *self, prom_metric_sample_histogram_t *hist_sample) {
+  prom_string_builder_t *sb = self->string_builder;
+  prom_native_histogram_t *native = hist_sample->native;
+  if (native == NULL) {
+    size_t bucket_count = prom_histogram_buckets_count(hist_sample->buckets);
+    uint64_t *cumulative = (uint64_t *)prom_metric_formatter_scratch(self, (bucket_count + 1) * sizeof(uint64_t));
+    if (cumulative == NULL) return 1;
+    double sum = 0.0;
+    prom_metric_sample_histogram_collect(hist_sample, cumulative, &sum);
+    return prom_protobuf_add_histogram_body(sb, hist_sample, cumulative, sum);
+  }
+
+  // The count, the sum and the buckets of a native histogram are read under one lock so that they agree
+  int r = pthread_mutex_lock(native->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  // Native samples have no fixed buckets, so the count is the only cumulative count
+  uint64_t count = native->count;
+  r = prom_protobuf_add_histogram_body(sb, hist_sample, &count, native->sum);
+  pthread_mutex_unlock(native->lock);
+  return r;
+}
+
+static int prom_protobuf_add_summary(prom_metric_formatter_t *self, prom_metric_sample_summary_t *summary_sample) {
+  int r = 0;
+  prom_string_builder_t *sb = self->string_builder;
+  size_t quantile_count = summary_sample->config->quantile_count;
+  double *quantile_values = (double *)prom_metric_formatter_scratch(self, (quantile_count + 1) * sizeof(double));
+  if (quantile_values == NULL) return 1;
+  uint64_t count = 0;
+  double sum = 0.0;
+  r = prom_metric_sample_summary_collect(summary_sample, quantile_values, &count, &sum);
+  if (r) return r;
+
+  // l_value_list holds one l_value per quantile, then count and sum; the count l_value has no quantile label
+  prom_linked_list_node_t *count_node = summary_sample->l_value_list->head;
+  for (size_t i = 0; i < quantile_count && count_node != NULL; i++) count_node = count_node->next;
+  if (count_node == NULL) return 1;
+
+  size_t start = 0;
+  r = prom_protobuf_open(sb, PROM_PROTOBUF_FAMILY_METRIC, &start);
+  if (r) return r;
+  r = prom_protobuf_add_labels(sb, (const char *)count_node->item, NULL);
+  if (r) return r;
+
+  size_t summary_start = 0;
+  r = prom_protobuf_open(sb, PROM_PROTOBUF_METRIC_SUMMARY, &summary_start);
+  if (r) return r;
+  r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_SUMMARY_SAMPLE_COUNT, PROM_PROTOBUF_VARINT);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, count);
+  if (r) return r;
+  r = prom_protobuf_add_double(sb, PROM_PROTOBUF_SUMMARY_SAMPLE_SUM, sum);
+  if (r) return r;
+
+  // A Quantile is two doubles, which encode to 18 bytes
+  for (size_t i = 0; i < quantile_count; i++) {
+    r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_SUMMARY_QUANTILE, PROM_PROTOBUF_LEN);
+    if (r) return r;
+    r = prom_string_builder_add_char(sb, 18);
+    if (r) return r;
+    r = prom_protobuf_add_double(sb, PROM_PROTOBUF_QUANTILE_QUANTILE, summary_sample->config->quantiles[i]);
+    if (r) return r;
+    r = prom_protobuf_add_double(sb, PROM_PROTOBUF_QUANTILE_VALUE, quantile_values[i]);
+    if (r) return r;
+  }
+
+  r = prom_protobuf_close(sb, summary_start);
+  if (r) return r;
+  return prom_protobuf_close(sb, start);
+}
+
+int prom_metric_formatter_load_metric_protobuf(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  prom_string_builder_t *sb = self->string_builder;
+
+  // A delimited MetricFamily is its length followed by the message itself
+  size_t start = 0;
+  r = prom_protobuf_open(sb, 0, &start);
+  if (r) return r;
+  r = prom_protobuf_add_string(sb, PROM_PROTOBUF_FAMILY_NAME, metric->name, strlen(metric->name));
+  if (r) return r;
+  r = prom_protobuf_add_string(sb, PROM_PROTOBUF_FAMILY_HELP, metric->help, strlen(metric->help));
+  if (r) return r;
+
+  int type = PROM_PROTOBUF_UNTYPED;
+  if (metric->type == PROM_COUNTER) type = PROM_PROTOBUF_COUNTER;
+  if (metric->type == PROM_GAUGE) type = PROM_PROTOBUF_GAUGE;
+  if (metric->type == PROM_SUMMARY) type = PROM_PROTOBUF_SUMMARY;
+  if (metric->type == PROM_HISTOGRAM) type = PROM_PROTOBUF_HISTOGRAM;
+  r = prom_protobuf_add_tag(sb, PROM_PROTOBUF_FAMILY_TYPE, PROM_PROTOBUF_VARINT);
+  if (r) return r;
+  r = prom_protobuf_add_varint(sb, type);
+  if (r) return r;
+
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL;
+       current_node = current_node->next) {
+    const char *key = (const char *)current_node->item;
+    void *sample = prom_map_get(metric->samples, key);
+    if (sample == NULL) {
+      r = 1;
+      break;
+    }
+    if (metric->type == PROM_HISTOGRAM) {
+      r = prom_protobuf_add_histogram(self, (prom_metric_sample_histogram_t *)sample);
+    } else if (metric->type == PROM_SUMMARY) {
+      r = prom_protobuf_add_summary(self, (prom_metric_sample_summary_t *)sample);
+    } else {
+      r = prom_protobuf_add_sample(sb, metric->type, (prom_metric_sample_t *)sample);
+    }
+    if (r) break;
+  }
+  pthread_rwlock_unlock(metric->rwlock);
+  if (r) return r;
+
+  return prom_protobuf_close(sb, start);
+}
+
+int prom_metric_formatter_load_metrics_protobuf(prom_metric_formatter_t *self, prom_map_t *collectors) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+  for (prom_linked_list_node_t *current_node = collectors->keys->head; current_node != NULL;
+       current_node = current_node->next) {
+    const char *collector_name = (const char *)current_node->item;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(collectors, collector_name);
+    if (collector == NULL) return 1;
+
+    prom_map_t *metrics = collector->collect_fn(collector);
+    if (metrics == NULL) return 1;
+
+    for (prom_linked_list_node_t *current_node = metrics->keys->head; current_node != NULL;
+         current_node = current_node->next) {
+      const char *metric_name = (const char *)current_node->item;
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(metrics, metric_name);
+      if (metric == NULL) return 1;
+      r = prom_metric_formatter_load_metric_protobuf(self, metric);
+      if (r) return r;
+    }
+  }
+  return r;
+}
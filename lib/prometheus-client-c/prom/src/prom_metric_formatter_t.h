@@ -19,9 +19,13 @@
 
 #include "prom_string_builder_t.h"
 
+#include <stddef.h>
+
 typedef struct prom_metric_formatter {
   prom_string_builder_t *string_builder;
   prom_string_builder_t *err_builder;
+  void *scratch;       /**< per-sample arrays such as cumulative bucket counts, see prom_metric_formatter_scratch */
+  size_t scratch_size; /**< bytes allocated for scratch */
 } prom_metric_formatter_t;
 
 #endif  // PROM_METRIC_FORMATTER_T_H
@@ -18,6 +18,8 @@
 #include "prom_metric_sample_histogram_t.h"
 #include "prom_metric_t.h"
 
+#include <stdint.h>
+
 #ifndef PROM_METRIC_I_INCLUDED
 #define PROM_METRIC_I_INCLUDED
 
@@ -42,4 +44,33 @@ int prom_metric_destroy_generic(void *item);
  */
 void prom_metric_free_generic(void *item);
 
+/**
+ * @brief API PRIVATE Returns the sample of label_values, creating it if needed, and holds it until
+ * prom_metric_sample_release, so it cannot be removed, evicted or replaced meanwhile. Unlike
+ * prom_metric_sample_from_labels, it takes no reference that outlives the release. Returns NULL, with nothing held, on
+ * failure.
+ */
+prom_metric_sample_t *prom_metric_sample_acquire(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief API PRIVATE Like prom_metric_sample_acquire, for histogram samples
+ */
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_acquire(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief API PRIVATE Like prom_metric_sample_acquire, for summary samples
+ */
+prom_metric_sample_summary_t *prom_metric_sample_summary_acquire(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief API PRIVATE Releases the sample returned by a successful prom_metric_sample_*acquire call
+ */
+void prom_metric_sample_release(prom_metric_t *self);
+
+/**
+ * @brief API PRIVATE Evicts and frees the samples of a metric with a TTL that were not updated within it
+ * @param now The time on the coarse clock of prom_metric_sample_clock
+ */
+int prom_metric_sweep(prom_metric_t *self, uint64_t now);
+
 #endif  // PROM_METRIC_I_INCLUDED
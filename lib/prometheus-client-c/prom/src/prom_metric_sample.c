@@ -14,7 +14,18 @@
  * limitations under the License.
  */
 
+// sched_getcpu
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <sched.h>
 #include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 // Public
 #include "prom_alloc.h"
@@ -30,7 +41,55 @@ prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char
   prom_metric_sample_t *self = (prom_metric_sample_t *)prom_malloc(sizeof(prom_metric_sample_t));
   self->type = type;
   self->l_value = prom_strdup(l_value);
+  self->l_value_len = strlen(l_value);
   self->r_value = ATOMIC_VAR_INIT(r_value);
+  self->integer = false;
+  atomic_init(&self->i_value, 0);
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  self->created = (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+  self->shard_count = 0;
+  self->shards = NULL;
+  self->shards_allocation = NULL;
+  self->expires = false;
+  atomic_init(&self->updated, 0);
+  atomic_init(&self->refs, 1);
+  return self;
+}
+
+prom_metric_sample_t *prom_metric_sample_int_new(prom_metric_type_t type, const char *l_value) {
+  prom_metric_sample_t *self = prom_metric_sample_new(type, l_value, 0.0);
+  if (self == NULL) return NULL;
+  self->integer = true;
+  return self;
+}
+
+// Shards beyond this many CPUs are shared by several CPUs
+#define PROM_METRIC_SAMPLE_MAX_SHARDS 256
+
+size_t prom_metric_sample_shard_count(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_CONF);
+  size_t count = 1;
+  while (count < (size_t)cpus && count < PROM_METRIC_SAMPLE_MAX_SHARDS) count <<= 1;
+  return count;
+}
+
+prom_metric_sample_t *prom_metric_sample_sharded_new(const char *l_value) {
+  prom_metric_sample_t *self = prom_metric_sample_new(PROM_COUNTER, l_value, 0.0);
+  if (self == NULL) return NULL;
+
+  size_t count = prom_metric_sample_shard_count();
+  // prom_malloc makes no alignment promise beyond max_align_t, so allocate a spare line and align by hand
+  self->shards_allocation = prom_malloc((count + 1) * sizeof(prom_metric_sample_shard_t));
+  if (self->shards_allocation == NULL) {
+    prom_metric_sample_destroy(self);
+    return NULL;
+  }
+  uintptr_t aligned = ((uintptr_t)self->shards_allocation + PROM_METRIC_SAMPLE_CACHE_LINE - 1) &
+                      ~(uintptr_t)(PROM_METRIC_SAMPLE_CACHE_LINE - 1);
+  self->shards = (prom_metric_sample_shard_t *)aligned;
+  for (size_t i = 0; i < count; i++) atomic_init(&self->shards[i].value, 0.0);
+  self->shard_count = count;
   return self;
 }
 
@@ -39,6 +98,9 @@ int prom_metric_sample_destroy(prom_metric_sample_t *self) {
   if (self == NULL) return 0;
   prom_free((void *)self->l_value);
   self->l_value = NULL;
+  prom_free(self->shards_allocation);
+  self->shards_allocation = NULL;
+  self->shards = NULL;
   prom_free((void *)self);
   self = NULL;
   return 0;
@@ -58,26 +120,111 @@ void prom_metric_sample_free_generic(void *gen) {
   prom_metric_sample_destroy(self);
 }
 
+// Threads that cannot tell which CPU they run on spread over the shards by the order they first add
+static atomic_size_t prom_metric_sample_next_thread = ATOMIC_VAR_INIT(0);
+static _Thread_local size_t prom_metric_sample_thread = 0;
+
+size_t prom_metric_sample_shard_index(size_t shard_count) {
+  int cpu = sched_getcpu();
+  if (cpu >= 0) return (size_t)cpu & (shard_count - 1);
+  if (prom_metric_sample_thread == 0) {
+    prom_metric_sample_thread = atomic_fetch_add(&prom_metric_sample_next_thread, 1) + 1;
+  }
+  return prom_metric_sample_thread & (shard_count - 1);
+}
+
+uint64_t prom_metric_sample_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void prom_metric_sample_touch(_Atomic uint64_t *updated) {
+  // The coarse clock ticks every few milliseconds, so CPUs updating one sample rarely write the stamp's cache line
+  uint64_t now = prom_metric_sample_clock();
+  if (atomic_load_explicit(updated, memory_order_relaxed) != now) {
+    atomic_store_explicit(updated, now, memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Converts r_value for an integer sample. NaN, infinities and values outside [-2^63, 2^63) are refused, as are
+ * fractions unless round is set, in which case r_value is rounded to the nearest integer, halves away from zero.
+ */
+static int prom_metric_sample_round(double r_value, bool round_value, int64_t *i_value) {
+  // Every double in the range is converted without overflow, and rounding cannot leave it since doubles this large
+  // are integers already
+  if (!(r_value >= -9223372036854775808.0 && r_value < 9223372036854775808.0)) {
+    PROM_LOG(PROM_METRIC_SAMPLE_INTEGER_RANGE);
+    return 1;
+  }
+  double rounded = round(r_value);
+  if (!round_value && rounded != r_value) {
+    PROM_LOG(PROM_METRIC_SAMPLE_FRACTION);
+    return 1;
+  }
+  *i_value = (int64_t)rounded;
+  return 0;
+}
+
+int prom_metric_sample_load(prom_metric_sample_t *self, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self->integer) {
+    int64_t i_value = 0;
+    if (prom_metric_sample_round(r_value, true, &i_value)) return 1;
+    atomic_store(&self->i_value, i_value);
+    return 0;
+  }
+  atomic_store(&self->r_value, r_value);
+  for (size_t i = 0; i < self->shard_count; i++) atomic_store(&self->shards[i].value, 0.0);
+  return 0;
+}
+
 int prom_metric_sample_add(prom_metric_sample_t *self, double r_value) {
   PROM_ASSERT(self != NULL);
   if (r_value < 0) {
     return 1;
   }
-  _Atomic double old = atomic_load(&self->r_value);
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  if (self->integer) {
+    int64_t i_value = 0;
+    if (prom_metric_sample_round(r_value, false, &i_value)) return 1;
+    atomic_fetch_add(&self->i_value, i_value);
+    return 0;
+  }
+  // The compare-and-swap still guards against a thread migrating to another CPU between picking a shard and adding
+  // to it, but it no longer fails because of other CPUs
+  _Atomic double *target = &self->r_value;
+  if (self->shards != NULL) target = &self->shards[prom_metric_sample_shard_index(self->shard_count)].value;
+  _Atomic double old = atomic_load(target);
   for (;;) {
     _Atomic double new = ATOMIC_VAR_INIT(old + r_value);
-    if (atomic_compare_exchange_weak(&self->r_value, &old, new)) {
+    if (atomic_compare_exchange_weak(target, &old, new)) {
       return 0;
     }
   }
 }
 
+double prom_metric_sample_value(prom_metric_sample_t *self) {
+  if (self->integer) return (double)atomic_load(&self->i_value);
+  double value = atomic_load(&self->r_value);
+  for (size_t i = 0; i < self->shard_count; i++) value += atomic_load(&self->shards[i].value);
+  return value;
+}
+
 int prom_metric_sample_sub(prom_metric_sample_t *self, double r_value) {
   PROM_ASSERT(self != NULL);
   if (self->type != PROM_GAUGE) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  if (self->integer) {
+    int64_t i_value = 0;
+    if (prom_metric_sample_round(r_value, false, &i_value)) return 1;
+    atomic_fetch_sub(&self->i_value, i_value);
+    return 0;
+  }
   _Atomic double old = atomic_load(&self->r_value);
   for (;;) {
     _Atomic double new = ATOMIC_VAR_INIT(old - r_value);
@@ -92,6 +239,47 @@ int prom_metric_sample_set(prom_metric_sample_t *self, double r_value) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  if (self->integer) {
+    int64_t i_value = 0;
+    if (prom_metric_sample_round(r_value, true, &i_value)) return 1;
+    atomic_store(&self->i_value, i_value);
+    return 0;
+  }
   atomic_store(&self->r_value, r_value);
   return 0;
 }
+
+int prom_metric_sample_add_int(prom_metric_sample_t *self, int64_t i_value) {
+  PROM_ASSERT(self != NULL);
+  if (i_value < 0) {
+    return 1;
+  }
+  if (!self->integer) return prom_metric_sample_add(self, (double)i_value);
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  atomic_fetch_add(&self->i_value, i_value);
+  return 0;
+}
+
+int prom_metric_sample_sub_int(prom_metric_sample_t *self, int64_t i_value) {
+  PROM_ASSERT(self != NULL);
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  if (!self->integer) return prom_metric_sample_sub(self, (double)i_value);
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  atomic_fetch_sub(&self->i_value, i_value);
+  return 0;
+}
+
+int prom_metric_sample_set_int(prom_metric_sample_t *self, int64_t i_value) {
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  if (!self->integer) return prom_metric_sample_set(self, (double)i_value);
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  atomic_store(&self->i_value, i_value);
+  return 0;
+}
@@ -14,8 +14,11 @@
  * limitations under the License.
  */
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 // Public
 #include "prom_alloc.h"
@@ -30,6 +33,7 @@
 #include "prom_metric_formatter_i.h"
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_i.h"
+#include "prom_native_histogram_i.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Static Declarations
@@ -44,8 +48,6 @@ static const char *prom_metric_sample_histogram_l_value_for_inf(prom_metric_samp
                                                                 size_t label_count, const char **label_keys,
                                                                 const char **label_values);
 
-static void prom_metric_sample_histogram_free_str_generic(void *gen);
-
 static int prom_metric_sample_histogram_init_bucket_samples(prom_metric_sample_histogram_t *self, const char *name,
                                                             size_t label_count, const char **label_keys,
                                                             const char **label_values);
@@ -75,6 +77,13 @@ prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(const char *nam
   // Allocate and set self
   prom_metric_sample_histogram_t *self =
       (prom_metric_sample_histogram_t *)prom_malloc(sizeof(prom_metric_sample_histogram_t));
+  self->exemplars = NULL;
+  self->counts = NULL;
+  self->native = NULL;
+  atomic_init(&self->sum, 0.0);
+  self->expires = false;
+  atomic_init(&self->updated, 0);
+  atomic_init(&self->refs, 1);
 
   // Allocate and set the l_value_list
   self->l_value_list = prom_linked_list_new();
@@ -104,29 +113,22 @@ prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(const char *nam
     return NULL;
   }
 
-  // Set a map of bucket: l_value
-  self->l_values = prom_map_new();  // Store map of bucket/l_value
-  if (self->l_values == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
+  self->buckets = buckets;
 
-  // Set the free value function for thhe l_values map
-  r = prom_map_set_free_value_fn(self->l_values, prom_metric_sample_histogram_free_str_generic);
-  if (r) {
+  // Allocate the counters and the exemplar slots, one per bucket plus +Inf
+  size_t slot_count = prom_histogram_buckets_count(buckets) + 1;
+  self->counts = (_Atomic uint64_t *)prom_malloc(sizeof(_Atomic uint64_t) * slot_count);
+  if (self->counts == NULL) {
     prom_metric_sample_histogram_destroy(self);
     return NULL;
   }
-
-  self->buckets = buckets;
-
-  // Allocate and initialize the lock
-  self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
-  r = pthread_rwlock_init(self->rwlock, NULL);
-  if (r) {
+  for (size_t i = 0; i < slot_count; i++) atomic_init(&self->counts[i], 0);
+  self->exemplars = (prom_exemplar_t *)prom_malloc(sizeof(prom_exemplar_t) * slot_count);
+  if (self->exemplars == NULL) {
     prom_metric_sample_histogram_destroy(self);
     return NULL;
   }
+  for (size_t i = 0; i < slot_count; i++) atomic_init(&self->exemplars[i].seq, 0);
 
   // Allocate and initialize bucket metric samples
   r = prom_metric_sample_histogram_init_bucket_samples(self, name, label_count, label_keys, label_values);
@@ -179,22 +181,18 @@ static int prom_metric_sample_histogram_init_bucket_samples(prom_metric_sample_h
                                                                           label_values, self->buckets->upper_bounds[i]);
     if (l_value == NULL) return 1;
 
-    r = prom_linked_list_append(self->l_value_list, prom_strdup(l_value));
-    if (r) return r;
-
-    const char *bucket_key = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
-    if (bucket_key == NULL) return 1;
-
-    r = prom_map_set(self->l_values, bucket_key, (char *)l_value);
-    if (r) return r;
+    // The list takes ownership of l_value
+    r = prom_linked_list_append(self->l_value_list, (char *)l_value);
+    if (r) {
+      prom_free((void *)l_value);
+      return r;
+    }
 
     prom_metric_sample_t *sample = prom_metric_sample_new(PROM_HISTOGRAM, l_value, 0.0);
     if (sample == NULL) return 1;
 
     r = prom_map_set(self->samples, l_value, sample);
     if (r) return r;
-
-    prom_free((void *)bucket_key);
   }
   return 0;
 }
@@ -208,11 +206,11 @@ static int prom_metric_sample_histogram_init_inf(prom_metric_sample_histogram_t
       prom_metric_sample_histogram_l_value_for_inf(self, name, label_count, label_keys, label_values);
   if (inf_l_value == NULL) return 1;
 
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(inf_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "+Inf", (char *)inf_l_value);
-  if (r) return r;
+  r = prom_linked_list_append(self->l_value_list, (char *)inf_l_value);
+  if (r) {
+    prom_free((void *)inf_l_value);
+    return r;
+  }
 
   prom_metric_sample_t *inf_sample = prom_metric_sample_new(PROM_HISTOGRAM, (char *)inf_l_value, 0.0);
   if (inf_sample == NULL) return 1;
@@ -232,11 +230,11 @@ static int prom_metric_sample_histogram_init_count(prom_metric_sample_histogram_
   const char *count_l_value = prom_metric_formatter_dump(self->metric_formatter);
   if (count_l_value == NULL) return 1;
 
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(count_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "count", (char *)count_l_value);
-  if (r) return r;
+  r = prom_linked_list_append(self->l_value_list, (char *)count_l_value);
+  if (r) {
+    prom_free((void *)count_l_value);
+    return r;
+  }
 
   prom_metric_sample_t *count_sample = prom_metric_sample_new(PROM_HISTOGRAM, count_l_value, 0.0);
   if (count_sample == NULL) return 1;
@@ -256,11 +254,11 @@ static int prom_metric_sample_histogram_init_summary(prom_metric_sample_histogra
   const char *sum_l_value = prom_metric_formatter_dump(self->metric_formatter);
   if (sum_l_value == NULL) return 1;
 
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(sum_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "sum", (char *)sum_l_value);
-  if (r) return r;
+  r = prom_linked_list_append(self->l_value_list, (char *)sum_l_value);
+  if (r) {
+    prom_free((void *)sum_l_value);
+    return r;
+  }
 
   prom_metric_sample_t *sum_sample = prom_metric_sample_new(PROM_HISTOGRAM, sum_l_value, 0.0);
   if (sum_sample == NULL) return 1;
@@ -283,19 +281,19 @@ int prom_metric_sample_histogram_destroy(prom_metric_sample_histogram_t *self) {
   if (r) ret = r;
   self->samples = NULL;
 
-  r = prom_map_destroy(self->l_values);
-  if (r) ret = r;
-  self->l_values = NULL;
-
   r = prom_metric_formatter_destroy(self->metric_formatter);
   if (r) ret = r;
   self->metric_formatter = NULL;
 
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) ret = r;
+  prom_free((void *)self->counts);
+  self->counts = NULL;
 
-  prom_free(self->rwlock);
-  self->rwlock = NULL;
+  prom_free(self->exemplars);
+  self->exemplars = NULL;
+
+  r = prom_native_histogram_destroy(self->native);
+  if (r) ret = r;
+  self->native = NULL;
 
   prom_free(self);
   self = NULL;
@@ -316,102 +314,161 @@ void prom_metric_sample_histogram_free_generic(void *gen) {
   prom_metric_sample_histogram_destroy(self);
 }
 
-int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value) {
-  int r = 0;
-
-  r = pthread_rwlock_wrlock(self->rwlock);
-  if (r) {
-    printf("RETURN CODE: %d\n", r);
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    return r;
+// Returns the index of the lowest bucket whose upper bound is at least value, or the bucket count for +Inf
+static size_t prom_metric_sample_histogram_index(prom_metric_sample_histogram_t *self, double value) {
+  const double *upper_bounds = self->buckets->upper_bounds;
+  size_t len = (size_t)self->buckets->count;
+  if (len == 0) return 0;
+
+  // Halving without a data-dependent branch, so the compiler emits conditional moves and nothing is mispredicted.
+  // NaN compares false everywhere and lands in the lowest bucket, which counts it in every bucket as before.
+  const double *base = upper_bounds;
+  while (len > 1) {
+    size_t half = len / 2;
+    base += (size_t)(base[half - 1] < value) * half;
+    len -= half;
   }
+  return (size_t)(base - upper_bounds) + (*base < value);
+}
 
-#define PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r) \
-  int rr = 0;                                                 \
-  rr = pthread_rwlock_unlock(self->rwlock);                   \
-  if (rr) {                                                   \
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);               \
-    return rr;                                                \
-  } else {                                                    \
-    return r;                                                 \
-  }
+static int prom_metric_sample_histogram_observe_at(prom_metric_sample_histogram_t *self, size_t index,
+                                                   double value) {
+  if (self->expires) prom_metric_sample_touch(&self->updated);
 
-  // Update the counter for the proper bucket if found
-  int bucket_count = prom_histogram_buckets_count(self->buckets);
-  for (int i = (bucket_count - 1); i >= 0; i--) {
-    if (value > self->buckets->upper_bounds[i]) {
-      break;
-    }
+  // Native histograms have no fixed buckets besides +Inf, which is counted from the native buckets when collected
+  if (self->native != NULL) return prom_native_histogram_observe(self->native, value);
 
-    const char *bucket_key = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
-    if (bucket_key == NULL) {
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
-
-    const char *l_value = prom_map_get(self->l_values, bucket_key);
-    if (l_value == NULL) {
-      prom_free((void *)bucket_key);
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
+  atomic_fetch_add_explicit(&self->counts[index], 1, memory_order_relaxed);
+  double sum = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&self->sum, &sum, sum + value, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+  return 0;
+}
 
-    prom_metric_sample_t *sample = prom_map_get(self->samples, l_value);
-    if (sample == NULL) {
-      prom_free((void *)bucket_key);
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
+int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  return prom_metric_sample_histogram_observe_at(self, prom_metric_sample_histogram_index(self, value), value);
+}
 
-    prom_free((void *)bucket_key);
-    r = prom_metric_sample_add(sample, 1.0);
-    if (r) {
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r);
-    }
+void prom_metric_sample_histogram_collect(prom_metric_sample_histogram_t *self, uint64_t *cumulative, double *sum) {
+  PROM_ASSERT(self != NULL);
+  size_t bucket_count = prom_histogram_buckets_count(self->buckets);
+  if (self->native != NULL) {
+    uint64_t count = 0;
+    prom_native_histogram_collect(self->native, &count, sum);
+    for (size_t i = 0; i <= bucket_count; i++) cumulative[i] = count;
+    return;
   }
 
-  // Update the +Inf and count samples
-  const char *inf_l_value = prom_map_get(self->l_values, "+Inf");
-  if (inf_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  uint64_t total = 0;
+  for (size_t i = 0; i <= bucket_count; i++) {
+    total += atomic_load_explicit(&self->counts[i], memory_order_relaxed);
+    cumulative[i] = total;
   }
+  *sum = atomic_load_explicit(&self->sum, memory_order_relaxed);
+}
 
-  prom_metric_sample_t *inf_sample = prom_map_get(self->samples, inf_l_value);
-  if (inf_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
+int prom_metric_sample_histogram_load(prom_metric_sample_histogram_t *self, const unsigned long long *counts,
+                                      double sum) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || self->native != NULL) return 1;
 
-  r = prom_metric_sample_add(inf_sample, 1.0);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
+  size_t bucket_count = prom_histogram_buckets_count(self->buckets);
+  for (size_t i = 0; i <= bucket_count; i++) atomic_store_explicit(&self->counts[i], counts[i], memory_order_relaxed);
+  atomic_store_explicit(&self->sum, sum, memory_order_relaxed);
+  return 0;
+}
 
-  const char *count_l_value = prom_map_get(self->l_values, "count");
-  if (count_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+int prom_metric_sample_histogram_observe_with_exemplar(prom_metric_sample_histogram_t *self, double value,
+                                                       size_t exemplar_label_count, const char **exemplar_label_keys,
+                                                       const char **exemplar_label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // Reject label sets OpenMetrics does not allow before touching the histogram
+  size_t chars = 0;
+  size_t rendered_len = 0;
+  for (size_t i = 0; i < exemplar_label_count; i++) {
+    size_t key_len = strlen(exemplar_label_keys[i]);
+    size_t value_len = strlen(exemplar_label_values[i]);
+    chars += key_len + value_len;
+    rendered_len += key_len + value_len + (i == 0 ? 3 : 4);
+    for (const char *c = exemplar_label_values[i]; *c != '\0'; c++) {
+      if (*c == '\\' || *c == '"' || *c == '\n') rendered_len++;
+    }
   }
-
-  prom_metric_sample_t *count_sample = prom_map_get(self->samples, count_l_value);
-  if (count_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  if (chars > PROM_EXEMPLAR_MAX_LEN || rendered_len >= PROM_EXEMPLAR_LABELS_SIZE) {
+    PROM_LOG(PROM_EXEMPLAR_TOO_LONG);
+    return 1;
   }
 
-  r = prom_metric_sample_add(count_sample, 1.0);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
+  // The exemplar belongs to the lowest bucket that counted the value
+  size_t index = prom_metric_sample_histogram_index(self, value);
+  int r = prom_metric_sample_histogram_observe_at(self, index, value);
+  if (r) return r;
 
-  // Update the sum sample
-  const char *sum_l_value = prom_map_get(self->l_values, "sum");
-  if (sum_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  // Claim the slot by making seq odd. If another writer holds it, its exemplar is as recent as ours, so drop ours.
+  prom_exemplar_t *slot = &self->exemplars[index];
+  unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+  if (seq & 1) return 0;
+  if (!atomic_compare_exchange_strong_explicit(&slot->seq, &seq, seq + 1, memory_order_acquire,
+                                               memory_order_relaxed)) {
+    return 0;
   }
 
-  prom_metric_sample_t *sum_sample = prom_map_get(self->samples, sum_l_value);
-  if (sum_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  char *p = slot->labels;
+  for (size_t i = 0; i < exemplar_label_count; i++) {
+    if (i > 0) *p++ = ',';
+    size_t key_len = strlen(exemplar_label_keys[i]);
+    memcpy(p, exemplar_label_keys[i], key_len);
+    p += key_len;
+    *p++ = '=';
+    *p++ = '"';
+    for (const char *c = exemplar_label_values[i]; *c != '\0'; c++) {
+      if (*c == '\\' || *c == '"') {
+        *p++ = '\\';
+        *p++ = *c;
+      } else if (*c == '\n') {
+        *p++ = '\\';
+        *p++ = 'n';
+      } else {
+        *p++ = *c;
+      }
+    }
+    *p++ = '"';
   }
+  *p = '\0';
+  slot->value = value;
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  slot->timestamp = (double)now.tv_sec + (double)now.tv_nsec / 1e9;
 
-  r = prom_metric_sample_add(sum_sample, value);
-  PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r);
-  return r;
+  atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+  return 0;
+}
+
+bool prom_metric_sample_histogram_read_exemplar(prom_metric_sample_histogram_t *self, size_t index,
+                                                prom_exemplar_t *out) {
+  PROM_ASSERT(self != NULL);
+  prom_exemplar_t *slot = &self->exemplars[index];
+
+  // A few retries are enough; an exemplar that keeps changing is simply left out of this scrape
+  for (int attempt = 0; attempt < 4; attempt++) {
+    unsigned int before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (before == 0) return false;
+    if (before & 1) continue;
+    memcpy(out->labels, slot->labels, sizeof(out->labels));
+    out->value = slot->value;
+    out->timestamp = slot->timestamp;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == before) {
+      out->labels[sizeof(out->labels) - 1] = '\0';
+      return true;
+    }
+  }
+  return false;
 }
 
 static const char *prom_metric_sample_histogram_l_value_for_bucket(prom_metric_sample_histogram_t *self,
@@ -493,12 +550,6 @@ static const char *prom_metric_sample_histogram_l_value_for_inf(prom_metric_samp
   return ret;
 }
 
-static void prom_metric_sample_histogram_free_str_generic(void *gen) {
-  char *str = (char *)gen;
-  prom_free((void *)str);
-  str = NULL;
-}
-
 char *prom_metric_sample_histogram_bucket_to_str(double bucket) {
   char *buf = (char *)prom_malloc(sizeof(char) * 50);
   sprintf(buf, "%g", bucket);
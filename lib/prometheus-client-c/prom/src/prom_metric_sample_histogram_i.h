@@ -17,6 +17,9 @@
 #ifndef PROM_METRIC_HISTOGRAM_SAMPLE_I_H
 #define PROM_METRIC_HISTOGRAM_SAMPLE_I_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 // Public
 #include "prom_metric_sample_histogram.h"
 
@@ -44,4 +47,32 @@ char *prom_metric_sample_histogram_bucket_to_str(double bucket);
 
 void prom_metric_sample_histogram_free_generic(void *gen);
 
+/**
+ * @brief API PRIVATE Reads the counters of the histogram for rendering.
+ *
+ * Observations only add to the counter of their own bucket, so the cumulative counts the exposition formats need are
+ * summed here. Each counter is read atomically but not all of them at once, so a concurrent observation may be in the
+ * sum and not yet in the counts or the other way around.
+ *
+ * @param cumulative Receives the cumulative count of each bucket followed by +Inf, which is also the total count;
+ *                   bucket count + 1 entries
+ * @param sum Receives the sum of the observations
+ */
+void prom_metric_sample_histogram_collect(prom_metric_sample_histogram_t *self, uint64_t *cumulative, double *sum);
+
+/**
+ * @brief API PRIVATE Overwrites the counters of the histogram with externally kept counts.
+ * @param counts The observations per bucket, not cumulative, followed by those above the last bucket
+ * @param sum The sum of the observations
+ */
+int prom_metric_sample_histogram_load(prom_metric_sample_histogram_t *self, const unsigned long long *counts,
+                                      double sum);
+
+/**
+ * @brief API PRIVATE Copies the exemplar of the bucket at index into out. Index bucket count refers to +Inf.
+ * @return true if the bucket holds an exemplar and it could be read without racing a writer
+ */
+bool prom_metric_sample_histogram_read_exemplar(prom_metric_sample_histogram_t *self, size_t index,
+                                                prom_exemplar_t *out);
+
 #endif  // PROM_METRIC_HISTOGRAM_SAMPLE_I_H
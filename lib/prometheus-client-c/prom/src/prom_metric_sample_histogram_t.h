@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 // Public
 #include "prom_histogram_buckets.h"
@@ -23,17 +25,42 @@
 // Private
 #include "prom_map_t.h"
 #include "prom_metric_formatter_t.h"
+#include "prom_native_histogram_t.h"
 
 #ifndef PROM_METRIC_HISTOGRAM_SAMPLE_T_H
 #define PROM_METRIC_HISTOGRAM_SAMPLE_T_H
 
+// OpenMetrics caps the combined length of an exemplar's label names and values at 128 UTF-8 characters
+#define PROM_EXEMPLAR_MAX_LEN 128
+
+// Room for PROM_EXEMPLAR_MAX_LEN characters of names and values plus the quotes, equals signs and commas around them
+#define PROM_EXEMPLAR_LABELS_SIZE 256
+
+/**
+ * @brief API PRIVATE The most recent exemplar observed in a histogram bucket.
+ *
+ * The slot is a seqlock: seq is odd while a writer updates it, and readers retry when seq changed under them. A writer
+ * that finds another writer in the slot drops its exemplar instead of waiting, so observing never blocks.
+ */
+typedef struct prom_exemplar {
+  atomic_uint seq;                         /**< even when the slot is stable; 0 when it was never written */
+  char labels[PROM_EXEMPLAR_LABELS_SIZE];  /**< the label set rendered as a="b",c="d", null terminated */
+  double value;                            /**< the observed value */
+  double timestamp;                        /**< when the value was observed, in seconds since the epoch */
+} prom_exemplar_t;
+
 struct prom_metric_sample_histogram {
   prom_linked_list_t *l_value_list;
-  prom_map_t *l_values;
   prom_map_t *samples;
   prom_metric_formatter_t *metric_formatter;
   prom_histogram_buckets_t *buckets;
-  pthread_rwlock_t *rwlock;
+  _Atomic uint64_t *counts;        /**< observations per bucket, not cumulative, then those above the last bucket */
+  _Atomic double sum;              /**< the sum of the observations */
+  prom_exemplar_t *exemplars;      /**< one slot per bucket followed by one for +Inf */
+  prom_native_histogram_t *native; /**< the sparse exponential buckets, or NULL if the histogram has fixed buckets */
+  bool expires;                    /**< whether the sample is evicted when it is not updated in time */
+  _Atomic uint64_t updated;        /**< the last observation on the coarse clock, kept when expires */
+  atomic_uint refs;                /**< the metric's map while linked plus every handle held */
 };
 
 #endif  // PROM_METRIC_HISTOGRAM_SAMPLE_T_H
@@ -29,6 +29,54 @@
  */
 prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char *l_value, double r_value);
 
+/**
+ * @brief API PRIVATE Return a prom_metric_sample_t* whose value is a 64-bit integer.
+ *
+ * Additions are a single atomic_fetch_add instead of a compare-and-swap loop on a double, and values beyond 2^53 stay
+ * exact.
+ */
+prom_metric_sample_t *prom_metric_sample_int_new(prom_metric_type_t type, const char *l_value);
+
+/**
+ * @brief API PRIVATE Return a prom_metric_sample_t* for a sharded counter.
+ *
+ * Additions go to one of one cache-line-sized shard per CPU, picked by the CPU the caller runs on, so threads on
+ * different CPUs never contend. The shards are summed by prom_metric_sample_value.
+ */
+prom_metric_sample_t *prom_metric_sample_sharded_new(const char *l_value);
+
+/**
+ * @brief API PRIVATE Returns the number of shards per-CPU state is split into: the CPU count rounded up to a power of
+ * two, capped at 256
+ */
+size_t prom_metric_sample_shard_count(void);
+
+/**
+ * @brief API PRIVATE Overwrites the value of a sample no other thread can see yet, whatever its type
+ */
+int prom_metric_sample_load(prom_metric_sample_t *self, double r_value);
+
+/**
+ * @brief API PRIVATE Returns the time on the coarse monotonic clock that last-update stamps use, in nanoseconds
+ */
+uint64_t prom_metric_sample_clock(void);
+
+/**
+ * @brief API PRIVATE Stamps a sample of a metric with a TTL as updated now
+ */
+void prom_metric_sample_touch(_Atomic uint64_t *updated);
+
+/**
+ * @brief API PRIVATE Returns the shard of the CPU the caller runs on, out of shard_count, a power of two
+ */
+size_t prom_metric_sample_shard_index(size_t shard_count);
+
+/**
+ * @brief API PRIVATE Returns the value of the sample, summing the shards of a sharded counter and converting the value
+ * of an integer sample
+ */
+double prom_metric_sample_value(prom_metric_sample_t *self);
+
 /**
  * @brief API PRIVATE Destroy the prom_metric_sample**
  */
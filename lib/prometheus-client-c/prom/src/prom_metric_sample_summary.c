@@ -0,0 +1,410 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_dtoa_i.h"
+#include "prom_errors.h"
+#include "prom_linked_list_i.h"
+#include "prom_log.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_quantile_stream_i.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_summary_config
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+prom_summary_config_t *prom_summary_config_new(size_t quantile_count, const double *quantiles, const double *errors,
+                                               double max_age, size_t age_buckets) {
+  if (!(max_age > 0.0) || age_buckets == 0) return NULL;
+  for (size_t i = 0; i < quantile_count; i++) {
+    if (!(quantiles[i] > 0.0 && quantiles[i] < 1.0)) return NULL;
+    if (!(errors[i] > 0.0 && errors[i] < 1.0)) return NULL;
+  }
+
+  prom_summary_config_t *self = (prom_summary_config_t *)prom_malloc(sizeof(prom_summary_config_t));
+  self->quantile_count = quantile_count;
+  self->quantiles = (double *)prom_malloc(sizeof(double) * (quantile_count + 1));
+  self->errors = (double *)prom_malloc(sizeof(double) * (quantile_count + 1));
+  self->max_age = (uint64_t)(max_age * 1e9);
+  self->age_buckets = age_buckets;
+  // Every rotation must move time forward
+  if (self->max_age < age_buckets) self->max_age = age_buckets;
+
+  // Insertion sort keeps each error with its quantile; there are only a handful of them
+  for (size_t i = 0; i < quantile_count; i++) {
+    size_t j = i;
+    while (j > 0 && self->quantiles[j - 1] > quantiles[i]) {
+      self->quantiles[j] = self->quantiles[j - 1];
+      self->errors[j] = self->errors[j - 1];
+      j--;
+    }
+    self->quantiles[j] = quantiles[i];
+    self->errors[j] = errors[i];
+  }
+  return self;
+}
+
+int prom_summary_config_destroy(prom_summary_config_t *self) {
+  if (self == NULL) return 0;
+  prom_free(self->quantiles);
+  self->quantiles = NULL;
+  prom_free(self->errors);
+  self->errors = NULL;
+  prom_free(self);
+  self = NULL;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_metric_sample_summary
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t prom_metric_sample_summary_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Formats an l_value with the given suffix, plus the quantile label when quantile is not NaN, and appends it to the
+// l_value_list
+static int prom_metric_sample_summary_add_l_value(prom_metric_sample_summary_t *self, const char *name,
+                                                  const char *suffix, size_t label_count, const char **label_keys,
+                                                  const char **label_values, double quantile) {
+  int r = 0;
+
+  // keys and values share the formatter's scratch, each with room for the quantile label
+  const char **keys =
+      (const char **)prom_metric_formatter_scratch(self->metric_formatter, 2 * (label_count + 1) * sizeof(char *));
+  if (keys == NULL) return 1;
+  const char **values = keys + label_count + 1;
+  for (size_t i = 0; i < label_count; i++) {
+    keys[i] = label_keys[i];
+    values[i] = label_values[i];
+  }
+
+  char quantile_str[PROM_DTOA_BUFFER_SIZE + 1];
+  if (!isnan(quantile)) {
+    quantile_str[prom_dtoa(quantile, quantile_str)] = '\0';
+    keys[label_count] = "quantile";
+    values[label_count] = quantile_str;
+    label_count++;
+  }
+
+  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, suffix, label_count, keys, values);
+  if (r) return r;
+
+  char *l_value = prom_metric_formatter_dump(self->metric_formatter);
+  if (l_value == NULL) return 1;
+
+  // The list takes ownership of l_value
+  r = prom_linked_list_append(self->l_value_list, l_value);
+  if (r) prom_free(l_value);
+  return r;
+}
+
+prom_metric_sample_summary_t *prom_metric_sample_summary_new(const char *name, prom_summary_config_t *config,
+                                                             size_t label_count, const char **label_keys,
+                                                             const char **label_values) {
+  PROM_ASSERT(config != NULL);
+  int r = 0;
+
+  prom_metric_sample_summary_t *self =
+      (prom_metric_sample_summary_t *)prom_malloc(sizeof(prom_metric_sample_summary_t));
+  self->config = config;
+  self->expires = false;
+  atomic_init(&self->updated, 0);
+  atomic_init(&self->refs, 1);
+  atomic_init(&self->count, 0);
+  atomic_init(&self->sum, 0.0);
+  self->lock = NULL;
+  self->streams = NULL;
+  self->head = 0;
+  self->head_expires = prom_metric_sample_summary_now() + config->max_age / config->age_buckets;
+  self->scratch = NULL;
+  self->scratch_allocated = 0;
+  self->buffer_count = 0;
+  self->buffers = NULL;
+  self->buffers_allocation = NULL;
+
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  self->created = (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+
+  self->l_value_list = prom_linked_list_new();
+  self->metric_formatter = prom_metric_formatter_new();
+  if (self->l_value_list == NULL || self->metric_formatter == NULL) {
+    prom_metric_sample_summary_destroy(self);
+    return NULL;
+  }
+
+  // l_value_list holds one l_value per quantile in ascending order, then count and sum
+  for (size_t i = 0; i < config->quantile_count && r == 0; i++) {
+    r = prom_metric_sample_summary_add_l_value(self, name, NULL, label_count, label_keys, label_values,
+                                               config->quantiles[i]);
+  }
+  if (!r) r = prom_metric_sample_summary_add_l_value(self, name, "count", label_count, label_keys, label_values, NAN);
+  if (!r) r = prom_metric_sample_summary_add_l_value(self, name, "sum", label_count, label_keys, label_values, NAN);
+  if (r) {
+    prom_metric_sample_summary_destroy(self);
+    return NULL;
+  }
+
+  self->lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  r = pthread_mutex_init(self->lock, NULL);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+    prom_free(self->lock);
+    self->lock = NULL;
+    prom_metric_sample_summary_destroy(self);
+    return NULL;
+  }
+
+  // A summary without quantiles is only a count and a sum
+  if (config->quantile_count == 0) return self;
+
+  self->streams = (prom_quantile_stream_t **)prom_malloc(sizeof(prom_quantile_stream_t *) * config->age_buckets);
+  for (size_t i = 0; i < config->age_buckets; i++) self->streams[i] = NULL;
+  for (size_t i = 0; i < config->age_buckets; i++) {
+    self->streams[i] = prom_quantile_stream_new(config->quantile_count, config->quantiles, config->errors);
+    if (self->streams[i] == NULL) {
+      prom_metric_sample_summary_destroy(self);
+      return NULL;
+    }
+  }
+
+  // prom_malloc makes no alignment promise beyond max_align_t, so allocate a spare buffer and align by hand
+  size_t count = prom_metric_sample_shard_count();
+  self->buffers_allocation = prom_malloc((count + 1) * sizeof(prom_summary_buffer_t));
+  if (self->buffers_allocation == NULL) {
+    prom_metric_sample_summary_destroy(self);
+    return NULL;
+  }
+  uintptr_t aligned = ((uintptr_t)self->buffers_allocation + PROM_SUMMARY_CACHE_LINE - 1) &
+                      ~(uintptr_t)(PROM_SUMMARY_CACHE_LINE - 1);
+  self->buffers = (prom_summary_buffer_t *)aligned;
+  for (size_t i = 0; i < count; i++) {
+    r = pthread_mutex_init(&self->buffers[i].lock, NULL);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+      prom_metric_sample_summary_destroy(self);
+      return NULL;
+    }
+    self->buffers[i].len = 0;
+    self->buffer_count = i + 1;
+  }
+  return self;
+}
+
+int prom_metric_sample_summary_destroy(prom_metric_sample_summary_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+
+  int r = 0;
+  int ret = 0;
+
+  r = prom_linked_list_destroy(self->l_value_list);
+  self->l_value_list = NULL;
+  if (r) ret = r;
+
+  r = prom_metric_formatter_destroy(self->metric_formatter);
+  self->metric_formatter = NULL;
+  if (r) ret = r;
+
+  for (size_t i = 0; i < self->buffer_count; i++) pthread_mutex_destroy(&self->buffers[i].lock);
+  prom_free(self->buffers_allocation);
+  self->buffers_allocation = NULL;
+  self->buffers = NULL;
+
+  if (self->streams != NULL) {
+    for (size_t i = 0; i < self->config->age_buckets; i++) {
+      r = prom_quantile_stream_destroy(self->streams[i]);
+      if (r) ret = r;
+    }
+  }
+  prom_free(self->streams);
+  self->streams = NULL;
+
+  prom_free(self->scratch);
+  self->scratch = NULL;
+
+  if (self->lock != NULL) {
+    r = pthread_mutex_destroy(self->lock);
+    if (r) ret = r;
+    prom_free(self->lock);
+    self->lock = NULL;
+  }
+
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+void prom_metric_sample_summary_free_generic(void *gen) {
+  prom_metric_sample_summary_t *self = (prom_metric_sample_summary_t *)gen;
+  prom_metric_sample_summary_destroy(self);
+}
+
+static int prom_metric_sample_summary_compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Merges a batch of observations into every sketch. The caller MUST hold self->lock.
+static int prom_metric_sample_summary_merge(prom_metric_sample_summary_t *self, double *values, size_t count) {
+  if (count == 0) return 0;
+  qsort(values, count, sizeof(double), prom_metric_sample_summary_compare);
+  for (size_t i = 0; i < self->config->age_buckets; i++) {
+    int r = prom_quantile_stream_merge(self->streams[i], values, count, &self->scratch, &self->scratch_allocated);
+    if (r) return r;
+  }
+  return 0;
+}
+
+// Merges the observations every buffer holds. The caller MUST hold self->lock.
+static int prom_metric_sample_summary_drain(prom_metric_sample_summary_t *self) {
+  double batch[PROM_SUMMARY_BUFFER_SIZE];
+  for (size_t i = 0; i < self->buffer_count; i++) {
+    prom_summary_buffer_t *buffer = &self->buffers[i];
+    int r = pthread_mutex_lock(&buffer->lock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+      return r;
+    }
+    size_t len = buffer->len;
+    memcpy(batch, buffer->values, len * sizeof(double));
+    buffer->len = 0;
+    pthread_mutex_unlock(&buffer->lock);
+
+    r = prom_metric_sample_summary_merge(self, batch, len);
+    if (r) return r;
+  }
+  return 0;
+}
+
+/**
+ * @brief Resets the sketches whose time is up. The caller MUST hold self->lock and drain the buffers first.
+ *
+ * Every sketch sees every observation, but each was started one rotation after the one before it. The head is the
+ * oldest, so it covers the last max_age, give or take one rotation; when it expires it starts over and becomes the
+ * youngest.
+ */
+static void prom_metric_sample_summary_rotate(prom_metric_sample_summary_t *self, uint64_t now) {
+  uint64_t interval = self->config->max_age / self->config->age_buckets;
+  if (now < self->head_expires) return;
+
+  // Nothing was merged for longer than the window, so every sketch is stale
+  if (now - self->head_expires >= self->config->max_age) {
+    for (size_t i = 0; i < self->config->age_buckets; i++) prom_quantile_stream_reset(self->streams[i]);
+    self->head_expires = now + interval;
+    return;
+  }
+  while (now >= self->head_expires) {
+    prom_quantile_stream_reset(self->streams[self->head]);
+    self->head = (self->head + 1) % self->config->age_buckets;
+    self->head_expires += interval;
+  }
+}
+
+// Merges a full buffer's observations, rotating the sketches first if the head expired
+static int prom_metric_sample_summary_flush(prom_metric_sample_summary_t *self, double *values, size_t count) {
+  int r = pthread_mutex_lock(self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  r = prom_metric_sample_summary_merge(self, values, count);
+  uint64_t now = prom_metric_sample_summary_now();
+  if (!r && now >= self->head_expires) {
+    // Observations waiting in other buffers are older than the rotation, so they go into the sketches before it
+    r = prom_metric_sample_summary_drain(self);
+    prom_metric_sample_summary_rotate(self, now);
+  }
+  pthread_mutex_unlock(self->lock);
+  return r;
+}
+
+int prom_metric_sample_summary_observe(prom_metric_sample_summary_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  if (self->expires) prom_metric_sample_touch(&self->updated);
+  atomic_fetch_add_explicit(&self->count, 1, memory_order_relaxed);
+  double sum = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&self->sum, &sum, sum + value, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+
+  // NaN has no rank, so it is counted and summed but kept out of the sketches
+  if (self->buffer_count == 0 || isnan(value)) return 0;
+
+  // Threads on different CPUs append to different buffers, and only a full buffer takes the summary's lock
+  prom_summary_buffer_t *buffer = &self->buffers[prom_metric_sample_shard_index(self->buffer_count)];
+  int r = pthread_mutex_lock(&buffer->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  buffer->values[buffer->len++] = value;
+  if (buffer->len < PROM_SUMMARY_BUFFER_SIZE) {
+    pthread_mutex_unlock(&buffer->lock);
+    return 0;
+  }
+  double batch[PROM_SUMMARY_BUFFER_SIZE];
+  memcpy(batch, buffer->values, sizeof(batch));
+  buffer->len = 0;
+  pthread_mutex_unlock(&buffer->lock);
+
+  return prom_metric_sample_summary_flush(self, batch, PROM_SUMMARY_BUFFER_SIZE);
+}
+
+int prom_metric_sample_summary_collect(prom_metric_sample_summary_t *self, double *quantile_values, uint64_t *count,
+                                       double *sum) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  *count = atomic_load_explicit(&self->count, memory_order_relaxed);
+  *sum = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  if (self->buffer_count == 0) return 0;
+
+  int r = pthread_mutex_lock(self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  r = prom_metric_sample_summary_drain(self);
+  prom_metric_sample_summary_rotate(self, prom_metric_sample_summary_now());
+  prom_quantile_stream_t *head = self->streams[self->head];
+  for (size_t i = 0; i < self->config->quantile_count; i++) {
+    quantile_values[i] = prom_quantile_stream_query(head, self->config->quantiles[i]);
+  }
+  pthread_mutex_unlock(self->lock);
+  return r;
+}
@@ -0,0 +1,71 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_METRIC_SAMPLE_SUMMARY_I_H
+#define PROM_METRIC_SAMPLE_SUMMARY_I_H
+
+#include <stdint.h>
+
+// Public
+#include "prom_metric_sample_summary.h"
+
+// Private
+#include "prom_metric_sample_summary_t.h"
+
+/**
+ * @brief API PRIVATE Constructs the configuration of a summary, copying the quantiles and sorting them
+ * @return The configuration, or NULL if a quantile is not within (0, 1) or an error is not within (0, 1)
+ */
+prom_summary_config_t *prom_summary_config_new(size_t quantile_count, const double *quantiles, const double *errors,
+                                               double max_age, size_t age_buckets);
+
+/**
+ * @brief API PRIVATE Destroys the configuration of a summary
+ */
+int prom_summary_config_destroy(prom_summary_config_t *self);
+
+/**
+ * @brief API PRIVATE Create a pointer to a prom_metric_sample_summary_t
+ */
+prom_metric_sample_summary_t *prom_metric_sample_summary_new(const char *name, prom_summary_config_t *config,
+                                                             size_t label_count, const char **label_keys,
+                                                             const char **label_values);
+
+/**
+ * @brief API PRIVATE Destroy a prom_metric_sample_summary_t
+ */
+int prom_metric_sample_summary_destroy(prom_metric_sample_summary_t *self);
+
+/**
+ * @brief API PRIVATE Destroy a void pointer that is cast to a prom_metric_sample_summary_t*
+ */
+void prom_metric_sample_summary_free_generic(void *gen);
+
+/**
+ * @brief API PRIVATE Reads the summary for rendering.
+ *
+ * Observations still buffered are merged first, so the quantiles cover everything observed before the call within
+ * max_age. A quantile is NaN when no observation is that recent.
+ *
+ * @param quantile_values Receives the estimate of each quantile; quantile_count entries
+ * @param count Receives the number of observations since the sample was created
+ * @param sum Receives the sum of those observations
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_sample_summary_collect(prom_metric_sample_summary_t *self, double *quantile_values, uint64_t *count,
+                                       double *sum);
+
+#endif  // PROM_METRIC_SAMPLE_SUMMARY_I_H
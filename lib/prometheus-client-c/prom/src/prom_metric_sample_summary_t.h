@@ -0,0 +1,81 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Public
+#include "prom_metric_sample_summary.h"
+
+// Private
+#include "prom_linked_list_t.h"
+#include "prom_metric_formatter_t.h"
+#include "prom_quantile_stream_t.h"
+
+#ifndef PROM_METRIC_SAMPLE_SUMMARY_T_H
+#define PROM_METRIC_SAMPLE_SUMMARY_T_H
+
+// Observations a CPU collects before they are merged into the sketches
+#define PROM_SUMMARY_BUFFER_SIZE 128
+
+// The cache line size the observation buffers are aligned to
+#define PROM_SUMMARY_CACHE_LINE 64
+
+/**
+ * @brief API PRIVATE The quantiles and the time window shared by the samples of a summary
+ */
+typedef struct prom_summary_config {
+  size_t quantile_count; /**< the number of quantiles exposed */
+  double *quantiles;     /**< the quantiles, ascending */
+  double *errors;        /**< the allowed rank error of each quantile */
+  uint64_t max_age;      /**< how long an observation counts towards the quantiles, in nanoseconds */
+  size_t age_buckets;    /**< the number of sketches the window rotates through */
+} prom_summary_config_t;
+
+/**
+ * @brief API PRIVATE Observations made on one CPU that were not merged into the sketches yet
+ */
+typedef struct prom_summary_buffer {
+  _Alignas(PROM_SUMMARY_CACHE_LINE) pthread_mutex_t lock; /**< guards len and values */
+  size_t len;
+  double values[PROM_SUMMARY_BUFFER_SIZE];
+} prom_summary_buffer_t;
+
+struct prom_metric_sample_summary {
+  prom_linked_list_t *l_value_list;          /**< one l_value per quantile, then count and sum */
+  prom_metric_formatter_t *metric_formatter; /**< renders the l_values */
+  prom_summary_config_t *config;             /**< owned by the metric */
+  double created;                            /**< when the sample was created, in seconds since the epoch */
+  bool expires;                              /**< whether the sample is evicted when it is not updated in time */
+  _Atomic uint64_t updated;                  /**< the last observation on the coarse clock, kept when expires */
+  atomic_uint refs;                          /**< the metric's map while linked plus every handle held */
+  _Atomic uint64_t count;                    /**< the number of observations */
+  _Atomic double sum;                        /**< the sum of the observations */
+  pthread_mutex_t *lock;                     /**< guards everything below but the buffers */
+  prom_quantile_stream_t **streams;          /**< age_buckets sketches, each started one rotation after the last */
+  size_t head;                               /**< the oldest sketch, which covers max_age and answers queries */
+  uint64_t head_expires;                     /**< when the head sketch is reset and the next one becomes the head */
+  prom_quantile_sample_t *scratch;           /**< merge buffer shared by the sketches */
+  size_t scratch_allocated;                  /**< the capacity of scratch */
+  size_t buffer_count;                       /**< the number of buffers, a power of two, or 0 without quantiles */
+  prom_summary_buffer_t *buffers;            /**< one buffer per CPU */
+  void *buffers_allocation;                  /**< what was allocated for buffers, before alignment */
+};
+
+#endif  // PROM_METRIC_SAMPLE_SUMMARY_T_H
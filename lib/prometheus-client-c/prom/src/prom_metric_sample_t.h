@@ -17,13 +17,38 @@
 #ifndef PROM_METRIC_SAMPLE_T_H
 #define PROM_METRIC_SAMPLE_T_H
 
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "prom_metric_sample.h"
 #include "prom_metric_t.h"
 
+// The size of a cache line on the CPUs this library targets
+#define PROM_METRIC_SAMPLE_CACHE_LINE 64
+
+/**
+ * @brief API PRIVATE A slot of a sharded counter sample, padded to a cache line of its own so CPUs adding to
+ * neighbouring slots do not contend for the same line
+ */
+typedef struct prom_metric_sample_shard {
+  _Alignas(PROM_METRIC_SAMPLE_CACHE_LINE) _Atomic double value;
+} prom_metric_sample_shard_t;
+
 struct prom_metric_sample {
   prom_metric_type_t type; /**< type is the metric type for the sample */
   char *l_value;           /**< l_value is the full metric name and label set represeted as a string */
+  size_t l_value_len;      /**< l_value_len is the length of l_value, so rendering can copy it without a strlen */
   _Atomic double r_value;  /**< r_value is the value of the metric sample */
+  bool integer;            /**< integer is whether the value is kept in i_value rather than r_value */
+  _Atomic int64_t i_value; /**< i_value is the value of an integer sample */
+  double created;          /**< created is when the sample was created, in seconds since the epoch */
+  size_t shard_count;      /**< shard_count is the number of shards, a power of two, or 0 if the sample is unsharded */
+  prom_metric_sample_shard_t *shards; /**< shards are added to instead of r_value, and summed with it when rendered */
+  void *shards_allocation;            /**< shards_allocation is what was allocated for shards, before alignment */
+  bool expires;                       /**< expires is whether the sample is evicted when it is not updated in time */
+  _Atomic uint64_t updated;           /**< updated is the last update on the coarse clock, kept when expires */
+  atomic_uint refs;                   /**< refs counts the metric's map while linked plus every handle held */
 };
 
 #endif  // PROM_METRIC_SAMPLE_T_H
@@ -18,15 +18,20 @@
 #define PROM_METRIC_T_H
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 // Public
 #include "prom_histogram_buckets.h"
 #include "prom_metric.h"
 
 // Private
+#include "prom_linked_list_t.h"
 #include "prom_map_i.h"
 #include "prom_map_t.h"
 #include "prom_metric_formatter_t.h"
+#include "prom_metric_sample_summary_t.h"
 
 /**
  * @brief API PRIVATE Contains metric type constants
@@ -40,18 +45,38 @@ extern char *prom_metric_type_map[4];
 
 /**
  * @brief API PRIVATE An opaque struct to users containing metric metadata; one or more metric samples; and a metric
- * formatter for locating metric samples and exporting metric data
+ * formatter for exporting metric data
  */
 struct prom_metric {
-  prom_metric_type_t type;            /**< metric_type      The type of metric */
-  const char *name;                   /**< name             The name of the metric */
-  const char *help;                   /**< help             The help output for the metric */
-  prom_map_t *samples;                /**< samples          Map comprised of samples for the given metric */
-  prom_histogram_buckets_t *buckets;  /**< buckets          Array of histogram bucket upper bound values */
-  size_t label_key_count;             /**< label_keys_count The count of labe_keys*/
-  prom_metric_formatter_t *formatter; /**< formatter        The metric formatter  */
-  pthread_rwlock_t *rwlock;           /**< rwlock           Required for locking on certain non-atomic operations */
-  const char **label_keys;            /**< labels           Array comprised of const char **/
+  prom_metric_type_t type;               /**< metric_type      The type of metric */
+  const char *name;                      /**< name             The name of the metric */
+  const char *help;                      /**< help             The help output for the metric */
+  prom_map_t *samples;                   /**< samples          Map comprised of samples for the given metric */
+  prom_histogram_buckets_t *buckets;     /**< buckets          Array of histogram bucket upper bound values */
+  size_t label_key_count;                /**< label_keys_count The count of labe_keys*/
+  prom_metric_formatter_t *formatter;    /**< formatter        The metric formatter  */
+  pthread_rwlock_t *rwlock;              /**< rwlock           Required for locking on certain non-atomic operations */
+  const char **label_keys;               /**< labels           Array comprised of const char **/
+  char *header;                          /**< header           The pre-rendered HELP and TYPE lines */
+  size_t header_len;                     /**< header_len       The length of header */
+  char *openmetrics_header;              /**< om_header        The pre-rendered OpenMetrics HELP and TYPE lines */
+  size_t openmetrics_header_len;         /**< om_header_len    The length of openmetrics_header */
+  bool sharded;                          /**< sharded          Whether counter samples are sharded per CPU */
+  bool integer;                          /**< integer          Whether samples hold 64-bit integers */
+  bool native;                           /**< native           Whether histogram samples have native buckets */
+  int native_schema;                     /**< native_schema    The initial schema of native histogram samples */
+  size_t native_max_bucket_count;        /**< native_max       The native buckets allowed before lowering the schema */
+  prom_summary_config_t *summary_config; /**< summary_cfg      The quantiles and window of summary samples */
+  size_t max_series;                     /**< max_series       The samples allowed at once; 0 for no limit */
+  uint64_t ttl;                          /**< ttl              Nanoseconds a sample may go without update; 0 for ever */
+  atomic_ullong dropped_series;          /**< dropped_series   The samples refused because of max_series */
+  atomic_ullong evicted_series;          /**< evicted_series   The samples evicted because of ttl */
+  prom_linked_list_t *retired;           /**< retired          Samples dropped from samples that handles still hold */
+};
+
+struct prom_metric_family {
+  prom_metric_t *metric; /**< the metric whose samples the family replaces */
+  prom_map_t *samples;   /**< the samples built so far, keyed like the samples of metric */
 };
 
 #endif  // PROM_METRIC_T_H
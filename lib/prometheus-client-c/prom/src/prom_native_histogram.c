@@ -0,0 +1,218 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://prometheus.io/docs/specs/native_histograms/
+//
+// Buckets are kept at key_schema, the initial schema or 0 if that is lower, and shifted down to the current schema on
+// every observation. A lowered schema therefore never has to recompute the bucket of a value from scratch.
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_native_histogram_i.h"
+#include "prom_native_histogram_t.h"
+
+// bounds[s][i] = 2^(i/2^s - 1) is the fraction at which bucket i of an octave at schema s ends, for i < 2^s
+static double prom_native_histogram_bounds[PROM_NATIVE_HISTOGRAM_MAX_SCHEMA + 1][1 << PROM_NATIVE_HISTOGRAM_MAX_SCHEMA];
+static pthread_once_t prom_native_histogram_bounds_once = PTHREAD_ONCE_INIT;
+
+static void prom_native_histogram_init_bounds(void) {
+  for (int s = 0; s <= PROM_NATIVE_HISTOGRAM_MAX_SCHEMA; s++) {
+    for (int i = 0; i < (1 << s); i++) prom_native_histogram_bounds[s][i] = exp2((double)i / (1 << s) - 1.0);
+  }
+}
+
+int prom_native_histogram_schema_for_factor(double bucket_factor) {
+  for (int s = PROM_NATIVE_HISTOGRAM_MIN_SCHEMA; s < PROM_NATIVE_HISTOGRAM_MAX_SCHEMA; s++) {
+    if (exp2(exp2(-s)) <= bucket_factor) return s;
+  }
+  return PROM_NATIVE_HISTOGRAM_MAX_SCHEMA;
+}
+
+prom_native_histogram_t *prom_native_histogram_new(int schema, size_t max_bucket_count) {
+  PROM_ASSERT(schema >= PROM_NATIVE_HISTOGRAM_MIN_SCHEMA && schema <= PROM_NATIVE_HISTOGRAM_MAX_SCHEMA);
+  if (schema < PROM_NATIVE_HISTOGRAM_MIN_SCHEMA || schema > PROM_NATIVE_HISTOGRAM_MAX_SCHEMA) return NULL;
+  pthread_once(&prom_native_histogram_bounds_once, &prom_native_histogram_init_bounds);
+
+  prom_native_histogram_t *self = (prom_native_histogram_t *)prom_malloc(sizeof(prom_native_histogram_t));
+  self->lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  if (pthread_mutex_init(self->lock, NULL)) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+    prom_free(self->lock);
+    prom_free(self);
+    return NULL;
+  }
+  self->key_schema = schema > 0 ? schema : 0;
+  self->schema = schema;
+  self->max_bucket_count = max_bucket_count;
+  self->count = 0;
+  self->sum = 0.0;
+  self->zero_count = 0;
+  memset(&self->positive, 0, sizeof(self->positive));
+  memset(&self->negative, 0, sizeof(self->negative));
+  return self;
+}
+
+int prom_native_histogram_destroy(prom_native_histogram_t *self) {
+  if (self == NULL) return 0;
+  int r = pthread_mutex_destroy(self->lock);
+  prom_free(self->lock);
+  self->lock = NULL;
+  prom_free(self->positive.items);
+  self->positive.items = NULL;
+  prom_free(self->negative.items);
+  self->negative.items = NULL;
+  prom_free(self);
+  self = NULL;
+  return r;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Buckets
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the index of the bucket of the magnitude at schema key_schema, which is 0 or more
+static int64_t prom_native_histogram_key(double magnitude, int key_schema) {
+  int exp = 0;
+  double frac = 0.5;
+  if (isinf(magnitude)) {
+    // +Inf shares the highest bucket, whose upper bound 2^1024 overflows to +Inf as well
+    exp = 1025;
+  } else {
+    frac = frexp(magnitude, &exp);
+  }
+
+  // The lowest bucket of the octave [0.5, 1) whose end is not below frac; 2^s when frac is above all of them
+  const double *bounds = prom_native_histogram_bounds[key_schema];
+  size_t lo = 0;
+  size_t hi = (size_t)1 << key_schema;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (bounds[mid] < frac) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (int64_t)lo + (int64_t)(exp - 1) * ((int64_t)1 << key_schema);
+}
+
+static int prom_native_histogram_buckets_add(prom_native_histogram_buckets_t *self, int32_t index) {
+  size_t lo = 0;
+  size_t hi = self->len;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (self->items[mid].index < index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < self->len && self->items[lo].index == index) {
+    self->items[lo].count++;
+    return 0;
+  }
+
+  if (self->len == self->allocated) {
+    size_t allocated = self->allocated == 0 ? 8 : self->allocated * 2;
+    prom_native_histogram_bucket_t *items = (prom_native_histogram_bucket_t *)prom_realloc(
+        self->items, allocated * sizeof(prom_native_histogram_bucket_t));
+    if (items == NULL) return 1;
+    self->items = items;
+    self->allocated = allocated;
+  }
+  memmove(&self->items[lo + 1], &self->items[lo], (self->len - lo) * sizeof(prom_native_histogram_bucket_t));
+  self->items[lo].index = index;
+  self->items[lo].count = 1;
+  self->len++;
+  return 0;
+}
+
+// Merges each pair of buckets that share a bucket one schema lower: bucket i becomes bucket ceil(i / 2)
+static void prom_native_histogram_buckets_halve(prom_native_histogram_buckets_t *self) {
+  size_t len = 0;
+  for (size_t i = 0; i < self->len; i++) {
+    int32_t index = (int32_t)(((int64_t)self->items[i].index + 1) >> 1);
+    if (len > 0 && self->items[len - 1].index == index) {
+      self->items[len - 1].count += self->items[i].count;
+    } else {
+      self->items[len].index = index;
+      self->items[len].count = self->items[i].count;
+      len++;
+    }
+  }
+  self->len = len;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Observing
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int prom_native_histogram_observe(prom_native_histogram_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  prom_native_histogram_buckets_t *buckets = NULL;
+  int64_t key = 0;
+  if (value > PROM_NATIVE_HISTOGRAM_ZERO_THRESHOLD) {
+    buckets = &self->positive;
+    key = prom_native_histogram_key(value, self->key_schema);
+  } else if (value < -PROM_NATIVE_HISTOGRAM_ZERO_THRESHOLD) {
+    buckets = &self->negative;
+    key = prom_native_histogram_key(-value, self->key_schema);
+  }
+
+  int r = pthread_mutex_lock(self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  if (buckets == NULL) {
+    self->zero_count++;
+  } else {
+    // Rounds up, so a value on a bucket boundary stays in the lower bucket as the spec requires
+    int shift = self->key_schema - self->schema;
+    r = prom_native_histogram_buckets_add(buckets, (int32_t)((key + ((int64_t)1 << shift) - 1) >> shift));
+  }
+  if (!r) {
+    self->count++;
+    self->sum += value;
+    while (self->max_bucket_count > 0 && self->positive.len + self->negative.len > self->max_bucket_count &&
+           self->schema > PROM_NATIVE_HISTOGRAM_MIN_SCHEMA) {
+      prom_native_histogram_buckets_halve(&self->positive);
+      prom_native_histogram_buckets_halve(&self->negative);
+      self->schema--;
+    }
+  }
+  pthread_mutex_unlock(self->lock);
+  return r;
+}
+
+void prom_native_histogram_collect(prom_native_histogram_t *self, uint64_t *count, double *sum) {
+  PROM_ASSERT(self != NULL);
+  pthread_mutex_lock(self->lock);
+  *count = self->count;
+  *sum = self->sum;
+  pthread_mutex_unlock(self->lock);
+}
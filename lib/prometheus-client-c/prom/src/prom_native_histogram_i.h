@@ -0,0 +1,57 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_NATIVE_HISTOGRAM_I_H
+#define PROM_NATIVE_HISTOGRAM_I_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "prom_native_histogram_t.h"
+
+/**
+ * @brief API PRIVATE Returns the highest-resolution schema whose buckets grow by no more than bucket_factor, clamped to
+ * PROM_NATIVE_HISTOGRAM_MIN_SCHEMA and PROM_NATIVE_HISTOGRAM_MAX_SCHEMA
+ */
+int prom_native_histogram_schema_for_factor(double bucket_factor);
+
+/**
+ * @brief API PRIVATE Constructs an empty native histogram
+ * @param schema The initial schema
+ * @param max_bucket_count The populated buckets allowed before the schema is lowered; 0 for no limit
+ * @return The native histogram, or NULL upon failure
+ */
+prom_native_histogram_t *prom_native_histogram_new(int schema, size_t max_bucket_count);
+
+/**
+ * @brief API PRIVATE Destroys a native histogram
+ */
+int prom_native_histogram_destroy(prom_native_histogram_t *self);
+
+/**
+ * @brief API PRIVATE Counts value in its bucket, allocating the bucket the first time it is populated.
+ *
+ * When the populated buckets exceed max_bucket_count, pairs of neighbouring buckets are merged and the schema drops by
+ * one until they fit or the schema reaches PROM_NATIVE_HISTOGRAM_MIN_SCHEMA. NaN compares false against the zero
+ * threshold and is counted in the zero bucket.
+ */
+int prom_native_histogram_observe(prom_native_histogram_t *self, double value);
+
+/**
+ * @brief API PRIVATE Reads the number and the sum of the observations
+ */
+void prom_native_histogram_collect(prom_native_histogram_t *self, uint64_t *count, double *sum);
+#endif  // PROM_NATIVE_HISTOGRAM_I_H
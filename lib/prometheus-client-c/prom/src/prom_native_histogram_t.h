@@ -0,0 +1,65 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_NATIVE_HISTOGRAM_T_H
+#define PROM_NATIVE_HISTOGRAM_T_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The schemas the exposition formats allow. Schema s grows buckets by a factor of 2^(2^-s).
+#define PROM_NATIVE_HISTOGRAM_MIN_SCHEMA -4
+#define PROM_NATIVE_HISTOGRAM_MAX_SCHEMA 8
+
+// Observations no further from zero than 2^-128 are counted in the zero bucket
+#define PROM_NATIVE_HISTOGRAM_ZERO_THRESHOLD 2.938735877055719e-39
+
+/**
+ * @brief API PRIVATE A populated bucket. At schema s, bucket index holds the observations in (b^(index-1), b^index]
+ * with b = 2^(2^-s); negative observations are kept apart by their absolute value.
+ */
+typedef struct prom_native_histogram_bucket {
+  int32_t index;  /**< the index of the bucket at the current schema */
+  uint64_t count; /**< the observations in the bucket, not cumulative */
+} prom_native_histogram_bucket_t;
+
+/**
+ * @brief API PRIVATE The populated buckets of one sign, sorted by index
+ */
+typedef struct prom_native_histogram_buckets {
+  prom_native_histogram_bucket_t *items;
+  size_t len;
+  size_t allocated;
+} prom_native_histogram_buckets_t;
+
+struct prom_native_histogram {
+  pthread_mutex_t *lock;                    /**< guards everything below */
+  int key_schema;                           /**< the schema indexes are computed at before reducing them to schema */
+  int schema;                               /**< the current schema, lowered when there are too many buckets */
+  size_t max_bucket_count;                  /**< the populated buckets allowed before lowering schema; 0 for any */
+  uint64_t count;                           /**< the number of observations */
+  double sum;                               /**< the sum of the observations */
+  uint64_t zero_count;                      /**< the observations in the zero bucket */
+  prom_native_histogram_buckets_t positive; /**< buckets above the zero bucket */
+  prom_native_histogram_buckets_t negative; /**< buckets below the zero bucket */
+};
+/**
+ * @brief API PRIVATE The sparse exponential buckets of a native histogram sample
+ */
+typedef struct prom_native_histogram prom_native_histogram_t;
+
+#endif  // PROM_NATIVE_HISTOGRAM_T_H
@@ -67,6 +67,6 @@ int prom_process_fds_count(const char *path) {
 }
 
 int prom_process_fds_init(void) {
-  prom_process_open_fds = prom_gauge_new("process_open_fds", "Number of open file descriptors.", 0, NULL);
+  prom_process_open_fds = prom_gauge_new_int("process_open_fds", "Number of open file descriptors.", 0, NULL);
   return 0;
 }
@@ -16,6 +16,7 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -52,7 +53,7 @@ prom_gauge_t *prom_process_max_fds;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // prom_process_limits_row_t
 
-prom_process_limits_row_t *prom_process_limits_row_new(const char *limit, const int soft, const int hard,
+prom_process_limits_row_t *prom_process_limits_row_new(const char *limit, const int64_t soft, const int64_t hard,
                                                        const char *units) {
   prom_process_limits_row_t *self = (prom_process_limits_row_t *)prom_malloc(sizeof(prom_process_limits_row_t));
 
@@ -282,8 +283,8 @@ bool prom_process_limits_rdp_data_line(prom_process_limits_file_t *f, prom_map_t
 
   // Load data from the current row into the map
   const char *limit = (const char *)current_row->limit;
-  int soft = current_row->soft;
-  int hard = current_row->hard;
+  int64_t soft = current_row->soft;
+  int64_t hard = current_row->hard;
   const char *units = (const char *)current_row->units;
   prom_process_limits_row_t *row = prom_process_limits_row_new(limit, soft, hard, units);
   prom_map_set(map, limit, row);
@@ -357,7 +358,7 @@ static bool prom_process_limits_rdp_generic_limit(prom_process_limits_file_t *f,
                                                   prom_process_limits_current_row_t *current_row,
                                                   prom_process_limit_rdp_limit_type_t type) {
   size_t current_index = f->index;
-  int value = 0;
+  int64_t value = 0;
   if (prom_process_limits_rdp_match(f, PROM_PROCESS_LIMITS_RDP_UNLIMITED)) {
     value = -1;
   } else {
@@ -372,7 +373,8 @@ static bool prom_process_limits_rdp_generic_limit(prom_process_limits_file_t *f,
       buf[i] = f->buf[current_index + i];
     }
     buf[num_digits - 1] = '\0';
-    value = atoi(buf);
+    // Limits in bytes, e.g. Max address space, do not fit an int
+    value = strtoll(buf, NULL, 10);
     f->index += num_digits;
   }
 
@@ -436,9 +438,9 @@ bool prom_process_limits_rdp_match(prom_process_limits_file_t *f, const char *to
  * @brief Initializes each gauge metric found in prom_process_t.h
  */
 int prom_process_limits_init(void) {
-  prom_process_max_fds = prom_gauge_new("process_max_fds", "Maximum number of open file descriptors.", 0, NULL);
+  prom_process_max_fds = prom_gauge_new_int("process_max_fds", "Maximum number of open file descriptors.", 0, NULL);
 
-  prom_process_virtual_memory_max_bytes = prom_gauge_new(
+  prom_process_virtual_memory_max_bytes = prom_gauge_new_int(
       "process_virtual_memory_max_bytes", "Maximum amount of virtual memory available in bytes.", 0, NULL);
   return 0;
 }
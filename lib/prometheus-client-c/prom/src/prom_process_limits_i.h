@@ -27,7 +27,7 @@
  */
 int prom_process_init(void);
 
-prom_process_limits_row_t *prom_process_limits_row_new(const char *limit, const int soft, const int hard,
+prom_process_limits_row_t *prom_process_limits_row_new(const char *limit, const int64_t soft, const int64_t hard,
                                                        const char *units);
 int prom_process_limits_row_destroy(prom_process_limits_row_t *self);
 
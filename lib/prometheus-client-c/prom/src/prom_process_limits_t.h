@@ -17,6 +17,8 @@
 #ifndef PROM_PROCESS_T_H
 #define PROM_PROCESS_T_H
 
+#include <stdint.h>
+
 #include "prom_gauge.h"
 #include "prom_procfs_t.h"
 
@@ -26,16 +28,16 @@ extern prom_gauge_t *prom_process_virtual_memory_max_bytes;
 
 typedef struct prom_process_limits_row {
   const char *limit; /**< Pointer to a string */
-  int soft;          /**< Soft value */
-  int hard;          /**< Hard value */
+  int64_t soft;      /**< Soft value */
+  int64_t hard;      /**< Hard value */
   const char *units; /**< Units  */
 } prom_process_limits_row_t;
 
 typedef struct prom_process_limits_current_row {
-  char *limit; /**< Pointer to a string */
-  int soft;    /**< Soft value */
-  int hard;    /**< Hard value */
-  char *units; /**< Units  */
+  char *limit;  /**< Pointer to a string */
+  int64_t soft; /**< Soft value */
+  int64_t hard; /**< Hard value */
+  char *units;  /**< Units  */
 } prom_process_limits_current_row_t;
 
 typedef prom_procfs_buf_t prom_process_limits_file_t;
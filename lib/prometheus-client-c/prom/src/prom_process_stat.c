@@ -183,11 +183,11 @@ int prom_process_stats_init(void) {
 
   // /proc/[pid]/stat Field 23
   prom_process_virtual_memory_bytes =
-      prom_gauge_new("process_virtual_memory_bytes", "Virtual memory size in bytes.", 0, NULL);
+      prom_gauge_new_int("process_virtual_memory_bytes", "Virtual memory size in bytes.", 0, NULL);
 
   // /proc/[pid]/stat Field 24
   prom_process_resident_memory_bytes =
-      prom_gauge_new("process_resident_memory_bytes", "Resident memory size in bytes.", 0, NULL);
+      prom_gauge_new_int("process_resident_memory_bytes", "Resident memory size in bytes.", 0, NULL);
 
   prom_process_start_time_seconds =
       prom_gauge_new("process_start_time_seconds", "Start time of the process since unix epoch in seconds.", 0, NULL);
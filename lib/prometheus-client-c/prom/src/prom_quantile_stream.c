@@ -0,0 +1,160 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: Cormode, Korn, Muthukrishnan and Srivastava, "Effective Computation of Biased Quantiles over Data
+// Streams" (CKMS), with the targeted-quantile invariant. The batching follows github.com/beorn7/perks, which the Go
+// client uses for its summaries.
+
+#include <math.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_quantile_stream_i.h"
+#include "prom_quantile_stream_t.h"
+
+prom_quantile_stream_t *prom_quantile_stream_new(size_t target_count, const double *quantiles, const double *errors) {
+  prom_quantile_stream_t *self = (prom_quantile_stream_t *)prom_malloc(sizeof(prom_quantile_stream_t));
+  self->target_count = target_count;
+  self->quantiles = quantiles;
+  self->errors = errors;
+  self->n = 0.0;
+  self->items = NULL;
+  self->len = 0;
+  self->allocated = 0;
+  return self;
+}
+
+int prom_quantile_stream_destroy(prom_quantile_stream_t *self) {
+  if (self == NULL) return 0;
+  prom_free(self->items);
+  self->items = NULL;
+  prom_free(self);
+  self = NULL;
+  return 0;
+}
+
+void prom_quantile_stream_reset(prom_quantile_stream_t *self) {
+  PROM_ASSERT(self != NULL);
+  self->n = 0.0;
+  self->len = 0;
+}
+
+// The largest width plus delta a value at rank r may have while every targeted quantile stays within its error
+static double prom_quantile_stream_invariant(prom_quantile_stream_t *self, double r) {
+  double min = INFINITY;
+  for (size_t i = 0; i < self->target_count; i++) {
+    double q = self->quantiles[i];
+    double f = (q * self->n <= r) ? (2.0 * self->errors[i] * r) / q
+                                  : (2.0 * self->errors[i] * (self->n - r)) / (1.0 - q);
+    if (f < min) min = f;
+  }
+  return min;
+}
+
+// Merges neighbours from the top down while the invariant allows, keeping the result at the front of items
+static void prom_quantile_stream_compress(prom_quantile_stream_t *self) {
+  if (self->len < 2) return;
+
+  size_t kept = self->len - 1;
+  prom_quantile_sample_t *x = &self->items[kept];
+  double r = self->n - 1.0 - x->width;
+  for (size_t i = self->len - 1; i-- > 0;) {
+    prom_quantile_sample_t c = self->items[i];
+    if (c.width + x->width + x->delta <= prom_quantile_stream_invariant(self, r)) {
+      x->width += c.width;
+    } else {
+      kept--;
+      self->items[kept] = c;
+      x = &self->items[kept];
+    }
+    r -= c.width;
+  }
+  self->len -= kept;
+  memmove(self->items, &self->items[kept], self->len * sizeof(prom_quantile_sample_t));
+}
+
+int prom_quantile_stream_merge(prom_quantile_stream_t *self, const double *values, size_t count,
+                               prom_quantile_sample_t **scratch, size_t *scratch_allocated) {
+  PROM_ASSERT(self != NULL);
+  if (count == 0) return 0;
+
+  size_t needed = self->len + count;
+  if (*scratch_allocated < needed) {
+    size_t allocated = needed * 2;
+    prom_quantile_sample_t *grown =
+        (prom_quantile_sample_t *)prom_realloc(*scratch, allocated * sizeof(prom_quantile_sample_t));
+    if (grown == NULL) return 1;
+    *scratch = grown;
+    *scratch_allocated = allocated;
+  }
+
+  // A new value goes after every kept value that is not greater. Its delta is the rank uncertainty at that position,
+  // unless it lands past the last kept value, where the rank is known.
+  prom_quantile_sample_t *out = *scratch;
+  size_t len = 0;
+  size_t i = 0;
+  double r = 0.0;
+  for (size_t j = 0; j < count; j++) {
+    while (i < self->len && self->items[i].value <= values[j]) {
+      r += self->items[i].width;
+      out[len++] = self->items[i++];
+    }
+    double delta = 0.0;
+    if (i < self->len) {
+      delta = floor(prom_quantile_stream_invariant(self, r)) - 1.0;
+      if (delta < 0.0) delta = 0.0;
+    }
+    out[len].value = values[j];
+    out[len].width = 1.0;
+    out[len].delta = delta;
+    len++;
+    self->n += 1.0;
+    r += 1.0;
+  }
+  while (i < self->len) out[len++] = self->items[i++];
+
+  // The merged values become the sketch and the previous storage becomes the scratch buffer
+  prom_quantile_sample_t *previous = self->items;
+  size_t previous_allocated = self->allocated;
+  self->items = out;
+  self->allocated = *scratch_allocated;
+  *scratch = previous;
+  *scratch_allocated = previous_allocated;
+  self->len = len;
+  prom_quantile_stream_compress(self);
+  return 0;
+}
+
+double prom_quantile_stream_query(prom_quantile_stream_t *self, double q) {
+  PROM_ASSERT(self != NULL);
+  if (self->len == 0) return NAN;
+
+  double t = ceil(q * self->n);
+  t += ceil(prom_quantile_stream_invariant(self, t) / 2.0);
+  prom_quantile_sample_t *p = &self->items[0];
+  double r = 0.0;
+  for (size_t i = 1; i < self->len; i++) {
+    prom_quantile_sample_t *c = &self->items[i];
+    r += p->width;
+    if (r + c->width + c->delta > t) return p->value;
+    p = c;
+  }
+  return p->value;
+}
@@ -0,0 +1,58 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_QUANTILE_STREAM_I_H
+#define PROM_QUANTILE_STREAM_I_H
+
+#include <stddef.h>
+
+#include "prom_quantile_stream_t.h"
+
+/**
+ * @brief API PRIVATE Constructs an empty sketch for the given quantiles. The arrays MUST outlive the sketch.
+ */
+prom_quantile_stream_t *prom_quantile_stream_new(size_t target_count, const double *quantiles, const double *errors);
+
+/**
+ * @brief API PRIVATE Destroys a sketch
+ */
+int prom_quantile_stream_destroy(prom_quantile_stream_t *self);
+
+/**
+ * @brief API PRIVATE Forgets every observation, keeping the allocated memory
+ */
+void prom_quantile_stream_reset(prom_quantile_stream_t *self);
+
+/**
+ * @brief API PRIVATE Merges a batch of observations into the sketch and compresses it.
+ *
+ * @param values The observations, sorted in ascending order
+ * @param count The number of observations
+ * @param scratch A buffer the merge may grow and write to; on return it holds the previous storage of the sketch, so
+ *                one scratch buffer can serve several sketches
+ * @param scratch_allocated The capacity of *scratch
+ * @return A non-zero integer value upon failure
+ */
+int prom_quantile_stream_merge(prom_quantile_stream_t *self, const double *values, size_t count,
+                               prom_quantile_sample_t **scratch, size_t *scratch_allocated);
+
+/**
+ * @brief API PRIVATE Returns the estimate of quantile q, which should be one of the targeted quantiles, or NaN if the
+ * sketch holds no observations
+ */
+double prom_quantile_stream_query(prom_quantile_stream_t *self, double q);
+
+#endif  // PROM_QUANTILE_STREAM_I_H
@@ -0,0 +1,46 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_QUANTILE_STREAM_T_H
+#define PROM_QUANTILE_STREAM_T_H
+
+#include <stddef.h>
+
+/**
+ * @brief API PRIVATE A value kept by the sketch. width is the number of observations it stands for, and delta bounds
+ * how far its rank may be from the rank the sketch assumes.
+ */
+typedef struct prom_quantile_sample {
+  double value;
+  double width;
+  double delta;
+} prom_quantile_sample_t;
+
+struct prom_quantile_stream {
+  size_t target_count;            /**< the number of targeted quantiles */
+  const double *quantiles;        /**< the targeted quantiles, owned by the caller */
+  const double *errors;           /**< the allowed rank error of each quantile, owned by the caller */
+  double n;                       /**< the number of observations merged */
+  prom_quantile_sample_t *items;  /**< the kept values, sorted */
+  size_t len;                     /**< the number of kept values */
+  size_t allocated;               /**< the capacity of items */
+};
+/**
+ * @brief API PRIVATE A biased quantile sketch that answers the targeted quantiles within their error in bounded memory
+ */
+typedef struct prom_quantile_stream prom_quantile_stream_t;
+
+#endif  // PROM_QUANTILE_STREAM_T_H
@@ -0,0 +1,170 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_render_pool_i.h"
+#include "prom_render_pool_t.h"
+
+static void *prom_render_pool_work(void *arg);
+
+prom_render_pool_t *prom_render_pool_new(size_t thread_count) {
+  PROM_ASSERT(thread_count > 0);
+  if (thread_count == 0) return NULL;
+
+  prom_render_pool_t *self = (prom_render_pool_t *)prom_malloc(sizeof(prom_render_pool_t));
+  self->lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  self->work = (pthread_cond_t *)prom_malloc(sizeof(pthread_cond_t));
+  self->done = (pthread_cond_t *)prom_malloc(sizeof(pthread_cond_t));
+  self->head = NULL;
+  self->stopping = false;
+  self->thread_count = 0;
+  self->threads = (pthread_t *)prom_malloc(thread_count * sizeof(pthread_t));
+  if (pthread_mutex_init(self->lock, NULL) || pthread_cond_init(self->work, NULL) ||
+      pthread_cond_init(self->done, NULL)) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+    prom_free(self->threads);
+    prom_free(self->done);
+    prom_free(self->work);
+    prom_free(self->lock);
+    prom_free(self);
+    return NULL;
+  }
+  for (size_t i = 0; i < thread_count; i++) {
+    if (pthread_create(&self->threads[i], NULL, &prom_render_pool_work, self)) {
+      prom_render_pool_destroy(self);
+      return NULL;
+    }
+    self->thread_count++;
+  }
+  return self;
+}
+
+int prom_render_pool_destroy(prom_render_pool_t *self) {
+  if (self == NULL) return 0;
+
+  int r = 0;
+  int ret = 0;
+
+  pthread_mutex_lock(self->lock);
+  self->stopping = true;
+  pthread_cond_broadcast(self->work);
+  pthread_mutex_unlock(self->lock);
+  for (size_t i = 0; i < self->thread_count; i++) {
+    r = pthread_join(self->threads[i], NULL);
+    if (r) ret = r;
+  }
+  prom_free(self->threads);
+  self->threads = NULL;
+
+  r = pthread_cond_destroy(self->done);
+  if (r) ret = r;
+  prom_free(self->done);
+  self->done = NULL;
+  r = pthread_cond_destroy(self->work);
+  if (r) ret = r;
+  prom_free(self->work);
+  self->work = NULL;
+  r = pthread_mutex_destroy(self->lock);
+  if (r) ret = r;
+  prom_free(self->lock);
+  self->lock = NULL;
+
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+// Hands out the next job of batch; call with the lock held
+static size_t prom_render_pool_take(prom_render_pool_t *self, prom_render_batch_t *batch) {
+  size_t index = batch->next++;
+  if (batch->next < batch->count) return index;
+
+  // The last job is out, so no other thread needs to find the batch
+  prom_render_batch_t **link = &self->head;
+  while (*link != batch) link = &(*link)->next_batch;
+  *link = batch->next_batch;
+  return index;
+}
+
+// Records that a job of batch returned result; call with the lock held. batch MUST NOT be used afterwards because the
+// thread that queued it may return as soon as its last job is finished.
+static void prom_render_pool_finish(prom_render_pool_t *self, prom_render_batch_t *batch, int result) {
+  if (result && !batch->result) batch->result = result;
+  if (++batch->finished == batch->count) pthread_cond_broadcast(self->done);
+}
+
+static void *prom_render_pool_work(void *arg) {
+  prom_render_pool_t *self = (prom_render_pool_t *)arg;
+
+  pthread_mutex_lock(self->lock);
+  for (;;) {
+    while (self->head == NULL && !self->stopping) pthread_cond_wait(self->work, self->lock);
+    if (self->head == NULL) break;
+
+    prom_render_batch_t *batch = self->head;
+    size_t index = prom_render_pool_take(self, batch);
+    pthread_mutex_unlock(self->lock);
+    int r = batch->fn(batch->data, index);
+    pthread_mutex_lock(self->lock);
+    prom_render_pool_finish(self, batch, r);
+  }
+  pthread_mutex_unlock(self->lock);
+  return NULL;
+}
+
+int prom_render_pool_run(prom_render_pool_t *self, prom_render_job_fn *fn, void *data, size_t count) {
+  int r = 0;
+
+  if (self == NULL || count < 2) {
+    for (size_t i = 0; i < count; i++) {
+      int rr = fn(data, i);
+      if (rr && !r) r = rr;
+    }
+    return r;
+  }
+
+  prom_render_batch_t batch = {fn, data, count, 0, 0, 0, NULL};
+
+  r = pthread_mutex_lock(self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+  prom_render_batch_t **link = &self->head;
+  while (*link != NULL) link = &(*link)->next_batch;
+  *link = &batch;
+  pthread_cond_broadcast(self->work);
+
+  // Run jobs of this batch rather than wait idle for the pool
+  while (batch.next < batch.count) {
+    size_t index = prom_render_pool_take(self, &batch);
+    pthread_mutex_unlock(self->lock);
+    int rr = fn(data, index);
+    pthread_mutex_lock(self->lock);
+    prom_render_pool_finish(self, &batch, rr);
+  }
+  while (batch.finished < batch.count) pthread_cond_wait(self->done, self->lock);
+  pthread_mutex_unlock(self->lock);
+  return batch.result;
+}
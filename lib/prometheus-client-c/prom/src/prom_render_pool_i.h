@@ -0,0 +1,43 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_RENDER_POOL_I_H
+#define PROM_RENDER_POOL_I_H
+
+#include "prom_render_pool_t.h"
+
+/**
+ * @brief API PRIVATE Starts thread_count threads
+ * @return The pool, or NULL upon failure
+ */
+prom_render_pool_t *prom_render_pool_new(size_t thread_count);
+
+/**
+ * @brief API PRIVATE Lets the threads finish the queued jobs, joins them and frees the pool
+ */
+int prom_render_pool_destroy(prom_render_pool_t *self);
+
+/**
+ * @brief API PRIVATE Runs jobs 0 through count - 1 of fn and returns once all of them are done.
+ *
+ * The calling thread runs jobs of the batch too, so a batch never waits for a busy pool alone. If self is NULL every
+ * job runs on the calling thread.
+ *
+ * @return The first non-zero result of a job, or 0
+ */
+int prom_render_pool_run(prom_render_pool_t *self, prom_render_job_fn *fn, void *data, size_t count);
+
+#endif  // PROM_RENDER_POOL_I_H
@@ -0,0 +1,57 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_RENDER_POOL_T_H
+#define PROM_RENDER_POOL_T_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief API PRIVATE A job of a batch; index is the position of the job in its batch
+ * @return A non-zero integer value upon failure
+ */
+typedef int prom_render_job_fn(void *data, size_t index);
+
+/**
+ * @brief API PRIVATE Jobs 0 through count - 1 of fn, queued by prom_render_pool_run
+ */
+typedef struct prom_render_batch {
+  prom_render_job_fn *fn;
+  void *data;
+  size_t count;                         /**< the number of jobs */
+  size_t next;                          /**< the next job to hand out */
+  size_t finished;                      /**< the number of jobs done */
+  int result;                           /**< the first non-zero result of a job */
+  struct prom_render_batch *next_batch; /**< the next batch with jobs left to hand out */
+} prom_render_batch_t;
+
+struct prom_render_pool {
+  pthread_mutex_t *lock;     /**< guards everything below but threads */
+  pthread_cond_t *work;      /**< signalled when a batch is queued or the pool stops */
+  pthread_cond_t *done;      /**< signalled when a batch finished */
+  prom_render_batch_t *head; /**< batches with jobs left to hand out, oldest first */
+  bool stopping;             /**< set by prom_render_pool_destroy */
+  size_t thread_count;
+  pthread_t *threads;
+};
+/**
+ * @brief API PRIVATE A fixed set of threads that run the jobs of batches
+ */
+typedef struct prom_render_pool prom_render_pool_t;
+
+#endif  // PROM_RENDER_POOL_T_H
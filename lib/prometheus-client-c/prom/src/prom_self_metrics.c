@@ -0,0 +1,190 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <time.h>
+
+// Public
+#include "prom_alloc.h"
+#include "prom_counter.h"
+#include "prom_histogram.h"
+#include "prom_histogram_buckets.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_collector_registry_t.h"
+#include "prom_collector_t.h"
+#include "prom_linked_list_t.h"
+#include "prom_log.h"
+#include "prom_map_i.h"
+#include "prom_metric_i.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_t.h"
+#include "prom_self_metrics_i.h"
+
+#define PROM_SELF_METRICS_SCRAPES "prom_scrapes_total"
+#define PROM_SELF_METRICS_SCRAPE_DURATION "prom_scrape_duration_seconds"
+#define PROM_SELF_METRICS_SCRAPE_BYTES "prom_scrape_bytes_total"
+#define PROM_SELF_METRICS_RENDER_SECONDS "prom_collector_render_seconds_total"
+#define PROM_SELF_METRICS_ERRORS "prom_collector_errors_total"
+#define PROM_SELF_METRICS_SERIES_DROPPED "prom_metric_series_dropped_total"
+#define PROM_SELF_METRICS_SERIES_EVICTED "prom_metric_series_evicted_total"
+
+static const double prom_self_metrics_bounds[PROM_SELF_METRICS_BUCKET_COUNT] = {PROM_SELF_METRICS_BUCKETS};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t prom_self_metrics_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void prom_self_metrics_observe_scrape(prom_scrape_stats_t *stats, double seconds, size_t bytes) {
+  size_t bucket = 0;
+  while (bucket < PROM_SELF_METRICS_BUCKET_COUNT && seconds > prom_self_metrics_bounds[bucket]) bucket++;
+
+  // Relaxed ordering is enough: the counters are read independently of each other when collected
+  atomic_fetch_add_explicit(&stats->buckets[bucket], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&stats->nanoseconds, (unsigned long long)(seconds * 1e9), memory_order_relaxed);
+  atomic_fetch_add_explicit(&stats->bytes, bytes, memory_order_relaxed);
+  atomic_fetch_add_explicit(&stats->count, 1, memory_order_relaxed);
+}
+
+void prom_self_metrics_observe_render(prom_collector_t *collector, uint64_t nanoseconds, bool failed) {
+  atomic_fetch_add_explicit(&collector->render_nanoseconds, nanoseconds, memory_order_relaxed);
+  if (failed) atomic_fetch_add_explicit(&collector->errors, 1, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Collection
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Counters only go through prom_counter_inc and prom_counter_add, so copy the recorded totals into the sample directly
+static int prom_self_metrics_store(prom_metric_t *metric, const char **label_values, double value) {
+  if (metric == NULL) return 1;
+  prom_metric_sample_t *sample = prom_metric_sample_acquire(metric, label_values);
+  if (sample == NULL) return 1;
+  atomic_store(&sample->r_value, value);
+  prom_metric_sample_release(metric);
+  return 0;
+}
+
+static prom_map_t *prom_self_metrics_collect(prom_collector_t *self) {
+  int r = 0;
+  prom_collector_registry_t *registry = self->registry;
+  prom_scrape_stats_t *stats = &registry->scrape_stats;
+
+  unsigned long long counts[PROM_SELF_METRICS_BUCKET_COUNT + 1];
+  for (size_t i = 0; i <= PROM_SELF_METRICS_BUCKET_COUNT; i++) {
+    counts[i] = atomic_load_explicit(&stats->buckets[i], memory_order_relaxed);
+  }
+  double seconds = (double)atomic_load_explicit(&stats->nanoseconds, memory_order_relaxed) / 1e9;
+
+  prom_metric_t *duration = (prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_SCRAPE_DURATION);
+  if (duration == NULL) return NULL;
+  prom_metric_sample_histogram_t *histogram = prom_metric_sample_histogram_acquire(duration, NULL);
+  if (histogram == NULL) return NULL;
+  r = prom_metric_sample_histogram_load(histogram, counts, seconds);
+  prom_metric_sample_release(duration);
+  if (r) return NULL;
+
+  r = prom_self_metrics_store((prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_SCRAPES), NULL,
+                              (double)atomic_load_explicit(&stats->count, memory_order_relaxed));
+  if (r) return NULL;
+  r = prom_self_metrics_store((prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_SCRAPE_BYTES), NULL,
+                              (double)atomic_load_explicit(&stats->bytes, memory_order_relaxed));
+  if (r) return NULL;
+
+  prom_metric_t *render_seconds = (prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_RENDER_SECONDS);
+  prom_metric_t *errors = (prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_ERRORS);
+  for (prom_linked_list_node_t *node = registry->collectors->keys->head; node != NULL; node = node->next) {
+    const char *name = (const char *)node->item;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(registry->collectors, name);
+    if (collector == NULL) continue;
+    const char *label_values[] = {name};
+    r = prom_self_metrics_store(
+        render_seconds, label_values,
+        (double)atomic_load_explicit(&collector->render_nanoseconds, memory_order_relaxed) / 1e9);
+    if (r) return NULL;
+    r = prom_self_metrics_store(errors, label_values,
+                                (double)atomic_load_explicit(&collector->errors, memory_order_relaxed));
+    if (r) return NULL;
+  }
+
+  // Only metrics with limits can drop or evict series, so the others would only add zeros to the page
+  prom_metric_t *dropped = (prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_SERIES_DROPPED);
+  prom_metric_t *evicted = (prom_metric_t *)prom_map_get(self->metrics, PROM_SELF_METRICS_SERIES_EVICTED);
+  for (prom_linked_list_node_t *node = registry->collectors->keys->head; node != NULL; node = node->next) {
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(registry->collectors, (const char *)node->item);
+    if (collector == NULL) continue;
+    for (prom_linked_list_node_t *metric_node = collector->metrics->keys->head; metric_node != NULL;
+         metric_node = metric_node->next) {
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(collector->metrics, (const char *)metric_node->item);
+      if (metric == NULL || (metric->max_series == 0 && metric->ttl == 0)) continue;
+      const char *label_values[] = {metric->name};
+      r = prom_self_metrics_store(dropped, label_values,
+                                  (double)atomic_load_explicit(&metric->dropped_series, memory_order_relaxed));
+      if (r) return NULL;
+      r = prom_self_metrics_store(evicted, label_values,
+                                  (double)atomic_load_explicit(&metric->evicted_series, memory_order_relaxed));
+      if (r) return NULL;
+    }
+  }
+  return self->metrics;
+}
+
+prom_collector_t *prom_self_metrics_collector_new(prom_collector_registry_t *registry) {
+  PROM_ASSERT(registry != NULL);
+  if (registry == NULL) return NULL;
+
+  prom_collector_t *self = prom_collector_new("self");
+  if (self == NULL) return NULL;
+  self->registry = registry;
+  self->collect_fn = &prom_self_metrics_collect;
+
+  const char *collector_keys[] = {"collector"};
+  const char *metric_keys[] = {"metric"};
+  prom_metric_t *metrics[] = {
+      prom_counter_new(PROM_SELF_METRICS_SCRAPES, "Scrapes of the registry.", 0, NULL),
+      prom_histogram_new(PROM_SELF_METRICS_SCRAPE_DURATION, "Seconds spent rendering and compressing scrapes.",
+                         prom_histogram_buckets_new(PROM_SELF_METRICS_BUCKET_COUNT, PROM_SELF_METRICS_BUCKETS), 0,
+                         NULL),
+      prom_counter_new(PROM_SELF_METRICS_SCRAPE_BYTES, "Bytes rendered by scrapes before compression.", 0, NULL),
+      prom_counter_new(PROM_SELF_METRICS_RENDER_SECONDS, "Seconds spent collecting and rendering each collector.", 1,
+                       collector_keys),
+      prom_counter_new(PROM_SELF_METRICS_ERRORS, "Failures to collect or render each collector.", 1, collector_keys),
+      prom_counter_new(PROM_SELF_METRICS_SERIES_DROPPED, "Updates dropped because a metric held its series limit.", 1,
+                       metric_keys),
+      prom_counter_new(PROM_SELF_METRICS_SERIES_EVICTED, "Series evicted because they outlived their metric's TTL.", 1,
+                       metric_keys),
+  };
+  int r = 0;
+  for (size_t i = 0; i < sizeof(metrics) / sizeof(metrics[0]); i++) {
+    if (!r && metrics[i] != NULL && !prom_collector_add_metric(self, metrics[i])) continue;
+    // Metrics the collector did not take are not freed with it
+    r = 1;
+    if (metrics[i] != NULL) prom_metric_destroy(metrics[i]);
+  }
+  if (r) {
+    prom_collector_destroy(self);
+    return NULL;
+  }
+  return self;
+}
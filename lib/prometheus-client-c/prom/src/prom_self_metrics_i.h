@@ -0,0 +1,51 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_SELF_METRICS_I_H
+#define PROM_SELF_METRICS_I_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Public
+#include "prom_collector.h"
+#include "prom_collector_registry.h"
+
+// Private
+#include "prom_self_metrics_t.h"
+
+/**
+ * @brief API PRIVATE Returns CLOCK_MONOTONIC in nanoseconds
+ */
+uint64_t prom_self_metrics_now(void);
+
+/**
+ * @brief API PRIVATE Records a scrape of the registry owning stats
+ */
+void prom_self_metrics_observe_scrape(prom_scrape_stats_t *stats, double seconds, size_t bytes);
+
+/**
+ * @brief API PRIVATE Records the time spent collecting and rendering collector, and whether it failed
+ */
+void prom_self_metrics_observe_render(prom_collector_t *collector, uint64_t nanoseconds, bool failed);
+
+/**
+ * @brief API PRIVATE Constructs the collector that exposes the scrape statistics of registry and the render time and
+ * errors of each of its collectors
+ */
+prom_collector_t *prom_self_metrics_collector_new(prom_collector_registry_t *registry);
+
+#endif  // PROM_SELF_METRICS_I_H
@@ -0,0 +1,40 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_SELF_METRICS_T_H
+#define PROM_SELF_METRICS_T_H
+
+#include <stdatomic.h>
+
+// The upper bounds of prom_scrape_duration_seconds, in seconds
+#define PROM_SELF_METRICS_BUCKETS 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0
+#define PROM_SELF_METRICS_BUCKET_COUNT 12
+
+/**
+ * @brief API PRIVATE Scrape statistics of a registry.
+ *
+ * Recording only touches these counters with atomic read-modify-write operations, so observing a scrape never takes a
+ * lock or allocates. They are copied into the metrics of the self collector when it is collected.
+ */
+typedef struct prom_scrape_stats {
+  atomic_ullong count;       /**< the number of scrapes */
+  atomic_ullong nanoseconds; /**< their summed duration */
+  atomic_ullong bytes;       /**< the bytes they rendered */
+  // Scrapes per duration bucket, not cumulative. The last one counts scrapes slower than every bound.
+  atomic_ullong buckets[PROM_SELF_METRICS_BUCKET_COUNT + 1];
+} prom_scrape_stats_t;
+
+#endif  // PROM_SELF_METRICS_T_H
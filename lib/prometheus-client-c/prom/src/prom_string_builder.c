@@ -21,6 +21,7 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_dtoa_i.h"
 #include "prom_string_builder_i.h"
 #include "prom_string_builder_t.h"
 
@@ -117,6 +118,66 @@ int prom_string_builder_add_char(prom_string_builder_t *self, char c) {
   return 0;
 }
 
+int prom_string_builder_add_bytes(prom_string_builder_t *self, const void *bytes, size_t len) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  if (self == NULL) return 1;
+  if (len == 0) return 0;
+  r = prom_string_builder_ensure_space(self, len);
+  if (r) return r;
+
+  memcpy(self->str + self->len, bytes, len);
+  self->len += len;
+  self->str[self->len] = '\0';
+  return 0;
+}
+
+int prom_string_builder_add_double(prom_string_builder_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  if (self == NULL) return 1;
+  r = prom_string_builder_ensure_space(self, PROM_DTOA_BUFFER_SIZE);
+  if (r) return r;
+
+  self->len += prom_dtoa(value, self->str + self->len);
+  self->str[self->len] = '\0';
+  return 0;
+}
+
+int prom_string_builder_add_int64(prom_string_builder_t *self, int64_t value) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  if (self == NULL) return 1;
+  r = prom_string_builder_ensure_space(self, PROM_DTOA_BUFFER_SIZE);
+  if (r) return r;
+
+  self->len += prom_itoa(value, self->str + self->len);
+  self->str[self->len] = '\0';
+  return 0;
+}
+
+int prom_string_builder_replace(prom_string_builder_t *self, size_t pos, size_t old_len, const void *bytes,
+                                size_t len) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  if (self == NULL) return 1;
+  if (pos + old_len > self->len) return 1;
+  if (len > old_len) {
+    r = prom_string_builder_ensure_space(self, len - old_len);
+    if (r) return r;
+  }
+
+  // Shift the tail, including the terminating null byte, then write the replacement in the gap
+  memmove(self->str + pos + len, self->str + pos + old_len, self->len - pos - old_len + 1);
+  memcpy(self->str + pos, bytes, len);
+  self->len = self->len - old_len + len;
+  return 0;
+}
+
 int prom_string_builder_truncate(prom_string_builder_t *self, size_t len) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
@@ -129,9 +190,19 @@ int prom_string_builder_truncate(prom_string_builder_t *self, size_t len) {
 
 int prom_string_builder_clear(prom_string_builder_t *self) {
   PROM_ASSERT(self != NULL);
-  prom_free(self->str);
-  self->str = NULL;
-  return prom_string_builder_init(self);
+  if (self == NULL) return 1;
+  // Keep the allocation. Builders are refilled with strings of similar length, so releasing the buffer here would
+  // only cause it to be regrown by repeated reallocs.
+  self->len = 0;
+  self->str[0] = '\0';
+  return 0;
+}
+
+int prom_string_builder_reserve(prom_string_builder_t *self, size_t len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (len <= self->len) return 0;
+  return prom_string_builder_ensure_space(self, len - self->len);
 }
 
 size_t prom_string_builder_len(prom_string_builder_t *self) {
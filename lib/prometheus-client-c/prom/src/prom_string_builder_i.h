@@ -18,6 +18,7 @@
 #define PROM_STRING_BUILDER_I_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "prom_string_builder_t.h"
 
@@ -47,10 +48,41 @@ int prom_string_builder_add_char(prom_string_builder_t *self, char c);
 
 /**
  * API PRIVATE
- * @brief Clear the string
+ * @brief Adds len bytes, which may include null bytes
+ */
+int prom_string_builder_add_bytes(prom_string_builder_t *self, const void *bytes, size_t len);
+
+/**
+ * API PRIVATE
+ * @brief Adds the shortest decimal representation of a finite double, see prom_dtoa
+ */
+int prom_string_builder_add_double(prom_string_builder_t *self, double value);
+
+/**
+ * API PRIVATE
+ * @brief Adds value in decimal, see prom_itoa
+ */
+int prom_string_builder_add_int64(prom_string_builder_t *self, int64_t value);
+
+/**
+ * API PRIVATE
+ * @brief Replaces the old_len bytes at pos with len bytes, shifting whatever follows
+ */
+int prom_string_builder_replace(prom_string_builder_t *self, size_t pos, size_t old_len, const void *bytes,
+                                size_t len);
+
+/**
+ * API PRIVATE
+ * @brief Clear the string. The allocation is retained for reuse.
  */
 int prom_string_builder_clear(prom_string_builder_t *self);
 
+/**
+ * API PRIVATE
+ * @brief Grow the allocation so the string can reach len bytes without reallocating
+ */
+int prom_string_builder_reserve(prom_string_builder_t *self, size_t len);
+
 /**
  * API PRIVATE
  * @brief Remove data from the end
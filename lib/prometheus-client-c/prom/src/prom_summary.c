@@ -0,0 +1,85 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Public
+#include "prom_summary.h"
+
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_metric_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_t.h"
+
+// The window and the rotations other Prometheus clients default to
+#define PROM_SUMMARY_DEFAULT_MAX_AGE 600.0
+#define PROM_SUMMARY_DEFAULT_AGE_BUCKETS 5
+
+prom_summary_t *prom_summary_new(const char *name, const char *help, size_t quantile_count, const double *quantiles,
+                                 const double *errors, double max_age, size_t age_buckets, size_t label_key_count,
+                                 const char **label_keys) {
+  if (max_age == 0.0) max_age = PROM_SUMMARY_DEFAULT_MAX_AGE;
+  if (age_buckets == 0) age_buckets = PROM_SUMMARY_DEFAULT_AGE_BUCKETS;
+  prom_summary_config_t *config = prom_summary_config_new(quantile_count, quantiles, errors, max_age, age_buckets);
+  if (config == NULL) return NULL;
+
+  prom_summary_t *self = (prom_summary_t *)prom_metric_new(PROM_SUMMARY, name, help, label_key_count, label_keys);
+  if (self == NULL) {
+    prom_summary_config_destroy(config);
+    return NULL;
+  }
+  self->summary_config = config;
+  return self;
+}
+
+int prom_summary_destroy(prom_summary_t *self) {
+  PROM_ASSERT(self != NULL);
+
+  int r = 0;
+
+  if (self == NULL) return r;
+  r = prom_metric_destroy(self);
+  if (r) return r;
+  self = NULL;
+  return r;
+}
+
+int prom_summary_observe(prom_summary_t *self, double value, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_SUMMARY) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  prom_metric_sample_summary_t *s_sample = prom_metric_sample_summary_acquire(self, label_values);
+  if (s_sample == NULL) return 1;
+  int r = prom_metric_sample_summary_observe(s_sample, value);
+  prom_metric_sample_release(self);
+  return r;
+}
+
+prom_metric_sample_summary_t *prom_summary_labels(prom_summary_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_SUMMARY) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return prom_metric_sample_summary_from_labels(self, label_values);
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_sweeper_i.h"
+#include "prom_sweeper_t.h"
+
+static void *prom_sweeper_work(void *arg);
+
+prom_sweeper_t *prom_sweeper_new(prom_collector_registry_t *registry, uint64_t interval) {
+  PROM_ASSERT(registry != NULL);
+  if (registry == NULL || interval == 0) return NULL;
+
+  prom_sweeper_t *self = (prom_sweeper_t *)prom_malloc(sizeof(prom_sweeper_t));
+  self->registry = registry;
+  self->interval = interval;
+  self->lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  self->wake = (pthread_cond_t *)prom_malloc(sizeof(pthread_cond_t));
+  self->stopping = false;
+
+  // The wait deadline is on the monotonic clock so that setting the wall clock neither delays nor hurries sweeps
+  pthread_condattr_t attr;
+  int r = pthread_condattr_init(&attr);
+  if (!r) r = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  if (!r) r = pthread_cond_init(self->wake, &attr);
+  pthread_condattr_destroy(&attr);
+  if (r || pthread_mutex_init(self->lock, NULL)) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+    if (!r) pthread_cond_destroy(self->wake);
+    prom_free(self->wake);
+    prom_free(self->lock);
+    prom_free(self);
+    return NULL;
+  }
+  if (pthread_create(&self->thread, NULL, &prom_sweeper_work, self)) {
+    pthread_mutex_destroy(self->lock);
+    pthread_cond_destroy(self->wake);
+    prom_free(self->wake);
+    prom_free(self->lock);
+    prom_free(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_sweeper_destroy(prom_sweeper_t *self) {
+  if (self == NULL) return 0;
+
+  int r = 0;
+  int ret = 0;
+
+  pthread_mutex_lock(self->lock);
+  self->stopping = true;
+  pthread_cond_signal(self->wake);
+  pthread_mutex_unlock(self->lock);
+  r = pthread_join(self->thread, NULL);
+  if (r) ret = r;
+
+  r = pthread_cond_destroy(self->wake);
+  if (r) ret = r;
+  prom_free(self->wake);
+  self->wake = NULL;
+  r = pthread_mutex_destroy(self->lock);
+  if (r) ret = r;
+  prom_free(self->lock);
+  self->lock = NULL;
+
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+static void *prom_sweeper_work(void *arg) {
+  prom_sweeper_t *self = (prom_sweeper_t *)arg;
+
+  pthread_mutex_lock(self->lock);
+  while (!self->stopping) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t ns = (uint64_t)deadline.tv_nsec + self->interval;
+    deadline.tv_sec += (time_t)(ns / 1000000000);
+    deadline.tv_nsec = (long)(ns % 1000000000);
+
+    int r = 0;
+    while (!self->stopping && r == 0) r = pthread_cond_timedwait(self->wake, self->lock, &deadline);
+    if (self->stopping) break;
+
+    pthread_mutex_unlock(self->lock);
+    prom_collector_registry_sweep(self->registry);
+    pthread_mutex_lock(self->lock);
+  }
+  pthread_mutex_unlock(self->lock);
+  return NULL;
+}
@@ -0,0 +1,39 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_SWEEPER_I_H
+#define PROM_SWEEPER_I_H
+
+#include <stdint.h>
+
+// Public
+#include "prom_collector_registry.h"
+
+// Private
+#include "prom_sweeper_t.h"
+
+/**
+ * @brief API PRIVATE Starts a thread that calls prom_collector_registry_sweep every interval nanoseconds
+ * @return The sweeper, or NULL upon failure
+ */
+prom_sweeper_t *prom_sweeper_new(prom_collector_registry_t *registry, uint64_t interval);
+
+/**
+ * @brief API PRIVATE Stops and joins the thread and frees the sweeper
+ */
+int prom_sweeper_destroy(prom_sweeper_t *self);
+
+#endif  // PROM_SWEEPER_I_H
@@ -0,0 +1,40 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_SWEEPER_T_H
+#define PROM_SWEEPER_T_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Public
+#include "prom_collector_registry.h"
+
+struct prom_sweeper {
+  prom_collector_registry_t *registry; /**< the registry swept */
+  uint64_t interval;                   /**< nanoseconds between sweeps */
+  pthread_mutex_t *lock;               /**< guards stopping */
+  pthread_cond_t *wake;                /**< signalled when the sweeper stops */
+  bool stopping;                       /**< set by prom_sweeper_destroy */
+  pthread_t thread;
+};
+/**
+ * @brief API PRIVATE A thread that sweeps the series of a registry at an interval
+ */
+typedef struct prom_sweeper prom_sweeper_t;
+
+#endif  // PROM_SWEEPER_T_H
@@ -0,0 +1,127 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_trie_i.h"
+#include "prom_trie_t.h"
+
+static prom_trie_node_t *prom_trie_node_new(char c) {
+  prom_trie_node_t *self = (prom_trie_node_t *)prom_malloc(sizeof(prom_trie_node_t));
+  self->c = c;
+  self->value = NULL;
+  self->child = NULL;
+  self->sibling = NULL;
+  return self;
+}
+
+static void prom_trie_node_destroy(prom_trie_node_t *self) {
+  while (self != NULL) {
+    prom_trie_node_t *sibling = self->sibling;
+    prom_trie_node_destroy(self->child);
+    prom_free(self);
+    self = sibling;
+  }
+}
+
+prom_trie_t *prom_trie_new(void) {
+  prom_trie_t *self = (prom_trie_t *)prom_malloc(sizeof(prom_trie_t));
+  self->root = prom_trie_node_new('\0');
+  self->size = 0;
+  return self;
+}
+
+int prom_trie_destroy(prom_trie_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+  prom_trie_node_destroy(self->root);
+  self->root = NULL;
+  prom_free(self);
+  self = NULL;
+  return 0;
+}
+
+/**
+ * @brief Returns the child of node reached by c, creating it in sorted position if create is true
+ */
+static prom_trie_node_t *prom_trie_node_child(prom_trie_node_t *node, char c, bool create) {
+  prom_trie_node_t **link = &node->child;
+  while (*link != NULL && (unsigned char)(*link)->c < (unsigned char)c) link = &(*link)->sibling;
+  if (*link != NULL && (*link)->c == c) return *link;
+  if (!create) return NULL;
+
+  prom_trie_node_t *child = prom_trie_node_new(c);
+  child->sibling = *link;
+  *link = child;
+  return child;
+}
+
+static prom_trie_node_t *prom_trie_find(prom_trie_t *self, const char *key, size_t len) {
+  prom_trie_node_t *node = self->root;
+  for (size_t i = 0; i < len && node != NULL; i++) node = prom_trie_node_child(node, key[i], false);
+  return node;
+}
+
+int prom_trie_set(prom_trie_t *self, const char *key, void *value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || key == NULL || value == NULL) return 1;
+
+  prom_trie_node_t *node = self->root;
+  for (const char *p = key; *p != '\0'; p++) node = prom_trie_node_child(node, *p, true);
+  if (node->value == NULL) self->size++;
+  node->value = value;
+  return 0;
+}
+
+void *prom_trie_get(prom_trie_t *self, const char *key) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || key == NULL) return NULL;
+
+  prom_trie_node_t *node = prom_trie_find(self, key, strlen(key));
+  return node == NULL ? NULL : node->value;
+}
+
+static int prom_trie_node_visit(prom_trie_node_t *node, prom_trie_visit_fn fn, void *data) {
+  int r = 0;
+  if (node->value != NULL) {
+    r = (*fn)(node->value, data);
+    if (r) return r;
+  }
+  for (prom_trie_node_t *child = node->child; child != NULL; child = child->sibling) {
+    r = prom_trie_node_visit(child, fn, data);
+    if (r) return r;
+  }
+  return 0;
+}
+
+int prom_trie_visit_prefix(prom_trie_t *self, const char *prefix, size_t prefix_len, prom_trie_visit_fn fn,
+                           void *data) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || prefix == NULL) return 1;
+
+  // Only the subtree below the prefix is walked
+  prom_trie_node_t *node = prom_trie_find(self, prefix, prefix_len);
+  if (node == NULL) return 0;
+  return prom_trie_node_visit(node, fn, data);
+}
@@ -0,0 +1,53 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PROM_TRIE_I_H
+#define PROM_TRIE_I_H
+
+// Private
+#include "prom_trie_t.h"
+
+/**
+ * @brief API PRIVATE Constructor for prom_trie
+ */
+prom_trie_t *prom_trie_new(void);
+
+/**
+ * @brief API PRIVATE Destroys a prom_trie. Values are not freed.
+ */
+int prom_trie_destroy(prom_trie_t *self);
+
+/**
+ * @brief API PRIVATE Sets the value of key, replacing any previous value
+ * @param value Must not be NULL
+ */
+int prom_trie_set(prom_trie_t *self, const char *key, void *value);
+
+/**
+ * @brief API PRIVATE Returns the value of key or NULL if not present
+ */
+void *prom_trie_get(prom_trie_t *self, const char *key);
+
+/**
+ * @brief API PRIVATE Calls fn for the value of every key starting with the first prefix_len bytes of prefix, in key
+ * order
+ * @return The first non-zero value returned by fn, or 0
+ */
+int prom_trie_visit_prefix(prom_trie_t *self, const char *prefix, size_t prefix_len, prom_trie_visit_fn fn,
+                           void *data);
+
+#endif  // PROM_TRIE_I_H
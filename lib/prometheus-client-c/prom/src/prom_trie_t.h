@@ -0,0 +1,46 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PROM_TRIE_T_H
+#define PROM_TRIE_T_H
+
+#include <stddef.h>
+
+/**
+ * @brief API PRIVATE Called for every value found by prom_trie_visit_prefix. A non-zero return stops the visit.
+ */
+typedef int (*prom_trie_visit_fn)(void *value, void *data);
+
+/**
+ * @brief API PRIVATE A trie node. Children are kept in a sibling list sorted by byte so visits run in key order.
+ */
+typedef struct prom_trie_node {
+  char c;                         /**< the byte on the edge into this node */
+  void *value;                    /**< the value of the key ending at this node, or NULL */
+  struct prom_trie_node *child;   /**< the first child */
+  struct prom_trie_node *sibling; /**< the next child of the parent */
+} prom_trie_node_t;
+
+/**
+ * @brief API PRIVATE A byte-wise trie mapping strings to values it does not own
+ */
+typedef struct prom_trie {
+  prom_trie_node_t *root; /**< the node of the empty key */
+  size_t size;            /**< the number of keys with a value */
+} prom_trie_t;
+
+#endif  // PROM_TRIE_T_H
@@ -0,0 +1,225 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "prom.h"
+#include "prom_test_helpers.h"
+
+static const char *prom_collector_registry_test_keys[] = {"comm"};
+
+// Builds a registry whose single collector holds the given metrics
+static prom_collector_registry_t *prom_collector_registry_test_new(prom_metric_t **metrics, size_t count) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  for (size_t i = 0; i < count; i++) prom_collector_add_metric(collector, metrics[i]);
+  prom_collector_registry_register_collector(registry, collector);
+  return registry;
+}
+
+static void test_prom_collector_registry_openmetrics(void) {
+  prom_counter_t *counter = prom_counter_new("requests_total", "Requests \\ served.\nBy \"code\".", 1,
+                                             (const char *[]){"code"});
+  prom_gauge_t *gauge = prom_gauge_new("temperature", "Temperature.", 0, NULL);
+  prom_histogram_t *histogram =
+      prom_histogram_new("latency_seconds", "Latency.", prom_histogram_buckets_linear(0.1, 0.1, 3), 0, NULL);
+  prom_collector_registry_t *registry =
+      prom_collector_registry_test_new((prom_metric_t *[]){counter, gauge, histogram}, 3);
+  TEST_ASSERT_NOT_NULL(registry);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_inc(counter, (const char *[]){"2\"0\\0\n"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, INFINITY, NULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe(histogram, 0.15, NULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe_with_exemplar(histogram, 0.25, NULL, 1, (const char *[]){"trace_id"},
+                                                                (const char *[]){"abc"}));
+
+  // Counters drop _total from their family name, and the page ends with # EOF
+  const char *expected =
+      "# HELP requests Requests \\\\ served.\\nBy \\\"code\\\".\n"
+      "# TYPE requests counter\n"
+      "requests_total{code=\"2\\\"0\\\\0\\n\"} 1\n"
+      "requests_created{code=\"2\\\"0\\\\0\\n\"} *\n"
+      "# HELP temperature Temperature.\n"
+      "# TYPE temperature gauge\n"
+      "temperature +Inf\n"
+      "# HELP latency_seconds Latency.\n"
+      "# TYPE latency_seconds histogram\n"
+      "latency_seconds_bucket{le=\"0.1\"} 0\n"
+      "latency_seconds_bucket{le=\"0.2\"} 1\n"
+      "latency_seconds_bucket{le=\"0.3\"} 2 # {trace_id=\"abc\"} 0.25 *\n"
+      "latency_seconds_bucket{le=\"+Inf\"} 2\n"
+      "latency_seconds_count 2\n"
+      "latency_seconds_sum 0.4\n"
+      "latency_seconds_created *\n"
+      "# EOF\n";
+  size_t len = 0;
+  const char *page =
+      prom_collector_registry_bridge_lease_format(registry, PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS, &len);
+  TEST_ASSERT_NOT_NULL(page);
+  bool matched = prom_test_match(expected, page, len);
+  if (!matched) fprintf(stderr, "%.*s", (int)len, page);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+  TEST_ASSERT_TRUE(matched);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+static void test_prom_collector_registry_snapshot_render(void) {
+  prom_gauge_t *gauge = prom_gauge_new("rss_bytes", "RSS.", 1, prom_collector_registry_test_keys);
+  prom_counter_t *counter = prom_counter_new_sharded("forks_total", "Forks.", 1, prom_collector_registry_test_keys);
+  prom_counter_t *integer = prom_counter_new_int("bytes_total", "Bytes.", 0, NULL);
+  prom_gauge_t *empty = prom_gauge_new("empty", "No series.", 1, prom_collector_registry_test_keys);
+  prom_histogram_t *histogram = prom_histogram_new("wait_seconds", "Wait.", prom_histogram_buckets_linear(1, 2, 4), 1,
+                                                   prom_collector_registry_test_keys);
+  prom_summary_t *summary = prom_summary_new("run_seconds", "Run.", 2, (double[]){0.5, 0.9}, (double[]){0.05, 0.01},
+                                             60, 5, 1, prom_collector_registry_test_keys);
+  prom_collector_registry_t *registry = prom_collector_registry_test_new(
+      (prom_metric_t *[]){gauge, counter, integer, empty, histogram, summary}, 6);
+  TEST_ASSERT_NOT_NULL(registry);
+
+  const char *quoted[] = {"a\"b"};
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, NAN, quoted));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, -INFINITY, (const char *[]){"x"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 0.1, (const char *[]){"y"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add(counter, 3.25, quoted));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add_int(integer, 1LL << 60, NULL));
+  for (int i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe(histogram, i * 0.1, quoted));
+    TEST_ASSERT_EQUAL_INT(0, prom_summary_observe(summary, i, quoted));
+  }
+
+  prom_collector_registry_snapshot_t *snapshot = prom_collector_registry_snapshot_new();
+  TEST_ASSERT_NOT_NULL(snapshot);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_snapshot(registry, snapshot));
+  size_t len = 0;
+  const char *rendered = prom_collector_registry_snapshot_render(snapshot, &len);
+  TEST_ASSERT_NOT_NULL(rendered);
+  const char *page = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_NOT_NULL(page);
+  TEST_ASSERT_EQUAL_INT(strlen(page), len);
+  TEST_ASSERT_EQUAL_STRING(page, rendered);
+  free((char *)page);
+
+  size_t family_count = 0;
+  size_t sample_count = 0;
+  const prom_collector_registry_snapshot_family_t *families =
+      prom_collector_registry_snapshot_families(snapshot, &family_count);
+  const prom_collector_registry_snapshot_sample_t *samples =
+      prom_collector_registry_snapshot_samples(snapshot, &sample_count);
+  TEST_ASSERT_EQUAL_INT(6, family_count);
+  TEST_ASSERT_EQUAL_STRING("bytes_total", families[2].name);
+  TEST_ASSERT_EQUAL_INT(1, families[2].count);
+  TEST_ASSERT_TRUE(samples[families[2].first].integer);
+  TEST_ASSERT_EQUAL_INT(1LL << 60, samples[families[2].first].i_value);
+  TEST_ASSERT_EQUAL_INT(0, families[3].count);
+
+  // The snapshot copies its lines, so they outlive the series
+  const char *l_value = samples[families[0].first].l_value;
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_clear(gauge));
+  TEST_ASSERT_TRUE(strncmp(l_value, "rss_bytes{comm=", strlen("rss_bytes{comm=")) == 0);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_snapshot_destroy(snapshot));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+// Returns the number of lines of the page that start with prefix
+static size_t prom_collector_registry_test_count(const char *page, size_t len, const char *prefix) {
+  size_t count = 0;
+  size_t prefix_len = strlen(prefix);
+  for (size_t i = 0; i < len; i++) {
+    if ((i == 0 || page[i - 1] == '\n') && len - i >= prefix_len && memcmp(page + i, prefix, prefix_len) == 0) count++;
+  }
+  return count;
+}
+
+static void test_prom_collector_registry_select(void) {
+  prom_gauge_t *user = prom_gauge_new("cpu_user", "User.", 0, NULL);
+  prom_gauge_t *system = prom_gauge_new("cpu_system", "System.", 0, NULL);
+  prom_gauge_t *memory = prom_gauge_new("memory_bytes", "Memory.", 0, NULL);
+  prom_gauge_t *cpus = prom_gauge_new("cpus", "CPUs.", 0, NULL);
+  prom_collector_registry_t *registry =
+      prom_collector_registry_test_new((prom_metric_t *[]){user, system, memory, cpus}, 4);
+  TEST_ASSERT_NOT_NULL(registry);
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(user, 1, NULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(system, 2, NULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(memory, 3, NULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(cpus, 4, NULL));
+
+  // A family matched by several selectors is rendered once, and cpu_* does not match cpus
+  const char *selectors[] = {"cpu_*", "cpu_user", "memory_bytes"};
+  size_t len = 0;
+  const char *page =
+      prom_collector_registry_bridge_lease_select(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, selectors, 3, &len);
+  TEST_ASSERT_NOT_NULL(page);
+  size_t user_lines = prom_collector_registry_test_count(page, len, "cpu_user ");
+  size_t system_lines = prom_collector_registry_test_count(page, len, "cpu_system ");
+  size_t memory_lines = prom_collector_registry_test_count(page, len, "memory_bytes ");
+  size_t cpus_lines = prom_collector_registry_test_count(page, len, "cpus ");
+  size_t process_lines = prom_collector_registry_test_count(page, len, "process_");
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+  TEST_ASSERT_EQUAL_INT(1, user_lines);
+  TEST_ASSERT_EQUAL_INT(1, system_lines);
+  TEST_ASSERT_EQUAL_INT(1, memory_lines);
+  TEST_ASSERT_EQUAL_INT(0, cpus_lines);
+  TEST_ASSERT_EQUAL_INT(0, process_lines);
+
+  // A selector that matches nothing renders an empty page
+  page = prom_collector_registry_bridge_lease_select(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT,
+                                                     (const char *[]){"disk_*"}, 1, &len);
+  TEST_ASSERT_NOT_NULL(page);
+  TEST_ASSERT_EQUAL_INT(0, len);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+
+  // The wildcard may only end a selector, after a valid name prefix or alone
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_validate_selector("cpu_*"));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_validate_selector("a:b_*"));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_validate_selector("*"));
+  TEST_ASSERT_TRUE(prom_collector_registry_validate_selector("") != 0);
+  TEST_ASSERT_TRUE(prom_collector_registry_validate_selector("9a") != 0);
+  TEST_ASSERT_TRUE(prom_collector_registry_validate_selector("a*b") != 0);
+  TEST_ASSERT_NULL(prom_collector_registry_bridge_lease_select(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT,
+                                                               (const char *[]){"a*b"}, 1, &len));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+static void test_prom_collector_registry_self_metrics(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  TEST_ASSERT_NOT_NULL(registry);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_enable_self_metrics(registry));
+  prom_collector_registry_observe_scrape(registry, 0.003, 100);
+  prom_collector_registry_observe_scrape(registry, 7, 100);
+
+  // The scrape durations keep their fixed buckets in the text format
+  const char *page = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_NOT_NULL(page);
+  TEST_ASSERT_NOT_NULL(strstr(page, "prom_scrape_duration_seconds{le=\"0.0025\"} 0\n"
+                                    "prom_scrape_duration_seconds{le=\"0.005\"} 1\n"));
+  TEST_ASSERT_NOT_NULL(strstr(page, "prom_scrape_duration_seconds{le=\"5.0\"} 1\n"
+                                    "prom_scrape_duration_seconds{le=\"+Inf\"} 2\n"
+                                    "prom_scrape_duration_seconds_count 2\n"
+                                    "prom_scrape_duration_seconds_sum 7.003\n"));
+  free((char *)page);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+int main(void) {
+  RUN_TEST(test_prom_collector_registry_openmetrics);
+  RUN_TEST(test_prom_collector_registry_snapshot_render);
+  RUN_TEST(test_prom_collector_registry_select);
+  RUN_TEST(test_prom_collector_registry_self_metrics);
+  return PROM_TEST_RESULT();
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prom_dtoa_i.h"
+#include "prom_test_helpers.h"
+
+// Writes value with prom_dtoa into a null terminated buffer
+static const char *prom_dtoa_test_format(double value, char *buffer) {
+  size_t len = prom_dtoa(value, buffer);
+  buffer[len] = '\0';
+  return buffer;
+}
+
+// Returns the shortest %g rendering of value that reads back as value
+static const char *prom_dtoa_test_shortest(double value, char *buffer, size_t size) {
+  for (int precision = 1; precision < 17; precision++) {
+    snprintf(buffer, size, "%.*g", precision, value);
+    if (strtod(buffer, NULL) == value) return buffer;
+  }
+  snprintf(buffer, size, "%.17g", value);
+  return buffer;
+}
+
+static void test_prom_dtoa_integers(void) {
+  char buffer[PROM_DTOA_BUFFER_SIZE + 1];
+  char expected[PROM_DTOA_BUFFER_SIZE + 1];
+
+  // Integral values up to 2^53 are written as plain integers, without a decimal point or exponent
+  TEST_ASSERT_EQUAL_STRING("0", prom_dtoa_test_format(0.0, buffer));
+  TEST_ASSERT_EQUAL_STRING("0", prom_dtoa_test_format(-0.0, buffer));
+  TEST_ASSERT_EQUAL_STRING("-1", prom_dtoa_test_format(-1.0, buffer));
+  TEST_ASSERT_EQUAL_STRING("1000000000000000", prom_dtoa_test_format(1e15, buffer));
+  TEST_ASSERT_EQUAL_STRING("9007199254740992", prom_dtoa_test_format(9007199254740992.0, buffer));
+  TEST_ASSERT_EQUAL_STRING("-9007199254740992", prom_dtoa_test_format(-9007199254740992.0, buffer));
+  for (int64_t i = -100000; i <= 100000; i++) {
+    snprintf(expected, sizeof(expected), "%lld", (long long)i);
+    TEST_ASSERT_EQUAL_STRING(expected, prom_dtoa_test_format((double)i, buffer));
+  }
+  for (int64_t i = 1; i < (INT64_C(1) << 53); i *= 3) {
+    snprintf(expected, sizeof(expected), "%lld", (long long)i);
+    TEST_ASSERT_EQUAL_STRING(expected, prom_dtoa_test_format((double)i, buffer));
+  }
+
+  // Past 2^53 integral values take the Grisu2 path and read back exactly
+  TEST_ASSERT_EQUAL_STRING("9007199254740994", prom_dtoa_test_format(9007199254740994.0, buffer));
+  TEST_ASSERT_EQUAL_STRING("10000000000000000", prom_dtoa_test_format(1e16, buffer));
+  TEST_ASSERT_EQUAL_STRING("1e+21", prom_dtoa_test_format(1e21, buffer));
+}
+
+static void test_prom_dtoa_itoa(void) {
+  char buffer[PROM_DTOA_BUFFER_SIZE + 1];
+  buffer[prom_itoa(0, buffer)] = '\0';
+  TEST_ASSERT_EQUAL_STRING("0", buffer);
+  buffer[prom_itoa(INT64_MAX, buffer)] = '\0';
+  TEST_ASSERT_EQUAL_STRING("9223372036854775807", buffer);
+  buffer[prom_itoa(INT64_MIN, buffer)] = '\0';
+  TEST_ASSERT_EQUAL_STRING("-9223372036854775808", buffer);
+}
+
+static void test_prom_dtoa_shortest(void) {
+  char buffer[PROM_DTOA_BUFFER_SIZE + 1];
+  char expected[PROM_DTOA_BUFFER_SIZE + 1];
+
+  // Values are laid out like %g, with the fewest digits that read back
+  TEST_ASSERT_EQUAL_STRING("0.1", prom_dtoa_test_format(0.1, buffer));
+  TEST_ASSERT_EQUAL_STRING("0.3", prom_dtoa_test_format(0.3, buffer));
+  TEST_ASSERT_EQUAL_STRING("12.000000000000002", prom_dtoa_test_format(12.000000000000002, buffer));
+  TEST_ASSERT_EQUAL_STRING("123456.789", prom_dtoa_test_format(123456.789, buffer));
+  TEST_ASSERT_EQUAL_STRING("2.5e-05", prom_dtoa_test_format(2.5e-5, buffer));
+  TEST_ASSERT_EQUAL_STRING("1e-07", prom_dtoa_test_format(1e-7, buffer));
+  TEST_ASSERT_EQUAL_STRING("1.5e+300", prom_dtoa_test_format(1.5e300, buffer));
+  TEST_ASSERT_EQUAL_STRING("5e-324", prom_dtoa_test_format(5e-324, buffer));
+  TEST_ASSERT_EQUAL_STRING("1.7976931348623157e+308", prom_dtoa_test_format(1.7976931348623157e308, buffer));
+
+  // Decimal fractions such as latency bucket bounds, in seconds and in nanoseconds scaled to seconds. Grisu2 reads
+  // back exactly but may spend a few more digits than needed on a tiny fraction of inputs.
+  int longer = 0;
+  for (int i = 1; i <= 100000; i++) {
+    for (int scale = 0; scale < 2; scale++) {
+      double value = scale == 0 ? i / 1000.0 : i / 1e9;
+      prom_dtoa_test_format(value, buffer);
+      TEST_ASSERT_TRUE(strtod(buffer, NULL) == value);
+      if (strcmp(prom_dtoa_test_shortest(value, expected, sizeof(expected)), buffer) != 0) longer++;
+    }
+  }
+  TEST_ASSERT_TRUE(longer < 200000 / 1000);
+}
+
+static void test_prom_dtoa_round_trip(void) {
+  char buffer[PROM_DTOA_BUFFER_SIZE + 1];
+
+  // Random bit patterns cover every exponent, subnormals included
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (int i = 0; i < 1000000; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    double value;
+    memcpy(&value, &state, sizeof(value));
+    if (!isfinite(value)) continue;
+
+    size_t len = prom_dtoa(value, buffer);
+    TEST_ASSERT_TRUE(len < PROM_DTOA_BUFFER_SIZE);
+    buffer[len] = '\0';
+    TEST_ASSERT_TRUE(strtod(buffer, NULL) == value);
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_prom_dtoa_integers);
+  RUN_TEST(test_prom_dtoa_itoa);
+  RUN_TEST(test_prom_dtoa_shortest);
+  RUN_TEST(test_prom_dtoa_round_trip);
+  return PROM_TEST_RESULT();
+}
@@ -0,0 +1,100 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+
+#include "prom.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_test_helpers.h"
+
+#define PROM_HISTOGRAM_TEST_MAX_BUCKETS 24
+
+// The bucket a value belongs to by the definition of le: the lowest bound at least value, or +Inf. NaN compares false
+// against every bound and is counted in the lowest bucket.
+static size_t prom_histogram_test_expected_index(const prom_histogram_buckets_t *buckets, double value) {
+  if (isnan(value)) return 0;
+  for (int i = 0; i < buckets->count; i++) {
+    if (value <= buckets->upper_bounds[i]) return (size_t)i;
+  }
+  return (size_t)buckets->count;
+}
+
+// Observes value and returns the bucket whose count went up, or SIZE_MAX if no single bucket did
+static size_t prom_histogram_test_observed_index(prom_metric_sample_histogram_t *sample, size_t bucket_count,
+                                                 double value) {
+  uint64_t before[PROM_HISTOGRAM_TEST_MAX_BUCKETS + 1];
+  uint64_t after[PROM_HISTOGRAM_TEST_MAX_BUCKETS + 1];
+  double sum = 0.0;
+  prom_metric_sample_histogram_collect(sample, before, &sum);
+  if (prom_metric_sample_histogram_observe(sample, value)) return SIZE_MAX;
+  prom_metric_sample_histogram_collect(sample, after, &sum);
+
+  // The cumulative counts rise by one from the observed bucket up to +Inf
+  size_t index = SIZE_MAX;
+  for (size_t i = 0; i <= bucket_count; i++) {
+    uint64_t delta = after[i] - before[i];
+    if (delta > 1 || (delta == 0 && index != SIZE_MAX)) return SIZE_MAX;
+    if (delta == 1 && index == SIZE_MAX) index = i;
+  }
+  return index;
+}
+
+static void prom_histogram_test_boundaries(prom_histogram_buckets_t *buckets) {
+  TEST_ASSERT_NOT_NULL(buckets);
+  size_t bucket_count = prom_histogram_buckets_count(buckets);
+  TEST_ASSERT_TRUE(bucket_count <= PROM_HISTOGRAM_TEST_MAX_BUCKETS);
+  prom_histogram_t *histogram = prom_histogram_new("latency_seconds", "Latency.", buckets, 0, NULL);
+  TEST_ASSERT_NOT_NULL(histogram);
+  prom_metric_sample_histogram_t *sample = prom_metric_sample_histogram_from_labels(histogram, NULL);
+  TEST_ASSERT_NOT_NULL(sample);
+
+  const double specials[] = {-INFINITY, -1e308, -0.0, 0.0, 1e308, INFINITY, NAN};
+  for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); i++) {
+    TEST_ASSERT_EQUAL_INT(prom_histogram_test_expected_index(buckets, specials[i]),
+                          prom_histogram_test_observed_index(sample, bucket_count, specials[i]));
+  }
+
+  // Each bound belongs to its own bucket; the doubles either side of it to the bucket below and above
+  for (size_t i = 0; i < bucket_count; i++) {
+    double bound = buckets->upper_bounds[i];
+    double values[] = {nextafter(bound, -INFINITY), bound, nextafter(bound, INFINITY)};
+    for (size_t j = 0; j < 3; j++) {
+      TEST_ASSERT_EQUAL_INT(prom_histogram_test_expected_index(buckets, values[j]),
+                            prom_histogram_test_observed_index(sample, bucket_count, values[j]));
+    }
+    TEST_ASSERT_EQUAL_INT(i, prom_histogram_test_observed_index(sample, bucket_count, bound));
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(histogram, sample));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_destroy(histogram));
+}
+
+// Every bucket count up to a few halvings, so both halves of the search take odd and even lengths
+static void test_prom_histogram_bucket_index(void) {
+  for (size_t count = 1; count <= PROM_HISTOGRAM_TEST_MAX_BUCKETS; count++) {
+    // Linear buckets take at least two bounds
+    if (count > 1) prom_histogram_test_boundaries(prom_histogram_buckets_linear(-2.5, 0.5, count));
+    prom_histogram_test_boundaries(prom_histogram_buckets_exponential(0.001, 2.5, count));
+  }
+  prom_histogram_test_boundaries(prom_histogram_buckets_new(3, -1.0, 0.0, 1.0));
+}
+
+int main(void) {
+  RUN_TEST(test_prom_histogram_bucket_index);
+  return PROM_TEST_RESULT();
+}
@@ -0,0 +1,169 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "prom_linked_list_t.h"
+#include "prom_map_i.h"
+#include "prom_test_helpers.h"
+
+#define PROM_MAP_TEST_KEYS 20000
+
+static void prom_map_test_key(char *key, size_t size, size_t i) {
+  snprintf(key, size, "node_cpu_seconds_total{cpu=\"%zu\",mode=\"idle\"}", i);
+}
+
+static size_t prom_map_test_key_count(prom_map_t *map) {
+  size_t count = 0;
+  for (prom_linked_list_node_t *node = map->keys->head; node != NULL; node = node->next) count++;
+  return count;
+}
+
+// Sets enough keys to grow the table many times, checking lookups in the middle of each migration
+static void test_prom_map_grows_while_migrating(void) {
+  prom_map_t *map = prom_map_new();
+  TEST_ASSERT_NOT_NULL(map);
+  char key[96];
+
+  bool migrated = false;
+  for (size_t i = 0; i < PROM_MAP_TEST_KEYS; i++) {
+    prom_map_test_key(key, sizeof(key), i);
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, key, (void *)(uintptr_t)(i + 1)));
+    if (map->old_slots == NULL) continue;
+    migrated = true;
+    // Keys still in the previous table and keys already moved are both found
+    for (size_t j = 0; j <= i; j += 97) {
+      prom_map_test_key(key, sizeof(key), j);
+      TEST_ASSERT_EQUAL_INT(j + 1, (uintptr_t)prom_map_get(map, key));
+    }
+  }
+  TEST_ASSERT_TRUE(migrated);
+  TEST_ASSERT_EQUAL_INT(PROM_MAP_TEST_KEYS, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(PROM_MAP_TEST_KEYS, prom_map_test_key_count(map));
+
+  for (size_t i = 0; i < PROM_MAP_TEST_KEYS; i++) {
+    prom_map_test_key(key, sizeof(key), i);
+    TEST_ASSERT_EQUAL_INT(i + 1, (uintptr_t)prom_map_get(map, key));
+  }
+  TEST_ASSERT_NULL(prom_map_get(map, "node_cpu_seconds_total{cpu=\"missing\"}"));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_destroy(map));
+}
+
+// Replaces, deletes and re-inserts keys so tombstones are left behind and reused
+static void test_prom_map_set_delete(void) {
+  prom_map_t *map = prom_map_new();
+  TEST_ASSERT_NOT_NULL(map);
+  char key[96];
+
+  for (size_t i = 0; i < 1000; i++) {
+    prom_map_test_key(key, sizeof(key), i);
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, key, (void *)(uintptr_t)(i + 1)));
+  }
+  // Setting an existing key replaces its value without adding a key
+  prom_map_test_key(key, sizeof(key), 7);
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, key, (void *)(uintptr_t)5000));
+  TEST_ASSERT_EQUAL_INT(5000, (uintptr_t)prom_map_get(map, key));
+  TEST_ASSERT_EQUAL_INT(1000, prom_map_size(map));
+
+  for (size_t i = 0; i < 1000; i += 2) {
+    prom_map_test_key(key, sizeof(key), i);
+    TEST_ASSERT_EQUAL_INT(0, prom_map_delete(map, key));
+  }
+  TEST_ASSERT_EQUAL_INT(500, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(500, prom_map_test_key_count(map));
+  for (size_t i = 0; i < 1000; i++) {
+    prom_map_test_key(key, sizeof(key), i);
+    void *value = prom_map_get(map, key);
+    if (i % 2 == 0) {
+      TEST_ASSERT_NULL(value);
+    } else if (i != 7) {
+      TEST_ASSERT_EQUAL_INT(i + 1, (uintptr_t)value);
+    }
+  }
+
+  for (size_t i = 0; i < 1000; i += 2) {
+    prom_map_test_key(key, sizeof(key), i);
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, key, (void *)(uintptr_t)(i + 2)));
+  }
+  TEST_ASSERT_EQUAL_INT(1000, prom_map_size(map));
+  prom_map_test_key(key, sizeof(key), 998);
+  TEST_ASSERT_EQUAL_INT(1000, (uintptr_t)prom_map_get(map, key));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_destroy(map));
+}
+
+static void test_prom_map_take(void) {
+  prom_map_t *map = prom_map_new();
+  TEST_ASSERT_NOT_NULL(map);
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, "a", (void *)(uintptr_t)1));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, "b", (void *)(uintptr_t)2));
+
+  // The value is handed back instead of being freed
+  TEST_ASSERT_EQUAL_INT(1, (uintptr_t)prom_map_take(map, "a"));
+  TEST_ASSERT_NULL(prom_map_take(map, "a"));
+  TEST_ASSERT_NULL(prom_map_get(map, "a"));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_test_key_count(map));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_destroy(map));
+}
+
+static void test_prom_map_swap(void) {
+  prom_map_t *map = prom_map_new();
+  prom_map_t *other = prom_map_new();
+  TEST_ASSERT_NOT_NULL(map);
+  TEST_ASSERT_NOT_NULL(other);
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, "old", (void *)(uintptr_t)1));
+  char key[96];
+  for (size_t i = 0; i < 100; i++) {
+    prom_map_test_key(key, sizeof(key), i);
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set(other, key, (void *)(uintptr_t)(i + 1)));
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, prom_map_swap(map, other));
+  TEST_ASSERT_EQUAL_INT(100, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(other));
+  TEST_ASSERT_NULL(prom_map_get(map, "old"));
+  TEST_ASSERT_EQUAL_INT(1, (uintptr_t)prom_map_get(other, "old"));
+  prom_map_test_key(key, sizeof(key), 42);
+  TEST_ASSERT_EQUAL_INT(43, (uintptr_t)prom_map_get(map, key));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_destroy(map));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_destroy(other));
+}
+
+static void test_prom_map_acquire(void) {
+  prom_map_t *map = prom_map_new();
+  TEST_ASSERT_NOT_NULL(map);
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set(map, "a", (void *)(uintptr_t)1));
+
+  TEST_ASSERT_EQUAL_INT(1, (uintptr_t)prom_map_acquire(map, "a"));
+  // Other readers proceed while the value is held
+  TEST_ASSERT_EQUAL_INT(1, (uintptr_t)prom_map_get(map, "a"));
+  prom_map_release(map);
+  // A missing key leaves nothing held, so writers proceed
+  TEST_ASSERT_NULL(prom_map_acquire(map, "b"));
+  TEST_ASSERT_EQUAL_INT(1, (uintptr_t)prom_map_take(map, "a"));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_destroy(map));
+}
+
+int main(void) {
+  RUN_TEST(test_prom_map_grows_while_migrating);
+  RUN_TEST(test_prom_map_set_delete);
+  RUN_TEST(test_prom_map_take);
+  RUN_TEST(test_prom_map_swap);
+  RUN_TEST(test_prom_map_acquire);
+  return PROM_TEST_RESULT();
+}
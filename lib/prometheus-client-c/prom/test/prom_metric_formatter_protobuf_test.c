@@ -0,0 +1,277 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "prom.h"
+#include "prom_test_helpers.h"
+
+// Field numbers of io.prometheus.client messages, see metrics.proto
+#define PROM_PB_FAMILY_NAME 1
+#define PROM_PB_FAMILY_TYPE 3
+#define PROM_PB_FAMILY_METRIC 4
+#define PROM_PB_METRIC_LABEL 1
+#define PROM_PB_METRIC_COUNTER 3
+#define PROM_PB_METRIC_HISTOGRAM 7
+#define PROM_PB_COUNTER_VALUE 1
+#define PROM_PB_HISTOGRAM_SAMPLE_COUNT 1
+#define PROM_PB_HISTOGRAM_SAMPLE_SUM 2
+#define PROM_PB_HISTOGRAM_SCHEMA 5
+#define PROM_PB_HISTOGRAM_ZERO_THRESHOLD 6
+#define PROM_PB_HISTOGRAM_ZERO_COUNT 7
+#define PROM_PB_HISTOGRAM_NEGATIVE_SPAN 9
+#define PROM_PB_HISTOGRAM_NEGATIVE_DELTA 10
+#define PROM_PB_HISTOGRAM_POSITIVE_SPAN 12
+#define PROM_PB_HISTOGRAM_POSITIVE_DELTA 13
+#define PROM_PB_SPAN_OFFSET 1
+#define PROM_PB_SPAN_LENGTH 2
+
+#define PROM_PB_TYPE_COUNTER 0
+#define PROM_PB_TYPE_HISTOGRAM 4
+
+/**
+ * @brief A field of a protobuf message: varints and fixed64 values in value, length-delimited fields in bytes
+ */
+typedef struct prom_pb_field {
+  uint32_t number;
+  uint32_t wire_type;
+  uint64_t value;
+  const uint8_t *bytes;
+  size_t len;
+} prom_pb_field_t;
+
+static bool prom_pb_varint(const uint8_t **p, const uint8_t *end, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; *p < end && shift < 64; shift += 7) {
+    uint8_t byte = *(*p)++;
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (byte < 0x80) return true;
+  }
+  return false;
+}
+
+static int64_t prom_pb_zigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+// Reads the field at *p and advances past it; returns false at the end of the message or on malformed input
+static bool prom_pb_next(const uint8_t **p, const uint8_t *end, prom_pb_field_t *field) {
+  uint64_t key = 0;
+  if (*p >= end || !prom_pb_varint(p, end, &key)) return false;
+  field->number = (uint32_t)(key >> 3);
+  field->wire_type = (uint32_t)(key & 7);
+  field->bytes = NULL;
+  field->len = 0;
+  switch (field->wire_type) {
+    case 0:
+      return prom_pb_varint(p, end, &field->value);
+    case 1:
+      if (end - *p < 8) return false;
+      memcpy(&field->value, *p, 8);
+      *p += 8;
+      return true;
+    case 2:
+      if (!prom_pb_varint(p, end, &field->value) || field->value > (uint64_t)(end - *p)) return false;
+      field->bytes = *p;
+      field->len = (size_t)field->value;
+      *p += field->len;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the first field with the given number, or false if the message has none
+static bool prom_pb_find(const uint8_t *message, size_t len, uint32_t number, prom_pb_field_t *field) {
+  const uint8_t *p = message;
+  while (prom_pb_next(&p, message + len, field)) {
+    if (field->number == number) return true;
+  }
+  return false;
+}
+
+static double prom_pb_double(const prom_pb_field_t *field) {
+  double value = 0;
+  memcpy(&value, &field->value, sizeof(value));
+  return value;
+}
+
+/**
+ * @brief Finds the length-delimited MetricFamily named name in a page and returns its bytes
+ */
+static bool prom_pb_family(const char *page, size_t page_len, const char *name, prom_pb_field_t *family) {
+  const uint8_t *p = (const uint8_t *)page;
+  const uint8_t *end = p + page_len;
+  while (p < end) {
+    uint64_t len = 0;
+    if (!prom_pb_varint(&p, end, &len) || len > (uint64_t)(end - p)) return false;
+    prom_pb_field_t field;
+    if (prom_pb_find(p, len, PROM_PB_FAMILY_NAME, &field) && field.len == strlen(name) &&
+        memcmp(field.bytes, name, field.len) == 0) {
+      family->bytes = p;
+      family->len = len;
+      return true;
+    }
+    p += len;
+  }
+  return false;
+}
+
+/**
+ * @brief Collects the spans (offset, length pairs) and deltas of one side of a native histogram. Deltas are read both
+ * packed and unpacked, as decoders must accept either.
+ */
+static void prom_pb_buckets(const prom_pb_field_t *histogram, uint32_t span_number, uint32_t delta_number,
+                            int64_t *spans, size_t *span_count, int64_t *deltas, size_t *delta_count) {
+  *span_count = 0;
+  *delta_count = 0;
+  const uint8_t *p = histogram->bytes;
+  prom_pb_field_t field;
+  while (prom_pb_next(&p, histogram->bytes + histogram->len, &field)) {
+    if (field.number == span_number) {
+      prom_pb_field_t part;
+      spans[2 * *span_count] = 0;
+      spans[2 * *span_count + 1] = 0;
+      if (prom_pb_find(field.bytes, field.len, PROM_PB_SPAN_OFFSET, &part)) {
+        spans[2 * *span_count] = prom_pb_zigzag(part.value);
+      }
+      if (prom_pb_find(field.bytes, field.len, PROM_PB_SPAN_LENGTH, &part)) {
+        spans[2 * *span_count + 1] = (int64_t)part.value;
+      }
+      (*span_count)++;
+    } else if (field.number == delta_number && field.wire_type == 0) {
+      deltas[(*delta_count)++] = prom_pb_zigzag(field.value);
+    } else if (field.number == delta_number) {
+      const uint8_t *q = field.bytes;
+      uint64_t value = 0;
+      while (q < field.bytes + field.len && prom_pb_varint(&q, field.bytes + field.len, &value)) {
+        deltas[(*delta_count)++] = prom_pb_zigzag(value);
+      }
+    }
+  }
+}
+
+static void test_prom_metric_formatter_protobuf_counter(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  prom_counter_t *counter = prom_counter_new("requests_total", "Requests.", 1, (const char *[]){"code"});
+  prom_collector_add_metric(collector, counter);
+  prom_collector_registry_register_collector(registry, collector);
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add(counter, 2.5, (const char *[]){"200"}));
+
+  size_t len = 0;
+  const char *page =
+      prom_collector_registry_bridge_lease_format(registry, PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF, &len);
+  TEST_ASSERT_NOT_NULL(page);
+  prom_pb_field_t family = {0};
+  prom_pb_field_t field = {0};
+  prom_pb_field_t metric = {0};
+  prom_pb_field_t counter_field = {0};
+  bool found = prom_pb_family(page, len, "requests_total", &family);
+  bool typed = found && prom_pb_find(family.bytes, family.len, PROM_PB_FAMILY_TYPE, &field);
+  bool has_metric = found && prom_pb_find(family.bytes, family.len, PROM_PB_FAMILY_METRIC, &metric);
+  bool labelled = has_metric && prom_pb_find(metric.bytes, metric.len, PROM_PB_METRIC_LABEL, &counter_field);
+  bool counted = has_metric && prom_pb_find(metric.bytes, metric.len, PROM_PB_METRIC_COUNTER, &counter_field) &&
+                 prom_pb_find(counter_field.bytes, counter_field.len, PROM_PB_COUNTER_VALUE, &counter_field);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+
+  TEST_ASSERT_TRUE(found);
+  TEST_ASSERT_TRUE(typed);
+  TEST_ASSERT_EQUAL_INT(PROM_PB_TYPE_COUNTER, field.value);
+  TEST_ASSERT_TRUE(labelled);
+  TEST_ASSERT_TRUE(counted);
+  TEST_ASSERT_EQUAL_DOUBLE(2.5, prom_pb_double(&counter_field));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+static void test_prom_metric_formatter_protobuf_native_histogram(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  // A factor of 1.1 gives schema 3, buckets growing by 2^(1/8)
+  prom_histogram_t *histogram = prom_histogram_new_native("latency_seconds", "Latency.", 1.1, 160, 0, NULL);
+  prom_collector_add_metric(collector, histogram);
+  prom_collector_registry_register_collector(registry, collector);
+  const double observations[] = {0.5, 0.5, 1, 1.05, 3, -2, 0};
+  for (size_t i = 0; i < sizeof(observations) / sizeof(observations[0]); i++) {
+    TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe(histogram, observations[i], NULL));
+  }
+
+  size_t len = 0;
+  const char *page =
+      prom_collector_registry_bridge_lease_format(registry, PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF, &len);
+  TEST_ASSERT_NOT_NULL(page);
+  char *copy = malloc(len);
+  memcpy(copy, page, len);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+
+  prom_pb_field_t family = {0};
+  prom_pb_field_t field = {0};
+  prom_pb_field_t metric = {0};
+  prom_pb_field_t native = {0};
+  bool found = prom_pb_family(copy, len, "latency_seconds", &family) &&
+               prom_pb_find(family.bytes, family.len, PROM_PB_FAMILY_TYPE, &field) &&
+               field.value == PROM_PB_TYPE_HISTOGRAM &&
+               prom_pb_find(family.bytes, family.len, PROM_PB_FAMILY_METRIC, &metric) &&
+               prom_pb_find(metric.bytes, metric.len, PROM_PB_METRIC_HISTOGRAM, &native);
+  if (!found) free(copy);
+  TEST_ASSERT_TRUE(found);
+
+  int64_t spans[16];
+  int64_t deltas[16];
+  size_t span_count = 0;
+  size_t delta_count = 0;
+  bool fields = prom_pb_find(native.bytes, native.len, PROM_PB_HISTOGRAM_SAMPLE_COUNT, &field) && field.value == 7 &&
+                prom_pb_find(native.bytes, native.len, PROM_PB_HISTOGRAM_SAMPLE_SUM, &field) &&
+                fabs(prom_pb_double(&field) - 4.05) < 1e-12 &&
+                prom_pb_find(native.bytes, native.len, PROM_PB_HISTOGRAM_SCHEMA, &field) &&
+                prom_pb_zigzag(field.value) == 3 &&
+                prom_pb_find(native.bytes, native.len, PROM_PB_HISTOGRAM_ZERO_THRESHOLD, &field) &&
+                prom_pb_double(&field) > 0 &&
+                prom_pb_find(native.bytes, native.len, PROM_PB_HISTOGRAM_ZERO_COUNT, &field) && field.value == 1;
+  if (!fields) free(copy);
+  TEST_ASSERT_TRUE(fields);
+
+  // -2 falls in bucket 8 of the negative side: 2^(7/8) < 2 <= 2^(8/8)
+  prom_pb_buckets(&native, PROM_PB_HISTOGRAM_NEGATIVE_SPAN, PROM_PB_HISTOGRAM_NEGATIVE_DELTA, spans, &span_count,
+                  deltas, &delta_count);
+  bool negative = span_count == 1 && spans[0] == 8 && spans[1] == 1 && delta_count == 1 && deltas[0] == 1;
+
+  // Buckets -8 (0.5 twice), 0 (1), 1 (1.05) and 13 (3): spans skip the empty runs between them, and each delta is
+  // the difference to the previous bucket's count
+  prom_pb_buckets(&native, PROM_PB_HISTOGRAM_POSITIVE_SPAN, PROM_PB_HISTOGRAM_POSITIVE_DELTA, spans, &span_count,
+                  deltas, &delta_count);
+  free(copy);
+  TEST_ASSERT_TRUE(negative);
+  TEST_ASSERT_EQUAL_INT(3, span_count);
+  TEST_ASSERT_EQUAL_INT(-8, spans[0]);
+  TEST_ASSERT_EQUAL_INT(1, spans[1]);
+  TEST_ASSERT_EQUAL_INT(7, spans[2]);
+  TEST_ASSERT_EQUAL_INT(2, spans[3]);
+  TEST_ASSERT_EQUAL_INT(11, spans[4]);
+  TEST_ASSERT_EQUAL_INT(1, spans[5]);
+  TEST_ASSERT_EQUAL_INT(4, delta_count);
+  TEST_ASSERT_EQUAL_INT(2, deltas[0]);
+  TEST_ASSERT_EQUAL_INT(-1, deltas[1]);
+  TEST_ASSERT_EQUAL_INT(0, deltas[2]);
+  TEST_ASSERT_EQUAL_INT(0, deltas[3]);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+int main(void) {
+  RUN_TEST(test_prom_metric_formatter_protobuf_counter);
+  RUN_TEST(test_prom_metric_formatter_protobuf_native_histogram);
+  return PROM_TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdalign.h>
+#include <string.h>
+
+#include "prom_metric_formatter_i.h"
+#include "prom_string_builder_i.h"
+#include "prom_test_helpers.h"
+
+// Escapes value the way the exposition formats require, one strcspn span at a time
+static void prom_metric_formatter_test_escape(const char *value, char *out) {
+  for (;;) {
+    size_t clean = strcspn(value, "\\\"\n");
+    memcpy(out, value, clean);
+    out += clean;
+    value += clean;
+    if (*value == '\0') break;
+    *out++ = '\\';
+    *out++ = *value == '\n' ? 'n' : *value;
+    value++;
+  }
+  *out = '\0';
+}
+
+// Compares the l_value of a single label with the strcspn escape of value
+static bool prom_metric_formatter_test_l_value(prom_metric_formatter_t *formatter, const char *value) {
+  char escaped[256];
+  char expected[320];
+  prom_metric_formatter_test_escape(value, escaped);
+  snprintf(expected, sizeof(expected), "m{k=\"%s\"}", escaped);
+
+  prom_metric_formatter_clear(formatter);
+  if (prom_metric_formatter_load_l_value(formatter, "m", NULL, 1, (const char *[]){"k"}, (const char *[]){value})) {
+    return false;
+  }
+  return strcmp(expected, prom_string_builder_str(formatter->string_builder)) == 0;
+}
+
+static void test_prom_metric_formatter_escape(void) {
+  prom_metric_formatter_t *formatter = prom_metric_formatter_new();
+  TEST_ASSERT_NOT_NULL(formatter);
+
+  TEST_ASSERT_TRUE(prom_metric_formatter_test_l_value(formatter, ""));
+  TEST_ASSERT_TRUE(prom_metric_formatter_test_l_value(formatter, "plain"));
+  TEST_ASSERT_TRUE(prom_metric_formatter_test_l_value(formatter, "\\\"\n"));
+  prom_metric_formatter_clear(formatter);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_l_value(formatter, "m", "sum", 1, (const char *[]){"k"},
+                                                              (const char *[]){"a\\b\"c\nd"}));
+  TEST_ASSERT_EQUAL_STRING("m_sum{k=\"a\\\\b\\\"c\\nd\"}", prom_string_builder_str(formatter->string_builder));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_destroy(formatter));
+}
+
+// Places values at every alignment, with every length up to a few blocks and a special character at every position,
+// surrounded by special characters the block scan must not count
+static void test_prom_metric_formatter_escape_alignment(void) {
+  prom_metric_formatter_t *formatter = prom_metric_formatter_new();
+  TEST_ASSERT_NOT_NULL(formatter);
+  const char specials[] = {'\\', '"', '\n'};
+  alignas(16) char storage[128];
+
+  for (size_t offset = 0; offset < 16; offset++) {
+    for (size_t len = 0; len <= 48; len++) {
+      // -1 places no special character at all
+      for (int position = -1; position < (int)len; position++) {
+        for (size_t s = 0; s < sizeof(specials); s++) {
+          memset(storage, specials[s], sizeof(storage));
+          char *value = storage + offset;
+          for (size_t i = 0; i < len; i++) value[i] = (char)('a' + i % 26);
+          if (position >= 0) value[position] = specials[s];
+          value[len] = '\0';
+          TEST_ASSERT_TRUE(prom_metric_formatter_test_l_value(formatter, value));
+        }
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_destroy(formatter));
+}
+
+int main(void) {
+  RUN_TEST(test_prom_metric_formatter_escape);
+  RUN_TEST(test_prom_metric_formatter_escape_alignment);
+  return PROM_TEST_RESULT();
+}
@@ -0,0 +1,295 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "prom.h"
+#include "prom_linked_list_i.h"
+#include "prom_map_i.h"
+#include "prom_metric_i.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_t.h"
+#include "prom_test_helpers.h"
+
+static const char *prom_metric_test_keys[] = {"comm"};
+
+static void test_prom_metric_remove(void) {
+  prom_gauge_t *gauge = prom_gauge_new("rss_bytes", "RSS.", 1, prom_metric_test_keys);
+  TEST_ASSERT_NOT_NULL(gauge);
+  const char *a[] = {"a"};
+  const char *b[] = {"b"};
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 3, a));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 4, b));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_remove(gauge, a));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(gauge->samples));
+  // Removing a missing series succeeds, and removing through the wrong type fails
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_remove(gauge, a));
+  TEST_ASSERT_TRUE(prom_counter_remove(gauge, b) != 0);
+
+  // The next update starts the series again from zero
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_add(gauge, 1, a));
+  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(gauge->samples, "rss_bytes{comm=\"a\"}");
+  TEST_ASSERT_NOT_NULL(sample);
+  TEST_ASSERT_EQUAL_DOUBLE(1, prom_metric_sample_value(sample));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_destroy(gauge));
+}
+
+static void test_prom_metric_replace(void) {
+  prom_gauge_t *gauge = prom_gauge_new("top_rss_bytes", "RSS.", 1, prom_metric_test_keys);
+  prom_counter_t *counter = prom_counter_new("forks_total", "Forks.", 0, NULL);
+  TEST_ASSERT_NOT_NULL(gauge);
+  TEST_ASSERT_NOT_NULL(counter);
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 1, (const char *[]){"old"}));
+
+  prom_metric_family_t *family = prom_metric_family_new(gauge);
+  TEST_ASSERT_NOT_NULL(family);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_family_set(family, (const char *[]){"a"}, 10));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_family_set(family, (const char *[]){"b"}, 20));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_family_set(family, (const char *[]){"a"}, 30));
+  // The family is not visible until it replaces the samples
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(gauge->samples));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_replace(gauge, family));
+
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(gauge->samples));
+  TEST_ASSERT_NULL(prom_map_get(gauge->samples, "top_rss_bytes{comm=\"old\"}"));
+  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(gauge->samples, "top_rss_bytes{comm=\"a\"}");
+  TEST_ASSERT_NOT_NULL(sample);
+  TEST_ASSERT_EQUAL_DOUBLE(30, prom_metric_sample_value(sample));
+
+  // A family only replaces the samples of the metric it was built for
+  TEST_ASSERT_TRUE(prom_metric_replace(counter, prom_metric_family_new(gauge)) != 0);
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(gauge->samples));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_clear(gauge));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_size(gauge->samples));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_destroy(gauge));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_destroy(counter));
+}
+
+static void test_prom_metric_ttl_eviction(void) {
+  prom_gauge_t *gauge = prom_gauge_new("conn_bytes", "Bytes.", 1, prom_metric_test_keys);
+  prom_histogram_t *histogram = prom_histogram_new("conn_seconds", "Seconds.", prom_histogram_buckets_linear(1, 1, 2),
+                                                   1, prom_metric_test_keys);
+  TEST_ASSERT_NOT_NULL(gauge);
+  TEST_ASSERT_NOT_NULL(histogram);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_ttl(gauge, 10));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_ttl(histogram, 10));
+  TEST_ASSERT_TRUE(prom_metric_set_ttl(gauge, NAN) != 0);
+  TEST_ASSERT_TRUE(prom_metric_set_ttl(gauge, -1) != 0);
+
+  const char *stale[] = {"stale"};
+  const char *fresh[] = {"fresh"};
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 1, stale));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe(histogram, 1, stale));
+  uint64_t now = prom_metric_sample_clock();
+
+  // Nothing expires within the TTL
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(gauge, now));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(gauge->samples));
+
+  // Sweeping as if 11 seconds went by evicts the stale series but keeps one updated since
+  uint64_t later = now + 11000000000ULL;
+  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(gauge->samples, "conn_bytes{comm=\"stale\"}");
+  TEST_ASSERT_NOT_NULL(sample);
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 2, fresh));
+  prom_metric_sample_t *updated = (prom_metric_sample_t *)prom_map_get(gauge->samples, "conn_bytes{comm=\"fresh\"}");
+  TEST_ASSERT_NOT_NULL(updated);
+  atomic_store(&updated->updated, later);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(gauge, later));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(histogram, later));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(gauge->samples));
+  TEST_ASSERT_NULL(prom_map_get(gauge->samples, "conn_bytes{comm=\"stale\"}"));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_size(histogram->samples));
+  TEST_ASSERT_EQUAL_INT(1, atomic_load(&gauge->evicted_series));
+  TEST_ASSERT_EQUAL_INT(1, atomic_load(&histogram->evicted_series));
+
+  // The TTL is fixed once series exist
+  TEST_ASSERT_TRUE(prom_metric_set_ttl(gauge, 5) != 0);
+
+  // A handed out sample is evicted like any other, and kept until its handle is returned
+  prom_metric_sample_t *handle = prom_gauge_labels(gauge, fresh);
+  TEST_ASSERT_TRUE(handle == updated);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(gauge, later + 11000000000ULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_size(gauge->samples));
+  TEST_ASSERT_EQUAL_INT(1, prom_linked_list_size(gauge->retired));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sample_set(handle, 3));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(gauge, handle));
+  TEST_ASSERT_EQUAL_INT(0, prom_linked_list_size(gauge->retired));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_destroy(gauge));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_destroy(histogram));
+}
+
+static void test_prom_metric_handle(void) {
+  prom_gauge_t *gauge = prom_gauge_new("device_bytes", "Bytes.", 1, prom_metric_test_keys);
+  TEST_ASSERT_NOT_NULL(gauge);
+  const char *a[] = {"a"};
+  const char *b[] = {"b"};
+  const char *c[] = {"c"};
+  prom_metric_sample_t *handle = prom_gauge_labels(gauge, a);
+  prom_metric_sample_t *kept = prom_gauge_labels(gauge, b);
+  TEST_ASSERT_NOT_NULL(handle);
+  TEST_ASSERT_NOT_NULL(kept);
+  TEST_ASSERT_TRUE(handle == prom_gauge_labels(gauge, a));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sample_set(handle, 5));
+
+  // The series goes away while both handles to it stay safe to update
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_remove(gauge, a));
+  TEST_ASSERT_NULL(prom_map_get(gauge->samples, "device_bytes{comm=\"a\"}"));
+  TEST_ASSERT_EQUAL_INT(1, prom_linked_list_size(gauge->retired));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sample_set(handle, 6));
+  TEST_ASSERT_EQUAL_DOUBLE(6, prom_metric_sample_value(handle));
+
+  // The next update through the gauge starts the series again in a new sample
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_inc(gauge, a));
+  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(gauge->samples, "device_bytes{comm=\"a\"}");
+  TEST_ASSERT_NOT_NULL(sample);
+  TEST_ASSERT_TRUE(sample != handle);
+  TEST_ASSERT_EQUAL_DOUBLE(1, prom_metric_sample_value(sample));
+
+  // The removed sample is freed with its last handle
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(gauge, handle));
+  TEST_ASSERT_EQUAL_INT(1, prom_linked_list_size(gauge->retired));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(gauge, handle));
+  TEST_ASSERT_EQUAL_INT(0, prom_linked_list_size(gauge->retired));
+
+  // Returning the handle of an exposed series leaves the series in place
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(gauge, prom_gauge_labels(gauge, c)));
+  TEST_ASSERT_NOT_NULL(prom_map_get(gauge->samples, "device_bytes{comm=\"c\"}"));
+
+  // Clearing and a TTL work on a gauge with handles out, and samples never returned are freed with the gauge
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_clear(gauge));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_size(gauge->samples));
+  TEST_ASSERT_EQUAL_INT(1, prom_linked_list_size(gauge->retired));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sample_add(kept, 1));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_ttl(gauge, 1));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_destroy(gauge));
+}
+
+static void test_prom_metric_series_limit(void) {
+  prom_gauge_t *gauge = prom_gauge_new("capped", "Capped.", 1, prom_metric_test_keys);
+  TEST_ASSERT_NOT_NULL(gauge);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_series_limit(gauge, 2));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 1, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 2, (const char *[]){"b"}));
+  TEST_ASSERT_TRUE(prom_gauge_set(gauge, 3, (const char *[]){"c"}) != 0);
+  // Existing series keep being updated
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 4, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(gauge->samples));
+  TEST_ASSERT_EQUAL_INT(1, atomic_load(&gauge->dropped_series));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_destroy(gauge));
+}
+
+static void test_prom_metric_integer(void) {
+  prom_gauge_t *gauge = prom_gauge_new_int("procs", "Processes.", 0, NULL);
+  TEST_ASSERT_NOT_NULL(gauge);
+  prom_metric_sample_t *sample = prom_gauge_labels(gauge, NULL);
+  TEST_ASSERT_NOT_NULL(sample);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set_int(gauge, INT64_MAX, NULL));
+  TEST_ASSERT_EQUAL_INT(INT64_MAX, atomic_load(&sample->i_value));
+  // Sets round to the nearest integer, halves away from zero
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 0.49999999999999994, NULL));
+  TEST_ASSERT_EQUAL_INT(0, atomic_load(&sample->i_value));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, -2.5, NULL));
+  TEST_ASSERT_EQUAL_INT(-3, atomic_load(&sample->i_value));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, -9223372036854775808.0, NULL));
+  TEST_ASSERT_EQUAL_INT(INT64_MIN, atomic_load(&sample->i_value));
+
+  // Values an int64_t cannot hold are refused and leave the sample alone
+  TEST_ASSERT_TRUE(prom_gauge_set(gauge, NAN, NULL) != 0);
+  TEST_ASSERT_TRUE(prom_gauge_set(gauge, INFINITY, NULL) != 0);
+  TEST_ASSERT_TRUE(prom_gauge_set(gauge, 9223372036854775808.0, NULL) != 0);
+  TEST_ASSERT_EQUAL_INT(INT64_MIN, atomic_load(&sample->i_value));
+
+  // Fractions would be lost on every add, so they are refused
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set_int(gauge, 10, NULL));
+  TEST_ASSERT_TRUE(prom_gauge_add(gauge, 0.5, NULL) != 0);
+  TEST_ASSERT_TRUE(prom_gauge_sub(gauge, 0.5, NULL) != 0);
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_add(gauge, 3, NULL));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_sub(gauge, 1, NULL));
+  TEST_ASSERT_EQUAL_INT(12, atomic_load(&sample->i_value));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_destroy(gauge));
+}
+
+#define PROM_METRIC_TEST_THREADS 8
+#define PROM_METRIC_TEST_INCREMENTS 20000
+
+static prom_counter_t *prom_metric_test_sharded = NULL;
+
+// Adds 0.5 and 1.5 alternately through labels and a handle; both are exact in binary, so the sum is too
+static void *prom_metric_test_increment(void *data) {
+  (void)data;
+  prom_metric_sample_t *handle = prom_counter_labels(prom_metric_test_sharded, (const char *[]){"handle"});
+  for (int i = 0; i < PROM_METRIC_TEST_INCREMENTS; i++) {
+    prom_counter_add(prom_metric_test_sharded, i % 2 ? 1.5 : 0.5, (const char *[]){"labels"});
+    prom_metric_sample_add(handle, i % 2 ? 1.5 : 0.5);
+  }
+  prom_metric_return_sample(prom_metric_test_sharded, handle);
+  return NULL;
+}
+
+static void test_prom_metric_sharded_counter(void) {
+  prom_metric_test_sharded = prom_counter_new_sharded("requests_total", "Requests.", 1, (const char *[]){"path"});
+  TEST_ASSERT_NOT_NULL(prom_metric_test_sharded);
+
+  pthread_t threads[PROM_METRIC_TEST_THREADS];
+  for (int i = 0; i < PROM_METRIC_TEST_THREADS; i++) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, &prom_metric_test_increment, NULL));
+  }
+  for (int i = 0; i < PROM_METRIC_TEST_THREADS; i++) pthread_join(threads[i], NULL);
+
+  // Every increment lands in some shard and the value is their sum
+  const double expected = PROM_METRIC_TEST_THREADS * PROM_METRIC_TEST_INCREMENTS;
+  const char *paths[] = {"labels", "handle"};
+  for (int i = 0; i < 2; i++) {
+    prom_metric_sample_t *sample = prom_counter_labels(prom_metric_test_sharded, (const char *[]){paths[i]});
+    TEST_ASSERT_NOT_NULL(sample);
+    TEST_ASSERT_EQUAL_INT(prom_metric_sample_shard_count(), sample->shard_count);
+    TEST_ASSERT_EQUAL_DOUBLE(expected, prom_metric_sample_value(sample));
+    TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(prom_metric_test_sharded, sample));
+  }
+
+  // Shard indexes are masked, so the count is a power of two
+  size_t shard_count = prom_metric_sample_shard_count();
+  TEST_ASSERT_TRUE(shard_count > 0 && (shard_count & (shard_count - 1)) == 0);
+
+  // Loading a value replaces the sum of the shards
+  prom_metric_sample_t *sample = prom_counter_labels(prom_metric_test_sharded, (const char *[]){"labels"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sample_load(sample, 7));
+  TEST_ASSERT_EQUAL_DOUBLE(7, prom_metric_sample_value(sample));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sample_add(sample, 1));
+  TEST_ASSERT_EQUAL_DOUBLE(8, prom_metric_sample_value(sample));
+  TEST_ASSERT_TRUE(prom_metric_sample_add(sample, -1) != 0);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_return_sample(prom_metric_test_sharded, sample));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_destroy(prom_metric_test_sharded));
+  prom_metric_test_sharded = NULL;
+}
+
+int main(void) {
+  RUN_TEST(test_prom_metric_remove);
+  RUN_TEST(test_prom_metric_replace);
+  RUN_TEST(test_prom_metric_ttl_eviction);
+  RUN_TEST(test_prom_metric_handle);
+  RUN_TEST(test_prom_metric_series_limit);
+  RUN_TEST(test_prom_metric_integer);
+  RUN_TEST(test_prom_metric_sharded_counter);
+  return PROM_TEST_RESULT();
+}
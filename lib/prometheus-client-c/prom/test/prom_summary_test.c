@@ -0,0 +1,149 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "prom.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_quantile_stream_i.h"
+#include "prom_test_helpers.h"
+
+#define PROM_SUMMARY_TEST_OBSERVATIONS 100000
+#define PROM_SUMMARY_TEST_BATCH 512
+
+static int prom_summary_test_compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void prom_summary_test_sleep(double seconds) {
+  struct timespec ts = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+  nanosleep(&ts, NULL);
+}
+
+// Feeds 1 through PROM_SUMMARY_TEST_OBSERVATIONS in shuffled, sorted batches; the true rank of a value is the value
+static void test_prom_quantile_stream_rank_error(void) {
+  const double quantiles[] = {0.01, 0.5, 0.9, 0.99, 0.999};
+  const double errors[] = {0.001, 0.05, 0.01, 0.001, 0.0001};
+  const size_t target_count = sizeof(quantiles) / sizeof(quantiles[0]);
+  prom_quantile_stream_t *stream = prom_quantile_stream_new(target_count, quantiles, errors);
+  TEST_ASSERT_NOT_NULL(stream);
+  TEST_ASSERT_TRUE(isnan(prom_quantile_stream_query(stream, 0.5)));
+
+  double *values = (double *)malloc(PROM_SUMMARY_TEST_OBSERVATIONS * sizeof(double));
+  for (size_t i = 0; i < PROM_SUMMARY_TEST_OBSERVATIONS; i++) values[i] = (double)(i + 1);
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+  for (size_t i = PROM_SUMMARY_TEST_OBSERVATIONS - 1; i > 0; i--) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    size_t j = state % (i + 1);
+    double swap = values[i];
+    values[i] = values[j];
+    values[j] = swap;
+  }
+
+  prom_quantile_sample_t *scratch = NULL;
+  size_t scratch_allocated = 0;
+  for (size_t i = 0; i < PROM_SUMMARY_TEST_OBSERVATIONS; i += PROM_SUMMARY_TEST_BATCH) {
+    size_t count = PROM_SUMMARY_TEST_OBSERVATIONS - i;
+    if (count > PROM_SUMMARY_TEST_BATCH) count = PROM_SUMMARY_TEST_BATCH;
+    qsort(values + i, count, sizeof(double), &prom_summary_test_compare);
+    TEST_ASSERT_EQUAL_INT(0, prom_quantile_stream_merge(stream, values + i, count, &scratch, &scratch_allocated));
+  }
+
+  for (size_t i = 0; i < target_count; i++) {
+    double rank = prom_quantile_stream_query(stream, quantiles[i]);
+    double allowed = errors[i] * PROM_SUMMARY_TEST_OBSERVATIONS;
+    TEST_ASSERT_TRUE(fabs(rank - quantiles[i] * PROM_SUMMARY_TEST_OBSERVATIONS) <= allowed);
+  }
+  // The sketch keeps a small subset of the values
+  TEST_ASSERT_TRUE(stream->len < PROM_SUMMARY_TEST_OBSERVATIONS / 20);
+
+  // A reset sketch starts over
+  prom_quantile_stream_reset(stream);
+  TEST_ASSERT_TRUE(isnan(prom_quantile_stream_query(stream, 0.5)));
+  double one = 1.0;
+  TEST_ASSERT_EQUAL_INT(0, prom_quantile_stream_merge(stream, &one, 1, &scratch, &scratch_allocated));
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_quantile_stream_query(stream, 0.99));
+
+  free(scratch);
+  free(values);
+  TEST_ASSERT_EQUAL_INT(0, prom_quantile_stream_destroy(stream));
+}
+
+// Reads the quantiles and count of the unlabeled sample of summary
+static void prom_summary_test_collect(prom_summary_t *summary, double *quantile_values, uint64_t *count) {
+  prom_metric_sample_summary_t *sample = prom_summary_labels(summary, NULL);
+  double sum = 0.0;
+  if (sample == NULL || prom_metric_sample_summary_collect(sample, quantile_values, count, &sum)) *count = UINT64_MAX;
+  prom_metric_return_sample(summary, sample);
+}
+
+static void prom_summary_test_observe(prom_summary_t *summary, double value, int times) {
+  for (int i = 0; i < times; i++) prom_summary_observe(summary, value, NULL);
+}
+
+// With two sketches started 0.2s apart over a 0.4s window, values leave the quantiles two rotations after they were
+// observed while the count keeps them
+static void test_prom_summary_rotation(void) {
+  const double quantiles[] = {0.1, 0.9};
+  const double errors[] = {0.01, 0.01};
+  prom_summary_t *summary = prom_summary_new("run_seconds", "Run.", 2, quantiles, errors, 0.4, 2, 0, NULL);
+  TEST_ASSERT_NOT_NULL(summary);
+  double values[2];
+  uint64_t count = 0;
+
+  prom_summary_test_observe(summary, 1.0, 1000);
+  prom_summary_test_collect(summary, values, &count);
+  TEST_ASSERT_EQUAL_INT(1000, count);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, values[1]);
+
+  // The first rotation resets the sketch started first; the other one still holds the old values
+  prom_summary_test_sleep(0.25);
+  prom_summary_test_collect(summary, values, &count);
+  prom_summary_test_observe(summary, 100.0, 1000);
+  prom_summary_test_collect(summary, values, &count);
+  TEST_ASSERT_EQUAL_INT(2000, count);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, values[0]);
+  TEST_ASSERT_EQUAL_DOUBLE(100.0, values[1]);
+
+  // The second rotation leaves the sketch that only saw the new values
+  prom_summary_test_sleep(0.25);
+  prom_summary_test_collect(summary, values, &count);
+  TEST_ASSERT_EQUAL_INT(2000, count);
+  TEST_ASSERT_EQUAL_DOUBLE(100.0, values[0]);
+  TEST_ASSERT_EQUAL_DOUBLE(100.0, values[1]);
+
+  // Once nothing was merged for a whole window every sketch is stale
+  prom_summary_test_sleep(0.65);
+  prom_summary_test_collect(summary, values, &count);
+  TEST_ASSERT_EQUAL_INT(2000, count);
+  TEST_ASSERT_TRUE(isnan(values[0]) && isnan(values[1]));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_summary_destroy(summary));
+}
+
+int main(void) {
+  RUN_TEST(test_prom_quantile_stream_rank_error);
+  RUN_TEST(test_prom_summary_rotation);
+  return PROM_TEST_RESULT();
+}
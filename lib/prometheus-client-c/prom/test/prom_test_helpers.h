@@ -0,0 +1,116 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file prom_test_helpers.h
+ * @brief The assertions of the tests, named after Unity's so the suites read alike.
+ *
+ * A failed assertion reports its location and returns from the test function, and the test program fails once all of
+ * its tests ran.
+ */
+
+#ifndef PROM_TEST_HELPERS_H
+#define PROM_TEST_HELPERS_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static int prom_test_failures = 0;
+
+#define PROM_TEST_FAIL(message)                                                \
+  do {                                                                         \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, __func__, message); \
+    prom_test_failures++;                                                      \
+    return;                                                                    \
+  } while (0)
+
+#define TEST_ASSERT_TRUE(condition)                           \
+  do {                                                        \
+    if (!(condition)) PROM_TEST_FAIL("expected " #condition); \
+  } while (0)
+
+#define TEST_ASSERT_NULL(pointer) TEST_ASSERT_TRUE((pointer) == NULL)
+
+#define TEST_ASSERT_NOT_NULL(pointer) TEST_ASSERT_TRUE((pointer) != NULL)
+
+#define TEST_ASSERT_EQUAL_INT(expected, actual)                                                   \
+  do {                                                                                            \
+    long long prom_test_expected = (long long)(expected), prom_test_actual = (long long)(actual); \
+    if (prom_test_expected != prom_test_actual) {                                                 \
+      char prom_test_message[128];                                                                \
+      snprintf(prom_test_message, sizeof(prom_test_message), "expected %lld, was %lld",           \
+               prom_test_expected, prom_test_actual);                                             \
+      PROM_TEST_FAIL(prom_test_message);                                                          \
+    }                                                                                             \
+  } while (0)
+
+#define TEST_ASSERT_EQUAL_DOUBLE(expected, actual)                                        \
+  do {                                                                                    \
+    double prom_test_expected = (expected), prom_test_actual = (actual);                  \
+    if (fabs(prom_test_expected - prom_test_actual) > 1e-9 * fabs(prom_test_expected)) {  \
+      char prom_test_message[128];                                                        \
+      snprintf(prom_test_message, sizeof(prom_test_message), "expected %.17g, was %.17g", \
+               prom_test_expected, prom_test_actual);                                     \
+      PROM_TEST_FAIL(prom_test_message);                                                  \
+    }                                                                                     \
+  } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING(expected, actual)                                       \
+  do {                                                                                   \
+    const char *prom_test_expected = (expected), *prom_test_actual = (actual);           \
+    if (prom_test_actual == NULL || strcmp(prom_test_expected, prom_test_actual) != 0) { \
+      fprintf(stderr, "expected:\n%s\nwas:\n%s\n", prom_test_expected,                   \
+              prom_test_actual == NULL ? "(null)" : prom_test_actual);                   \
+      PROM_TEST_FAIL("strings differ");                                                  \
+    }                                                                                    \
+  } while (0)
+
+#define RUN_TEST(test)                                                                           \
+  do {                                                                                           \
+    int prom_test_failures_before = prom_test_failures;                                          \
+    test();                                                                                      \
+    printf("%s %s\n", #test, prom_test_failures == prom_test_failures_before ? "PASS" : "FAIL"); \
+  } while (0)
+
+#define PROM_TEST_RESULT() (prom_test_failures == 0 ? 0 : 1)
+
+/**
+ * @brief Returns whether the len bytes of text match pattern, in which '*' stands for any run of bytes within a line.
+ * Used for pages that carry timestamps.
+ */
+static inline bool prom_test_match(const char *pattern, const char *text, size_t len) {
+  const char *end = text + len;
+  while (*pattern != '\0') {
+    if (*pattern == '*') {
+      pattern++;
+      // The rest of the line is matched from every position the wildcard may stop at
+      for (const char *stop = text; stop <= end; stop++) {
+        if (prom_test_match(pattern, stop, end - stop)) return true;
+        if (stop == end || *stop == '\n') break;
+      }
+      return false;
+    }
+    if (text == end || *pattern != *text) return false;
+    pattern++;
+    text++;
+  }
+  return text == end;
+}
+
+#endif  // PROM_TEST_HELPERS_H
@@ -0,0 +1,152 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures the CPU cost of compressing an exposition page against the bytes it saves, for every zlib level and both
+ * codings, plus the cost of rendering a page and of serving a cached body for an unchanged page.
+ *
+ * The page mimics a host agent: per-CPU, per-device and per-process series with labels.
+ *
+ * Usage: promhttp_compress_bench [scale] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom.h"
+#include "promhttp_compress_i.h"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_populate(prom_collector_registry_t *registry, int scale) {
+  const char *cpu_keys[] = {"cpu", "mode"};
+  const char *modes[] = {"user", "nice", "system", "idle", "iowait", "irq", "softirq", "steal"};
+  prom_gauge_t *cpu = prom_gauge_new("node_cpu_seconds_total", "Seconds the CPUs spent in each mode.", 2, cpu_keys);
+
+  const char *disk_keys[] = {"device"};
+  prom_gauge_t *reads = prom_gauge_new("node_disk_reads_completed_total", "Reads completed.", 1, disk_keys);
+  prom_gauge_t *writes = prom_gauge_new("node_disk_writes_completed_total", "Writes completed.", 1, disk_keys);
+
+  const char *proc_keys[] = {"pid", "comm"};
+  prom_gauge_t *rss = prom_gauge_new("process_resident_memory_bytes_by_pid", "Resident memory by process.", 2,
+                                     proc_keys);
+
+  char a[32];
+  char b[32];
+  for (int i = 0; i < 16 * scale; i++) {
+    snprintf(a, sizeof(a), "%d", i);
+    for (int m = 0; m < 8; m++) {
+      const char *values[] = {a, modes[m]};
+      prom_gauge_set(cpu, 1000.0 * i + m + 0.25, values);
+    }
+  }
+  for (int i = 0; i < 8 * scale; i++) {
+    snprintf(a, sizeof(a), "nvme%dn1", i);
+    const char *values[] = {a};
+    prom_gauge_set(reads, 123456.0 * (i + 1), values);
+    prom_gauge_set(writes, 654321.0 * (i + 1), values);
+  }
+  for (int i = 0; i < 64 * scale; i++) {
+    snprintf(a, sizeof(a), "%d", 1000 + i * 7);
+    snprintf(b, sizeof(b), "worker-%d", i % 13);
+    const char *values[] = {a, b};
+    prom_gauge_set(rss, 4096.0 * (i * 31 % 977), values);
+  }
+
+  prom_collector_t *collector = prom_collector_new("bench");
+  prom_collector_add_metric(collector, cpu);
+  prom_collector_add_metric(collector, reads);
+  prom_collector_add_metric(collector, writes);
+  prom_collector_add_metric(collector, rss);
+  prom_collector_registry_register_collector(registry, collector);
+}
+
+int main(int argc, char **argv) {
+  int scale = argc > 1 ? atoi(argv[1]) : 16;
+  int iterations = argc > 2 ? atoi(argv[2]) : 50;
+  if (scale < 1) scale = 1;
+  if (iterations < 1) iterations = 1;
+
+  prom_collector_registry_t *registry = prom_collector_registry_new("bench");
+  bench_populate(registry, scale);
+  char *page = (char *)prom_collector_registry_bridge(registry);
+  size_t page_len = strlen(page);
+
+  printf("page: %zu bytes, %d iterations per row\n\n", page_len, iterations);
+  printf("%-8s %5s %12s %10s %10s %12s\n", "coding", "level", "bytes", "saved", "us/page", "MB/s");
+
+  for (int encoding = PROMHTTP_ENCODING_GZIP; encoding <= PROMHTTP_ENCODING_DEFLATE; encoding++) {
+    for (int level = 1; level <= 9; level++) {
+      promhttp_compressor_t *compressor = promhttp_compressor_new(level);
+      unsigned char *out = NULL;
+      size_t out_len = 0;
+      size_t out_allocated = 0;
+
+      double start = bench_now();
+      for (int i = 0; i < iterations; i++) {
+        if (promhttp_compressor_compress(compressor, encoding, page, page_len, &out, &out_len, &out_allocated)) {
+          fprintf(stderr, "compression failed\n");
+          return 1;
+        }
+      }
+      double per_page = (bench_now() - start) / iterations;
+
+      printf("%-8s %5d %12zu %9.1f%% %10.1f %12.1f\n", promhttp_encoding_map[encoding], level, out_len,
+             100.0 * (1.0 - (double)out_len / (double)page_len), per_page * 1e6, page_len / per_page / 1e6);
+      free(out);
+      promhttp_compressor_destroy(compressor);
+    }
+  }
+
+  // Rendering into a leased formatter skips the copy and the regrowth that prom_collector_registry_bridge pays
+  double start = bench_now();
+  for (int i = 0; i < iterations; i++) free((char *)prom_collector_registry_bridge(registry));
+  printf("\nrender with prom_collector_registry_bridge: %.1f us/page\n", (bench_now() - start) / iterations * 1e6);
+  start = bench_now();
+  for (int i = 0; i < iterations; i++) {
+    size_t len = 0;
+    prom_collector_registry_bridge_return(registry, prom_collector_registry_bridge_lease(registry, &len));
+  }
+  printf("render with prom_collector_registry_bridge_lease: %.1f us/page\n", (bench_now() - start) / iterations * 1e6);
+
+  // Serving an unchanged page only costs a render, a comparison and a reference to the compressed body
+  promhttp_compression_cache_t *cache = promhttp_compression_cache_new(1);
+  start = bench_now();
+  for (int i = 0; i < iterations; i++) {
+    size_t len = 0;
+    const char *text = prom_collector_registry_bridge_lease(registry, &len);
+    promhttp_body_t *body = NULL;
+    if (promhttp_compression_cache_get(cache, registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, NULL, NULL, 0,
+                                       PROMHTTP_ENCODING_GZIP, text, len, &body)) {
+      fprintf(stderr, "cache lookup failed\n");
+      return 1;
+    }
+    prom_collector_registry_bridge_return(registry, text);
+    promhttp_body_release(body);
+  }
+  printf("cached gzip body for an unchanged page: %.1f us/page\n", (bench_now() - start) / iterations * 1e6);
+
+  promhttp_compression_cache_destroy(cache);
+  free(page);
+  prom_collector_registry_destroy(registry);
+  return 0;
+}
@@ -23,6 +23,7 @@
  * https://www.gnu.org/software/libmicrohttpd/manual/libmicrohttpd.html#index-_002aMHD_005fAcceptPolicyCallback
  */
 
+#include <stdbool.h>
 #include <string.h>
 
 #include "microhttpd.h"
@@ -36,9 +37,49 @@
  */
 void promhttp_set_active_collector_registry(prom_collector_registry_t *active_registry);
 
+/**
+ * @brief Sets the zlib level used to compress /metrics responses.
+ *
+ * Responses are compressed with gzip or deflate when the scraper's Accept-Encoding header allows it. The compressed
+ * body is cached with the page it was produced from, so scrapes that render an identical page are not recompressed.
+ * This MUST be called before promhttp_start_daemon. The default level is 1.
+ *
+ * @param level 1 (fastest) through 9 (smallest output). Pass 0 to disable compression.
+ * @return A non-zero integer value upon failure
+ */
+int promhttp_set_compression_level(int level);
+
+/**
+ * @brief Streams uncompressed /metrics responses instead of rendering the whole page before sending it.
+ *
+ * The page is rendered a few kilobytes at a time while it is being sent with chunked transfer encoding, which bounds
+ * memory for very large registries and lets the scraper receive data while later collectors are still rendering.
+ * Responses compressed per promhttp_set_compression_level are never streamed. Streaming is disabled by default.
+ *
+ * @param enabled true to stream responses
+ */
+void promhttp_set_streaming(bool enabled);
+
 /**
  *  @brief Starts a daemon in the background and returns a pointer to an HMD_Daemon.
  *
+ * /metrics serves the text exposition format unless the scraper's Accept header prefers the delimited protobuf format
+ * (application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; encoding=delimited) or OpenMetrics
+ * (application/openmetrics-text; version=1.0.0).
+ *
+ * Scrapers may restrict /metrics to some metric families with name[] query arguments, each a metric name or a prefix
+ * followed by '*', e.g. /metrics?name[]=node_cpu_*&name[]=node_memory_bytes. Up to 64 are accepted.
+ *
+ * /metrics/<collector> serves only the named collector of the active registry, so collectors can be scraped at
+ * different intervals; unknown names get a 404. It accepts the same formats and name[] selectors as /metrics. See
+ * prom_collector_set_cache_ttl for collectors that are too expensive to render on every scrape.
+ *
+ * Uncompressed, unfiltered pages are sent as one buffer per collector with MHD_create_response_from_iovec, so they are
+ * never joined into one string; see prom_collector_registry_set_render_threads to render those buffers in parallel.
+ *
+ * Every scrape of /metrics is recorded with prom_collector_registry_observe_scrape, so its duration and size show up in
+ * the metrics of prom_collector_registry_enable_self_metrics.
+ *
  * References:
  *  * https://www.gnu.org/software/libmicrohttpd/manual/libmicrohttpd.html#microhttpd_002dinit
  *
@@ -14,13 +14,33 @@
  * limitations under the License.
  */
 
+#include <stdbool.h>
 #include <string.h>
+#include <time.h>
 
 #include "microhttpd.h"
 #include "prom.h"
+#include "prom_alloc.h"
+#include "promhttp_compress_i.h"
+#include "promhttp_format_i.h"
+
+// The zlib level used when a scraper accepts gzip or deflate. Level 1 already removes most of the redundancy of the
+// text exposition format; see bench/promhttp_compress_bench.c.
+#define PROMHTTP_DEFAULT_COMPRESSION_LEVEL 1
+
+// The size of the buffer libmicrohttpd hands to the stream reader when streaming is enabled
+#define PROMHTTP_STREAM_BLOCK_SIZE (32 * 1024)
+
+// The most name[] selectors a single scrape may pass
+#define PROMHTTP_MAX_SELECTORS 64
 
 prom_collector_registry_t *PROM_ACTIVE_REGISTRY;
 
+static int promhttp_compression_level = PROMHTTP_DEFAULT_COMPRESSION_LEVEL;
+// One cache per exposition format so scrapers asking for different formats do not evict each other's bodies
+static promhttp_compression_cache_t *promhttp_compression_cache = NULL;
+static bool promhttp_streaming = false;
+
 void promhttp_set_active_collector_registry(prom_collector_registry_t *active_registry) {
   if (!active_registry) {
     PROM_ACTIVE_REGISTRY = PROM_COLLECTOR_REGISTRY_DEFAULT;
@@ -29,6 +49,213 @@ void promhttp_set_active_collector_registry(prom_collector_registry_t *active_re
   }
 }
 
+int promhttp_set_compression_level(int level) {
+  if (level < 0 || level > 9) return 1;
+  promhttp_compression_level = level;
+  return 0;
+}
+
+// Ties a leased page to the registry it must be returned to once libmicrohttpd has sent it
+typedef struct promhttp_lease {
+  prom_collector_registry_t *registry;
+  const char *page;
+} promhttp_lease_t;
+
+static void promhttp_lease_return(void *cls) {
+  promhttp_lease_t *lease = (promhttp_lease_t *)cls;
+  prom_collector_registry_bridge_return(lease->registry, lease->page);
+  prom_free(lease);
+}
+
+// Ties pieces of a page to the registry they must be returned to once libmicrohttpd has sent them
+typedef struct promhttp_parts_lease {
+  prom_collector_registry_t *registry;
+  const prom_collector_registry_part_t *parts;
+} promhttp_parts_lease_t;
+
+static void promhttp_parts_lease_return(void *cls) {
+  promhttp_parts_lease_t *lease = (promhttp_parts_lease_t *)cls;
+  prom_collector_registry_bridge_return_parts(lease->registry, lease->parts);
+  prom_free(lease);
+}
+
+void promhttp_set_streaming(bool enabled) { promhttp_streaming = enabled; }
+
+static double promhttp_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// A streamed scrape is recorded once libmicrohttpd is done with it, when its duration and size are known
+typedef struct promhttp_stream {
+  prom_collector_registry_stream_t *stream;
+  prom_collector_registry_t *registry;
+  double start;
+  size_t bytes;
+} promhttp_stream_t;
+
+static ssize_t promhttp_stream_read(void *cls, uint64_t pos, char *buf, size_t max) {
+  promhttp_stream_t *self = (promhttp_stream_t *)cls;
+  size_t len = 0;
+  if (prom_collector_registry_stream_read(self->stream, buf, max, &len)) {
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  }
+  if (len == 0) return MHD_CONTENT_READER_END_OF_STREAM;
+  self->bytes += len;
+  return (ssize_t)len;
+}
+
+static void promhttp_stream_free(void *cls) {
+  promhttp_stream_t *self = (promhttp_stream_t *)cls;
+  prom_collector_registry_observe_scrape(self->registry, promhttp_now() - self->start, self->bytes);
+  prom_collector_registry_stream_destroy(self->stream);
+  prom_free(self);
+}
+
+static void promhttp_add_metrics_headers(struct MHD_Response *response, prom_collector_registry_format_t format) {
+  MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, promhttp_format_content_type[format]);
+  if (promhttp_compression_level > 0) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, "Accept, Accept-Encoding");
+  } else {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, MHD_HTTP_HEADER_ACCEPT);
+  }
+}
+
+// The name[] query arguments of a scrape, e.g. /metrics?name[]=node_cpu_*&name[]=node_memory_bytes
+typedef struct promhttp_selectors {
+  const char *selectors[PROMHTTP_MAX_SELECTORS];
+  size_t count;
+  bool invalid;
+} promhttp_selectors_t;
+
+static enum MHD_Result promhttp_selectors_add(void *cls, enum MHD_ValueKind kind, const char *key, const char *value) {
+  promhttp_selectors_t *self = (promhttp_selectors_t *)cls;
+  if (strcmp(key, "name[]") != 0 && strcmp(key, "name") != 0) return MHD_YES;
+  if (value == NULL || self->count == PROMHTTP_MAX_SELECTORS || prom_collector_registry_validate_selector(value)) {
+    self->invalid = true;
+    return MHD_NO;
+  }
+  self->selectors[self->count++] = value;
+  return MHD_YES;
+}
+
+// Renders the page of a scrape that is neither streamed nor sent in pieces
+static const char *promhttp_lease_page(prom_collector_registry_t *registry, prom_collector_registry_format_t format,
+                                       const char *collector_name, promhttp_selectors_t *selectors, size_t *len) {
+  if (collector_name != NULL || selectors->count > 0) {
+    return prom_collector_registry_bridge_lease_collector(registry, format, collector_name,
+                                                          selectors->count > 0 ? selectors->selectors : NULL,
+                                                          selectors->count, len);
+  }
+  return prom_collector_registry_bridge_lease_format(registry, format, len);
+}
+
+static struct MHD_Response *promhttp_metrics_response(struct MHD_Connection *connection, const char *collector_name,
+                                                      promhttp_selectors_t *selectors) {
+  prom_collector_registry_t *registry = PROM_ACTIVE_REGISTRY;
+  double start = promhttp_now();
+
+  prom_collector_registry_format_t format =
+      promhttp_format_negotiate(MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT));
+
+  promhttp_encoding_t encoding = PROMHTTP_ENCODING_IDENTITY;
+  if (promhttp_compression_cache != NULL) {
+    encoding = promhttp_encoding_negotiate(
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING));
+  }
+
+  // Compressed bodies are cached whole, so only uncompressed scrapes are streamed. Selections and single collectors are
+  // small enough to render at once.
+  if (promhttp_streaming && encoding == PROMHTTP_ENCODING_IDENTITY && format == PROM_COLLECTOR_REGISTRY_FORMAT_TEXT &&
+      selectors->count == 0 && collector_name == NULL) {
+    prom_collector_registry_stream_t *registry_stream = prom_collector_registry_stream_new(registry);
+    if (registry_stream == NULL) return NULL;
+    promhttp_stream_t *stream = (promhttp_stream_t *)prom_malloc(sizeof(promhttp_stream_t));
+    stream->stream = registry_stream;
+    stream->registry = registry;
+    stream->start = start;
+    stream->bytes = 0;
+    struct MHD_Response *response = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN, PROMHTTP_STREAM_BLOCK_SIZE, &promhttp_stream_read, stream, &promhttp_stream_free);
+    if (response == NULL) {
+      prom_collector_registry_stream_destroy(registry_stream);
+      prom_free(stream);
+      return NULL;
+    }
+    promhttp_add_metrics_headers(response, format);
+    return response;
+  }
+
+  size_t len = 0;
+
+  // Uncompressed full pages are sent straight from the buffer of each collector, which the registry may render in
+  // parallel
+  if (encoding == PROMHTTP_ENCODING_IDENTITY && selectors->count == 0 && collector_name == NULL) {
+    size_t count = 0;
+    const prom_collector_registry_part_t *parts =
+        prom_collector_registry_bridge_lease_parts(registry, format, &count, &len);
+    if (parts == NULL) return NULL;
+
+    // libmicrohttpd copies the iovec array, but not the buffers it points to
+    struct MHD_IoVec *iov = (struct MHD_IoVec *)prom_malloc((count + 1) * sizeof(struct MHD_IoVec));
+    for (size_t i = 0; i < count; i++) {
+      iov[i].iov_base = parts[i].data;
+      iov[i].iov_len = parts[i].len;
+    }
+    promhttp_parts_lease_t *lease = (promhttp_parts_lease_t *)prom_malloc(sizeof(promhttp_parts_lease_t));
+    lease->registry = registry;
+    lease->parts = parts;
+    struct MHD_Response *response =
+        MHD_create_response_from_iovec(iov, (unsigned int)count, &promhttp_parts_lease_return, lease);
+    prom_free(iov);
+    if (response == NULL) {
+      promhttp_parts_lease_return(lease);
+      return NULL;
+    }
+    promhttp_add_metrics_headers(response, format);
+    prom_collector_registry_observe_scrape(registry, promhttp_now() - start, len);
+    return response;
+  }
+
+  const char *buf = promhttp_lease_page(registry, format, collector_name, selectors, &len);
+  if (buf == NULL) return NULL;
+
+  struct MHD_Response *response = NULL;
+  if (encoding != PROMHTTP_ENCODING_IDENTITY) {
+    promhttp_body_t *body = NULL;
+    if (promhttp_compression_cache_get(promhttp_compression_cache, registry, format, collector_name,
+                                       selectors->selectors, selectors->count, encoding, buf, len, &body) == 0) {
+      // The cache keeps its own copy of the page, so the lease goes straight back to the pool
+      prom_collector_registry_bridge_return(registry, buf);
+      buf = NULL;
+
+      // The response holds a reference to the cached body instead of a copy of it
+      response = MHD_create_response_from_buffer_with_free_callback_cls(body->len, body->data, &promhttp_body_release,
+                                                                        body);
+      if (response == NULL) {
+        promhttp_body_release(body);
+        return NULL;
+      }
+      MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, promhttp_encoding_map[encoding]);
+    }
+    // On failure the page is served uncompressed below
+  }
+  if (response == NULL) {
+    promhttp_lease_t *lease = (promhttp_lease_t *)prom_malloc(sizeof(promhttp_lease_t));
+    lease->registry = registry;
+    lease->page = buf;
+    response = MHD_create_response_from_buffer_with_free_callback_cls(len, (void *)buf, &promhttp_lease_return, lease);
+    if (response == NULL) {
+      promhttp_lease_return(lease);
+      return NULL;
+    }
+  }
+  promhttp_add_metrics_headers(response, format);
+  prom_collector_registry_observe_scrape(registry, promhttp_now() - start, len);
+  return response;
+}
+
 enum MHD_Result promhttp_handler(void *cls, struct MHD_Connection *connection, const char *url, const char *method,
                      const char *version, const char *upload_data, size_t *upload_data_size, void **con_cls) {
   if (strcmp(method, "GET") != 0) {
@@ -45,9 +272,40 @@ enum MHD_Result promhttp_handler(void *cls, struct MHD_Connection *connection, c
     MHD_destroy_response(response);
     return ret;
   }
-  if (strcmp(url, "/metrics") == 0) {
-    const char *buf = prom_collector_registry_bridge(PROM_ACTIVE_REGISTRY);
-    struct MHD_Response *response = MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_MUST_FREE);
+  // /metrics/<collector> renders a single collector of the active registry
+  const char *collector_name = NULL;
+  if (strncmp(url, "/metrics/", strlen("/metrics/")) == 0 && url[strlen("/metrics/")] != '\0') {
+    collector_name = url + strlen("/metrics/");
+    if (!prom_collector_registry_has_collector(PROM_ACTIVE_REGISTRY, collector_name)) {
+      char *buf = "Not Found\n";
+      struct MHD_Response *response =
+          MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_PERSISTENT);
+      int ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
+      MHD_destroy_response(response);
+      return ret;
+    }
+  }
+  if (collector_name != NULL || strcmp(url, "/metrics") == 0) {
+    promhttp_selectors_t selectors = {.count = 0, .invalid = false};
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, &promhttp_selectors_add, &selectors);
+    if (selectors.invalid) {
+      char *buf = "Bad Request\n";
+      struct MHD_Response *response =
+          MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_PERSISTENT);
+      int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+      MHD_destroy_response(response);
+      return ret;
+    }
+    // Equivalent selections share a cached compressed page
+    selectors.count = prom_collector_registry_normalize_selectors(selectors.selectors, selectors.count);
+    struct MHD_Response *response = promhttp_metrics_response(connection, collector_name, &selectors);
+    if (response == NULL) {
+      char *buf = "Internal Server Error\n";
+      response = MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_PERSISTENT);
+      int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+      MHD_destroy_response(response);
+      return ret;
+    }
     int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
     MHD_destroy_response(response);
     return ret;
@@ -61,5 +319,8 @@ enum MHD_Result promhttp_handler(void *cls, struct MHD_Connection *connection, c
 
 struct MHD_Daemon *promhttp_start_daemon(unsigned int flags, unsigned short port, MHD_AcceptPolicyCallback apc,
                                          void *apc_cls) {
+  if (promhttp_compression_level > 0 && promhttp_compression_cache == NULL) {
+    promhttp_compression_cache = promhttp_compression_cache_new(promhttp_compression_level);
+  }
   return MHD_start_daemon(flags, port, apc, apc_cls, &promhttp_handler, NULL, MHD_OPTION_END);
 }
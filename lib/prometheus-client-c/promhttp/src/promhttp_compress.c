@@ -0,0 +1,369 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "prom_alloc.h"
+#include "promhttp_compress_i.h"
+
+const char *promhttp_encoding_map[PROMHTTP_ENCODING_COUNT] = {"identity", "gzip", "deflate"};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Content negotiation
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool promhttp_encoding_token_is(const char *token, size_t len, const char *name) {
+  return strlen(name) == len && strncasecmp(token, name, len) == 0;
+}
+
+promhttp_encoding_t promhttp_encoding_negotiate(const char *accept_encoding) {
+  if (accept_encoding == NULL) return PROMHTTP_ENCODING_IDENTITY;
+
+  // A q-value of -1 means the coding was not mentioned
+  double gzip_q = -1.0;
+  double deflate_q = -1.0;
+  double any_q = -1.0;
+
+  const char *p = accept_encoding;
+  while (*p != '\0') {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == '\0') break;
+
+    const char *token = p;
+    while (*p != '\0' && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') p++;
+    size_t token_len = p - token;
+
+    // Parse parameters; only q is meaningful for Accept-Encoding
+    double q = 1.0;
+    while (*p != '\0' && *p != ',') {
+      if (*p == ';') {
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        if ((*p == 'q' || *p == 'Q') && p[1] == '=') {
+          char *end = NULL;
+          q = strtod(p + 2, &end);
+          if (end == p + 2) q = 0.0;
+          p = end;
+          continue;
+        }
+      }
+      p++;
+    }
+
+    if (promhttp_encoding_token_is(token, token_len, "gzip") ||
+        promhttp_encoding_token_is(token, token_len, "x-gzip")) {
+      gzip_q = q;
+    } else if (promhttp_encoding_token_is(token, token_len, "deflate")) {
+      deflate_q = q;
+    } else if (promhttp_encoding_token_is(token, token_len, "*")) {
+      any_q = q;
+    }
+  }
+
+  if (gzip_q < 0) gzip_q = any_q;
+  if (deflate_q < 0) deflate_q = any_q;
+
+  if (gzip_q > 0 && gzip_q >= deflate_q) return PROMHTTP_ENCODING_GZIP;
+  if (deflate_q > 0) return PROMHTTP_ENCODING_DEFLATE;
+  return PROMHTTP_ENCODING_IDENTITY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// promhttp_compressor
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+promhttp_compressor_t *promhttp_compressor_new(int level) {
+  if (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION) return NULL;
+  promhttp_compressor_t *self = (promhttp_compressor_t *)prom_malloc(sizeof(promhttp_compressor_t));
+  memset(self->streams, 0, sizeof(self->streams));
+  for (int i = 0; i < PROMHTTP_ENCODING_COUNT; i++) self->ready[i] = false;
+  self->level = level;
+  return self;
+}
+
+int promhttp_compressor_destroy(promhttp_compressor_t *self) {
+  if (self == NULL) return 0;
+  for (int i = 0; i < PROMHTTP_ENCODING_COUNT; i++) {
+    if (self->ready[i]) deflateEnd(&self->streams[i]);
+    self->ready[i] = false;
+  }
+  prom_free(self);
+  self = NULL;
+  return 0;
+}
+
+static int promhttp_compressor_prepare(promhttp_compressor_t *self, promhttp_encoding_t encoding) {
+  z_stream *stream = &self->streams[encoding];
+  if (self->ready[encoding]) return deflateReset(stream) == Z_OK ? 0 : 1;
+
+  // windowBits of 15 produces the zlib format which is what HTTP calls deflate; adding 16 produces gzip
+  int window_bits = (encoding == PROMHTTP_ENCODING_GZIP) ? 15 + 16 : 15;
+  if (deflateInit2(stream, self->level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 1;
+  self->ready[encoding] = true;
+  return 0;
+}
+
+int promhttp_compressor_compress(promhttp_compressor_t *self, promhttp_encoding_t encoding, const char *in,
+                                 size_t in_len, unsigned char **out, size_t *out_len, size_t *out_allocated) {
+  if (self == NULL) return 1;
+  if (encoding != PROMHTTP_ENCODING_GZIP && encoding != PROMHTTP_ENCODING_DEFLATE) return 1;
+  if (in_len > UINT_MAX) return 1;
+
+  int r = promhttp_compressor_prepare(self, encoding);
+  if (r) return r;
+
+  z_stream *stream = &self->streams[encoding];
+  size_t bound = deflateBound(stream, (uLong)in_len);
+  if (bound > UINT_MAX) return 1;
+  if (*out == NULL || *out_allocated < bound) {
+    *out = (unsigned char *)prom_realloc(*out, bound);
+    if (*out == NULL) {
+      *out_allocated = 0;
+      return 1;
+    }
+    *out_allocated = bound;
+  }
+
+  stream->next_in = (Bytef *)in;
+  stream->avail_in = (uInt)in_len;
+  stream->next_out = (Bytef *)*out;
+  stream->avail_out = (uInt)bound;
+
+  // deflateBound guarantees a single Z_FINISH call completes the stream
+  if (deflate(stream, Z_FINISH) != Z_STREAM_END) return 1;
+  *out_len = stream->total_out;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// promhttp_compression_cache
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static promhttp_body_t *promhttp_body_new(void) {
+  promhttp_body_t *self = (promhttp_body_t *)prom_malloc(sizeof(promhttp_body_t));
+  atomic_init(&self->refs, 1);
+  self->len = 0;
+  self->allocated = 0;
+  self->data = NULL;
+  return self;
+}
+
+void promhttp_body_release(void *body) {
+  promhttp_body_t *self = (promhttp_body_t *)body;
+  if (self == NULL) return;
+  if (atomic_fetch_sub(&self->refs, 1) != 1) return;
+  prom_free(self->data);
+  self->data = NULL;
+  prom_free(self);
+  self = NULL;
+}
+
+promhttp_compression_cache_t *promhttp_compression_cache_new(int level) {
+  promhttp_compression_cache_t *self =
+      (promhttp_compression_cache_t *)prom_malloc(sizeof(promhttp_compression_cache_t));
+  self->compressor = promhttp_compressor_new(level);
+  if (self->compressor == NULL) {
+    prom_free(self);
+    return NULL;
+  }
+  if (pthread_mutex_init(&self->lock, NULL)) {
+    promhttp_compressor_destroy(self->compressor);
+    prom_free(self);
+    return NULL;
+  }
+  for (int i = 0; i < PROMHTTP_COMPRESSION_CACHE_SIZE; i++) {
+    promhttp_compression_entry_t *entry = &self->entries[i];
+    entry->registry = NULL;
+    entry->format = PROM_COLLECTOR_REGISTRY_FORMAT_TEXT;
+    entry->scope = NULL;
+    entry->text = NULL;
+    entry->text_len = 0;
+    entry->text_allocated = 0;
+    for (int j = 0; j < PROMHTTP_ENCODING_COUNT; j++) entry->body[j] = NULL;
+    entry->used = 0;
+  }
+  self->clock = 0;
+  self->scope = NULL;
+  self->scope_allocated = 0;
+  return self;
+}
+
+// Forgets the page of entry, keeping its text buffer for the next one
+static void promhttp_compression_entry_clear(promhttp_compression_entry_t *entry) {
+  // Responses still in flight keep their bodies alive
+  for (int i = 0; i < PROMHTTP_ENCODING_COUNT; i++) {
+    promhttp_body_release(entry->body[i]);
+    entry->body[i] = NULL;
+  }
+  prom_free(entry->scope);
+  entry->scope = NULL;
+  entry->registry = NULL;
+  entry->text_len = 0;
+}
+
+int promhttp_compression_cache_destroy(promhttp_compression_cache_t *self) {
+  if (self == NULL) return 0;
+  int r = 0;
+  int ret = 0;
+
+  r = promhttp_compressor_destroy(self->compressor);
+  self->compressor = NULL;
+  if (r) ret = r;
+
+  for (int i = 0; i < PROMHTTP_COMPRESSION_CACHE_SIZE; i++) {
+    promhttp_compression_entry_clear(&self->entries[i]);
+    prom_free(self->entries[i].text);
+    self->entries[i].text = NULL;
+  }
+  prom_free(self->scope);
+  self->scope = NULL;
+
+  r = pthread_mutex_destroy(&self->lock);
+  if (r) ret = r;
+
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+/**
+ * @brief Writes the collector name and the selectors into the scope buffer of self, each followed by a newline, which
+ * neither a collector name in a URL path nor a valid selector contains.
+ *
+ * @return The scope, or NULL upon failure
+ */
+static const char *promhttp_compression_cache_scope(promhttp_compression_cache_t *self, const char *collector_name,
+                                                    const char **selectors, size_t selector_count) {
+  if (collector_name == NULL) collector_name = "";
+  size_t len = strlen(collector_name) + 1;
+  for (size_t i = 0; i < selector_count; i++) len += strlen(selectors[i]) + 1;
+
+  if (self->scope_allocated < len + 1) {
+    char *grown = (char *)prom_realloc(self->scope, len + 1);
+    if (grown == NULL) return NULL;
+    self->scope = grown;
+    self->scope_allocated = len + 1;
+  }
+
+  char *p = self->scope;
+  p = stpcpy(p, collector_name);
+  *p++ = '\n';
+  for (size_t i = 0; i < selector_count; i++) {
+    p = stpcpy(p, selectors[i]);
+    *p++ = '\n';
+  }
+  *p = '\0';
+  return self->scope;
+}
+
+// Finds the entry for a key, or takes over an unused or the least recently used one
+static promhttp_compression_entry_t *promhttp_compression_cache_entry(promhttp_compression_cache_t *self,
+                                                                      prom_collector_registry_t *registry,
+                                                                      prom_collector_registry_format_t format,
+                                                                      const char *scope) {
+  promhttp_compression_entry_t *victim = &self->entries[0];
+  for (int i = 0; i < PROMHTTP_COMPRESSION_CACHE_SIZE; i++) {
+    promhttp_compression_entry_t *entry = &self->entries[i];
+    if (entry->scope != NULL && entry->registry == registry && entry->format == format &&
+        strcmp(entry->scope, scope) == 0) {
+      return entry;
+    }
+    if (victim->scope != NULL && (entry->scope == NULL || entry->used < victim->used)) victim = entry;
+  }
+
+  char *copy = prom_strdup(scope);
+  if (copy == NULL) return NULL;
+  promhttp_compression_entry_clear(victim);
+  victim->registry = registry;
+  victim->format = format;
+  victim->scope = copy;
+  return victim;
+}
+
+int promhttp_compression_cache_get(promhttp_compression_cache_t *self, prom_collector_registry_t *registry,
+                                   prom_collector_registry_format_t format, const char *collector_name,
+                                   const char **selectors, size_t selector_count, promhttp_encoding_t encoding,
+                                   const char *text, size_t text_len, promhttp_body_t **body) {
+  if (self == NULL) return 1;
+  if (encoding != PROMHTTP_ENCODING_GZIP && encoding != PROMHTTP_ENCODING_DEFLATE) return 1;
+
+  int r = pthread_mutex_lock(&self->lock);
+  if (r) return r;
+
+  const char *scope = promhttp_compression_cache_scope(self, collector_name, selectors, selector_count);
+  promhttp_compression_entry_t *entry =
+      scope == NULL ? NULL : promhttp_compression_cache_entry(self, registry, format, scope);
+  if (entry == NULL) {
+    pthread_mutex_unlock(&self->lock);
+    return 1;
+  }
+  entry->used = ++self->clock;
+
+  bool same_text = entry->text_len == text_len && (text_len == 0 || memcmp(entry->text, text, text_len) == 0);
+
+  promhttp_body_t *cached = entry->body[encoding];
+  if (!same_text || cached == NULL || cached->len == 0) {
+    // A body still referenced by a response must not be overwritten
+    if (cached != NULL && atomic_load(&cached->refs) > 1) {
+      promhttp_body_release(cached);
+      cached = NULL;
+    }
+    if (cached == NULL) {
+      cached = promhttp_body_new();
+      entry->body[encoding] = cached;
+    }
+    r = promhttp_compressor_compress(self->compressor, encoding, text, text_len, &cached->data, &cached->len,
+                                     &cached->allocated);
+    if (r) {
+      // The body buffer may hold a partial stream now, so forget it
+      cached->len = 0;
+      pthread_mutex_unlock(&self->lock);
+      return r;
+    }
+    if (!same_text) {
+      // Bodies compressed from the previous page are stale
+      for (int i = 0; i < PROMHTTP_ENCODING_COUNT; i++) {
+        if (i == encoding || entry->body[i] == NULL) continue;
+        promhttp_body_release(entry->body[i]);
+        entry->body[i] = NULL;
+      }
+      if (entry->text_allocated < text_len) {
+        char *grown = (char *)prom_realloc(entry->text, text_len);
+        if (grown == NULL) {
+          // Without a copy of text the body cannot be matched again, so it is served but not kept
+          entry->body[encoding] = NULL;
+          entry->text_len = 0;
+          *body = cached;
+          pthread_mutex_unlock(&self->lock);
+          return 0;
+        }
+        entry->text = grown;
+        entry->text_allocated = text_len;
+      }
+      memcpy(entry->text, text, text_len);
+      entry->text_len = text_len;
+    }
+  }
+
+  atomic_fetch_add(&cached->refs, 1);
+  *body = cached;
+
+  pthread_mutex_unlock(&self->lock);
+  return 0;
+}
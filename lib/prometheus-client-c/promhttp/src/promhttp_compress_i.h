@@ -0,0 +1,85 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://www.rfc-editor.org/rfc/rfc9110#name-accept-encoding
+
+#ifndef PROMHTTP_COMPRESS_I_H
+#define PROMHTTP_COMPRESS_I_H
+
+#include "promhttp_compress_t.h"
+
+/**
+ * @brief API PRIVATE Picks the content coding for an Accept-Encoding header value.
+ *
+ * Codings with q=0 are refused; among the rest the highest q-value wins and gzip is preferred over deflate on ties.
+ * A NULL or empty header yields PROMHTTP_ENCODING_IDENTITY.
+ */
+promhttp_encoding_t promhttp_encoding_negotiate(const char *accept_encoding);
+
+/**
+ * @brief API PRIVATE promhttp_compressor constructor
+ * @param level zlib compression level, 1 through 9
+ */
+promhttp_compressor_t *promhttp_compressor_new(int level);
+
+/**
+ * @brief API PRIVATE promhttp_compressor destructor
+ */
+int promhttp_compressor_destroy(promhttp_compressor_t *self);
+
+/**
+ * @brief API PRIVATE Compresses in into *out, growing *out and *out_allocated as needed.
+ * @param encoding PROMHTTP_ENCODING_GZIP or PROMHTTP_ENCODING_DEFLATE
+ * @return A non-zero integer value upon failure
+ */
+int promhttp_compressor_compress(promhttp_compressor_t *self, promhttp_encoding_t encoding, const char *in,
+                                 size_t in_len, unsigned char **out, size_t *out_len, size_t *out_allocated);
+
+/**
+ * @brief API PRIVATE promhttp_compression_cache constructor
+ */
+promhttp_compression_cache_t *promhttp_compression_cache_new(int level);
+
+/**
+ * @brief API PRIVATE promhttp_compression_cache destructor
+ */
+int promhttp_compression_cache_destroy(promhttp_compression_cache_t *self);
+
+/**
+ * @brief API PRIVATE Drops a reference to body, freeing it with the last one. Matches MHD_ContentReaderFreeCallback so
+ * it can be handed to libmicrohttpd directly.
+ */
+void promhttp_body_release(void *body);
+
+/**
+ * @brief API PRIVATE Returns the compressed form of text.
+ *
+ * Pages are cached per registry, format, collector and selection. If text is identical to the page last cached for
+ * that key and a body for the requested coding exists, that body is reused; otherwise text is copied, compressed and
+ * cached. text is not retained, so a page leased from registry is returned by the caller as soon as this function
+ * returns. On success *body holds a reference the caller MUST drop with promhttp_body_release.
+ *
+ * @param collector_name The collector text was rendered from, or NULL for every collector
+ * @param selectors The selectors text was rendered with, normalized with prom_collector_registry_normalize_selectors
+ * @param selector_count The number of selectors
+ * @return A non-zero integer value upon failure
+ */
+int promhttp_compression_cache_get(promhttp_compression_cache_t *self, prom_collector_registry_t *registry,
+                                   prom_collector_registry_format_t format, const char *collector_name,
+                                   const char **selectors, size_t selector_count, promhttp_encoding_t encoding,
+                                   const char *text, size_t text_len, promhttp_body_t **body);
+
+#endif  // PROMHTTP_COMPRESS_I_H
@@ -0,0 +1,97 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROMHTTP_COMPRESS_T_H
+#define PROMHTTP_COMPRESS_T_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#include "prom_collector_registry.h"
+
+/**
+ * @brief API PRIVATE Content codings understood by promhttp
+ */
+typedef enum promhttp_encoding {
+  PROMHTTP_ENCODING_IDENTITY = 0,
+  PROMHTTP_ENCODING_GZIP = 1,
+  PROMHTTP_ENCODING_DEFLATE = 2,
+  PROMHTTP_ENCODING_COUNT = 3
+} promhttp_encoding_t;
+
+/**
+ * @brief API PRIVATE Maps promhttp_encoding_t constants to Content-Encoding header values
+ */
+extern const char *promhttp_encoding_map[PROMHTTP_ENCODING_COUNT];
+
+/**
+ * @brief API PRIVATE Holds one zlib stream per coding. The streams are reset rather than re-initialized between
+ * scrapes so the deflate state (~256KB) is only allocated once.
+ */
+typedef struct promhttp_compressor {
+  z_stream streams[PROMHTTP_ENCODING_COUNT]; /**< deflate streams indexed by promhttp_encoding_t */
+  bool ready[PROMHTTP_ENCODING_COUNT];       /**< true once the stream at the same index is initialized */
+  int level;                                 /**< zlib compression level, 1 through 9 */
+} promhttp_compressor_t;
+
+/**
+ * @brief API PRIVATE A compressed body shared between the cache and the responses serving it. The cache reuses data
+ * in place only while it holds the sole reference; otherwise it starts a new body and drops its reference.
+ */
+typedef struct promhttp_body {
+  atomic_int refs;          /**< the cache and every in-flight response each hold one reference */
+  size_t len;               /**< length of data in bytes; 0 when not yet compressed */
+  size_t allocated;         /**< bytes allocated for data */
+  unsigned char *data;      /**< the compressed stream */
+} promhttp_body_t;
+
+// The number of distinct pages a compression cache keeps, e.g. the full page in every format plus a few selections
+#define PROMHTTP_COMPRESSION_CACHE_SIZE 8
+
+/**
+ * @brief API PRIVATE A copy of one rendered exposition page alongside its compressed bodies, keyed by what the page
+ * was rendered from.
+ */
+typedef struct promhttp_compression_entry {
+  prom_collector_registry_t *registry;              /**< registry text was rendered by */
+  prom_collector_registry_format_t format;          /**< format text was rendered in */
+  char *scope;                                      /**< collector and normalized selectors; NULL if unused */
+  char *text;                                       /**< copy of the last page rendered for this key */
+  size_t text_len;                                  /**< length of text in bytes */
+  size_t text_allocated;                            /**< bytes allocated for text */
+  promhttp_body_t *body[PROMHTTP_ENCODING_COUNT];   /**< compressed bodies of text, indexed by coding */
+  unsigned long used;                               /**< cache clock at the last lookup, for LRU eviction */
+} promhttp_compression_entry_t;
+
+/**
+ * @brief API PRIVATE Caches the last rendered page of each format, collector and selection alongside its compressed
+ * bodies so an identical page is never compressed twice, even when scrapes of different pages interleave. The least
+ * recently used entry makes way for a new key. The cache never holds a page leased from the registry, so the
+ * registry's formatter pool is left to the scrapes in flight.
+ */
+typedef struct promhttp_compression_cache {
+  pthread_mutex_t lock;                             /**< guards every member below */
+  promhttp_compressor_t *compressor;                /**< compressor shared by all entries */
+  promhttp_compression_entry_t entries[PROMHTTP_COMPRESSION_CACHE_SIZE]; /**< cached pages */
+  unsigned long clock;                              /**< advanced on every lookup */
+  char *scope;                                      /**< scratch buffer the scope of a lookup is built in */
+  size_t scope_allocated;                           /**< bytes allocated for scope */
+} promhttp_compression_cache_t;
+
+#endif  // PROMHTTP_COMPRESS_T_H
@@ -0,0 +1,103 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "promhttp_format_i.h"
+
+const char *promhttp_format_content_type[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT] = {
+    "text/plain; version=0.0.4; charset=utf-8",
+    "application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; encoding=delimited",
+    "application/openmetrics-text; version=1.0.0; charset=utf-8"};
+
+static bool promhttp_format_token_is(const char *token, size_t len, const char *name) {
+  return strlen(name) == len && strncasecmp(token, name, len) == 0;
+}
+
+prom_collector_registry_format_t promhttp_format_negotiate(const char *accept) {
+  if (accept == NULL) return PROM_COLLECTOR_REGISTRY_FORMAT_TEXT;
+
+  // A q-value of -1 means the format was not offered
+  double q_values[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT] = {-1.0, -1.0, -1.0};
+
+  const char *p = accept;
+  while (*p != '\0') {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == '\0') break;
+
+    const char *media_range = p;
+    while (*p != '\0' && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') p++;
+    size_t media_range_len = p - media_range;
+
+    // Parse parameters. The protobuf format is only served for the MetricFamily message in delimited encoding, and
+    // OpenMetrics only in version 1.0.0.
+    double q = 1.0;
+    bool delimited = false;
+    bool metric_family = true;
+    bool openmetrics_1 = true;
+    while (*p != '\0' && *p != ',') {
+      if (*p != ';') {
+        p++;
+        continue;
+      }
+      p++;
+      while (*p == ' ' || *p == '\t') p++;
+      const char *name = p;
+      while (*p != '\0' && *p != '=' && *p != ';' && *p != ',') p++;
+      size_t name_len = p - name;
+      if (*p != '=') continue;
+      p++;
+      const char *value = p;
+      while (*p != '\0' && *p != ';' && *p != ',' && *p != ' ' && *p != '\t') p++;
+      size_t value_len = p - value;
+
+      if (promhttp_format_token_is(name, name_len, "q")) {
+        char *end = NULL;
+        q = strtod(value, &end);
+        if (end == value) q = 0.0;
+      } else if (promhttp_format_token_is(name, name_len, "encoding")) {
+        delimited = promhttp_format_token_is(value, value_len, "delimited");
+      } else if (promhttp_format_token_is(name, name_len, "proto")) {
+        metric_family = promhttp_format_token_is(value, value_len, "io.prometheus.client.MetricFamily");
+      } else if (promhttp_format_token_is(name, name_len, "version")) {
+        openmetrics_1 = promhttp_format_token_is(value, value_len, "1.0.0");
+      }
+    }
+
+    prom_collector_registry_format_t format = PROM_COLLECTOR_REGISTRY_FORMAT_COUNT;
+    if (promhttp_format_token_is(media_range, media_range_len, "application/vnd.google.protobuf")) {
+      if (delimited && metric_family) format = PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF;
+    } else if (promhttp_format_token_is(media_range, media_range_len, "application/openmetrics-text")) {
+      if (openmetrics_1) format = PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS;
+    } else if (promhttp_format_token_is(media_range, media_range_len, "text/plain") ||
+               promhttp_format_token_is(media_range, media_range_len, "text/*") ||
+               promhttp_format_token_is(media_range, media_range_len, "*/*")) {
+      format = PROM_COLLECTOR_REGISTRY_FORMAT_TEXT;
+    }
+    if (format != PROM_COLLECTOR_REGISTRY_FORMAT_COUNT && q > q_values[format]) q_values[format] = q;
+  }
+
+  // Formats are listed from most to least conservative, so the earlier one wins a tie
+  prom_collector_registry_format_t best = PROM_COLLECTOR_REGISTRY_FORMAT_TEXT;
+  for (int format = 0; format < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; format++) {
+    if (q_values[format] > 0 && q_values[format] > q_values[best]) best = format;
+  }
+  return best;
+}
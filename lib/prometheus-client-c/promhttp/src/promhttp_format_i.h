@@ -0,0 +1,38 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Reference: https://prometheus.io/docs/instrumenting/exposition_formats/
+
+#ifndef PROMHTTP_FORMAT_I_H
+#define PROMHTTP_FORMAT_I_H
+
+#include "prom_collector_registry.h"
+
+/**
+ * @brief API PRIVATE Maps prom_collector_registry_format_t constants to Content-Type header values
+ */
+extern const char *promhttp_format_content_type[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT];
+
+/**
+ * @brief API PRIVATE Picks the exposition format for an Accept header value.
+ *
+ * The media range with the highest q-value among the formats promhttp can render wins; the text format wins ties and
+ * is also returned when the header is absent or names nothing renderable.
+ */
+prom_collector_registry_format_t promhttp_format_negotiate(const char *accept);
+
+#endif  // PROMHTTP_FORMAT_I_H
@@ -0,0 +1,281 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#include "prom.h"
+#include "prom_collector_registry_t.h"
+#include "prom_test_helpers.h"
+#include "promhttp_compress_i.h"
+
+#define PROMHTTP_COMPRESS_TEST_SCRAPES 200
+
+static prom_gauge_t *promhttp_compress_test_gauge = NULL;
+
+static prom_collector_registry_t *promhttp_compress_test_registry_new(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  promhttp_compress_test_gauge = prom_gauge_new("temperature", "Temperature.", 1, (const char *[]){"room"});
+  prom_collector_add_metric(collector, promhttp_compress_test_gauge);
+  prom_collector_registry_register_collector(registry, collector);
+  prom_gauge_set(promhttp_compress_test_gauge, 21.5, (const char *[]){"kitchen"});
+  return registry;
+}
+
+// Inflates a gzip body into out, returning its length or -1
+static long promhttp_compress_test_inflate(promhttp_body_t *body, char *out, size_t out_len) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 16) != Z_OK) return -1;
+  stream.next_in = body->data;
+  stream.avail_in = (uInt)body->len;
+  stream.next_out = (Bytef *)out;
+  stream.avail_out = (uInt)out_len;
+  int r = inflate(&stream, Z_FINISH);
+  long len = (long)stream.total_out;
+  inflateEnd(&stream);
+  return r == Z_STREAM_END ? len : -1;
+}
+
+static void test_promhttp_encoding_negotiate(void) {
+  const struct {
+    const char *accept_encoding;
+    promhttp_encoding_t expected;
+  } cases[] = {
+      {NULL, PROMHTTP_ENCODING_IDENTITY},
+      {"", PROMHTTP_ENCODING_IDENTITY},
+      {"identity", PROMHTTP_ENCODING_IDENTITY},
+      {"br", PROMHTTP_ENCODING_IDENTITY},
+      {"gzip", PROMHTTP_ENCODING_GZIP},
+      {"GZip", PROMHTTP_ENCODING_GZIP},
+      {"x-gzip", PROMHTTP_ENCODING_GZIP},
+      {"deflate", PROMHTTP_ENCODING_DEFLATE},
+      // gzip wins ties
+      {"deflate, gzip", PROMHTTP_ENCODING_GZIP},
+      {"gzip;q=0.5, deflate;q=0.5", PROMHTTP_ENCODING_GZIP},
+      // Otherwise the highest q-value wins, with or without whitespace around parameters
+      {"gzip;q=0.5, deflate;q=0.6", PROMHTTP_ENCODING_DEFLATE},
+      {"gzip ; q=0.5 , deflate ; Q=0.6", PROMHTTP_ENCODING_DEFLATE},
+      {"br;q=1.0, gzip;q=0.8", PROMHTTP_ENCODING_GZIP},
+      {"deflate;q=0.001", PROMHTTP_ENCODING_DEFLATE},
+      // q=0 and unparsable q-values refuse a coding
+      {"gzip;q=0", PROMHTTP_ENCODING_IDENTITY},
+      {"gzip;q=0.0, deflate", PROMHTTP_ENCODING_DEFLATE},
+      {"gzip;q=abc", PROMHTTP_ENCODING_IDENTITY},
+      // * stands for the codings not mentioned
+      {"*", PROMHTTP_ENCODING_GZIP},
+      {"*;q=0", PROMHTTP_ENCODING_IDENTITY},
+      {"*, gzip;q=0", PROMHTTP_ENCODING_DEFLATE},
+      {"deflate;q=0.9, *;q=0.1", PROMHTTP_ENCODING_DEFLATE},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    promhttp_encoding_t encoding = promhttp_encoding_negotiate(cases[i].accept_encoding);
+    if (encoding != cases[i].expected) fprintf(stderr, "Accept-Encoding: %s\n", cases[i].accept_encoding);
+    TEST_ASSERT_EQUAL_INT(cases[i].expected, encoding);
+  }
+}
+
+// Looks up the gzip body of a text page
+static int promhttp_compress_test_get(promhttp_compression_cache_t *cache, prom_collector_registry_t *registry,
+                                      const char *collector_name, const char **selectors, size_t selector_count,
+                                      const char *page, size_t len, promhttp_body_t **body) {
+  return promhttp_compression_cache_get(cache, registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, collector_name,
+                                        selectors, selector_count, PROMHTTP_ENCODING_GZIP, page, len, body);
+}
+
+static void test_promhttp_compression_cache_reuse(void) {
+  prom_collector_registry_t *registry = promhttp_compress_test_registry_new();
+  promhttp_compression_cache_t *cache = promhttp_compression_cache_new(6);
+  TEST_ASSERT_NOT_NULL(cache);
+
+  size_t len = 0;
+  const char *page = prom_collector_registry_bridge_lease_format(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, &len);
+  TEST_ASSERT_NOT_NULL(page);
+  promhttp_body_t *first = NULL;
+  TEST_ASSERT_EQUAL_INT(0, promhttp_compress_test_get(cache, registry, NULL, NULL, 0, page, len, &first));
+
+  // The cache keeps a copy, so the page goes back to the pool and is overwritten by the next render
+  char expected[256];
+  TEST_ASSERT_TRUE(len < sizeof(expected));
+  memcpy(expected, page, len);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+  TEST_ASSERT_EQUAL_INT(0, registry->leased_count);
+
+  // An unchanged page is served the body compressed for the first scrape
+  page = prom_collector_registry_bridge_lease_format(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, &len);
+  promhttp_body_t *second = NULL;
+  TEST_ASSERT_EQUAL_INT(0, promhttp_compress_test_get(cache, registry, NULL, NULL, 0, page, len, &second));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+  TEST_ASSERT_TRUE(first == second);
+
+  char inflated[256];
+  TEST_ASSERT_EQUAL_INT(len, promhttp_compress_test_inflate(second, inflated, sizeof(inflated)));
+  TEST_ASSERT_TRUE(memcmp(expected, inflated, len) == 0);
+  promhttp_body_release(first);
+  promhttp_body_release(second);
+
+  // A changed page is compressed again
+  prom_gauge_set(promhttp_compress_test_gauge, 22.5, (const char *[]){"kitchen"});
+  page = prom_collector_registry_bridge_lease_format(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, &len);
+  promhttp_body_t *third = NULL;
+  TEST_ASSERT_EQUAL_INT(0, promhttp_compress_test_get(cache, registry, NULL, NULL, 0, page, len, &third));
+  TEST_ASSERT_EQUAL_INT(len, promhttp_compress_test_inflate(third, inflated, sizeof(inflated)));
+  TEST_ASSERT_TRUE(memcmp(page, inflated, len) == 0);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_bridge_return(registry, page));
+  promhttp_body_release(third);
+
+  TEST_ASSERT_EQUAL_INT(0, promhttp_compression_cache_destroy(cache));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+// Compresses the page of a selection of registry, returning the body or NULL
+static promhttp_body_t *promhttp_compress_test_select(promhttp_compression_cache_t *cache,
+                                                      prom_collector_registry_t *registry, const char *collector_name,
+                                                      const char **selectors, size_t selector_count) {
+  size_t len = 0;
+  const char *page = prom_collector_registry_bridge_lease_collector(registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT,
+                                                                    collector_name, selectors, selector_count, &len);
+  if (page == NULL) return NULL;
+  promhttp_body_t *body = NULL;
+  selector_count = prom_collector_registry_normalize_selectors(selectors, selector_count);
+  int r = promhttp_compress_test_get(cache, registry, collector_name, selectors, selector_count, page, len, &body);
+  prom_collector_registry_bridge_return(registry, page);
+  return r ? NULL : body;
+}
+
+static void test_promhttp_compression_cache_keys(void) {
+  prom_collector_registry_t *registry = promhttp_compress_test_registry_new();
+  promhttp_compression_cache_t *cache = promhttp_compression_cache_new(6);
+  TEST_ASSERT_NOT_NULL(cache);
+
+  // Scrapes of the full page and of a selection take turns without evicting each other
+  promhttp_body_t *full = promhttp_compress_test_select(cache, registry, NULL, NULL, 0);
+  promhttp_body_t *selected = promhttp_compress_test_select(cache, registry, NULL, (const char *[]){"temp*"}, 1);
+  promhttp_body_t *collector = promhttp_compress_test_select(cache, registry, "test", NULL, 0);
+  TEST_ASSERT_NOT_NULL(full);
+  TEST_ASSERT_NOT_NULL(selected);
+  TEST_ASSERT_NOT_NULL(collector);
+  TEST_ASSERT_TRUE(full != selected && full != collector && selected != collector);
+
+  promhttp_body_t *again = promhttp_compress_test_select(cache, registry, NULL, NULL, 0);
+  TEST_ASSERT_TRUE(again == full);
+  promhttp_body_release(again);
+
+  // Selections that normalize alike share an entry
+  again = promhttp_compress_test_select(cache, registry, NULL, (const char *[]){"temperature", "temp*", "temp*"}, 3);
+  TEST_ASSERT_TRUE(again == selected);
+  promhttp_body_release(again);
+  again = promhttp_compress_test_select(cache, registry, "test", NULL, 0);
+  TEST_ASSERT_TRUE(again == collector);
+  promhttp_body_release(again);
+
+  // The cache is bounded: as many other selections evict the least recently used full page
+  char names[PROMHTTP_COMPRESSION_CACHE_SIZE][32];
+  for (int i = 0; i < PROMHTTP_COMPRESSION_CACHE_SIZE; i++) {
+    snprintf(names[i], sizeof(names[i]), "temperature_%d*", i);
+    promhttp_body_t *body = promhttp_compress_test_select(cache, registry, NULL, (const char *[]){names[i]}, 1);
+    TEST_ASSERT_NOT_NULL(body);
+    promhttp_body_release(body);
+  }
+  int used = 0;
+  for (int i = 0; i < PROMHTTP_COMPRESSION_CACHE_SIZE; i++) used += cache->entries[i].scope != NULL;
+  TEST_ASSERT_EQUAL_INT(PROMHTTP_COMPRESSION_CACHE_SIZE, used);
+  again = promhttp_compress_test_select(cache, registry, NULL, NULL, 0);
+  TEST_ASSERT_TRUE(again != full);
+  promhttp_body_release(again);
+
+  promhttp_body_release(full);
+  promhttp_body_release(selected);
+  promhttp_body_release(collector);
+  TEST_ASSERT_EQUAL_INT(0, promhttp_compression_cache_destroy(cache));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+typedef struct promhttp_compress_test_scraper {
+  prom_collector_registry_t *registry;
+  promhttp_compression_cache_t *cache;
+  atomic_int *copies;
+  atomic_int *failures;
+} promhttp_compress_test_scraper_t;
+
+// Scrapes like promhttp does for a gzip request, counting pages the registry had to copy because its pool ran dry
+static void *promhttp_compress_test_scrape(void *data) {
+  promhttp_compress_test_scraper_t *self = (promhttp_compress_test_scraper_t *)data;
+  for (int i = 0; i < PROMHTTP_COMPRESS_TEST_SCRAPES; i++) {
+    if (i % 16 == 0) prom_gauge_set(promhttp_compress_test_gauge, i, (const char *[]){"kitchen"});
+
+    size_t len = 0;
+    const char *page =
+        prom_collector_registry_bridge_lease_format(self->registry, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT, &len);
+    if (page == NULL) {
+      atomic_fetch_add(self->failures, 1);
+      continue;
+    }
+
+    bool pooled = false;
+    pthread_mutex_lock(self->registry->pool_lock);
+    for (size_t j = 0; j < self->registry->leased_count; j++) {
+      if (self->registry->leased_pages[j] == page) pooled = true;
+    }
+    pthread_mutex_unlock(self->registry->pool_lock);
+    if (!pooled) atomic_fetch_add(self->copies, 1);
+
+    promhttp_body_t *body = NULL;
+    if (promhttp_compress_test_get(self->cache, self->registry, NULL, NULL, 0, page, len, &body)) {
+      atomic_fetch_add(self->failures, 1);
+    } else {
+      promhttp_body_release(body);
+    }
+    prom_collector_registry_bridge_return(self->registry, page);
+  }
+  return NULL;
+}
+
+static void test_promhttp_compression_cache_concurrent(void) {
+  prom_collector_registry_t *registry = promhttp_compress_test_registry_new();
+  promhttp_compression_cache_t *cache = promhttp_compression_cache_new(1);
+  TEST_ASSERT_NOT_NULL(cache);
+  atomic_int copies = 0;
+  atomic_int failures = 0;
+
+  // As many scrapes in flight as the registry pools pages: the cache must not keep one of them to itself
+  pthread_t threads[PROM_COLLECTOR_REGISTRY_POOL_SIZE];
+  promhttp_compress_test_scraper_t scraper = {
+      .registry = registry, .cache = cache, .copies = &copies, .failures = &failures};
+  for (int i = 0; i < PROM_COLLECTOR_REGISTRY_POOL_SIZE; i++) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, &promhttp_compress_test_scrape, &scraper));
+  }
+  for (int i = 0; i < PROM_COLLECTOR_REGISTRY_POOL_SIZE; i++) pthread_join(threads[i], NULL);
+
+  TEST_ASSERT_EQUAL_INT(0, atomic_load(&failures));
+  TEST_ASSERT_EQUAL_INT(0, atomic_load(&copies));
+  TEST_ASSERT_EQUAL_INT(0, registry->leased_count);
+
+  TEST_ASSERT_EQUAL_INT(0, promhttp_compression_cache_destroy(cache));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_destroy(registry));
+}
+
+int main(void) {
+  RUN_TEST(test_promhttp_encoding_negotiate);
+  RUN_TEST(test_promhttp_compression_cache_reuse);
+  RUN_TEST(test_promhttp_compression_cache_keys);
+  RUN_TEST(test_promhttp_compression_cache_concurrent);
+  return PROM_TEST_RESULT();
+}
@@ -0,0 +1,75 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+
+#include "prom_test_helpers.h"
+#include "promhttp_format_i.h"
+
+static void test_promhttp_format_negotiate(void) {
+  const struct {
+    const char *accept;
+    prom_collector_registry_format_t expected;
+  } cases[] = {
+      {NULL, PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"text/plain; version=0.0.4", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"*/*", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"application/json", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      // Protobuf is only served as delimited MetricFamily messages
+      {"application/vnd.google.protobuf;proto=io.prometheus.client.MetricFamily;encoding=delimited",
+       PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF},
+      {"application/vnd.google.protobuf;proto=io.prometheus.client.MetricFamily", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"application/vnd.google.protobuf;proto=io.prometheus.client.Metric;encoding=delimited",
+       PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"application/vnd.google.protobuf;proto=io.prometheus.client.MetricFamily;encoding=text",
+       PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      // OpenMetrics is only served in version 1.0.0, which an unversioned media range stands for
+      {"application/openmetrics-text; version=1.0.0", PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS},
+      {"APPLICATION/OPENMETRICS-TEXT; VERSION=1.0.0", PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS},
+      {"application/openmetrics-text", PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS},
+      {"application/openmetrics-text; version=0.0.1", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      // The scrape headers Prometheus sends
+      {"application/openmetrics-text;version=1.0.0,application/openmetrics-text;version=0.0.1;q=0.75,"
+       "text/plain;version=0.0.4;q=0.5,*/*;q=0.1",
+       PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS},
+      {"application/vnd.google.protobuf;proto=io.prometheus.client.MetricFamily;encoding=delimited;q=0.7,"
+       "text/plain;version=0.0.4;q=0.3,*/*;q=0.1",
+       PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF},
+      // The highest q-value wins and the more conservative format wins a tie
+      {"text/plain;q=0.5, application/openmetrics-text;q=0.6", PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS},
+      {"text/plain;q=0.6, application/openmetrics-text;q=0.5", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"application/openmetrics-text, text/plain", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"application/openmetrics-text;version=1.0.0, application/vnd.google.protobuf;"
+       "proto=io.prometheus.client.MetricFamily;encoding=delimited",
+       PROM_COLLECTOR_REGISTRY_FORMAT_PROTOBUF},
+      // q=0 and unparsable q-values refuse a format
+      {"application/openmetrics-text;q=0", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+      {"text/plain;q=0, application/openmetrics-text;q=0.1", PROM_COLLECTOR_REGISTRY_FORMAT_OPENMETRICS},
+      {"application/openmetrics-text;q=abc, text/plain;q=0.1", PROM_COLLECTOR_REGISTRY_FORMAT_TEXT},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    prom_collector_registry_format_t format = promhttp_format_negotiate(cases[i].accept);
+    if (format != cases[i].expected) fprintf(stderr, "Accept: %s\n", cases[i].accept);
+    TEST_ASSERT_EQUAL_INT(cases[i].expected, format);
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_promhttp_format_negotiate);
+  return PROM_TEST_RESULT();
+}
@@ -3,125 +3,293 @@
 /** Mutex para sincronización de hilos */
 pthread_mutex_t lock;
 
-/** Métrica de Prometheus para el uso de CPU */
-static prom_gauge_t* cpu_usage_metric;
+/**
+ * @brief Tabla de las métricas del sistema: identificador, nombre, ayuda y tipo de valor.
+ *
+ * Cada entrada genera su identificador en system_metric_t, su creación en init_metrics y su registro en
+ * register_metrics. Agregar una métrica solo requiere una entrada aquí y asignar su valor en una función update_*.
+ * Las de tipo INT son gauges de enteros de 64 bits (prom_gauge_new_int), las REAL gauges de doubles.
+ */
+#define SYSTEM_METRICS(X)                                                                                              \
+    X(CPU_USAGE, "cpu_usage_percentage", "Porcentaje de uso de CPU", REAL)                                             \
+    X(MEMORY_USAGE, "memory_usage_percentage", "Porcentaje de uso de memoria", REAL)                                   \
+    X(TOTAL_MEMORY, "total_memory", "Memoria total", INT)                                                              \
+    X(FREE_MEMORY, "free_memory", "Memoria disponible", INT)                                                           \
+    X(USED_MEMORY, "used_memory", "Memoria usada", INT)                                                                \
+    X(DISK_READS, "reads_sda", "Lecturas", INT)                                                                        \
+    X(DISK_WRITES, "writes_sda", "Escrituras", INT)                                                                    \
+    X(DISK_TOTAL_TIME, "total_time_sda", "Tiempo total", INT)                                                          \
+    X(NETWORK_RX, "network_rx_bytes", "Bytes recibidos", INT)                                                          \
+    X(NETWORK_TX, "network_tx_bytes", "Bytes enviados", INT)                                                           \
+    X(RUNNING_PROCESSES, "running_processes", "Procesos corriendo", INT)                                               \
+    X(CONTEXT_SWITCHES, "context_switches", "Contextos de switches", INT)
+
+/**
+ * @brief Identificadores de las métricas del sistema, generados a partir de SYSTEM_METRICS.
+ */
+typedef enum
+{
+#define SYSTEM_METRIC_ID(id, name, help, kind) SYSTEM_METRIC_##id,
+    SYSTEM_METRICS(SYSTEM_METRIC_ID)
+#undef SYSTEM_METRIC_ID
+    SYSTEM_METRIC_COUNT /**< Cantidad de métricas del sistema */
+} system_metric_t;
+
+/** Tipos de valor de las métricas del sistema */
+typedef enum
+{
+    SYSTEM_METRIC_REAL, /**< double, expuesto con prom_gauge_new */
+    SYSTEM_METRIC_INT   /**< entero de 64 bits, expuesto con prom_gauge_new_int */
+} system_metric_kind_t;
+
+/** Nombres de las métricas del sistema, indexados por system_metric_t */
+static const char* system_metric_names[SYSTEM_METRIC_COUNT] = {
+#define SYSTEM_METRIC_NAME(id, name, help, kind) name,
+    SYSTEM_METRICS(SYSTEM_METRIC_NAME)
+#undef SYSTEM_METRIC_NAME
+};
+
+/** Textos de ayuda de las métricas del sistema, indexados por system_metric_t */
+static const char* system_metric_helps[SYSTEM_METRIC_COUNT] = {
+#define SYSTEM_METRIC_HELP(id, name, help, kind) help,
+    SYSTEM_METRICS(SYSTEM_METRIC_HELP)
+#undef SYSTEM_METRIC_HELP
+};
+
+/** Tipos de valor de las métricas del sistema, indexados por system_metric_t */
+static const system_metric_kind_t system_metric_kinds[SYSTEM_METRIC_COUNT] = {
+#define SYSTEM_METRIC_KIND(id, name, help, kind) SYSTEM_METRIC_##kind,
+    SYSTEM_METRICS(SYSTEM_METRIC_KIND)
+#undef SYSTEM_METRIC_KIND
+};
+
+/**
+ * @brief Valores de las métricas del sistema como estructura de arreglos indexados por system_metric_t.
+ *
+ * Las funciones update_* solo escriben aquí, con el mutex lock tomado. Los valores se copian a las muestras de
+ * Prometheus en una única pasada sobre el bloque cuando se recolecta el colector "system", es decir, en cada scrape.
+ */
+typedef struct
+{
+    double real[SYSTEM_METRIC_COUNT];     /**< Valores de las métricas REAL */
+    int64_t integer[SYSTEM_METRIC_COUNT]; /**< Valores de las métricas INT */
+    bool present[SYSTEM_METRIC_COUNT];    /**< Si la métrica ya recibió un valor; las demás no exponen muestra */
+} system_values_t;
+
+/** Bloque contiguo con los valores de las métricas del sistema */
+static system_values_t system_values;
+
+/** Gauges de las métricas del sistema, indexados por system_metric_t */
+static prom_gauge_t* system_gauges[SYSTEM_METRIC_COUNT];
 
-/** Métrica de Prometheus para el uso de memoria */
-static prom_gauge_t* memory_usage_metric;
+/** Muestras de system_gauges, resueltas en la primera recolección que las necesita */
+static prom_metric_sample_t* system_samples[SYSTEM_METRIC_COUNT];
 
-/** Metrica de Prometheus para la memoria total */
-static prom_gauge_t* total_memory_metric;
+/** Colector que expone las métricas del sistema a partir de system_values */
+static prom_collector_t* system_collector;
 
-/** Metrica de Prometheus para la memoria disponible */
-static prom_gauge_t* free_memory_metric;
+/** Nombres de las funciones de recolección, usados como valor de la etiqueta collector */
+static const char* collection_names[COLLECTION_COUNT] = {"cpu", "memory", "diskstats", "network", "processes"};
 
-/** Metrica de Prometheus para la memoria usada */
-static prom_gauge_t* used_memory_metric;
+/** Metrica de Prometheus con la duración de la última recolección de cada función update_* */
+static prom_gauge_t* collection_duration_metric;
 
-/** Metrica de Prometheus para las lecturas de disco */
-static prom_gauge_t* reads_gauge;
+/** Histograma de Prometheus con la distribución de las duraciones de cada función update_* */
+static prom_histogram_t* collection_latency_metric;
 
-/** Metrica de Prometheus para las escrituras de disco*/
-static prom_gauge_t* writes_gauge;
+/** Metrica de Prometheus con los errores de recolección de cada función update_* */
+static prom_counter_t* collection_errors_metric;
 
-/** Metrica de Prometheus para el tiempo total de disco activo */
-static prom_gauge_t* total_time_gauge;
+/** Muestras de collection_duration_metric resueltas de antemano para registrar sin bloqueos */
+static prom_metric_sample_t* collection_duration_samples[COLLECTION_COUNT];
 
-/** Metrica de Prometheus transmision de red */
-static prom_gauge_t* network_tx_metric;
+/** Muestras de collection_latency_metric resueltas de antemano para registrar sin bloqueos */
+static prom_metric_sample_histogram_t* collection_latency_samples[COLLECTION_COUNT];
 
-/** Metrica de Prometheus recepcion de red */
-static prom_gauge_t* network_rx_metric;
+/** Muestras de collection_errors_metric resueltas de antemano para registrar sin bloqueos */
+static prom_metric_sample_t* collection_errors_samples[COLLECTION_COUNT];
+
+/**
+ * @brief Devuelve el tiempo monótono actual en segundos.
+ */
+static double now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Asigna el valor de una métrica REAL del sistema. Se debe llamar con el mutex lock tomado.
+ */
+static void set_system_real(system_metric_t metric, double value)
+{
+    system_values.real[metric] = value;
+    system_values.present[metric] = true;
+}
 
-/** Metrica de Prometheus procesos en ejecución */
-static prom_gauge_t* running_processes_metric;
+/**
+ * @brief Asigna el valor de una métrica INT del sistema. Se debe llamar con el mutex lock tomado.
+ */
+static void set_system_int(system_metric_t metric, int64_t value)
+{
+    system_values.integer[metric] = value;
+    system_values.present[metric] = true;
+}
 
-/** Metrica de Prometheus cambios de contexto */
-static prom_gauge_t* context_switches_metric;
+/**
+ * @brief Función de recolección del colector "system".
+ *
+ * Recorre el bloque system_values una sola vez y copia cada valor presente a la muestra de su gauge, de modo que el
+ * scrape expone los valores de la última actualización de cada función update_*.
+ */
+static prom_map_t* collect_system_metrics(prom_collector_t* self)
+{
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < SYSTEM_METRIC_COUNT; i++)
+    {
+        if (!system_values.present[i])
+        {
+            continue;
+        }
+        if (system_samples[i] == NULL)
+        {
+            system_samples[i] = prom_gauge_labels(system_gauges[i], NULL);
+            if (system_samples[i] == NULL)
+            {
+                continue;
+            }
+        }
+        if (system_metric_kinds[i] == SYSTEM_METRIC_INT)
+        {
+            prom_metric_sample_set_int(system_samples[i], system_values.integer[i]);
+        }
+        else
+        {
+            prom_metric_sample_set(system_samples[i], system_values.real[i]);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return prom_collector_metrics(self);
+}
+
+/**
+ * @brief Registra la duración de una recolección y, si falló, cuenta el error.
+ *
+ * Las muestras ya están resueltas y el histograma tiene buckets fijos, así que solo se hacen
+ * operaciones atómicas: no se toma ningún mutex ni se reserva memoria.
+ */
+static void record_collection(collection_t collection, double start, int failed)
+{
+    double elapsed = now_seconds() - start;
+    if (collection_duration_samples[collection] != NULL)
+    {
+        prom_metric_sample_set(collection_duration_samples[collection], elapsed);
+    }
+    if (collection_latency_samples[collection] != NULL)
+    {
+        prom_metric_sample_histogram_observe(collection_latency_samples[collection], elapsed);
+    }
+    if (failed && collection_errors_samples[collection] != NULL)
+    {
+        prom_metric_sample_add(collection_errors_samples[collection], 1.0);
+    }
+}
 
 void update_cpu_gauge()
 {
+    double start = now_seconds();
     double usage = get_cpu_usage();
     if (usage >= 0)
     {
         pthread_mutex_lock(&lock);
-        prom_gauge_set(cpu_usage_metric, usage, NULL);
+        set_system_real(SYSTEM_METRIC_CPU_USAGE, usage);
         pthread_mutex_unlock(&lock);
     }
     else
     {
         fprintf(stderr, "Error al obtener el uso de CPU\n");
     }
+    record_collection(COLLECTION_CPU, start, usage < 0);
 }
 
 void update_memory_gauge()
 {
+    double start = now_seconds();
     unsigned long long total_mem = 0, free_mem = 0, used_mem = 0;
     double usage_mem = get_memory_usage(&total_mem, &free_mem, &used_mem);
     if (usage_mem >= 0)
     {
         pthread_mutex_lock(&lock);
-        prom_gauge_set(memory_usage_metric, usage_mem, NULL);
-        prom_gauge_set(total_memory_metric, total_mem, NULL);
-        prom_gauge_set(free_memory_metric, free_mem, NULL);
-        prom_gauge_set(used_memory_metric, used_mem, NULL);
+        set_system_real(SYSTEM_METRIC_MEMORY_USAGE, usage_mem);
+        set_system_int(SYSTEM_METRIC_TOTAL_MEMORY, total_mem);
+        set_system_int(SYSTEM_METRIC_FREE_MEMORY, free_mem);
+        set_system_int(SYSTEM_METRIC_USED_MEMORY, used_mem);
         pthread_mutex_unlock(&lock);
     }
     else
     {
         fprintf(stderr, "Error al obtener el uso de memoria\n");
     }
+    record_collection(COLLECTION_MEMORY, start, usage_mem < 0);
 }
 
 void update_diskstats_gauge()
 {
+    double start = now_seconds();
     Diskstats diskstats;
     int control_disk = collect_diskstats(&diskstats);
     if (control_disk == 0)
     {
         pthread_mutex_lock(&lock);
-        prom_gauge_set(reads_gauge, diskstats.reads, NULL);
-        prom_gauge_set(writes_gauge, diskstats.writes, NULL);
-        prom_gauge_set(total_time_gauge, diskstats.total_time, NULL);
+        set_system_int(SYSTEM_METRIC_DISK_READS, diskstats.reads);
+        set_system_int(SYSTEM_METRIC_DISK_WRITES, diskstats.writes);
+        set_system_int(SYSTEM_METRIC_DISK_TOTAL_TIME, diskstats.total_time);
         pthread_mutex_unlock(&lock);
     }
     else
     {
         fprintf(stderr, "Error al obtener el uso de disco\n");
     }
+    record_collection(COLLECTION_DISKSTATS, start, control_disk != 0);
 }
 
 void update_network_gauge()
 {
+    double start = now_seconds();
     network_stats_t network_stats;
     int control_net = get_network_traffic(&network_stats);
     if (control_net == 0)
     {
         pthread_mutex_lock(&lock);
-        prom_gauge_set(network_tx_metric, network_stats.tx_bytes, NULL);
-        prom_gauge_set(network_rx_metric, network_stats.rx_bytes, NULL);
+        set_system_int(SYSTEM_METRIC_NETWORK_TX, network_stats.tx_bytes);
+        set_system_int(SYSTEM_METRIC_NETWORK_RX, network_stats.rx_bytes);
         pthread_mutex_unlock(&lock);
     }
     else
     {
         fprintf(stderr, "Error al obtener el uso de red\n");
     }
+    record_collection(COLLECTION_NETWORK, start, control_net != 0);
 }
 void update_running_processes_add_context_gauge()
 {
-    int running_processes = 0, context_switches = 0;
+    double start = now_seconds();
+    int running_processes = 0;
+    unsigned long long context_switches = 0;
     int control = get_running_processes_and_context_switches(&running_processes, &context_switches);
     if (control == 0)
     {
         pthread_mutex_lock(&lock);
-        prom_gauge_set(context_switches_metric, context_switches, NULL);
-        prom_gauge_set(running_processes_metric, running_processes, NULL);
+        set_system_int(SYSTEM_METRIC_CONTEXT_SWITCHES, context_switches);
+        set_system_int(SYSTEM_METRIC_RUNNING_PROCESSES, running_processes);
         pthread_mutex_unlock(&lock);
     }
     else
     {
         fprintf(stderr, "Error al obtener el cambio de contextos\n");
     }
+    record_collection(COLLECTION_PROCESSES, start, control != 0);
 }
 void* expose_metrics(void* arg)
 {
@@ -130,6 +298,10 @@ void* expose_metrics(void* arg)
     // Aseguramos que el manejador HTTP esté adjunto al registro por defecto
     promhttp_set_active_collector_registry(NULL);
 
+    // Los scrapes de texto sin comprimir se envían por partes mientras se renderizan, sin armar la página entera;
+    // los comprimidos siguen usando la caché de compresión
+    promhttp_set_streaming(true);
+
     // Iniciamos el servidor HTTP en el puerto 8000
     struct MHD_Daemon* daemon = promhttp_start_daemon(MHD_USE_SELECT_INTERNALLY, 8000, NULL, NULL);
     if (daemon == NULL)
@@ -165,164 +337,100 @@ void init_metrics()
         return;
     }
 
-    // Creamos la métrica para el uso de CPU
-    cpu_usage_metric = prom_gauge_new("cpu_usage_percentage", "Porcentaje de uso de CPU", 0, NULL);
-    if (cpu_usage_metric == NULL)
+    // Exponemos también cuánto cuestan los scrapes y el renderizado de cada colector
+    if (prom_collector_registry_enable_self_metrics(PROM_COLLECTOR_REGISTRY_DEFAULT) != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de uso de CPU\n");
+        fprintf(stderr, "Error al habilitar las métricas propias de Prometheus\n");
         return;
     }
 
-    // Creamos la métrica para el uso de memoria
-    memory_usage_metric = prom_gauge_new("memory_usage_percentage", "Porcentaje de uso de memoria", 0, NULL);
-    if (memory_usage_metric == NULL)
+    // Creamos los gauges de la tabla SYSTEM_METRICS y el colector que los expone
+    system_collector = prom_collector_new("system");
+    if (system_collector == NULL || prom_collector_set_collect_fn(system_collector, collect_system_metrics) != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de uso de memoria\n");
+        fprintf(stderr, "Error al crear el colector de métricas del sistema\n");
         return;
     }
-
-    // creamos la metrica para la memoria total
-    total_memory_metric = prom_gauge_new("total_memory", "Memoria total", 0, NULL);
-    if (total_memory_metric == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica de la memoria total\n");
+    for (int i = 0; i < SYSTEM_METRIC_COUNT; i++)
+    {
+        if (system_metric_kinds[i] == SYSTEM_METRIC_INT)
+        {
+            system_gauges[i] = prom_gauge_new_int(system_metric_names[i], system_metric_helps[i], 0, NULL);
+        }
+        else
+        {
+            system_gauges[i] = prom_gauge_new(system_metric_names[i], system_metric_helps[i], 0, NULL);
+        }
+        if (system_gauges[i] == NULL)
+        {
+            fprintf(stderr, "Error al crear la métrica %s\n", system_metric_names[i]);
+            return;
+        }
+    }
+
+    // creamos las metricas de duración y errores de recolección
+    const char* collection_keys[] = {"collector"};
+    collection_duration_metric = prom_gauge_new("collection_duration_seconds",
+                                                "Duración de la última recolección", 1, collection_keys);
+    if (collection_duration_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de duración de recolección\n");
         return;
     }
-
-    // creamos la metrica para la memoria disponible
-    free_memory_metric = prom_gauge_new("free_memory", "Memoria disponible", 0, NULL);
-    if (free_memory_metric == NULL)
+    // buckets de 100 µs a 3,3 s, cada uno el doble de ancho que el anterior
+    collection_latency_metric =
+        prom_histogram_new("collection_latency_seconds", "Distribución de la duración de las recolecciones",
+                           prom_histogram_buckets_exponential(0.0001, 2, 16), 1, collection_keys);
+    if (collection_latency_metric == NULL)
     {
-        fprintf(stderr, "Error al crear la metrica de la memoria disponible\n");
+        fprintf(stderr, "Error al crear la metrica de latencia de recolección\n");
         return;
     }
-
-    // creamos la metrica para la memoria usada
-    used_memory_metric = prom_gauge_new("used_memory", "Memoria usada", 0, NULL);
-    if (used_memory_metric == NULL)
+    collection_errors_metric =
+        prom_counter_new("collection_errors_total", "Errores de recolección", 1, collection_keys);
+    if (collection_errors_metric == NULL)
     {
-        fprintf(stderr, "Error al crear la metrica de la memoria usada\n");
+        fprintf(stderr, "Error al crear la metrica de errores de recolección\n");
         return;
     }
-
-    // creamos la metrica para las lecturas
-    reads_gauge = prom_gauge_new("reads_sda", "Lecturas", 0, NULL);
-    if (reads_gauge == NULL)
+    for (int i = 0; i < COLLECTION_COUNT; i++)
     {
-        fprintf(stderr, "Error al crear la metrica de las lecturas\n");
-        return;
-    }
-
-    // creamos la metrica para las escrituras
-    writes_gauge = prom_gauge_new("writes_sda", "Escrituras", 0, NULL);
-    if (writes_gauge == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica de las escrituras\n");
-        return;
-    }
-
-    // creamos la metrica para el tiempo total
-    total_time_gauge = prom_gauge_new("total_time_sda", "Tiempo total", 0, NULL);
-    if (total_time_gauge == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica del tiempo total\n");
-        return;
-    }
-
-    // creamos la metrica para recepcion de datos
-    network_rx_metric = prom_gauge_new("network_rx_bytes", "Bytes recibidos", 0, NULL);
-    if (network_rx_metric == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica de recepción de datos\n");
-        return;
-    }
-
-    // creamos la metrica para envío de datos
-    network_tx_metric = prom_gauge_new("network_tx_bytes", "Bytes enviados", 0, NULL);
-    if (network_tx_metric == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica de envío de datos\n");
-        return;
-    }
-
-    // creamos la metrica para procesos corriendo
-    running_processes_metric = prom_gauge_new("running_processes", "Procesos corriendo", 0, NULL);
-    if (running_processes_metric == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica de procesos corriendo\n");
-        return;
-    }
-    // creamos la metrica para contextos de switches
-    context_switches_metric = prom_gauge_new("context_switches", "Contextos de switches", 0, NULL);
-    if (context_switches_metric == NULL)
-    {
-        fprintf(stderr, "Error al crear la metrica de contextos de switches\n");
-        return;
+        const char* values[] = {collection_names[i]};
+        collection_duration_samples[i] = prom_gauge_labels(collection_duration_metric, values);
+        collection_latency_samples[i] = prom_histogram_labels(collection_latency_metric, values);
+        collection_errors_samples[i] = prom_counter_labels(collection_errors_metric, values);
     }
 
     register_metrics();
 }
 void register_metrics()
 {
-    if (prom_collector_registry_must_register_metric(cpu_usage_metric) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la métrica de uso de CPU\n");
-        return;
-    }
-
-    if (prom_collector_registry_must_register_metric(memory_usage_metric) == NULL)
+    for (int i = 0; i < SYSTEM_METRIC_COUNT; i++)
     {
-        fprintf(stderr, "Error al registrar la métrica de uso de memoria\n");
-        return;
-    }
-    if (prom_collector_registry_must_register_metric(total_memory_metric) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la metrica de la memoria total\n");
-        return;
-    }
-    if (prom_collector_registry_must_register_metric(free_memory_metric) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la metrica de la memoria disponible\n");
-        return;
-    }
-    if (prom_collector_registry_must_register_metric(used_memory_metric) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la metrica de la memoria usada\n");
-        return;
-    }
-    if (prom_collector_registry_must_register_metric(reads_gauge) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la metrica de las lecturas\n");
-        return;
-    }
-    if (prom_collector_registry_must_register_metric(writes_gauge) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la metrica de las escrituras\n");
-        return;
-    }
-    if (prom_collector_registry_must_register_metric(total_time_gauge) == NULL)
-    {
-        fprintf(stderr, "Error al registrar la metrica del tiempo total\n");
-        return;
+        if (prom_collector_add_metric(system_collector, system_gauges[i]) != 0)
+        {
+            fprintf(stderr, "Error al registrar la métrica %s\n", system_metric_names[i]);
+            return;
+        }
     }
-    if (prom_collector_registry_must_register_metric(network_rx_metric) == NULL)
+    if (prom_collector_registry_register_collector(PROM_COLLECTOR_REGISTRY_DEFAULT, system_collector) != 0)
     {
-        fprintf(stderr, "Error al registrar la metrica de recepción de datos\n");
+        fprintf(stderr, "Error al registrar el colector de métricas del sistema\n");
         return;
     }
-    if (prom_collector_registry_must_register_metric(network_tx_metric) == NULL)
+    if (prom_collector_registry_must_register_metric(collection_duration_metric) == NULL)
     {
-        fprintf(stderr, "Error al registrar la metrica de envío de datos\n");
+        fprintf(stderr, "Error al registrar la metrica de duración de recolección\n");
         return;
     }
-    if (prom_collector_registry_must_register_metric(running_processes_metric) == NULL)
+    if (prom_collector_registry_must_register_metric(collection_latency_metric) == NULL)
     {
-        fprintf(stderr, "Error al registrar la metrica de procesos corriendo\n");
+        fprintf(stderr, "Error al registrar la metrica de latencia de recolección\n");
         return;
     }
-    if (prom_collector_registry_must_register_metric(context_switches_metric) == NULL)
+    if (prom_collector_registry_must_register_metric(collection_errors_metric) == NULL)
     {
-        fprintf(stderr, "Error al registrar la metrica de contextos de switches\n");
+        fprintf(stderr, "Error al registrar la metrica de errores de recolección\n");
         return;
     }
 }
@@ -158,7 +158,8 @@ int get_network_traffic(network_stats_t* network_stats)
         // Comprobar si es un dispositivo de red
         if (strncmp(line, "wlp", 3) == 0)
         {
-            sscanf(line, "%*s %lu %*d %*d %*d %*d %*d %*d %*d %lu", &network_stats->rx_bytes, &network_stats->tx_bytes);
+            sscanf(line, "%*s %llu %*d %*d %*d %*d %*d %*d %*d %llu", &network_stats->rx_bytes,
+                   &network_stats->tx_bytes);
             fclose(file);
             return 0;
         }
@@ -168,7 +169,7 @@ int get_network_traffic(network_stats_t* network_stats)
     return -1;
 }
 
-int get_running_processes_and_context_switches(int* running_processes, int* context_switches)
+int get_running_processes_and_context_switches(int* running_processes, unsigned long long* context_switches)
 {
     char buffer[BUFFER_SIZE];
     FILE* file = fopen("/proc/stat", "r");
@@ -179,7 +180,7 @@ int get_running_processes_and_context_switches(int* running_processes, int* cont
     }
     while (fgets(buffer, sizeof(buffer), file) != NULL)
     {
-        if (sscanf(buffer, "ctxt %d", context_switches) == 1)
+        if (sscanf(buffer, "ctxt %llu", context_switches) == 1)
         {
             continue;
         }